@@ -63,7 +63,7 @@ public:
    */
   BucketPrioQueue(); 
 
-  void clear() { buckets.clear(); }
+  void clear() { buckets.clear(); nextPop = buckets.end(); count = 0; }
 
   //! Checks whether the Queue is empty
   bool empty();
@@ -35,25 +35,43 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+
 #ifndef _DYNAMICEDT3D_H_
 #define _DYNAMICEDT3D_H_
 
 #include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <queue>
+#include <vector>
 
 #include "bucketedqueue.h"
 
 //! A DynamicEDT3D object computes and updates a 3D distance map.
+/** The map is stored in blocks of 8x8x8 compact 12 byte cells for locality of the
+ *  neighbor inspection. The closest obstacle of a cell is stored as a 16 bit offset
+ *  relative to the cell, which limits the maximum distance to maxObstacleOffset cells.
+ *
+ *  A dense map allocates all blocks at once in a single array. A sparse map
+ *  allocates blocks only when a cell in them changes, i.e., within the maximum
+ *  distance of obstacles. Cells of unallocated blocks are at the maximum distance.
+ */
 class DynamicEDT3D {
   
 public:
   
+  //! Creates an empty distance map, distances are clamped at sqrt(_maxdist_squared) cells.
+  //! Larger distances than maxObstacleOffset cells cannot be represented, they are reduced to it with an error message.
   DynamicEDT3D(int _maxdist_squared);
   ~DynamicEDT3D();
 
-  //! Initialization with an empty map
-  void initializeEmpty(int _sizeX, int _sizeY, int sizeZ, bool initGridMap=true);
-  //! Initialization with a given binary map (false==free, true==occupied)
+  //! Initialization with an empty map, optionally with sparse storage (see class description)
+  void initializeEmpty(int _sizeX, int _sizeY, int sizeZ, bool initGridMap=true, bool sparse=false);
+  //! Initialization with a given binary map (false==free, true==occupied).
+  //! The map is copied into an internal bitset and _gridMap (allocated with new[] per dimension)
+  //! is deleted before this function returns, so it must not be used afterwards.
+  //! Earlier versions kept _gridMap until the destruction of this object.
   void initializeMap(int _sizeX, int _sizeY, int sizeZ, bool*** _gridMap);
 
   //! add an obstacle at the specified cell coordinate
@@ -63,7 +81,19 @@ public:
   //! remove old dynamic obstacles and add the new ones
   void exchangeObstacles(std::vector<INTPOINT3D> newObstacles);
 
-  //! update distance map to reflect the changes
+  //! Shifts the map by dx, dy, dz cells: the cell formerly at x+dx, y+dy, z+dz is now at x, y, z.
+  //! The map is a circular buffer, only its origin moves. Obstacles leaving the map are removed
+  //! and the distances are updated, the cells entering the map are free. Add their obstacles with
+  //! occupyCell() and call update() afterwards, which also propagates the distances into them.
+  //! The cost depends on the number of cells entering the map, not on the size of the map.
+  void shiftMap(int dx, int dy, int dz, bool updateRealDist=true);
+
+  //! update distance map to reflect the changes.
+  //! The first update after initialization (or after shiftMap() replaced all cells) computes all distances at once
+  //! with an exact, separable EDT that runs in parallel over the lines of the map (with OpenMP). Later updates
+  //! propagate the changes incrementally. Equidistant obstacles are resolved deterministically, independent of
+  //! the number of threads.
+  //! Distances are derived from the squared distances on access, updateRealDist is only kept for compatibility.
   virtual void update(bool updateRealDist=true);
 
   //! returns the obstacle distance at the specified location
@@ -83,16 +113,24 @@ public:
   //! returns the z size of the workspace/map
   unsigned int getSizeZ() const {return sizeZ;}
 
+  //! returns true if the map only allocates blocks near obstacles
+  bool isSparse() const {return sparse;}
+  //! returns the number of allocated blocks of 8x8x8 cells
+  size_t getNumAllocatedBlocks() const {return numAllocatedBlocks;}
+
   typedef enum {invalidObstData = INT_MAX} ObstDataState;
 
+  //! maximum distance (in cells per axis) between a cell and its closest obstacle that can be represented
+  static const int maxObstacleOffset = 32765;
+
   ///distance value returned when requesting distance for a cell outside the map
   static float distanceValue_Error;
   ///distance value returned when requesting distance in cell units for a cell outside the map
   static int distanceInCellsValue_Error;
 
 protected: 
+  //! unpacked state of a single cell, see getCell() and setCell()
   struct dataCell {
-    float dist;
     int obstX;
     int obstY;
     int obstZ;
@@ -105,18 +143,150 @@ protected:
   typedef enum {fwNotQueued=1, fwQueued=2, fwProcessed=3, bwQueued=4, bwProcessed=1} QueueingState;
   
   // methods
-  inline void raiseCell(INTPOINT3D &p, dataCell &c, bool updateRealDist);
-  inline void propagateCell(INTPOINT3D &p, dataCell &c, bool updateRealDist);
-  inline void inspectCellRaise(int &nx, int &ny, int &nz, bool updateRealDist);
-  inline void inspectCellPropagate(int &nx, int &ny, int &nz, dataCell &c, bool updateRealDist);
+  inline void raiseCell(INTPOINT3D &p, dataCell &c);
+  inline void propagateCell(INTPOINT3D &p, dataCell &c);
+  inline void inspectCellRaise(int &nx, int &ny, int &nz);
+  inline void inspectCellPropagate(int &nx, int &ny, int &nz, dataCell &c);
 
   void setObstacle(int x, int y, int z);
   void removeObstacle(int x, int y, int z);
 
+  //! index of the block containing a cell (storage coordinates, see storageCoords())
+  inline size_t blockIndex(int x, int y, int z) const {
+    return ((size_t) (x>>3)*blocksY + (y>>3))*blocksZ + (z>>3);
+  }
+
+  //! index of a cell within its block (storage coordinates)
+  static inline int cellIndex(int x, int y, int z) {
+    return ((x&7)<<6) | ((y&7)<<3) | (z&7);
+  }
+
+  //! converts map coordinates into storage coordinates, the storage is a circular buffer (see shiftMap())
+  inline void storageCoords(int& x, int& y, int& z) const {
+    x += originX; if (x >= sizeX) x -= sizeX;
+    y += originY; if (y >= sizeY) y -= sizeY;
+    z += originZ; if (z >= sizeZ) z -= sizeZ;
+  }
+
+  //! returns the unpacked state of the cell at x, y, z (no bounds checking)
+  inline dataCell getCell(int x, int y, int z) const {
+    const packedCell& pc = getPackedCell(x,y,z);
+    dataCell c;
+    if (pc.flags & obstValidFlag) {
+      c.obstX = x + pc.obstDX;
+      c.obstY = y + pc.obstDY;
+      c.obstZ = z + pc.obstDZ;
+    } else {
+      c.obstX = c.obstY = c.obstZ = invalidObstData;
+    }
+    c.sqdist = pc.sqdist;
+    c.queueing = pc.flags & queueingMask;
+    c.needsRaise = (pc.flags & needsRaiseFlag) != 0;
+    return c;
+  }
+
+  //! stores the state c of the cell at x, y, z (no bounds checking)
+  inline void setCell(int x, int y, int z, const dataCell& c) {
+    int sx = x, sy = y, sz = z;
+    storageCoords(sx, sy, sz);
+    packedCell*& block = blocks[blockIndex(sx,sy,sz)];
+    if (!block) {
+      // unallocated blocks hold the initial state
+      if (c.sqdist == maxDist_squared && c.obstX == invalidObstData && c.queueing == fwNotQueued && !c.needsRaise)
+        return;
+      block = allocateBlock();
+    }
+    packedCell& pc = block[cellIndex(sx,sy,sz)];
+    pc.sqdist = c.sqdist;
+    pc.flags = (unsigned char) (c.queueing | (c.needsRaise ? needsRaiseFlag : 0));
+    if (c.obstX != invalidObstData) {
+      pc.obstDX = (int16_t) (c.obstX - x);
+      pc.obstDY = (int16_t) (c.obstY - y);
+      pc.obstDZ = (int16_t) (c.obstZ - z);
+      pc.flags |= obstValidFlag;
+    }
+  }
+
+  //! obstacle distance in cells at x, y, z (no bounds checking)
+  inline float getCellDistance(int x, int y, int z) const {
+    int sqdist = getPackedCell(x,y,z).sqdist;
+    return sqdist < (int) distanceLUT.size() ? distanceLUT[sqdist] : (float) sqrt((double) sqdist);
+  }
+
+  //! squared obstacle distance in cells at x, y, z (no bounds checking)
+  inline int getCellSQDistance(int x, int y, int z) const {
+    return getPackedCell(x,y,z).sqdist;
+  }
+
+  //! axis-aligned box of cells [min, max)
+  struct cellBox {
+    int min[3];
+    int max[3];
+  };
+
+  //! Disjoint boxes covering the cells that enter (exposed=true, in the shifted
+  //! map) or leave (exposed=false, in the unshifted map) the map when shifting by shift.
+  void getShiftBoxes(const int shift[3], bool exposed, std::vector<cellBox>& boxes) const;
+
 private:
-  void commitAndColorize(bool updateRealDist=true);
+  //! packed cell in the distance map, 12 bytes
+  struct packedCell {
+    int32_t sqdist;
+    int16_t obstDX; ///< offset of the closest obstacle, valid if obstValidFlag is set
+    int16_t obstDY;
+    int16_t obstDZ;
+    unsigned char flags; ///< queueing state (bits 0-2), needsRaise, obstValid
+  };
+
+  enum {queueingMask=0x07, needsRaiseFlag=0x08, obstValidFlag=0x10};
+
+  void commitAndColorize();
+
+  inline bool isOccupied(int x, int y, int z, const dataCell &c) const;
+
+  inline const packedCell& getPackedCell(int x, int y, int z) const {
+    storageCoords(x, y, z);
+    const packedCell* block = blocks[blockIndex(x,y,z)];
+    return block ? block[cellIndex(x,y,z)] : initialCell;
+  }
+
+  packedCell* allocateBlock();
 
-  inline bool isOccupied(int &x, int &y, int &z, dataCell &c);
+  inline size_t gridMapIndex(int x, int y, int z) const {
+    storageCoords(x, y, z);
+    return ((size_t) x*sizeY + y)*sizeZ + z;
+  }
+  inline bool getGridMap(int x, int y, int z) const {
+    size_t i = gridMapIndex(x,y,z);
+    return (gridMap[i>>6] >> (i&63)) & 1;
+  }
+  inline void setGridMap(int x, int y, int z, bool occupied) {
+    size_t i = gridMapIndex(x,y,z);
+    if (occupied) gridMap[i>>6] |= (uint64_t) 1 << (i&63);
+    else gridMap[i>>6] &= ~((uint64_t) 1 << (i&63));
+  }
+
+  void freeData();
+  void resetCell(int x, int y, int z);
+
+  //! returns the cell at x, y, z (map coordinates), NULL if its block is not allocated
+  inline packedCell* getCellPointer(int x, int y, int z) {
+    storageCoords(x, y, z);
+    packedCell* block = blocks[blockIndex(x,y,z)];
+    return block ? block + cellIndex(x,y,z) : NULL;
+  }
+
+  //! computes all distances from the obstacle cells, see update()
+  void exactUpdate();
+  //! one pass of exactUpdate() along axis, the first pass starts from the obstacles, the last one writes the final cell states
+  void exactUpdatePass(int axis, bool first, bool last);
+  //! allocates all blocks of a sparse map within maxDist of obstacles
+  void allocateObstacleBlocks();
+  //! frees the blocks of a sparse map whose cells are all in the initial state
+  void freeInitialBlocks();
+  //! Exact 1D distance transform: site[i] is the index j minimizing (i-j)^2 + g[j] over all j with g[j] >= 0
+  //! (the smallest such j for ties), -1 if there is none. s and t are work arrays of size n.
+  static void lowerEnvelope(const int* g, int n, int* site, int* s, int* t);
 
   // queues
   BucketPrioQueue<INTPOINT3D> open;
@@ -125,6 +295,8 @@ private:
   std::vector<INTPOINT3D> addList;
   std::vector<INTPOINT3D> lastObstacles;
 
+  bool initialUpdatePending; ///< no distances computed since initialization, see update()
+
   // maps
 protected:
   int sizeX;
@@ -134,9 +306,22 @@ protected:
   int sizeYm1;
   int sizeZm1;
 
-  dataCell*** data;
-  bool*** gridMap;
+private:
+  bool sparse;
+  int originX; ///< storage coordinates of the map cell 0,0,0
+  int originY;
+  int originZ;
+  size_t blocksY; ///< number of 8x8x8 blocks in y direction
+  size_t blocksZ; ///< number of 8x8x8 blocks in z direction
+  std::vector<packedCell*> blocks; ///< cells of each block, NULL if not allocated (sparse)
+  size_t numAllocatedBlocks;
+  char* dataMemory; ///< single allocation of all blocks of a dense map, aligned to a cache line
+  packedCell initialCell; ///< state of all cells after initialization
+  std::vector<uint64_t> gridMap; ///< occupancy bitset, x-major
+  std::vector<float> distanceLUT; ///< distance for each squared distance up to maxDist_squared (at most maxDistanceLUTSize entries)
+  static const int maxDistanceLUTSize = 1 << 18;
 
+protected:
   // parameters
   int padding;
   double doubleThreshold;
@@ -148,4 +333,3 @@ protected:
 
 
 #endif
-
@@ -39,6 +39,8 @@
 #define DYNAMICEDTOCTOMAP_H_
 
 #include "dynamicEDT3D.h"
+#include <algorithm>
+#include <climits>
 #include <octomap/OcTree.h>
 #include <octomap/OcTreeStamped.h>
 
@@ -51,9 +53,10 @@ public:
      *
      *  The constructor copies occupancy data but does not yet compute the distance map. You need to call udpate to do this.
      *
-     *  The distance map is maintained in a full three-dimensional array, i.e., there exists a float field in memory for every voxel inside the bounding box given by bbxMin and bbxMax. Consider this when computing distance maps for large octomaps, they will use much more memory than the octomap itself!
+     *  By default, the distance map is maintained in a full three-dimensional array, i.e., there exists a field in memory for every voxel inside the bounding box given by bbxMin and bbxMax. Consider this when computing distance maps for large octomaps, they will use much more memory than the octomap itself!
+     *  With sparse set, memory is only allocated in blocks of 8x8x8 voxels within maxdist of obstacles, all other voxels are at maxdist. This is much more compact for large, mostly free maps (but not with treatUnknownAsOccupied in mostly unknown maps), at the cost of slightly slower updates and queries.
      */
-	DynamicEDTOctomapBase(float maxdist, TREE* _octree, octomap::point3d bbxMin, octomap::point3d bbxMax, bool treatUnknownAsOccupied);
+	DynamicEDTOctomapBase(float maxdist, TREE* _octree, octomap::point3d bbxMin, octomap::point3d bbxMax, bool treatUnknownAsOccupied, bool sparse=false);
 
 	virtual ~DynamicEDTOctomapBase();
 
@@ -61,6 +64,17 @@ public:
 	///If you set updateRealDist to false, computations will be faster (square root will be omitted), but you can only retrieve squared distances
 	virtual void update(bool updateRealDist=true);
 
+	///recomputes the distance map from scratch from the current state of the octomap and discards all pending changes.
+	///After large changes of the map (e.g., loop closures or reloading the map) this is usually faster than update(), since no raise waves need to be propagated.
+	///The result is identical to that of a newly constructed DynamicEDTOctomapBase after update().
+	void rebuild(bool updateRealDist=true);
+
+	///Moves the bounding box of the distance map (keeping its size) to be centered at center, e.g., to follow a robot.
+	///Only the voxels entering the bounding box are initialized from the octomap, and distances are only repaired near the
+	///changed border, so the cost depends on the distance moved rather than on the size of the map. Pending changes are
+	///applied as in update(). Returns false (and leaves the map unchanged) if the bounding box would exceed the octomap's range.
+	bool moveWindow(const octomap::point3d& center, bool updateRealDist=true);
+
 	///retrieves distance and closestObstacle (closestObstacle is to be discarded if distance is maximum distance, the method does not write closestObstacle in this case).
 	///Returns DynamicEDTOctomapBase::distanceValue_Error if point is outside the map.
 	void getDistanceAndClosestObstacle(const octomap::point3d& p, float &distance, octomap::point3d& closestObstacle) const;
@@ -86,6 +100,21 @@ public:
 	//variant of getSquaredDistanceInCells that ommits the check whether p is inside the area of the distance map. Use only if you are certain that p is covered by the distance map and if you need to save the time of the check.
 	int getSquaredDistanceInCells_unsafe(const octomap::point3d& p) const;
 
+	///retrieves the distance at p, trilinearly interpolated between the voxel centers, and its analytic gradient (both in meters).
+	///Returns DynamicEDTOctomapBase::distanceValue_Error and a zero gradient if p is outside the map.
+	float getInterpolatedDistance(const octomap::point3d& p, octomap::point3d& gradient) const;
+
+	///retrieves the distance at p, trilinearly interpolated between the voxel centers.
+	///Returns DynamicEDTOctomapBase::distanceValue_Error if p is outside the map.
+	float getInterpolatedDistance(const octomap::point3d& p) const;
+
+	///batch version of getInterpolatedDistance() for many points (e.g., for trajectory optimization), distances and gradients are resized to the number of points.
+	///The points are processed in chunks whose arithmetic can be vectorized by the compiler. With parallel set, the chunks are distributed over threads (if compiled with OpenMP).
+	void getInterpolatedDistances(const std::vector<octomap::point3d>& points, std::vector<float>& distances, std::vector<octomap::point3d>& gradients, bool parallel=false) const;
+
+	///batch version of getInterpolatedDistance() without gradients, see above
+	void getInterpolatedDistances(const std::vector<octomap::point3d>& points, std::vector<float>& distances, bool parallel=false) const;
+
 	///retrieve maximum distance value
 	float getMaxDist() const {
 	  return maxDist*octree->getResolution();
@@ -99,16 +128,33 @@ public:
 	///Brute force method used for debug purposes. Checks occupancy state consistency between octomap and internal representation.
 	bool checkConsistency() const;
 
+	///returns true if memory is only allocated near obstacles
+	bool isSparse() const {
+	  return DynamicEDT3D::isSparse();
+	}
+
+	///number of allocated blocks of 8x8x8 voxels
+	size_t getNumAllocatedBlocks() const {
+	  return DynamicEDT3D::getNumAllocatedBlocks();
+	}
+
 	///distance value returned when requesting distance for a cell outside the map
 	static float distanceValue_Error;
 	///distance value returned when requesting distance in cell units for a cell outside the map
 	static int distanceInCellsValue_Error;
 
 private:
-	void initializeOcTree(octomap::point3d bbxMin, octomap::point3d bbxMax);
-	void insertMaxDepthLeafAtInitialize(octomap::OcTreeKey key);
+	void initializeOcTree(octomap::point3d bbxMin, octomap::point3d bbxMax, bool sparse);
+	void commitOctreeChanges();
+	void insertObstaclesInBox(const octomap::OcTreeKey& minKey, const octomap::OcTreeKey& maxKey);
+	void insertMaxDepthLeafAtInitialize(octomap::OcTreeKey key, bool isSurrounded);
+	bool isSurroundedByObstacles(const octomap::OcTreeKey& key) const;
 	void updateMaxDepthLeaf(octomap::OcTreeKey& key, bool occupied);
 
+	///interpolates the distances (and gradients, if not NULL) of up to interpolationChunkSize points
+	void interpolateChunk(const octomap::point3d* points, size_t numPoints, float* distances, octomap::point3d* gradients) const;
+	enum {interpolationChunkSize = 64};
+
 	void worldToMap(const octomap::point3d &p, int &x, int &y, int &z) const;
 	void mapToWorld(int x, int y, int z, octomap::point3d &p) const;
 	void mapToWorld(int x, int y, int z, octomap::OcTreeKey &key) const;
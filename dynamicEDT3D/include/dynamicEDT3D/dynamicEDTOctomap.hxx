@@ -42,12 +42,12 @@ template <class TREE>
 int DynamicEDTOctomapBase<TREE>::distanceInCellsValue_Error = -1;
 
 template <class TREE>
-DynamicEDTOctomapBase<TREE>::DynamicEDTOctomapBase(float maxdist, TREE* _octree, octomap::point3d bbxMin, octomap::point3d bbxMax, bool treatUnknownAsOccupied)
+DynamicEDTOctomapBase<TREE>::DynamicEDTOctomapBase(float maxdist, TREE* _octree, octomap::point3d bbxMin, octomap::point3d bbxMax, bool treatUnknownAsOccupied, bool sparse)
 : DynamicEDT3D(((int) (maxdist/_octree->getResolution()+1)*((int) (maxdist/_octree->getResolution()+1)))), octree(_octree), unknownOccupied(treatUnknownAsOccupied)
 {
 	treeDepth = octree->getTreeDepth();
 	treeResolution = octree->getResolution();
-	initializeOcTree(bbxMin, bbxMax);
+	initializeOcTree(bbxMin, bbxMax, sparse);
 	octree->enableChangeDetection(true);
 }
 
@@ -59,11 +59,19 @@ DynamicEDTOctomapBase<TREE>::~DynamicEDTOctomapBase() {
 
 template <class TREE>
 void DynamicEDTOctomapBase<TREE>::update(bool updateRealDist){
+	commitOctreeChanges();
+	DynamicEDT3D::update(updateRealDist);
+}
 
+template <class TREE>
+void DynamicEDTOctomapBase<TREE>::commitOctreeChanges(){
+
+	std::vector<octomap::OcTreeKey> keys;
+	keys.reserve(octree->numChangesDetected());
 	for(octomap::KeyBoolMap::const_iterator it = octree->changedKeysBegin(), end=octree->changedKeysEnd(); it!=end; ++it){
 		//the keys in this list all go down to the lowest level!
 
-		octomap::OcTreeKey key = it->first;
+		const octomap::OcTreeKey& key = it->first;
 
 		//ignore changes outside of bounding box
 		if(key[0] < boundingBoxMinKey[0] || key[1] < boundingBoxMinKey[1] || key[2] < boundingBoxMinKey[2])
@@ -71,20 +79,116 @@ void DynamicEDTOctomapBase<TREE>::update(bool updateRealDist){
 		if(key[0] > boundingBoxMaxKey[0] || key[1] > boundingBoxMaxKey[1] || key[2] > boundingBoxMaxKey[2])
 			continue;
 
-		typename TREE::NodeType* node = octree->search(key);
+		keys.push_back(key);
+	}
+
+	//the tree lookups are done in parallel, the changes are committed in their original order
+	//afterwards, so the result does not depend on the number of threads
+	std::vector<char> occupied(keys.size());
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(guided)
+#endif
+	for(int i=0; i<(int)keys.size(); i++){
+		typename TREE::NodeType* node = octree->search(keys[i]);
 		assert(node);
 		//"node" is not necessarily at lowest level, BUT: the occupancy value of this node
-		//has to be the same as of the node indexed by the key *it
-
-		updateMaxDepthLeaf(key, octree->isNodeOccupied(node));
+		//has to be the same as of the node indexed by the key
+		occupied[i] = octree->isNodeOccupied(node);
 	}
+
+	for(size_t i=0; i<keys.size(); i++)
+		updateMaxDepthLeaf(keys[i], occupied[i]);
 	octree->resetChangeDetection();
+}
+
+template <class TREE>
+void DynamicEDTOctomapBase<TREE>::rebuild(bool updateRealDist){
+	octree->resetChangeDetection();
+	initializeOcTree(octree->keyToCoord(boundingBoxMinKey), octree->keyToCoord(boundingBoxMaxKey), isSparse());
+	DynamicEDT3D::update(updateRealDist);
+}
+
+template <class TREE>
+bool DynamicEDTOctomapBase<TREE>::moveWindow(const octomap::point3d& center, bool updateRealDist){
+	octomap::OcTreeKey centerKey;
+	if(!octree->coordToKeyChecked(center, centerKey))
+		return false;
+
+	const int size[3] = {sizeX, sizeY, sizeZ};
+	int shift[3];
+	octomap::OcTreeKey minKey, maxKey;
+	for(int i=0; i<3; i++){
+		int min = (int) centerKey[i] - size[i]/2;
+		if(min < 0 || min + size[i] - 1 > USHRT_MAX)
+			return false;
+		minKey[i] = (unsigned short int) min;
+		maxKey[i] = (unsigned short int) (min + size[i] - 1);
+		shift[i] = min - (int) boundingBoxMinKey[i];
+	}
+
+	//changes inside the old bounding box are applied before moving,
+	//the entering voxels are initialized from the current state of the octree
+	commitOctreeChanges();
+	DynamicEDT3D::shiftMap(shift[0], shift[1], shift[2], updateRealDist);
+
+	boundingBoxMinKey = minKey;
+	boundingBoxMaxKey = maxKey;
+	offsetX = -boundingBoxMinKey[0];
+	offsetY = -boundingBoxMinKey[1];
+	offsetZ = -boundingBoxMinKey[2];
+
+	std::vector<cellBox> boxes;
+	getShiftBoxes(shift, true, boxes);
+	for(size_t b=0; b<boxes.size(); b++){
+		octomap::OcTreeKey boxMinKey, boxMaxKey;
+		mapToWorld(boxes[b].min[0], boxes[b].min[1], boxes[b].min[2], boxMinKey);
+		mapToWorld(boxes[b].max[0]-1, boxes[b].max[1]-1, boxes[b].max[2]-1, boxMaxKey);
+		insertObstaclesInBox(boxMinKey, boxMaxKey);
+	}
 
 	DynamicEDT3D::update(updateRealDist);
+	return true;
+}
+
+template <class TREE>
+void DynamicEDTOctomapBase<TREE>::insertObstaclesInBox(const octomap::OcTreeKey& minKey, const octomap::OcTreeKey& maxKey){
+	if(unknownOccupied == false){
+		for(typename TREE::leaf_bbx_iterator it = octree->begin_leafs_bbx(minKey, maxKey), end=octree->end_leafs_bbx(); it!= end; ++it){
+			if(!octree->isNodeOccupied(*it))
+				continue;
+
+			//clip the leaf to the box
+			int cubeSize = 1 << (treeDepth - it.getDepth());
+			octomap::OcTreeKey key = it.getIndexKey();
+			int min[3], max[3];
+			for(int i=0; i<3; i++){
+				min[i] = std::max((int) key[i], (int) minKey[i]);
+				max[i] = std::min((int) key[i] + cubeSize - 1, (int) maxKey[i]);
+			}
+			for(int x=min[0]; x<=max[0]; x++)
+				for(int y=min[1]; y<=max[1]; y++)
+					for(int z=min[2]; z<=max[2]; z++)
+						setObstacle(x+offsetX, y+offsetY, z+offsetZ);
+		}
+	} else {
+		octomap::OcTreeKey key;
+		for(int x=minKey[0]; x<=maxKey[0]; x++){
+			key[0] = x;
+			for(int y=minKey[1]; y<=maxKey[1]; y++){
+				key[1] = y;
+				for(int z=minKey[2]; z<=maxKey[2]; z++){
+					key[2] = z;
+					typename TREE::NodeType* node = octree->search(key);
+					if(!node || octree->isNodeOccupied(node))
+						setObstacle(x+offsetX, y+offsetY, z+offsetZ);
+				}
+			}
+		}
+	}
 }
 
 template <class TREE>
-void DynamicEDTOctomapBase<TREE>::initializeOcTree(octomap::point3d bbxMin, octomap::point3d bbxMax){
+void DynamicEDTOctomapBase<TREE>::initializeOcTree(octomap::point3d bbxMin, octomap::point3d bbxMax, bool sparse){
 
     boundingBoxMinKey = octree->coordToKey(bbxMin);
     boundingBoxMaxKey = octree->coordToKey(bbxMax);
@@ -97,15 +201,16 @@ void DynamicEDTOctomapBase<TREE>::initializeOcTree(octomap::point3d bbxMin, octo
 	int _sizeY = boundingBoxMaxKey[1] - boundingBoxMinKey[1] + 1;
 	int _sizeZ = boundingBoxMaxKey[2] - boundingBoxMinKey[2] + 1;
 
-	initializeEmpty(_sizeX, _sizeY, _sizeZ, false);
-
+	initializeEmpty(_sizeX, _sizeY, _sizeZ, false, sparse);
 
+	//collect all obstacle cells first, in a fixed order
+	std::vector<octomap::OcTreeKey> keys;
 	if(unknownOccupied == false){
 		for(typename TREE::leaf_bbx_iterator it = octree->begin_leafs_bbx(bbxMin,bbxMax), end=octree->end_leafs_bbx(); it!= end; ++it){
 			if(octree->isNodeOccupied(*it)){
 				int nodeDepth = it.getDepth();
 				if( nodeDepth == treeDepth){
-					insertMaxDepthLeafAtInitialize(it.getKey());
+					keys.push_back(it.getKey());
 				} else {
 					int cubeSize = 1 << (treeDepth - nodeDepth);
 					octomap::OcTreeKey key=it.getIndexKey();
@@ -121,14 +226,19 @@ void DynamicEDTOctomapBase<TREE>::initializeOcTree(octomap::point3d bbxMin, octo
 								if(boundingBoxMaxKey[0] < tmpx || boundingBoxMaxKey[1] < tmpy || boundingBoxMaxKey[2] < tmpz)
 									continue;
 
-								insertMaxDepthLeafAtInitialize(octomap::OcTreeKey(tmpx, tmpy, tmpz));
+								keys.push_back(octomap::OcTreeKey(tmpx, tmpy, tmpz));
 							}
 				}
 			}
 		}
 	} else {
-		octomap::OcTreeKey key;
+		//every cell of the bounding box is looked up, one x slice per thread
+		std::vector<std::vector<octomap::OcTreeKey> > sliceKeys(sizeX);
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic)
+#endif
 		for(int dx=0; dx<sizeX; dx++){
+			octomap::OcTreeKey key;
 			key[0] = boundingBoxMinKey[0] + dx;
 			for(int dy=0; dy<sizeY; dy++){
 				key[1] = boundingBoxMinKey[1] + dy;
@@ -137,19 +247,29 @@ void DynamicEDTOctomapBase<TREE>::initializeOcTree(octomap::point3d bbxMin, octo
 
 					typename TREE::NodeType* node = octree->search(key);
 					if(!node || octree->isNodeOccupied(node)){
-						insertMaxDepthLeafAtInitialize(key);
+						sliceKeys[dx].push_back(key);
 					}
 				}
 			}
 		}
+		for(int dx=0; dx<sizeX; dx++)
+			keys.insert(keys.end(), sliceKeys[dx].begin(), sliceKeys[dx].end());
 	}
-}
 
-template <class TREE>
-void DynamicEDTOctomapBase<TREE>::insertMaxDepthLeafAtInitialize(octomap::OcTreeKey key){
-	bool isSurrounded = true;
+	//the neighborhood lookups are independent, the cells are inserted in order afterwards
+	std::vector<char> surrounded(keys.size());
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(guided)
+#endif
+	for(int i=0; i<(int)keys.size(); i++)
+		surrounded[i] = isSurroundedByObstacles(keys[i]);
 
+	for(size_t i=0; i<keys.size(); i++)
+		insertMaxDepthLeafAtInitialize(keys[i], surrounded[i]);
+}
 
+template <class TREE>
+bool DynamicEDTOctomapBase<TREE>::isSurroundedByObstacles(const octomap::OcTreeKey& key) const {
 	for(int dx=-1; dx<=1; dx++)
 		for(int dy=-1; dy<=1; dy++)
 			for(int dz=-1; dz<=1; dz++){
@@ -157,11 +277,14 @@ void DynamicEDTOctomapBase<TREE>::insertMaxDepthLeafAtInitialize(octomap::OcTree
 					continue;
 				typename TREE::NodeType* node = octree->search(octomap::OcTreeKey(key[0]+dx, key[1]+dy, key[2]+dz));
 				if((!unknownOccupied && node==NULL) || ((node!=NULL) && (octree->isNodeOccupied(node)==false))){
-					isSurrounded = false;
-					break;
+					return false;
 				}
 			}
+	return true;
+}
 
+template <class TREE>
+void DynamicEDTOctomapBase<TREE>::insertMaxDepthLeafAtInitialize(octomap::OcTreeKey key, bool isSurrounded){
 	if(isSurrounded){
 		//obstacles that are surrounded by obstacles do not need to be put in the queues,
 		//hence this initialization
@@ -173,10 +296,9 @@ void DynamicEDTOctomapBase<TREE>::insertMaxDepthLeafAtInitialize(octomap::OcTree
 		c.obstY = y;
 		c.obstZ = z;
 		c.sqdist = 0;
-		c.dist = 0.0;
 		c.queueing = fwProcessed;
 		c.needsRaise = false;
-		data[x][y][z] = c;
+		setCell(x,y,z,c);
 	} else {
 		setObstacle(key[0]+offsetX, key[1]+offsetY, key[2]+offsetZ);
 	}
@@ -213,9 +335,9 @@ void DynamicEDTOctomapBase<TREE>::getDistanceAndClosestObstacle(const octomap::p
 	int x,y,z;
 	worldToMap(p, x, y, z);
 	if(x>=0 && x<sizeX && y>=0 && y<sizeY && z>=0 && z<sizeZ){
-		dataCell c= data[x][y][z];
+		dataCell c = getCell(x,y,z);
 
-		distance = c.dist*treeResolution;
+		distance = getCellDistance(x,y,z)*treeResolution;
 		if(c.obstX != invalidObstData){
 			mapToWorld(c.obstX, c.obstY, c.obstZ, closestObstacle);
 		} else {
@@ -231,9 +353,9 @@ void DynamicEDTOctomapBase<TREE>::getDistanceAndClosestObstacle_unsafe(const oct
 	int x,y,z;
 	worldToMap(p, x, y, z);
 
-	dataCell c= data[x][y][z];
+	dataCell c = getCell(x,y,z);
 
-	distance = c.dist*treeResolution;
+	distance = getCellDistance(x,y,z)*treeResolution;
 	if(c.obstX != invalidObstData){
 		mapToWorld(c.obstX, c.obstY, c.obstZ, closestObstacle);
 	} else {
@@ -246,7 +368,7 @@ float DynamicEDTOctomapBase<TREE>::getDistance(const octomap::point3d& p) const
   int x,y,z;
   worldToMap(p, x, y, z);
   if(x>=0 && x<sizeX && y>=0 && y<sizeY && z>=0 && z<sizeZ){
-      return data[x][y][z].dist*treeResolution;
+      return getCellDistance(x,y,z)*treeResolution;
   } else {
       return distanceValue_Error;
   }
@@ -256,7 +378,7 @@ template <class TREE>
 float DynamicEDTOctomapBase<TREE>::getDistance_unsafe(const octomap::point3d& p) const {
   int x,y,z;
   worldToMap(p, x, y, z);
-  return data[x][y][z].dist*treeResolution;
+  return getCellDistance(x,y,z)*treeResolution;
 }
 
 template <class TREE>
@@ -266,7 +388,7 @@ float DynamicEDTOctomapBase<TREE>::getDistance(const octomap::OcTreeKey& k) cons
   int z = k[2] + offsetZ;
 
   if(x>=0 && x<sizeX && y>=0 && y<sizeY && z>=0 && z<sizeZ){
-      return data[x][y][z].dist*treeResolution;
+      return getCellDistance(x,y,z)*treeResolution;
   } else {
       return distanceValue_Error;
   }
@@ -278,7 +400,126 @@ float DynamicEDTOctomapBase<TREE>::getDistance_unsafe(const octomap::OcTreeKey&
   int y = k[1] + offsetY;
   int z = k[2] + offsetZ;
 
-  return data[x][y][z].dist*treeResolution;
+  return getCellDistance(x,y,z)*treeResolution;
+}
+
+template <class TREE>
+float DynamicEDTOctomapBase<TREE>::getInterpolatedDistance(const octomap::point3d& p, octomap::point3d& gradient) const {
+	float distance;
+	interpolateChunk(&p, 1, &distance, &gradient);
+	return distance;
+}
+
+template <class TREE>
+float DynamicEDTOctomapBase<TREE>::getInterpolatedDistance(const octomap::point3d& p) const {
+	float distance;
+	interpolateChunk(&p, 1, &distance, NULL);
+	return distance;
+}
+
+template <class TREE>
+void DynamicEDTOctomapBase<TREE>::getInterpolatedDistances(const std::vector<octomap::point3d>& points, std::vector<float>& distances, std::vector<octomap::point3d>& gradients, bool parallel) const {
+	distances.resize(points.size());
+	gradients.resize(points.size());
+	if(points.empty())
+		return;
+
+	(void)parallel; // only used with OpenMP
+	const long numChunks = (long) ((points.size() + interpolationChunkSize - 1) / interpolationChunkSize);
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if(parallel)
+#endif
+	for(long i=0; i<numChunks; i++){
+		size_t first = i*interpolationChunkSize;
+		size_t n = std::min((size_t) interpolationChunkSize, points.size() - first);
+		interpolateChunk(&points[first], n, &distances[first], &gradients[first]);
+	}
+}
+
+template <class TREE>
+void DynamicEDTOctomapBase<TREE>::getInterpolatedDistances(const std::vector<octomap::point3d>& points, std::vector<float>& distances, bool parallel) const {
+	distances.resize(points.size());
+	if(points.empty())
+		return;
+
+	(void)parallel; // only used with OpenMP
+	const long numChunks = (long) ((points.size() + interpolationChunkSize - 1) / interpolationChunkSize);
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static) if(parallel)
+#endif
+	for(long i=0; i<numChunks; i++){
+		size_t first = i*interpolationChunkSize;
+		size_t n = std::min((size_t) interpolationChunkSize, points.size() - first);
+		interpolateChunk(&points[first], n, &distances[first], NULL);
+	}
+}
+
+template <class TREE>
+void DynamicEDTOctomapBase<TREE>::interpolateChunk(const octomap::point3d* points, size_t numPoints, float* distances, octomap::point3d* gradients) const {
+	assert(numPoints <= (size_t) interpolationChunkSize);
+
+	//continuous map coordinates have their origin in the center of cell 0,0,0
+	octomap::point3d origin;
+	mapToWorld(0, 0, 0, origin);
+	const float scale = (float) (1.0 / treeResolution);
+
+	//gather the distances at the 8 surrounding voxel centers (structure of arrays)
+	float c[8][interpolationChunkSize];
+	float t[3][interpolationChunkSize];
+	bool valid[interpolationChunkSize];
+	const int size[3] = {sizeX, sizeY, sizeZ};
+	for(size_t i=0; i<numPoints; i++){
+		int lower[3], upper[3];
+		valid[i] = true;
+		for(int j=0; j<3; j++){
+			float g = (points[i](j) - origin(j)) * scale;
+			//same cells as worldToMap(), up to rounding at the border
+			if(g < -0.5f || g >= size[j] - 0.5f)
+				valid[i] = false;
+			//half a voxel at the border is extrapolated constantly
+			g = std::max(0.0f, std::min(g, (float) (size[j] - 1)));
+			lower[j] = std::min((int) g, std::max(size[j] - 2, 0));
+			upper[j] = std::min(lower[j] + 1, size[j] - 1);
+			t[j][i] = std::min(g - lower[j], 1.0f);
+		}
+		if(!valid[i]){
+			for(int k=0; k<8; k++)
+				c[k][i] = 0.0f;
+			continue;
+		}
+		for(int k=0; k<8; k++)
+			c[k][i] = getCellDistance((k&1) ? upper[0] : lower[0], (k&2) ? upper[1] : lower[1], (k&4) ? upper[2] : lower[2]);
+	}
+
+	//interpolation and analytic gradient, independent per point (vectorizable)
+	const float resolution = (float) treeResolution;
+	for(size_t i=0; i<numPoints; i++){
+		const float tx = t[0][i], ty = t[1][i], tz = t[2][i];
+		const float c00 = c[0][i] + (c[1][i] - c[0][i]) * tx;
+		const float c10 = c[2][i] + (c[3][i] - c[2][i]) * tx;
+		const float c01 = c[4][i] + (c[5][i] - c[4][i]) * tx;
+		const float c11 = c[6][i] + (c[7][i] - c[6][i]) * tx;
+		const float c0 = c00 + (c10 - c00) * ty;
+		const float c1 = c01 + (c11 - c01) * ty;
+		distances[i] = valid[i] ? (c0 + (c1 - c0) * tz) * resolution : distanceValue_Error;
+	}
+
+	if(gradients){
+		for(size_t i=0; i<numPoints; i++){
+			const float tx = t[0][i], ty = t[1][i], tz = t[2][i];
+			//distances are in cells, so the gradient in cells per cell is also in meters per meter
+			const float dx0 = (c[1][i] - c[0][i]) + ((c[3][i] - c[2][i]) - (c[1][i] - c[0][i])) * ty;
+			const float dx1 = (c[5][i] - c[4][i]) + ((c[7][i] - c[6][i]) - (c[5][i] - c[4][i])) * ty;
+			const float dy0 = (c[2][i] - c[0][i]) + ((c[3][i] - c[1][i]) - (c[2][i] - c[0][i])) * tx;
+			const float dy1 = (c[6][i] - c[4][i]) + ((c[7][i] - c[5][i]) - (c[6][i] - c[4][i])) * tx;
+			const float c00 = c[0][i] + (c[1][i] - c[0][i]) * tx;
+			const float c10 = c[2][i] + (c[3][i] - c[2][i]) * tx;
+			const float c01 = c[4][i] + (c[5][i] - c[4][i]) * tx;
+			const float c11 = c[6][i] + (c[7][i] - c[6][i]) * tx;
+			const float dz = (c01 + (c11 - c01) * ty) - (c00 + (c10 - c00) * ty);
+			gradients[i] = octomap::point3d(dx0 + (dx1 - dx0) * tz, dy0 + (dy1 - dy0) * tz, dz);
+		}
+	}
 }
 
 template <class TREE>
@@ -286,7 +527,7 @@ int DynamicEDTOctomapBase<TREE>::getSquaredDistanceInCells(const octomap::point3
   int x,y,z;
   worldToMap(p, x, y, z);
   if(x>=0 && x<sizeX && y>=0 && y<sizeY && z>=0 && z<sizeZ){
-    return data[x][y][z].sqdist;
+    return getCellSQDistance(x,y,z);
   } else {
     return distanceInCellsValue_Error;
   }
@@ -296,7 +537,7 @@ template <class TREE>
 int DynamicEDTOctomapBase<TREE>::getSquaredDistanceInCells_unsafe(const octomap::point3d& p) const {
   int x,y,z;
   worldToMap(p, x, y, z);
-  return data[x][y][z].sqdist;
+  return getCellSQDistance(x,y,z);
 }
 
 template <class TREE>
@@ -38,7 +38,9 @@
 #include <dynamicEDT3D/dynamicEDT3D.h>
 
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
 
 #define FOR_EACH_NEIGHBOR_WITH_CHECK(function, p, ...) \
 	int x=p.x;\
@@ -108,35 +110,56 @@ int DynamicEDT3D::distanceInCellsValue_Error = -1;
 
 DynamicEDT3D::DynamicEDT3D(int _maxdist_squared) {
 	sqrt2 = sqrt(2.0);
+	// obstacle offsets are stored in 16 bits, cells at the maximum distance
+	// may refer to obstacles up to two cells further away
+	if (_maxdist_squared > maxObstacleOffset*maxObstacleOffset || _maxdist_squared < 0) {
+		fprintf(stderr, "ERROR: DynamicEDT3D: the maximum distance exceeds the limit of %d cells and is reduced to it.\n",
+		        maxObstacleOffset);
+		_maxdist_squared = maxObstacleOffset*maxObstacleOffset;
+	}
 	maxDist_squared = _maxdist_squared;
 	maxDist = sqrt((double) maxDist_squared);
-	data = NULL;
-	gridMap = NULL;
+	distanceLUT.resize(std::min(maxDist_squared+1, (int) maxDistanceLUTSize));
+	for (int i=0; i<(int) distanceLUT.size(); i++)
+		distanceLUT[i] = sqrt((double) i);
+	sizeX = sizeY = sizeZ = 0;
+	sparse = false;
+	originX = originY = originZ = 0;
+	blocksY = blocksZ = 0;
+	numAllocatedBlocks = 0;
+	dataMemory = NULL;
+	initialUpdatePending = false;
+
+	initialCell.sqdist = maxDist_squared;
+	initialCell.obstDX = initialCell.obstDY = initialCell.obstDZ = 0;
+	initialCell.flags = fwNotQueued;
 }
 
 DynamicEDT3D::~DynamicEDT3D() {
-	if (data) {
-		for (int x=0; x<sizeX; x++){
-			for (int y=0; y<sizeY; y++)
-				delete[] data[x][y];
+	freeData();
+}
 
-			delete[] data[x];
-		}
-		delete[] data;
+void DynamicEDT3D::freeData() {
+	if (dataMemory) {
+		delete[] dataMemory;
+		dataMemory = NULL;
+	} else {
+		for (size_t i=0; i<blocks.size(); i++)
+			delete[] blocks[i];
 	}
+	blocks.clear();
+	numAllocatedBlocks = 0;
+}
 
-	if (gridMap) {
-		for (int x=0; x<sizeX; x++){
-			for (int y=0; y<sizeY; y++)
-				delete[] gridMap[x][y];
-
-			delete[] gridMap[x];
-		}
-		delete[] gridMap;
-	}
+DynamicEDT3D::packedCell* DynamicEDT3D::allocateBlock() {
+	packedCell* block = new packedCell[512];
+	for (int i=0; i<512; i++)
+		block[i] = initialCell;
+	numAllocatedBlocks++;
+	return block;
 }
 
-void DynamicEDT3D::initializeEmpty(int _sizeX, int _sizeY, int _sizeZ, bool initGridMap) {
+void DynamicEDT3D::initializeEmpty(int _sizeX, int _sizeY, int _sizeZ, bool initGridMap, bool _sparse) {
 	sizeX = _sizeX;
 	sizeY = _sizeY;
 	sizeZ = _sizeZ;
@@ -145,76 +168,64 @@ void DynamicEDT3D::initializeEmpty(int _sizeX, int _sizeY, int _sizeZ, bool init
 	sizeYm1 = sizeY-1;
 	sizeZm1 = sizeZ-1;
 
-	if (data) {
-		for (int x=0; x<sizeX; x++){
-			for (int y=0; y<sizeY; y++)
-				delete[] data[x][y];
-
-			delete[] data[x];
+	// the map is padded to full blocks of 8x8x8 cells
+	size_t blocksX = (sizeX+7) >> 3;
+	blocksY = (sizeY+7) >> 3;
+	blocksZ = (sizeZ+7) >> 3;
+	size_t numBlocks = blocksX*blocksY*blocksZ;
+
+	freeData();
+	sparse = _sparse;
+	originX = originY = originZ = 0;
+	blocks.assign(numBlocks, (packedCell*) NULL);
+	if (!sparse) {
+		dataMemory = new char[(numBlocks << 9)*sizeof(packedCell) + 63];
+		packedCell* data = reinterpret_cast<packedCell*>((reinterpret_cast<size_t>(dataMemory) + 63) & ~((size_t) 63));
+		numAllocatedBlocks = numBlocks;
+
+#ifdef _OPENMP
+		#pragma omp parallel for
+#endif
+		for (long i=0; i<(long) numBlocks; i++) {
+			blocks[i] = data + (i << 9);
+			for (int j=0; j<512; j++)
+				blocks[i][j] = initialCell;
 		}
-		delete[] data;
 	}
 
-	data = new dataCell**[sizeX];
-	for (int x=0; x<sizeX; x++){
-		data[x] = new dataCell*[sizeY];
-		for(int y=0; y<sizeY; y++)
-			data[x][y] = new dataCell[sizeZ];
-	}
-
-	if (initGridMap) {
-		if (gridMap) {
-			for (int x=0; x<sizeX; x++){
-				for (int y=0; y<sizeY; y++)
-					delete[] gridMap[x][y];
+	if (initGridMap)
+		gridMap.assign(((size_t) sizeX*sizeY*sizeZ + 63) >> 6, 0);
+	else
+		gridMap.clear();
 
-				delete[] gridMap[x];
-			}
-			delete[] gridMap;
-		}
-
-		gridMap = new bool**[sizeX];
-		for (int x=0; x<sizeX; x++){
-			gridMap[x] = new bool*[sizeY];
-			for (int y=0; y<sizeY; y++)
-				gridMap[x][y] = new bool[sizeZ];
-		}
-	}
+	// pending changes refer to the old map
+	open.clear();
+	addList.clear();
+	removeList.clear();
+	lastObstacles.clear();
+	initialUpdatePending = true;
+}
 
-	dataCell c;
-	c.dist = maxDist;
-	c.sqdist = maxDist_squared;
-	c.obstX = invalidObstData;
-	c.obstY = invalidObstData;
-	c.obstZ = invalidObstData;
-	c.queueing = fwNotQueued;
-	c.needsRaise = false;
+void DynamicEDT3D::initializeMap(int _sizeX, int _sizeY, int _sizeZ, bool*** _gridMap) {
+	initializeEmpty(_sizeX, _sizeY, _sizeZ, true);
 
-	for (int x=0; x<sizeX; x++){
-		for (int y=0; y<sizeY; y++){
-			for (int z=0; z<sizeZ; z++){
-				data[x][y][z] = c;
+	for (int x=0; x<sizeX; x++) {
+		for (int y=0; y<sizeY; y++) {
+			for (int z=0; z<sizeZ; z++) {
+				if (_gridMap[x][y][z])
+					setGridMap(x,y,z,true);
 			}
+			delete[] _gridMap[x][y];
 		}
+		delete[] _gridMap[x];
 	}
-
-	if (initGridMap) {
-		for (int x=0; x<sizeX; x++)
-			for (int y=0; y<sizeY; y++)
-				for (int z=0; z<sizeZ; z++)
-					gridMap[x][y][z] = 0;
-	}
-}
-
-void DynamicEDT3D::initializeMap(int _sizeX, int _sizeY, int _sizeZ, bool*** _gridMap) {
-	gridMap = _gridMap;
-	initializeEmpty(_sizeX, _sizeY, _sizeZ, false);
+	delete[] _gridMap;
 
 	for (int x=0; x<sizeX; x++) {
 		for (int y=0; y<sizeY; y++) {
 			for (int z=0; z<sizeZ; z++) {
-				if (gridMap[x][y][z]) {
-					dataCell c = data[x][y][z];
+				if (getGridMap(x,y,z)) {
+					dataCell c = getCell(x,y,z);
 					if (!isOccupied(x,y,z,c)) {
 
 						bool isSurrounded = true;
@@ -229,7 +240,7 @@ void DynamicEDT3D::initializeMap(int _sizeX, int _sizeY, int _sizeZ, bool*** _gr
 									int nz = z+dz;
 									if (nz<0 || nz>sizeZ-1) continue;
 
-									if (!gridMap[nx][ny][nz]) {
+									if (!getGridMap(nx,ny,nz)) {
 										isSurrounded = false;
 										break;
 									}
@@ -241,9 +252,8 @@ void DynamicEDT3D::initializeMap(int _sizeX, int _sizeY, int _sizeZ, bool*** _gr
 							c.obstY = y;
 							c.obstZ = z;
 							c.sqdist = 0;
-							c.dist = 0;
 							c.queueing = fwProcessed;
-							data[x][y][z] = c;
+							setCell(x,y,z,c);
 						} else setObstacle(x,y,z);
 					}
 				}
@@ -253,28 +263,28 @@ void DynamicEDT3D::initializeMap(int _sizeX, int _sizeY, int _sizeZ, bool*** _gr
 }
 
 void DynamicEDT3D::occupyCell(int x, int y, int z) {
-	gridMap[x][y][z] = 1;
+	setGridMap(x,y,z,true);
 	setObstacle(x,y,z);
 }
 
 void DynamicEDT3D::clearCell(int x, int y, int z) {
-	gridMap[x][y][z] = 0;
+	setGridMap(x,y,z,false);
 	removeObstacle(x,y,z);
 }
 
 void DynamicEDT3D::setObstacle(int x, int y, int z) {
-	dataCell c = data[x][y][z];
+	dataCell c = getCell(x,y,z);
 	if(isOccupied(x,y,z,c)) return;
 
 	addList.push_back(INTPOINT3D(x,y,z));
 	c.obstX = x;
 	c.obstY = y;
 	c.obstZ = z;
-	data[x][y][z] = c;
+	setCell(x,y,z,c);
 }
 
 void DynamicEDT3D::removeObstacle(int x, int y, int z) {
-	dataCell c = data[x][y][z];
+	dataCell c = getCell(x,y,z);
 	if(isOccupied(x,y,z,c) == false) return;
 
 	removeList.push_back(INTPOINT3D(x,y,z));
@@ -282,7 +292,7 @@ void DynamicEDT3D::removeObstacle(int x, int y, int z) {
 	c.obstY  = invalidObstData;
 	c.obstZ  = invalidObstData;
 	c.queueing = bwQueued;
-	data[x][y][z] = c;
+	setCell(x,y,z,c);
 }
 
 void DynamicEDT3D::exchangeObstacles(std::vector<INTPOINT3D> points) {
@@ -292,7 +302,7 @@ void DynamicEDT3D::exchangeObstacles(std::vector<INTPOINT3D> points) {
 		int y = lastObstacles[i].y;
 		int z = lastObstacles[i].z;
 
-		bool v = gridMap[x][y][z];
+		bool v = getGridMap(x,y,z);
 		if (v) continue;
 		removeObstacle(x,y,z);
 	}
@@ -303,39 +313,405 @@ void DynamicEDT3D::exchangeObstacles(std::vector<INTPOINT3D> points) {
 		int x = points[i].x;
 		int y = points[i].y;
 		int z = points[i].z;
-		bool v = gridMap[x][y][z];
+		bool v = getGridMap(x,y,z);
 		if (v) continue;
 		setObstacle(x,y,z);
 		lastObstacles.push_back(points[i]);
 	}
 }
 
-void DynamicEDT3D::update(bool updateRealDist) {
-	commitAndColorize(updateRealDist);
+void DynamicEDT3D::resetCell(int x, int y, int z) {
+	storageCoords(x,y,z);
+	packedCell* block = blocks[blockIndex(x,y,z)];
+	if (block)
+		block[cellIndex(x,y,z)] = initialCell;
+	if (!gridMap.empty()) {
+		size_t i = ((size_t) x*sizeY + y)*sizeZ + z;
+		gridMap[i>>6] &= ~((uint64_t) 1 << (i&63));
+	}
+}
+
+void DynamicEDT3D::getShiftBoxes(const int shift[3], bool exposed, std::vector<cellBox>& boxes) const {
+	const int size[3] = {sizeX, sizeY, sizeZ};
+	boxes.clear();
+
+	// box i covers the cells on axis i, restricted to the remaining cells on
+	// the previous axes so that the boxes are disjoint
+	cellBox box;
+	for (int i=0; i<3; i++) {
+		box.min[i] = 0;
+		box.max[i] = size[i];
+	}
+	for (int i=0; i<3; i++) {
+		int d = shift[i];
+		if (d == 0) continue;
+		if (d >= size[i] || -d >= size[i]) {
+			box.min[i] = 0;
+			box.max[i] = size[i];
+			boxes.push_back(box);
+			return;
+		}
+
+		// entering cells are at the end of the shifted map for positive shifts,
+		// leaving cells at the beginning of the unshifted map
+		bool atEnd = (d > 0) == exposed;
+		int n = d > 0 ? d : -d;
+		cellBox b = box;
+		b.min[i] = atEnd ? size[i]-n : 0;
+		b.max[i] = atEnd ? size[i] : n;
+		boxes.push_back(b);
+
+		box.min[i] = atEnd ? 0 : n;
+		box.max[i] = atEnd ? size[i]-n : size[i];
+	}
+}
+
+void DynamicEDT3D::shiftMap(int dx, int dy, int dz, bool updateRealDist) {
+	const int shift[3] = {dx, dy, dz};
+	if (dx == 0 && dy == 0 && dz == 0)
+		return;
+
+	if (abs(dx) >= sizeX || abs(dy) >= sizeY || abs(dz) >= sizeZ) {
+		// all cells are replaced
+		open.clear();
+		addList.clear();
+		removeList.clear();
+		lastObstacles.clear();
+		for (int x=0; x<sizeX; x++)
+			for (int y=0; y<sizeY; y++)
+				for (int z=0; z<sizeZ; z++)
+					resetCell(x,y,z);
+		initialUpdatePending = true;
+		return;
+	}
+
+	// pending changes are applied first, an obstacle added and removed in the same update would be kept
+	update(updateRealDist);
+
+	// remove the obstacles leaving the map, repairing the distances of the remaining cells
+	std::vector<cellBox> boxes;
+	getShiftBoxes(shift, false, boxes);
+	for (size_t b=0; b<boxes.size(); b++) {
+		const cellBox& box = boxes[b];
+		for (int x=box.min[0]; x<box.max[0]; x++)
+			for (int y=box.min[1]; y<box.max[1]; y++)
+				for (int z=box.min[2]; z<box.max[2]; z++)
+					if (isOccupied(x,y,z))
+						removeObstacle(x,y,z);
+	}
+	update(updateRealDist);
+
+	// move the origin of the circular buffer
+	originX = ((originX + dx) % sizeX + sizeX) % sizeX;
+	originY = ((originY + dy) % sizeY + sizeY) % sizeY;
+	originZ = ((originZ + dz) % sizeZ + sizeZ) % sizeZ;
+
+	std::vector<INTPOINT3D> remainingObstacles;
+	for (unsigned int i=0; i<lastObstacles.size(); i++) {
+		INTPOINT3D p(lastObstacles[i].x - dx, lastObstacles[i].y - dy, lastObstacles[i].z - dz);
+		if (p.x >= 0 && p.x < sizeX && p.y >= 0 && p.y < sizeY && p.z >= 0 && p.z < sizeZ)
+			remainingObstacles.push_back(p);
+	}
+	lastObstacles.swap(remainingObstacles);
+
+	// the storage of the leaving cells is reused for the entering cells
+	getShiftBoxes(shift, true, boxes);
+	for (size_t b=0; b<boxes.size(); b++) {
+		const cellBox& box = boxes[b];
+		for (int x=box.min[0]; x<box.max[0]; x++)
+			for (int y=box.min[1]; y<box.max[1]; y++)
+				for (int z=box.min[2]; z<box.max[2]; z++)
+					resetCell(x,y,z);
+	}
+
+	// queue the remaining cells next to the entering cells, so that the
+	// next update propagates their distances into the entering cells
+	const int size[3] = {sizeX, sizeY, sizeZ};
+	for (int i=0; i<3; i++) {
+		int d = shift[i];
+		if (d == 0 || d >= size[i] || -d >= size[i]) continue;
+
+		int min[3] = {0, 0, 0};
+		int max[3] = {sizeX, sizeY, sizeZ};
+		min[i] = d > 0 ? size[i]-d-1 : -d;
+		max[i] = min[i] + 1;
+		for (int x=min[0]; x<max[0]; x++) {
+			for (int y=min[1]; y<max[1]; y++) {
+				for (int z=min[2]; z<max[2]; z++) {
+					dataCell c = getCell(x,y,z);
+					if (c.obstX == invalidObstData || c.sqdist >= maxDist_squared || c.queueing == fwQueued)
+						continue;
+					open.push(c.sqdist, INTPOINT3D(x,y,z));
+					c.queueing = fwQueued;
+					setCell(x,y,z,c);
+				}
+			}
+		}
+	}
+}
+
+void DynamicEDT3D::update(bool /*updateRealDist*/) {
+	if (initialUpdatePending) {
+		exactUpdate();
+		return;
+	}
+
+	commitAndColorize();
 
 		while (!open.empty()) {
 			INTPOINT3D p = open.pop();
 			int x = p.x;
 			int y = p.y;
 			int z = p.z;
-			dataCell c = data[x][y][z];
+			dataCell c = getCell(x,y,z);
 
 			if(c.queueing==fwProcessed) continue;
 
 			if (c.needsRaise) {
 				// RAISE
-				raiseCell(p, c, updateRealDist);
-				data[x][y][z] = c;
+				raiseCell(p, c);
+				setCell(x,y,z,c);
 			}
-			else if (c.obstX != invalidObstData && isOccupied(c.obstX,c.obstY,c.obstZ,data[c.obstX][c.obstY][c.obstZ])) {
+			else if (c.obstX != invalidObstData && isOccupied(c.obstX,c.obstY,c.obstZ,getCell(c.obstX,c.obstY,c.obstZ))) {
 				// LOWER
-				propagateCell(p, c, updateRealDist);
-				data[x][y][z] = c;
+				propagateCell(p, c);
+				setCell(x,y,z,c);
 			}
 		}
 }
 
-void DynamicEDT3D::raiseCell(INTPOINT3D &p, dataCell &c, bool updateRealDist){
+void DynamicEDT3D::exactUpdate() {
+	// all obstacle cells hold themselves as closest obstacle, pending changes are included
+	open.clear();
+	addList.clear();
+	removeList.clear();
+
+	if (sparse)
+		allocateObstacleBlocks();
+
+	// squared distance transform along z, then y, then x (Meijster et al.). Between
+	// the passes, each cell holds the closest obstacle within the processed axes.
+	exactUpdatePass(2, true, false);
+	exactUpdatePass(1, false, false);
+	exactUpdatePass(0, false, true);
+
+	if (sparse)
+		freeInitialBlocks();
+	initialUpdatePending = false;
+}
+
+void DynamicEDT3D::exactUpdatePass(int axis, bool first, bool last) {
+	const int size[3] = {sizeX, sizeY, sizeZ};
+	const int axis1 = (axis == 0) ? 1 : 0; // the other two axes
+	const int axis2 = (axis == 2) ? 1 : 2;
+	const int n = size[axis];
+	const long numLines = (long) size[axis1] * size[axis2];
+
+#ifdef _OPENMP
+	#pragma omp parallel
+#endif
+	{
+		std::vector<packedCell*> cells(n);
+		std::vector<packedCell> line(n);
+		std::vector<int> g(n), site(n), s(n), t(n);
+
+#ifdef _OPENMP
+		#pragma omp for schedule(dynamic, 16)
+#endif
+		for (long l=0; l<numLines; l++) {
+			int p[3];
+			p[axis1] = (int) (l / size[axis2]);
+			p[axis2] = (int) (l % size[axis2]);
+
+			bool allocated = false;
+			for (int i=0; i<n; i++) {
+				p[axis] = i;
+				cells[i] = getCellPointer(p[0], p[1], p[2]);
+				if (cells[i]) {
+					line[i] = *cells[i];
+					allocated = true;
+				}
+			}
+			if (!allocated)
+				continue;
+
+			// sites: obstacles in the first pass, cells with an obstacle (within maxDist) afterwards
+			for (int i=0; i<n; i++) {
+				g[i] = -1;
+				if (!cells[i] || !(line[i].flags & obstValidFlag))
+					continue;
+				if (!first)
+					g[i] = line[i].sqdist;
+				else if (line[i].obstDX == 0 && line[i].obstDY == 0 && line[i].obstDZ == 0)
+					g[i] = 0;
+			}
+			lowerEnvelope(&g[0], n, &site[0], &s[0], &t[0]);
+
+			for (int i=0; i<n; i++) {
+				packedCell* cell = cells[i];
+				if (!cell)
+					continue;
+				int j = site[i];
+				int sqdist = maxDist_squared;
+				if (j >= 0)
+					sqdist = (int) std::min((long long) (i-j)*(i-j) + g[j], (long long) maxDist_squared);
+
+				if (sqdist < maxDist_squared) {
+					// same closest obstacle as the site j on the other axes
+					packedCell c = line[j];
+					if (first)
+						c.obstDX = c.obstDY = c.obstDZ = 0;
+					int16_t* offset = (axis == 0) ? &c.obstDX : ((axis == 1) ? &c.obstDY : &c.obstDZ);
+					*offset = (int16_t) (j - i);
+					c.sqdist = sqdist;
+					c.flags = (unsigned char) (obstValidFlag | (last ? fwProcessed : 0));
+					*cell = c;
+				} else if (last) {
+					*cell = initialCell;
+				} else {
+					cell->sqdist = maxDist_squared;
+					cell->flags = 0;
+				}
+			}
+		}
+	}
+}
+
+void DynamicEDT3D::lowerEnvelope(const int* g, int n, int* site, int* s, int* t) {
+	// s[0..q] are the sites of the lower envelope, s[k] is the minimum from t[k] on
+	int q = -1;
+	for (int u=0; u<n; u++) {
+		if (g[u] < 0)
+			continue;
+		while (q >= 0 && (long long) (t[q]-s[q])*(t[q]-s[q]) + g[s[q]] > (long long) (t[q]-u)*(t[q]-u) + g[u])
+			q--;
+		if (q < 0) {
+			q = 0;
+			s[0] = u;
+			t[0] = 0;
+		} else {
+			// last position where s[q] is at most as far as u
+			long long num = (long long) u*u - (long long) s[q]*s[q] + g[u] - g[s[q]];
+			long long den = 2 * (long long) (u - s[q]);
+			long long sep = (num >= 0) ? num / den : -((-num + den - 1) / den);
+			if (sep + 1 < n) {
+				q++;
+				s[q] = u;
+				t[q] = (int) (sep + 1);
+			}
+		}
+	}
+
+	for (int u=n-1; u>=0; u--) {
+		if (q < 0) {
+			site[u] = -1;
+			continue;
+		}
+		site[u] = s[q];
+		if (u == t[q])
+			q--;
+	}
+}
+
+void DynamicEDT3D::allocateObstacleBlocks() {
+	// blocks in map coordinates (x>>3, ...) that contain obstacles
+	const int size[3] = {sizeX, sizeY, sizeZ};
+	const int origin[3] = {originX, originY, originZ};
+	int numMapBlocks[3];
+	for (int i=0; i<3; i++)
+		numMapBlocks[i] = (size[i]+7) >> 3;
+	std::vector<char> mapBlocks((size_t) numMapBlocks[0]*numMapBlocks[1]*numMapBlocks[2], 0);
+	for (int x=0; x<sizeX; x++) {
+		for (int y=0; y<sizeY; y++) {
+			for (int z=0; z<sizeZ; z++) {
+				const packedCell* cell = getCellPointer(x,y,z);
+				if (cell && (cell->flags & obstValidFlag) && cell->obstDX == 0 && cell->obstDY == 0 && cell->obstDZ == 0)
+					mapBlocks[((size_t) (x>>3)*numMapBlocks[1] + (y>>3))*numMapBlocks[2] + (z>>3)] = 1;
+			}
+		}
+	}
+
+	// dilate by the blocks within maxDist along each axis (separable box dilation)
+	const int radius = ((int) ceil(maxDist) + 7) >> 3;
+	const int stride[3] = {numMapBlocks[1]*numMapBlocks[2], numMapBlocks[2], 1};
+	for (int axis=0; axis<3; axis++) {
+		const int axis1 = (axis == 0) ? 1 : 0;
+		const int axis2 = (axis == 2) ? 1 : 2;
+		std::vector<char> dilated(mapBlocks.size(), 0);
+		for (int b1=0; b1<numMapBlocks[axis1]; b1++) {
+			for (int b2=0; b2<numMapBlocks[axis2]; b2++) {
+				size_t lineStart = (size_t) b1*stride[axis1] + (size_t) b2*stride[axis2];
+				int last = -1; // last marked block on the line
+				for (int b=0; b<numMapBlocks[axis]; b++) {
+					if (mapBlocks[lineStart + (size_t) b*stride[axis]]) {
+						for (int d=std::max(std::max(b-radius, last+1), 0); d<=std::min(b+radius, numMapBlocks[axis]-1); d++)
+							dilated[lineStart + (size_t) d*stride[axis]] = 1;
+						last = std::min(b+radius, numMapBlocks[axis]-1);
+					}
+				}
+			}
+		}
+		mapBlocks.swap(dilated);
+	}
+
+	// storage blocks of the cells in each map block, at most two per axis (circular buffer)
+	std::vector<int> storageBlocks[3];
+	for (int i=0; i<3; i++) {
+		storageBlocks[i].assign(2*numMapBlocks[i], -1);
+		for (int c=0; c<size[i]; c++) {
+			int storage = (c + origin[i]) % size[i];
+			int* entry = &storageBlocks[i][2*(c>>3)];
+			if (entry[0] < 0 || entry[0] == (storage>>3))
+				entry[0] = storage>>3;
+			else
+				entry[1] = storage>>3;
+		}
+	}
+
+	for (int bx=0; bx<numMapBlocks[0]; bx++) {
+		for (int by=0; by<numMapBlocks[1]; by++) {
+			for (int bz=0; bz<numMapBlocks[2]; bz++) {
+				if (!mapBlocks[((size_t) bx*numMapBlocks[1] + by)*numMapBlocks[2] + bz])
+					continue;
+				for (int i=0; i<2; i++) {
+					int sx = storageBlocks[0][2*bx+i];
+					if (sx < 0) continue;
+					for (int j=0; j<2; j++) {
+						int sy = storageBlocks[1][2*by+j];
+						if (sy < 0) continue;
+						for (int k=0; k<2; k++) {
+							int sz = storageBlocks[2][2*bz+k];
+							if (sz < 0) continue;
+							packedCell*& block = blocks[((size_t) sx*blocksY + sy)*blocksZ + sz];
+							if (!block)
+								block = allocateBlock();
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void DynamicEDT3D::freeInitialBlocks() {
+	for (size_t i=0; i<blocks.size(); i++) {
+		packedCell* block = blocks[i];
+		if (!block)
+			continue;
+		bool initial = true;
+		for (int j=0; j<512 && initial; j++) {
+			initial = block[j].sqdist == initialCell.sqdist && block[j].flags == initialCell.flags
+				&& block[j].obstDX == 0 && block[j].obstDY == 0 && block[j].obstDZ == 0;
+		}
+		if (initial) {
+			delete[] block;
+			blocks[i] = NULL;
+			numAllocatedBlocks--;
+		}
+	}
+}
+
+void DynamicEDT3D::raiseCell(INTPOINT3D &p, dataCell &c){
 	/*
 	for (int dx=-1; dx<=1; dx++) {
 		int nx = p.x+dx;
@@ -348,41 +724,40 @@ void DynamicEDT3D::raiseCell(INTPOINT3D &p, dataCell &c, bool updateRealDist){
 				int nz = p.z+dz;
 				if (nz<0 || nz>sizeZ-1) continue;
 
-				inspectCellRaise(nx,ny,nz, updateRealDist);
+				inspectCellRaise(nx,ny,nz);
 			}
 		}
 	}
 */
-	FOR_EACH_NEIGHBOR_WITH_CHECK(inspectCellRaise,p, updateRealDist)
+	FOR_EACH_NEIGHBOR_WITH_CHECK(inspectCellRaise,p)
 
 	c.needsRaise = false;
 	c.queueing = bwProcessed;
 }
 
-void DynamicEDT3D::inspectCellRaise(int &nx, int &ny, int &nz, bool updateRealDist){
-	dataCell nc = data[nx][ny][nz];
+void DynamicEDT3D::inspectCellRaise(int &nx, int &ny, int &nz){
+	dataCell nc = getCell(nx,ny,nz);
 	if (nc.obstX!=invalidObstData && !nc.needsRaise) {
-		if(!isOccupied(nc.obstX,nc.obstY,nc.obstZ,data[nc.obstX][nc.obstY][nc.obstZ])) {
+		if(!isOccupied(nc.obstX,nc.obstY,nc.obstZ,getCell(nc.obstX,nc.obstY,nc.obstZ))) {
 			open.push(nc.sqdist, INTPOINT3D(nx,ny,nz));
 			nc.queueing = fwQueued;
 			nc.needsRaise = true;
 			nc.obstX = invalidObstData;
 			nc.obstY = invalidObstData;
 			nc.obstZ = invalidObstData;
-			if (updateRealDist) nc.dist = maxDist;
 			nc.sqdist = maxDist_squared;
-			data[nx][ny][nz] = nc;
+			setCell(nx,ny,nz,nc);
 		} else {
 			if(nc.queueing != fwQueued){
 				open.push(nc.sqdist, INTPOINT3D(nx,ny,nz));
 				nc.queueing = fwQueued;
-				data[nx][ny][nz] = nc;
+				setCell(nx,ny,nz,nc);
 			}
 		}
 	}
 }
 
-void DynamicEDT3D::propagateCell(INTPOINT3D &p, dataCell &c, bool updateRealDist){
+void DynamicEDT3D::propagateCell(INTPOINT3D &p, dataCell &c){
 	c.queueing = fwProcessed;
 	/*
 	for (int dx=-1; dx<=1; dx++) {
@@ -396,14 +771,14 @@ void DynamicEDT3D::propagateCell(INTPOINT3D &p, dataCell &c, bool updateRealDist
 				int nz = p.z+dz;
 				if (nz<0 || nz>sizeZ-1) continue;
 
-				inspectCellPropagate(nx, ny, nz, c, updateRealDist);
+				inspectCellPropagate(nx, ny, nz, c);
 			}
 		}
 	}
 	 */
 
 	if(c.sqdist==0){
-		FOR_EACH_NEIGHBOR_WITH_CHECK(inspectCellPropagate, p, c, updateRealDist)
+		FOR_EACH_NEIGHBOR_WITH_CHECK(inspectCellPropagate, p, c)
 	} else {
 		int x=p.x;
 		int y=p.y;
@@ -423,62 +798,62 @@ void DynamicEDT3D::propagateCell(INTPOINT3D &p, dataCell &c, bool updateRealDist
 		//    dpz=0;
 
 
-		if(dpz >=0 && z<sizeZm1) inspectCellPropagate(x, y, zp1, c, updateRealDist);
-		if(dpz <=0 && z>0)       inspectCellPropagate(x, y, zm1, c, updateRealDist);
+		if(dpz >=0 && z<sizeZm1) inspectCellPropagate(x, y, zp1, c);
+		if(dpz <=0 && z>0)       inspectCellPropagate(x, y, zm1, c);
 
 		if(dpy>=0 && y<sizeYm1){
-			inspectCellPropagate(x, yp1, z, c, updateRealDist);
-			if(dpz >=0 && z<sizeZm1) inspectCellPropagate(x, yp1, zp1, c, updateRealDist);
-			if(dpz <=0 && z>0)       inspectCellPropagate(x, yp1, zm1, c, updateRealDist);
+			inspectCellPropagate(x, yp1, z, c);
+			if(dpz >=0 && z<sizeZm1) inspectCellPropagate(x, yp1, zp1, c);
+			if(dpz <=0 && z>0)       inspectCellPropagate(x, yp1, zm1, c);
 		}
 
 		if(dpy<=0 && y>0){
-			inspectCellPropagate(x, ym1, z, c, updateRealDist);
-			if(dpz >=0 && z<sizeZm1) inspectCellPropagate(x, ym1, zp1, c, updateRealDist);
-			if(dpz <=0 && z>0)       inspectCellPropagate(x, ym1, zm1, c, updateRealDist);
+			inspectCellPropagate(x, ym1, z, c);
+			if(dpz >=0 && z<sizeZm1) inspectCellPropagate(x, ym1, zp1, c);
+			if(dpz <=0 && z>0)       inspectCellPropagate(x, ym1, zm1, c);
 		}
 
 
 		if(dpx>=0 && x<sizeXm1){
-			inspectCellPropagate(xp1, y, z, c, updateRealDist);
-			if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xp1, y, zp1, c, updateRealDist);
-			if(dpz <=0 && z>0)       inspectCellPropagate(xp1, y, zm1, c, updateRealDist);
+			inspectCellPropagate(xp1, y, z, c);
+			if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xp1, y, zp1, c);
+			if(dpz <=0 && z>0)       inspectCellPropagate(xp1, y, zm1, c);
 
 			if(dpy>=0 && y<sizeYm1){
-				inspectCellPropagate(xp1, yp1, z, c, updateRealDist);
-				if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xp1, yp1, zp1, c, updateRealDist);
-				if(dpz <=0 && z>0)       inspectCellPropagate(xp1, yp1, zm1, c, updateRealDist);
+				inspectCellPropagate(xp1, yp1, z, c);
+				if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xp1, yp1, zp1, c);
+				if(dpz <=0 && z>0)       inspectCellPropagate(xp1, yp1, zm1, c);
 			}
 
 			if(dpy<=0 && y>0){
-				inspectCellPropagate(xp1, ym1, z, c, updateRealDist);
-				if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xp1, ym1, zp1, c, updateRealDist);
-				if(dpz <=0 && z>0)       inspectCellPropagate(xp1, ym1, zm1, c, updateRealDist);
+				inspectCellPropagate(xp1, ym1, z, c);
+				if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xp1, ym1, zp1, c);
+				if(dpz <=0 && z>0)       inspectCellPropagate(xp1, ym1, zm1, c);
 			}
 		}
 
 		if(dpx<=0 && x>0){
-			inspectCellPropagate(xm1, y, z, c, updateRealDist);
-			if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xm1, y, zp1, c, updateRealDist);
-			if(dpz <=0 && z>0)       inspectCellPropagate(xm1, y, zm1, c, updateRealDist);
+			inspectCellPropagate(xm1, y, z, c);
+			if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xm1, y, zp1, c);
+			if(dpz <=0 && z>0)       inspectCellPropagate(xm1, y, zm1, c);
 
 			if(dpy>=0 && y<sizeYm1){
-				inspectCellPropagate(xm1, yp1, z, c, updateRealDist);
-				if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xm1, yp1, zp1, c, updateRealDist);
-				if(dpz <=0 && z>0)       inspectCellPropagate(xm1, yp1, zm1, c, updateRealDist);
+				inspectCellPropagate(xm1, yp1, z, c);
+				if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xm1, yp1, zp1, c);
+				if(dpz <=0 && z>0)       inspectCellPropagate(xm1, yp1, zm1, c);
 			}
 
 			if(dpy<=0 && y>0){
-				inspectCellPropagate(xm1, ym1, z, c, updateRealDist);
-				if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xm1, ym1, zp1, c, updateRealDist);
-				if(dpz <=0 && z>0)       inspectCellPropagate(xm1, ym1, zm1, c, updateRealDist);
+				inspectCellPropagate(xm1, ym1, z, c);
+				if(dpz >=0 && z<sizeZm1) inspectCellPropagate(xm1, ym1, zp1, c);
+				if(dpz <=0 && z>0)       inspectCellPropagate(xm1, ym1, zm1, c);
 			}
 		}
 	}
 }
 
-void DynamicEDT3D::inspectCellPropagate(int &nx, int &ny, int &nz, dataCell &c, bool updateRealDist){
-	dataCell nc = data[nx][ny][nz];
+void DynamicEDT3D::inspectCellPropagate(int &nx, int &ny, int &nz, dataCell &c){
+	dataCell nc = getCell(nx,ny,nz);
 	if(!nc.needsRaise) {
 		int distx = nx-c.obstX;
 		int disty = ny-c.obstY;
@@ -494,7 +869,7 @@ void DynamicEDT3D::inspectCellPropagate(int &nx, int &ny, int &nz, dataCell &c,
 			}
 			else {
 				//the neighbor has no valid source obstacle but the raise wave has not yet reached it
-				dataCell tmp = data[nc.obstX][nc.obstY][nc.obstZ];
+				dataCell tmp = getCell(nc.obstX,nc.obstY,nc.obstZ);
 
 				if((tmp.obstX==nc.obstX && tmp.obstY==nc.obstY && tmp.obstZ==nc.obstZ)==false)
 					overwrite = true;
@@ -505,29 +880,26 @@ void DynamicEDT3D::inspectCellPropagate(int &nx, int &ny, int &nz, dataCell &c,
 				open.push(newSqDistance, INTPOINT3D(nx,ny,nz));
 				nc.queueing = fwQueued;
 			}
-			if (updateRealDist) {
-				nc.dist = sqrt((double) newSqDistance);
-			}
 			nc.sqdist = newSqDistance;
 			nc.obstX = c.obstX;
 			nc.obstY = c.obstY;
 			nc.obstZ = c.obstZ;
 		}
-		data[nx][ny][nz] = nc;
+		setCell(nx,ny,nz,nc);
 	}
 }
 
 
 float DynamicEDT3D::getDistance( int x, int y, int z ) const {
 	if( (x>=0) && (x<sizeX) && (y>=0) && (y<sizeY) && (z>=0) && (z<sizeZ)){
-		return data[x][y][z].dist;
+		return getCellDistance(x,y,z);
 	}
 	else return distanceValue_Error;
 }
 
 INTPOINT3D DynamicEDT3D::getClosestObstacle( int x, int y, int z ) const {
 	if( (x>=0) && (x<sizeX) && (y>=0) && (y<sizeY) && (z>=0) && (z<sizeZ)){
-	  dataCell c = data[x][y][z];
+	  dataCell c = getCell(x,y,z);
 	  return INTPOINT3D(c.obstX, c.obstY, c.obstZ);
 	}
 	else return INTPOINT3D(invalidObstData, invalidObstData, invalidObstData);
@@ -535,29 +907,28 @@ INTPOINT3D DynamicEDT3D::getClosestObstacle( int x, int y, int z ) const {
 
 int DynamicEDT3D::getSQCellDistance( int x, int y, int z ) const {
 	if( (x>=0) && (x<sizeX) && (y>=0) && (y<sizeY) && (z>=0) && (z<sizeZ)){
-		return data[x][y][z].sqdist;
+		return getCellSQDistance(x,y,z);
 	}
 	else return distanceInCellsValue_Error;
 }
 
 
-void DynamicEDT3D::commitAndColorize(bool updateRealDist) {
+void DynamicEDT3D::commitAndColorize() {
 	// ADD NEW OBSTACLES
 	for (unsigned int i=0; i<addList.size(); i++) {
 		INTPOINT3D p = addList[i];
 		int x = p.x;
 		int y = p.y;
 		int z = p.z;
-		dataCell c = data[x][y][z];
+		dataCell c = getCell(x,y,z);
 
 		if(c.queueing != fwQueued){
-			if (updateRealDist) c.dist = 0;
 			c.sqdist = 0;
 			c.obstX = x;
 			c.obstY = y;
 			c.obstZ = z;
 			c.queueing = fwQueued;
-			data[x][y][z] = c;
+			setCell(x,y,z,c);
 			open.push(0, INTPOINT3D(x,y,z));
 		}
 	}
@@ -568,24 +939,23 @@ void DynamicEDT3D::commitAndColorize(bool updateRealDist) {
 		int x = p.x;
 		int y = p.y;
 		int z = p.z;
-		dataCell c = data[x][y][z];
+		dataCell c = getCell(x,y,z);
 
 		if (isOccupied(x,y,z,c)==true) continue; // obstacle was removed and reinserted
 		open.push(0, INTPOINT3D(x,y,z));
-		if (updateRealDist) c.dist  = maxDist;
 		c.sqdist = maxDist_squared;
 		c.needsRaise = true;
-		data[x][y][z] = c;
+		setCell(x,y,z,c);
 	}
 	removeList.clear();
 	addList.clear();
 }
 
 bool DynamicEDT3D::isOccupied(int x, int y, int z) const {
-	dataCell c = data[x][y][z];
+	dataCell c = getCell(x,y,z);
 	return (c.obstX==x && c.obstY==y && c.obstZ==z);
 }
 
-bool DynamicEDT3D::isOccupied(int &x, int &y, int &z, dataCell &c) { 
+bool DynamicEDT3D::isOccupied(int x, int y, int z, const dataCell &c) const { 
 	return (c.obstX==x && c.obstY==y && c.obstZ==z);
 }
@@ -0,0 +1,480 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include <dynamicEDT3D/dynamicEDT3D.h>
+#include <dynamicEDT3D/dynamicEDTOctomap.h>
+#include "testing.h"
+
+// deterministic pseudo random numbers in [0, 1)
+double randomUniform(unsigned int& state) {
+  state = state * 1103515245u + 12345u;
+  return ((state >> 8) & 0xFFFF) / 65536.0;
+}
+
+// squared distance to the closest obstacle, clamped at max_sqdist
+int bruteForceSQDistance(const std::vector<INTPOINT3D>& obstacles, int x, int y, int z, int max_sqdist) {
+  int sqdist = max_sqdist;
+  for (size_t i = 0; i < obstacles.size(); ++i) {
+    int dx = x - obstacles[i].x;
+    int dy = y - obstacles[i].y;
+    int dz = z - obstacles[i].z;
+    int d = dx*dx + dy*dy + dz*dz;
+    if (d < sqdist)
+      sqdist = d;
+  }
+  return sqdist;
+}
+
+// compares all cells of edt with a brute force distance transform of obstacles
+void checkDistanceMap(const DynamicEDT3D& edt, const std::vector<INTPOINT3D>& obstacles, int max_sqdist) {
+  for (int x = 0; x < (int) edt.getSizeX(); ++x) {
+    for (int y = 0; y < (int) edt.getSizeY(); ++y) {
+      for (int z = 0; z < (int) edt.getSizeZ(); ++z) {
+        int sqdist = bruteForceSQDistance(obstacles, x, y, z, max_sqdist);
+        EXPECT_EQ (edt.getSQCellDistance(x, y, z), sqdist);
+        EXPECT_FLOAT_EQ (edt.getDistance(x, y, z), sqrt((double) sqdist));
+        EXPECT_EQ (edt.isOccupied(x, y, z), (sqdist == 0));
+        if (sqdist < max_sqdist) {
+          // any of several equidistant obstacles
+          INTPOINT3D o = edt.getClosestObstacle(x, y, z);
+          EXPECT_TRUE (edt.isOccupied(o.x, o.y, o.z));
+          EXPECT_EQ ((x-o.x)*(x-o.x) + (y-o.y)*(y-o.y) + (z-o.z)*(z-o.z), sqdist);
+        }
+      }
+    }
+  }
+}
+
+// number of 8x8x8 blocks with a cell closer than sqrt(below_sqdist) to one of the obstacles
+size_t countBlocksNearObstacles(int size_x, int size_y, int size_z, const std::vector<INTPOINT3D>& obstacles,
+                                int below_sqdist) {
+  const int blocks_y = (size_y+7)/8, blocks_z = (size_z+7)/8;
+  std::vector<bool> near ((size_t) (size_x+7)/8 * blocks_y * blocks_z, false);
+  for (int x = 0; x < size_x; ++x) {
+    for (int y = 0; y < size_y; ++y) {
+      for (int z = 0; z < size_z; ++z) {
+        if (bruteForceSQDistance(obstacles, x, y, z, below_sqdist) < below_sqdist)
+          near[((size_t) (x/8)*blocks_y + y/8)*blocks_z + z/8] = true;
+      }
+    }
+  }
+  return std::count(near.begin(), near.end(), true);
+}
+
+// random point in the cube [-extent, extent]^3
+octomap::point3d randomPoint(double extent, unsigned int& state) {
+  double x = (2*randomUniform(state) - 1) * extent;
+  double y = (2*randomUniform(state) - 1) * extent;
+  double z = (2*randomUniform(state) - 1) * extent;
+  return octomap::point3d((float) x, (float) y, (float) z);
+}
+
+// random occupied and free voxels, log-odds updates are large enough to flip the state of a voxel
+void randomScene(octomap::OcTree& tree, double extent, int num_occupied, int num_free, unsigned int& state) {
+  for (int i = 0; i < num_occupied; ++i)
+    tree.updateNode(randomPoint(extent, state), 2.0f);
+  for (int i = 0; i < num_free; ++i)
+    tree.updateNode(randomPoint(extent, state), -2.0f);
+}
+
+// compares the distance maps at all voxel centers in the box (and one voxel around it),
+// closest obstacles are compared if compare_obstacles is set
+void compareDistanceMaps(const DynamicEDTOctomap& a, const DynamicEDTOctomap& b, const octomap::OcTree& tree,
+                         const octomap::point3d& min, const octomap::point3d& max, bool compare_obstacles) {
+  octomap::OcTreeKey min_key = tree.coordToKey(min);
+  octomap::OcTreeKey max_key = tree.coordToKey(max);
+  for (int kx = min_key[0]-1; kx <= max_key[0]+1; ++kx) {
+    for (int ky = min_key[1]-1; ky <= max_key[1]+1; ++ky) {
+      for (int kz = min_key[2]-1; kz <= max_key[2]+1; ++kz) {
+        octomap::point3d p = tree.keyToCoord(octomap::OcTreeKey(kx, ky, kz));
+        EXPECT_EQ (a.getSquaredDistanceInCells(p), b.getSquaredDistanceInCells(p));
+        if (!compare_obstacles)
+          continue;
+        float distance_a, distance_b;
+        octomap::point3d obstacle_a, obstacle_b;
+        a.getDistanceAndClosestObstacle(p, distance_a, obstacle_a);
+        b.getDistanceAndClosestObstacle(p, distance_b, obstacle_b);
+        EXPECT_EQ (distance_a, distance_b);
+        EXPECT_EQ (obstacle_a, obstacle_b);
+      }
+    }
+  }
+}
+
+// obstacles of a random map with the given density
+void randomObstacles(int size_x, int size_y, int size_z, double density, unsigned int& state,
+                     std::vector<INTPOINT3D>& obstacles) {
+  obstacles.clear();
+  for (int x = 0; x < size_x; ++x)
+    for (int y = 0; y < size_y; ++y)
+      for (int z = 0; z < size_z; ++z)
+        if (randomUniform(state) < density)
+          obstacles.push_back(INTPOINT3D(x, y, z));
+}
+
+int main(int argc, char** argv) {
+
+  if (argc != 2){
+    std::cerr << "Error: you need to specify a test as argument" << std::endl;
+    return 1; // exit 1 means failure
+  }
+  std::string test_name (argv[1]);
+
+
+  // ------------------------------------------------------------
+  if (test_name == "DistanceMap") {
+    // random obstacles, the size is not a multiple of the block size
+    const int size_x = 37, size_y = 29, size_z = 23;
+    const int max_sqdist = 8*8;
+    unsigned int state = 42;
+    std::vector<INTPOINT3D> obstacles;
+    randomObstacles(size_x, size_y, size_z, 0.003, state, obstacles);
+
+    // initializeMap() takes ownership of the grid
+    bool*** grid = new bool**[size_x];
+    for (int x = 0; x < size_x; ++x) {
+      grid[x] = new bool*[size_y];
+      for (int y = 0; y < size_y; ++y) {
+        grid[x][y] = new bool[size_z];
+        for (int z = 0; z < size_z; ++z)
+          grid[x][y][z] = false;
+      }
+    }
+    for (size_t i = 0; i < obstacles.size(); ++i)
+      grid[obstacles[i].x][obstacles[i].y][obstacles[i].z] = true;
+
+    DynamicEDT3D edt (max_sqdist);
+    edt.initializeMap(size_x, size_y, size_z, grid);
+    edt.update();
+    checkDistanceMap(edt, obstacles, max_sqdist);
+
+    // incremental updates: remove and add obstacles
+    for (int round = 0; round < 3; ++round) {
+      std::vector<INTPOINT3D> remaining;
+      for (size_t i = 0; i < obstacles.size(); ++i) {
+        if (randomUniform(state) < 0.3)
+          edt.clearCell(obstacles[i].x, obstacles[i].y, obstacles[i].z);
+        else
+          remaining.push_back(obstacles[i]);
+      }
+      std::vector<INTPOINT3D> added;
+      randomObstacles(size_x, size_y, size_z, 0.001, state, added);
+      for (size_t i = 0; i < added.size(); ++i) {
+        if (edt.isOccupied(added[i].x, added[i].y, added[i].z))
+          continue;
+        edt.occupyCell(added[i].x, added[i].y, added[i].z);
+        remaining.push_back(added[i]);
+      }
+      obstacles.swap(remaining);
+      edt.update();
+      checkDistanceMap(edt, obstacles, max_sqdist);
+    }
+
+    // outside of the map
+    EXPECT_EQ (edt.getDistance(-1, 0, 0), DynamicEDT3D::distanceValue_Error);
+    EXPECT_EQ (edt.getSQCellDistance(0, size_y, 0), DynamicEDT3D::distanceInCellsValue_Error);
+    EXPECT_EQ (edt.getClosestObstacle(0, 0, size_z).x, (int) DynamicEDT3D::invalidObstData);
+
+    // obstacles further away than 127 cells (8 bit offsets) are represented
+    const int far_sqdist = 250*250;
+    DynamicEDT3D far_edt (far_sqdist);
+    far_edt.initializeEmpty(300, 2, 2);
+    far_edt.occupyCell(0, 0, 0);
+    far_edt.update();
+    obstacles.assign(1, INTPOINT3D(0, 0, 0));
+    checkDistanceMap(far_edt, obstacles, far_sqdist);
+    EXPECT_EQ (far_edt.getSQCellDistance(200, 1, 1), 200*200 + 2);
+    EXPECT_EQ (far_edt.getClosestObstacle(200, 1, 1).x, 0);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Rebuild") {
+    const octomap::point3d min (-1.0f, -0.8f, -0.6f);
+    const octomap::point3d max (1.2f, 0.9f, 0.7f);
+    for (int config = 0; config < 3; ++config) {
+      const bool unknown_occupied = (config == 2);
+      const bool sparse = (config == 1);
+      unsigned int state = 7 + config;
+      octomap::OcTree tree (0.1);
+      randomScene(tree, 1.5, 150, 1500, state);
+
+      DynamicEDTOctomap rebuilt (0.6f, &tree, min, max, unknown_occupied, sparse);
+      DynamicEDTOctomap incremental (0.6f, &tree, min, max, unknown_occupied, sparse);
+      rebuilt.update();
+      incremental.update();
+
+      // changes are consumed by the first update() or rebuild()
+      randomScene(tree, 1.5, 60, 600, state);
+      incremental.update();
+      rebuilt.rebuild();
+
+      DynamicEDTOctomap fresh (0.6f, &tree, min, max, unknown_occupied, sparse);
+      fresh.update();
+      EXPECT_TRUE (rebuilt.checkConsistency());
+      EXPECT_TRUE (fresh.checkConsistency());
+
+      // ties are resolved identically, the incremental update may choose another of several equidistant obstacles
+      compareDistanceMaps(rebuilt, fresh, tree, min, max, true);
+      compareDistanceMaps(incremental, fresh, tree, min, max, false);
+      if (sparse)
+        EXPECT_EQ (rebuilt.getNumAllocatedBlocks(), fresh.getNumAllocatedBlocks());
+    }
+
+  // ------------------------------------------------------------
+  } else if (test_name == "SparseMap") {
+    // mostly free map with a few clusters of obstacles
+    const int size_x = 70, size_y = 61, size_z = 45;
+    const int max_sqdist = 5*5;
+    unsigned int state = 3;
+    DynamicEDT3D dense (max_sqdist);
+    DynamicEDT3D sparse (max_sqdist);
+    dense.initializeEmpty(size_x, size_y, size_z);
+    sparse.initializeEmpty(size_x, size_y, size_z, true, true);
+    EXPECT_FALSE (dense.isSparse());
+    EXPECT_TRUE (sparse.isSparse());
+    EXPECT_EQ (sparse.getNumAllocatedBlocks(), (size_t) 0);
+
+    std::vector<INTPOINT3D> obstacles;
+    for (int c = 0; c < 4; ++c) {
+      int cx = (int) (randomUniform(state) * size_x);
+      int cy = (int) (randomUniform(state) * size_y);
+      int cz = (int) (randomUniform(state) * size_z);
+      for (int i = 0; i < 20; ++i) {
+        INTPOINT3D p (cx + (int) (randomUniform(state)*6) - 3, cy + (int) (randomUniform(state)*6) - 3,
+                      cz + (int) (randomUniform(state)*6) - 3);
+        if (p.x < 0 || p.x >= size_x || p.y < 0 || p.y >= size_y || p.z < 0 || p.z >= size_z
+            || dense.isOccupied(p.x, p.y, p.z))
+          continue;
+        dense.occupyCell(p.x, p.y, p.z);
+        sparse.occupyCell(p.x, p.y, p.z);
+        obstacles.push_back(p);
+      }
+    }
+    std::vector<INTPOINT3D> all_obstacles = obstacles; // obstacles that were ever set
+
+    for (int round = 0; round < 4; ++round) {
+      dense.update();
+      sparse.update();
+      checkDistanceMap(sparse, obstacles, max_sqdist);
+      for (int x = 0; x < size_x; ++x) {
+        for (int y = 0; y < size_y; ++y) {
+          for (int z = 0; z < size_z; ++z) {
+            EXPECT_EQ (sparse.getSQCellDistance(x, y, z), dense.getSQCellDistance(x, y, z));
+            EXPECT_EQ (sparse.getClosestObstacle(x, y, z).x, dense.getClosestObstacle(x, y, z).x);
+            EXPECT_EQ (sparse.getClosestObstacle(x, y, z).y, dense.getClosestObstacle(x, y, z).y);
+            EXPECT_EQ (sparse.getClosestObstacle(x, y, z).z, dense.getClosestObstacle(x, y, z).z);
+          }
+        }
+      }
+
+      // the initial update allocates exactly the blocks with distances below the maximum, incremental updates
+      // only blocks within the maximum distance (plus one cell diagonal) of current or removed obstacles
+      const int ring_sqdist = 46; // > (5 + sqrt(3))^2
+      size_t total_blocks = (size_t) ((size_x+7)/8) * ((size_y+7)/8) * ((size_z+7)/8);
+      EXPECT_EQ (dense.getNumAllocatedBlocks(), total_blocks);
+      if (round == 0)
+        EXPECT_EQ (sparse.getNumAllocatedBlocks(), countBlocksNearObstacles(size_x, size_y, size_z, obstacles, max_sqdist));
+      EXPECT_TRUE (sparse.getNumAllocatedBlocks() <=
+                   countBlocksNearObstacles(size_x, size_y, size_z, all_obstacles, ring_sqdist));
+      EXPECT_TRUE (sparse.getNumAllocatedBlocks() < total_blocks / 2);
+
+      // move some obstacles
+      std::vector<INTPOINT3D> remaining;
+      for (size_t i = 0; i < obstacles.size(); ++i) {
+        if (randomUniform(state) < 0.2) {
+          dense.clearCell(obstacles[i].x, obstacles[i].y, obstacles[i].z);
+          sparse.clearCell(obstacles[i].x, obstacles[i].y, obstacles[i].z);
+        } else {
+          remaining.push_back(obstacles[i]);
+        }
+      }
+      for (int i = 0; i < 5; ++i) {
+        INTPOINT3D p ((int) (randomUniform(state) * size_x), (int) (randomUniform(state) * size_y),
+                      (int) (randomUniform(state) * size_z));
+        if (dense.isOccupied(p.x, p.y, p.z))
+          continue;
+        dense.occupyCell(p.x, p.y, p.z);
+        sparse.occupyCell(p.x, p.y, p.z);
+        remaining.push_back(p);
+        all_obstacles.push_back(p);
+      }
+      obstacles.swap(remaining);
+    }
+
+    // the same for distance maps of an octomap, with incremental changes. Each map needs its
+    // own tree, update() consumes the changes of the tree.
+    octomap::OcTree dense_tree (0.1);
+    randomScene(dense_tree, 0.5, 40, 400, state);
+    octomap::OcTree sparse_tree (dense_tree);
+    const octomap::point3d min (-3.0f, -2.5f, -2.0f);
+    const octomap::point3d max (3.0f, 2.5f, 2.0f);
+    DynamicEDTOctomap dense_map (0.5f, &dense_tree, min, max, false);
+    DynamicEDTOctomap sparse_map (0.5f, &sparse_tree, min, max, false, true);
+    EXPECT_TRUE (sparse_map.isSparse());
+    dense_map.update();
+    sparse_map.update();
+    compareDistanceMaps(dense_map, sparse_map, dense_tree, min, max, true);
+    EXPECT_TRUE (sparse_map.getNumAllocatedBlocks() < dense_map.getNumAllocatedBlocks() / 2);
+
+    unsigned int scene_state = state;
+    randomScene(dense_tree, 0.5, 20, 400, scene_state);
+    randomScene(sparse_tree, 0.5, 20, 400, state);
+    dense_map.update();
+    sparse_map.update();
+    compareDistanceMaps(dense_map, sparse_map, dense_tree, min, max, true);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Interpolation") {
+    unsigned int state = 11;
+    octomap::OcTree tree (0.1);
+    randomScene(tree, 1.5, 150, 1500, state);
+    const octomap::point3d min (-1.0f, -0.8f, -0.6f);
+    const octomap::point3d max (1.2f, 0.9f, 0.7f);
+    DynamicEDTOctomap distmap (0.8f, &tree, min, max, false);
+    distmap.update();
+    const float resolution = (float) tree.getResolution();
+
+    // the interpolation is exact at the voxel centers
+    octomap::OcTreeKey min_key = tree.coordToKey(min);
+    octomap::OcTreeKey max_key = tree.coordToKey(max);
+    std::vector<octomap::point3d> centers;
+    for (int kx = min_key[0]; kx <= max_key[0]; ++kx) {
+      for (int ky = min_key[1]; ky <= max_key[1]; ++ky) {
+        for (int kz = min_key[2]; kz <= max_key[2]; ++kz) {
+          octomap::point3d p = tree.keyToCoord(octomap::OcTreeKey(kx, ky, kz));
+          float distance = distmap.getDistance(p);
+          if (distance == DynamicEDTOctomap::distanceValue_Error)
+            continue;
+          EXPECT_NEAR (distmap.getInterpolatedDistance(p), distance, 1e-5);
+          centers.push_back(p);
+        }
+      }
+    }
+    EXPECT_TRUE (centers.size() > 1000);
+
+    // analytic gradients match central differences inside the cells between voxel centers,
+    // where the interpolation is linear along each axis
+    std::vector<octomap::point3d> points;
+    while (points.size() < 500) {
+      octomap::point3d center = centers[(size_t) (randomUniform(state) * centers.size())];
+      octomap::point3d p = center + octomap::point3d((float) (0.1 + 0.8*randomUniform(state)),
+                                                     (float) (0.1 + 0.8*randomUniform(state)),
+                                                     (float) (0.1 + 0.8*randomUniform(state))) * resolution;
+      octomap::point3d upper = center + octomap::point3d(1.0f, 1.0f, 1.0f) * resolution;
+      if (distmap.getDistance(upper) != DynamicEDTOctomap::distanceValue_Error)
+        points.push_back(p);
+    }
+    const float h = 0.02f * resolution;
+    size_t num_sloped = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+      octomap::point3d gradient;
+      float distance = distmap.getInterpolatedDistance(points[i], gradient);
+      EXPECT_TRUE (distance >= 0.0f && distance <= distmap.getMaxDist() + 1e-5);
+      if (gradient.norm() > 0.1)
+        ++num_sloped;
+      for (int j = 0; j < 3; ++j) {
+        octomap::point3d step (0.0f, 0.0f, 0.0f);
+        step(j) = h;
+        float difference = (distmap.getInterpolatedDistance(points[i] + step)
+                            - distmap.getInterpolatedDistance(points[i] - step)) / (2*h);
+        EXPECT_NEAR (gradient(j), difference, 1e-3);
+      }
+    }
+    EXPECT_TRUE (num_sloped > points.size() / 2);
+
+    // points outside of the map
+    std::vector<octomap::point3d> outside;
+    outside.push_back(max + octomap::point3d(0.5f, 0.0f, 0.0f));
+    outside.push_back(min - octomap::point3d(0.0f, 0.5f, 0.0f));
+    outside.push_back(octomap::point3d(0.0f, 0.0f, max.z() + 0.5f));
+    outside.push_back(octomap::point3d(100.0f, -100.0f, 100.0f));
+    for (size_t i = 0; i < outside.size(); ++i) {
+      octomap::point3d gradient (1.0f, 1.0f, 1.0f);
+      EXPECT_EQ (distmap.getInterpolatedDistance(outside[i], gradient), DynamicEDTOctomap::distanceValue_Error);
+      EXPECT_EQ (gradient, octomap::point3d(0.0f, 0.0f, 0.0f));
+      EXPECT_EQ (distmap.getInterpolatedDistance(outside[i]), DynamicEDTOctomap::distanceValue_Error);
+    }
+
+    // the batch versions (in several chunks) match the single point queries
+    points.insert(points.end(), outside.begin(), outside.end());
+    for (int parallel = 0; parallel < 2; ++parallel) {
+      std::vector<float> distances, distances_only;
+      std::vector<octomap::point3d> gradients;
+      distmap.getInterpolatedDistances(points, distances, gradients, parallel != 0);
+      distmap.getInterpolatedDistances(points, distances_only, parallel != 0);
+      EXPECT_EQ (distances.size(), points.size());
+      EXPECT_EQ (gradients.size(), points.size());
+      for (size_t i = 0; i < points.size(); ++i) {
+        octomap::point3d gradient;
+        float distance = distmap.getInterpolatedDistance(points[i], gradient);
+        EXPECT_EQ (distances[i], distance);
+        EXPECT_EQ (distances_only[i], distance);
+        EXPECT_EQ (gradients[i], gradient);
+      }
+    }
+
+  // ------------------------------------------------------------
+  } else if (test_name == "MoveWindow") {
+    const octomap::point3d min (-0.8f, -0.6f, -0.5f);
+    const octomap::point3d max (0.7f, 0.6f, 0.5f);
+    // window centers: small moves, a move without a shift and one larger than the window
+    std::vector<octomap::point3d> centers;
+    centers.push_back(octomap::point3d(0.3f, 0.0f, 0.0f));
+    centers.push_back(octomap::point3d(0.1f, 0.45f, -0.2f));
+    centers.push_back(octomap::point3d(0.1f, 0.45f, -0.2f));
+    centers.push_back(octomap::point3d(2.5f, -1.0f, 0.6f));
+    centers.push_back(octomap::point3d(2.3f, -1.2f, 0.9f));
+    centers.push_back(octomap::point3d(0.0f, 0.0f, 0.0f));
+
+    for (int config = 0; config < 3; ++config) {
+      const bool unknown_occupied = (config == 2);
+      const bool sparse = (config == 1);
+      unsigned int state = 5 + config;
+      octomap::OcTree tree (0.1);
+      randomScene(tree, 2.0, 300, 3000, state);
+      DynamicEDTOctomap moved (0.5f, &tree, min, max, unknown_occupied, sparse);
+      moved.update();
+
+      octomap::OcTreeKey min_key = tree.coordToKey(min);
+      octomap::OcTreeKey max_key = tree.coordToKey(max);
+      octomap::point3d window_min = min, window_max = max;
+      for (size_t i = 0; i < centers.size(); ++i) {
+        // changes of the octree before the move are applied by moveWindow()
+        randomScene(tree, 3.0, 20, 200, state);
+        EXPECT_TRUE (moved.moveWindow(centers[i]));
+        EXPECT_TRUE (moved.checkConsistency());
+
+        // the window keeps its size and is centered at the voxel of the new center
+        octomap::OcTreeKey center_key = tree.coordToKey(centers[i]);
+        octomap::OcTreeKey window_min_key, window_max_key;
+        for (int j = 0; j < 3; ++j) {
+          int size = max_key[j] - min_key[j] + 1;
+          window_min_key[j] = (unsigned short int) (center_key[j] - size/2);
+          window_max_key[j] = (unsigned short int) (window_min_key[j] + size - 1);
+        }
+        window_min = tree.keyToCoord(window_min_key);
+        window_max = tree.keyToCoord(window_max_key);
+        DynamicEDTOctomap fresh (0.5f, &tree, window_min, window_max, unknown_occupied, sparse);
+        fresh.update();
+        compareDistanceMaps(moved, fresh, tree, window_min, window_max, false);
+      }
+
+      // the octree's range is exceeded, the map is unchanged
+      EXPECT_FALSE (moved.moveWindow(octomap::point3d(5000.0f, 0.0f, 0.0f)));
+      DynamicEDTOctomap fresh (0.5f, &tree, window_min, window_max, unknown_occupied, sparse);
+      fresh.update();
+      compareDistanceMaps(moved, fresh, tree, window_min, window_max, false);
+    }
+
+  // ------------------------------------------------------------
+  } else {
+    std::cerr << "Invalid test name specified: " << test_name << std::endl;
+    return 1;
+
+  }
+
+  std::cerr << "Test successful.\n";
+  return 0;
+}
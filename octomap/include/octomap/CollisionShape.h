@@ -0,0 +1,94 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_COLLISION_SHAPE_H
+#define OCTOMAP_COLLISION_SHAPE_H
+
+#include <octomap/octomap_types.h>
+
+namespace octomap {
+
+  /**
+   * Geometric primitive for collision checks against an occupancy map, see
+   * OccupancyOcTreeBase::collides(). Supported are spheres, axis-aligned boxes,
+   * oriented boxes and capsules (line segments with a radius).
+   */
+  class CollisionShape {
+  public:
+    enum ShapeType { SPHERE, BOX, ORIENTED_BOX, CAPSULE };
+
+    /// sphere around center
+    static CollisionShape sphere(const point3d& center, double radius);
+    /// axis-aligned box from min to max
+    static CollisionShape box(const point3d& min, const point3d& max);
+    /// box with half_extents along the axes of pose, centered at its origin
+    static CollisionShape orientedBox(const pose6d& pose, const point3d& half_extents);
+    /// all points within radius of the line segment from p1 to p2
+    static CollisionShape capsule(const point3d& p1, const point3d& p2, double radius);
+
+    /// @return shape transformed by pose (e.g. from robot to map coordinates). Boxes become oriented boxes.
+    CollisionShape transform(const pose6d& pose) const;
+
+    /// @return true if the shape intersects the axis-aligned cube at center with the given half size
+    bool intersectsCube(const point3d& center, double half_size) const;
+
+    ShapeType getType() const { return type; }
+    /// minimum corner of the shape's axis-aligned bounding box
+    const point3d& getBBXMin() const { return bbx_min; }
+    /// maximum corner of the shape's axis-aligned bounding box
+    const point3d& getBBXMax() const { return bbx_max; }
+
+  protected:
+    CollisionShape(ShapeType type) : type(type), radius(0.0) {}
+
+    /// computes bbx_min and bbx_max from the parameters of the shape
+    void updateBBX();
+
+    bool orientedBoxIntersectsCube(const point3d& cube_center, double half_size) const;
+    /// squared distance of the segment p1-p2 to the cube
+    double segmentCubeDistanceSq(const point3d& cube_center, double half_size) const;
+
+    ShapeType type;
+    point3d center;       ///< sphere, oriented box
+    point3d p1;           ///< capsule start, box min
+    point3d p2;           ///< capsule end, box max
+    point3d axes[3];      ///< oriented box: unit axes
+    point3d half_extents; ///< oriented box
+    double radius;        ///< sphere, capsule
+    point3d bbx_min;
+    point3d bbx_max;
+  };
+
+} // end namespace
+
+#endif
@@ -36,6 +36,7 @@
 
 
 #include <iostream>
+#include <vector>
 #include <octomap/OcTreeNode.h>
 #include <octomap/OccupancyOcTreeBase.h>
 
@@ -163,6 +164,26 @@ namespace octomap {
       return integrateNodeColor(key,r,g,b);
     }
 
+    /**
+     * Integrates a colored Pointcloud (in global reference frame). Same as insertPointCloud()
+     * followed by integrateNodeColor() for every endpoint and updateInnerOccupancy(), but in a
+     * single pass: colors are integrated into the occupied endpoints while updating them, and
+     * the occupancy and color of inner nodes are only updated along the paths to updated voxels,
+     * each inner node once. Voxels are updated in Morton order.
+     *
+     * @param scan Pointcloud (measurement endpoints), in global reference frame
+     * @param colors color of each point of scan
+     * @param sensor_origin measurement origin in global reference frame
+     * @param maxrange maximum range for how long individual beams are inserted (default -1: complete beam)
+     * @param lazy_eval whether update of inner nodes is omitted after the update (default: false).
+     *   This speeds up the insertion, but you need to call updateInnerOccupancy() when done.
+     * @param discretize whether the scan is discretized first into octree key cells (default: false),
+     *   see insertPointCloud()
+     */
+    void insertColoredPointCloud(const Pointcloud& scan, const std::vector<ColorOcTreeNode::Color>& colors,
+                                 const point3d& sensor_origin, double maxrange = -1., bool lazy_eval = false,
+                                 bool discretize = false);
+
     // update inner nodes, sets color to average child color
     void updateInnerOccupancy();
 
@@ -172,6 +193,14 @@ namespace octomap {
   protected:
     void updateInnerOccupancyRecurs(ColorOcTreeNode* node, unsigned int depth);
 
+    /// updates (or prunes) the inner nodes on the paths to the voxels with the
+    /// sorted Morton codes [begin, end), see insertColoredPointCloud()
+    void updateInnerNodesRecurs(ColorOcTreeNode* node, unsigned int depth,
+                                const uint64_t* begin, const uint64_t* end);
+
+    /// integrates a color measurement into node, see integrateNodeColor()
+    void integrateColor(ColorOcTreeNode* node, uint8_t r, uint8_t g, uint8_t b) const;
+
     /**
      * Static member object which ensures that this OcTree's prototype
      * ends up in the classIDMapping only once. You need this as a 
@@ -80,11 +80,14 @@ namespace octomap {
     CountingOcTree(double resolution);
     virtual CountingOcTreeNode* updateNode(const point3d& value);
     CountingOcTreeNode* updateNode(const OcTreeKey& k);
+    /// appends the centers of all leafs with at least min_hits counts to node_centers
+    void getCentersMinHits(std::vector<point3d>& node_centers, unsigned int min_hits) const;
+    /// \deprecated std::list version of getCentersMinHits(), use the std::vector version instead
     void getCentersMinHits(point3d_list& node_centers, unsigned int min_hits) const;
 
   protected:
 
-    void getCentersMinHitsRecurs( point3d_list& node_centers,
+    void getCentersMinHitsRecurs( std::vector<point3d>& node_centers,
                                   unsigned int& min_hits,
                                   unsigned int max_depth,
                                   CountingOcTreeNode* node, unsigned int depth,
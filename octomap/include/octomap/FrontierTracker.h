@@ -0,0 +1,116 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_FRONTIER_TRACKER_H
+#define OCTOMAP_FRONTIER_TRACKER_H
+
+#include <vector>
+#include <limits>
+#include <octomap/OcTreeKey.h>
+
+namespace octomap {
+
+  /**
+   * Maintains the frontier of an occupancy map: all free voxels (at the finest
+   * resolution) with at least one unknown face neighbor. The frontier is updated
+   * incrementally from the change detection of the tree (see
+   * OccupancyOcTreeBase::enableChangeDetection()), only voxels around changed
+   * keys are re-evaluated, so that the cost depends on the size of the change
+   * instead of the size of the map.
+   *
+   * Changes which are not reported by the change detection (e.g. deleteNode(),
+   * merge() or setNodeValueBBX() on coarse nodes) require a rebuild().
+   *
+   * Usage:
+   * \code
+   * tree.enableChangeDetection(true);
+   * FrontierTracker<OcTree> frontier(tree);
+   * tree.insertPointCloud(...);
+   * frontier.update(); // consumes and resets the tree's changed keys
+   * frontier.getClusters(clusters);
+   * \endcode
+   */
+  template <class TREE>
+  class FrontierTracker {
+  public:
+    typedef KeySet::const_iterator iterator;
+
+    /// tracks the frontier of tree, call rebuild() if tree is not empty
+    FrontierTracker(TREE& tree) : tree(tree) {}
+
+    /// recomputes the frontier from scratch by traversing all free leafs, O(map)
+    void rebuild();
+
+    /**
+     * Re-evaluates the voxels at and next to all keys changed since the last
+     * update, O(changes).
+     *
+     * @param reset_change_detection reset the tree's changed keys afterwards
+     *   (default: true), otherwise this has to be done before the next update
+     */
+    void update(bool reset_change_detection = true);
+
+    /// @return true if the voxel at key is in the frontier
+    bool isFrontier(const OcTreeKey& key) const { return frontier.find(key) != frontier.end(); }
+
+    /// number of frontier voxels
+    size_t size() const { return frontier.size(); }
+
+    iterator begin() const { return frontier.begin(); }
+    iterator end() const { return frontier.end(); }
+
+    /**
+     * Groups the frontier into connected clusters (26-neighborhood).
+     *
+     * @param[out] clusters keys of the frontier voxels, one vector per cluster
+     * @param min_size clusters with fewer voxels are omitted (default: 1)
+     */
+    void getClusters(std::vector<std::vector<OcTreeKey> >& clusters, size_t min_size = 1) const;
+
+  protected:
+    /// @return true if the voxel at key is known free and a face neighbor is unknown
+    bool evaluate(const OcTreeKey& key) const;
+    /// re-evaluates the voxel at key and updates the frontier
+    void updateVoxel(const OcTreeKey& key);
+    /// @return false if the neighbor at offset is outside of the key range
+    static bool neighborKey(const OcTreeKey& key, int dx, int dy, int dz, OcTreeKey& neighbor);
+
+    TREE& tree;
+    KeySet frontier;
+  };
+
+} // end namespace
+
+#include "octomap/FrontierTracker.hxx"
+
+#endif
@@ -0,0 +1,157 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+namespace octomap {
+
+  template <class TREE>
+  void FrontierTracker<TREE>::rebuild() {
+    frontier.clear();
+
+    for (typename TREE::leaf_iterator it = tree.begin_leafs(); it != tree.end_leafs(); ++it) {
+      if (tree.isNodeOccupied(*it))
+        continue;
+
+      // only voxels on the surface of a (pruned) free leaf can have unknown neighbors
+      const unsigned int size = 1 << (tree.getTreeDepth() - it.getDepth());
+      const OcTreeKey min_key = it.getIndexKey();
+      OcTreeKey key;
+      for (unsigned int x = 0; x < size; ++x) {
+        key[0] = key_type(min_key[0] + x);
+        for (unsigned int y = 0; y < size; ++y) {
+          key[1] = key_type(min_key[1] + y);
+          const bool side = (x == 0 || y == 0 || x == size-1 || y == size-1);
+          const unsigned int z_step = (side || size == 1) ? 1 : size-1;
+          for (unsigned int z = 0; z < size; z += z_step) {
+            key[2] = key_type(min_key[2] + z);
+            if (evaluate(key))
+              frontier.insert(key);
+          }
+        }
+      }
+    }
+  }
+
+  template <class TREE>
+  void FrontierTracker<TREE>::update(bool reset_change_detection) {
+    // a voxel's state depends on itself and its face neighbors
+    KeySet candidates;
+    OcTreeKey neighbor;
+    for (KeyBoolMap::const_iterator it = tree.changedKeysBegin(); it != tree.changedKeysEnd(); ++it) {
+      candidates.insert(it->first);
+      for (int i = 0; i < 3; ++i) {
+        for (int d = -1; d <= 1; d += 2) {
+          if (neighborKey(it->first, i == 0 ? d : 0, i == 1 ? d : 0, i == 2 ? d : 0, neighbor))
+            candidates.insert(neighbor);
+        }
+      }
+    }
+
+    for (KeySet::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+      updateVoxel(*it);
+
+    if (reset_change_detection)
+      tree.resetChangeDetection();
+  }
+
+  template <class TREE>
+  void FrontierTracker<TREE>::getClusters(std::vector<std::vector<OcTreeKey> >& clusters, size_t min_size) const {
+    clusters.clear();
+    KeySet visited;
+    std::vector<OcTreeKey> open;
+    OcTreeKey neighbor;
+
+    for (KeySet::const_iterator it = frontier.begin(); it != frontier.end(); ++it) {
+      if (!visited.insert(*it).second)
+        continue;
+
+      // flood fill over the 26-neighborhood
+      std::vector<OcTreeKey> cluster;
+      open.push_back(*it);
+      while (!open.empty()) {
+        OcTreeKey key = open.back();
+        open.pop_back();
+        cluster.push_back(key);
+        for (int dx = -1; dx <= 1; ++dx) {
+          for (int dy = -1; dy <= 1; ++dy) {
+            for (int dz = -1; dz <= 1; ++dz) {
+              if ((dx || dy || dz) && neighborKey(key, dx, dy, dz, neighbor)
+                  && isFrontier(neighbor) && visited.insert(neighbor).second)
+                open.push_back(neighbor);
+            }
+          }
+        }
+      }
+
+      if (cluster.size() >= min_size)
+        clusters.push_back(cluster);
+    }
+  }
+
+  template <class TREE>
+  bool FrontierTracker<TREE>::evaluate(const OcTreeKey& key) const {
+    typename TREE::NodeType* node = tree.search(key);
+    if (node == NULL || tree.isNodeOccupied(node))
+      return false;
+
+    OcTreeKey neighbor;
+    for (int i = 0; i < 3; ++i) {
+      for (int d = -1; d <= 1; d += 2) {
+        if (neighborKey(key, i == 0 ? d : 0, i == 1 ? d : 0, i == 2 ? d : 0, neighbor)
+            && tree.search(neighbor) == NULL)
+          return true;
+      }
+    }
+    return false;
+  }
+
+  template <class TREE>
+  void FrontierTracker<TREE>::updateVoxel(const OcTreeKey& key) {
+    if (evaluate(key))
+      frontier.insert(key);
+    else
+      frontier.erase(key);
+  }
+
+  template <class TREE>
+  bool FrontierTracker<TREE>::neighborKey(const OcTreeKey& key, int dx, int dy, int dz, OcTreeKey& neighbor) {
+    const int offset[3] = { dx, dy, dz };
+    for (unsigned int i = 0; i < 3; ++i) {
+      int k = int(key[i]) + offset[i];
+      if (k < 0 || k > int(std::numeric_limits<key_type>::max()))
+        return false;
+      neighbor[i] = key_type(k);
+    }
+    return true;
+  }
+
+} // end namespace
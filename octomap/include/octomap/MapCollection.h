@@ -58,9 +58,25 @@ namespace octomap {
 
     double getOccupancy(const point3d& p);
 
+    /**
+     * Casts a ray into all submaps it passes (in parallel with OpenMP) and
+     * returns the hit closest to origin. Submaps are visited in the order in
+     * which the ray enters their bounding boxes, submaps entered behind the
+     * closest hit found so far are skipped.
+     */
     bool castRay(const point3d& origin, const point3d& direction, point3d& end,
                  bool ignoreUnknownCells=false, double maxRange=-1.0) const;
 
+    /**
+     * Rebuilds the spatial index used by all queries: a bounding volume hierarchy
+     * over the bounding boxes of the submaps (in the global frame) and their
+     * inverse transforms. The index is rebuilt automatically on the next query
+     * after nodes were added or a node's origin or map changed (see
+     * MapNode::setOrigin() and MapNode::mapChanged()). Call this before
+     * querying from several threads.
+     */
+    void updateIndex() const;
+
     bool writePointcloud(std::string filename);
     bool write(std::string filename);
 
@@ -90,10 +106,47 @@ namespace octomap {
     static void splitPathAndFilename(std::string &filenamefullpath, std::string* path, std::string *filename);
     static std::string combinePathAndFilename(std::string path, std::string filename);
     static bool readTagValue(std::string tag, std::ifstream &infile, std::string* value);
+
+    /// node of the bounding volume hierarchy over all submaps
+    struct BVHNode {
+      point3d min;
+      point3d max;
+      unsigned int right; ///< index of the right child (inner nodes), the left child follows the node
+      unsigned int first; ///< first index into bvh_indices (leafs)
+      unsigned int count; ///< number of submaps (leafs), 0 for inner nodes
+    };
+
+    /// rebuilds the index if nodes were added or changed since the last update
+    void checkIndex() const { if (!index_valid || nodesChanged()) updateIndex(); }
+    /// @return true if the revision of a node differs from the one of the index
+    bool nodesChanged() const;
+    /// recursive call of updateIndex(), builds the hierarchy over bvh_indices[first, first+count)
+    void buildBVHRecurs(unsigned int first, unsigned int count) const;
+    /// indices of all submaps whose bounding box contains p, in ascending order
+    void getCandidates(const point3d& p, std::vector<unsigned int>& candidates) const;
+    static bool inBBX(const point3d& p, const point3d& min, const point3d& max);
+    /// slab test, @return false if the ray misses the box, otherwise t_entry is the
+    /// distance along the ray at which it enters the box (0 if origin is inside)
+    static bool intersectRayBBX(const point3d& origin, const point3d& inv_direction,
+                                const point3d& min, const point3d& max, double& t_entry);
+    /// (distance, index) of all submaps whose bounding box is hit by the ray within
+    /// max_range (negative: unlimited), sorted by the distance of origin to the box
+    /// (a lower bound for the distance of any hit). direction has to be normalized
+    void getCandidates(const point3d& origin, const point3d& direction, double max_range,
+                       std::vector<std::pair<double, unsigned int> >& candidates) const;
     
   protected:
 
     std::vector<MAPNODE*> nodes;
+
+    // spatial index, see updateIndex()
+    mutable bool index_valid;
+    mutable std::vector<BVHNode> bvh;
+    mutable std::vector<unsigned int> bvh_indices; ///< submap indices, grouped by BVH leaf
+    mutable std::vector<pose6d> inv_origins; ///< inverse transforms of the submaps
+    mutable std::vector<unsigned int> node_revisions; ///< MapNode::getRevision() of the submaps
+    mutable std::vector<point3d> bbx_min; ///< bounding box of each submap (global frame)
+    mutable std::vector<point3d> bbx_max;
   };
 
 } // end namespace
@@ -32,17 +32,24 @@
  */
 
 #include <stdio.h>
+#include <math.h>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
+#include <limits>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
 
 namespace octomap {
   
   template <class MAPNODE>
-  MapCollection<MAPNODE>::MapCollection() {
+  MapCollection<MAPNODE>::MapCollection() : index_valid(false) {
   }
 
   template <class MAPNODE>
-  MapCollection<MAPNODE>::MapCollection(std::string filename) {
+  MapCollection<MAPNODE>::MapCollection(std::string filename) : index_valid(false) {
     this->read(filename);
   }
 
@@ -58,6 +65,7 @@ namespace octomap {
     // for(typename std::vector<MAPNODE*>::iterator it= nodes.begin(); it != nodes.end(); ++it)
     //   delete *it;
     nodes.clear();
+    index_valid = false;
   }
 
   template <class MAPNODE>
@@ -115,6 +123,7 @@ namespace octomap {
         return false;
       } else {
         nodes.push_back(node);
+        index_valid = false;
       }
     }
     infile.close();
@@ -124,6 +133,7 @@ namespace octomap {
   template <class MAPNODE>
   void MapCollection<MAPNODE>::addNode( MAPNODE* node){
     nodes.push_back(node);
+    index_valid = false;
   }
 
   template <class MAPNODE>
@@ -140,22 +150,30 @@ namespace octomap {
 
   template <class MAPNODE>
   MAPNODE* MapCollection<MAPNODE>::queryNode(const point3d& p) {
-    for (const_iterator it = this->begin(); it != this->end(); ++it) {
-      point3d ptrans = (*it)->getOrigin().inv().transform(p);
-      typename MAPNODE::TreeType::NodeType* n = (*it)->getMap()->search(ptrans);
+    checkIndex();
+    std::vector<unsigned int> candidates;
+    getCandidates(p, candidates);
+    for (size_t c = 0; c < candidates.size(); ++c) {
+      unsigned int i = candidates[c];
+      point3d ptrans = inv_origins[i].transform(p);
+      typename MAPNODE::TreeType::NodeType* n = nodes[i]->getMap()->search(ptrans);
       if (!n) continue;
-      if ((*it)->getMap()->isNodeOccupied(n)) return (*it);
+      if (nodes[i]->getMap()->isNodeOccupied(n)) return nodes[i];
     }
     return 0;
   }
 
   template <class MAPNODE>
   bool MapCollection<MAPNODE>::isOccupied(const point3d& p) const {
-    for (const_iterator it = this->begin(); it != this->end(); ++it) {
-      point3d ptrans = (*it)->getOrigin().inv().transform(p);
-      typename MAPNODE::TreeType::NodeType* n = (*it)->getMap()->search(ptrans);
+    checkIndex();
+    std::vector<unsigned int> candidates;
+    getCandidates(p, candidates);
+    for (size_t c = 0; c < candidates.size(); ++c) {
+      unsigned int i = candidates[c];
+      point3d ptrans = inv_origins[i].transform(p);
+      typename MAPNODE::TreeType::NodeType* n = nodes[i]->getMap()->search(ptrans);
       if (!n) continue;
-      if ((*it)->getMap()->isNodeOccupied(n)) return true;
+      if (nodes[i]->getMap()->isNodeOccupied(n)) return true;
     }
     return false;
   }
@@ -169,11 +187,15 @@ namespace octomap {
 
   template <class MAPNODE>
   double MapCollection<MAPNODE>::getOccupancy(const point3d& p) {
+    checkIndex();
+    std::vector<unsigned int> candidates;
+    getCandidates(p, candidates);
     double max_occ_val = 0;
     bool is_unknown = true;
-    for (const_iterator it = this->begin(); it != this->end(); ++it) {
-      point3d ptrans = (*it)->getOrigin().inv().transform(p);
-      typename MAPNODE::TreeType::NodeType* n = (*it)->getMap()->search(ptrans);
+    for (size_t c = 0; c < candidates.size(); ++c) {
+      unsigned int i = candidates[c];
+      point3d ptrans = inv_origins[i].transform(p);
+      typename MAPNODE::TreeType::NodeType* n = nodes[i]->getMap()->search(ptrans);
       if (n) {
         double occ = n->getOccupancy();
         if (occ > max_occ_val) max_occ_val = occ;
@@ -188,31 +210,238 @@ namespace octomap {
   template <class MAPNODE>
   bool MapCollection<MAPNODE>::castRay(const point3d& origin, const point3d& direction, point3d& end,
                                        bool ignoreUnknownCells, double maxRange) const {
+    checkIndex();
+    std::vector<std::pair<double, unsigned int> > candidates;
+    getCandidates(origin, direction.normalized(), maxRange, candidates);
+
     bool hit_obstacle = false;
-    double min_dist = 1e6;
-    // SPEEDUP: use openMP to do raycasting in parallel
-    // SPEEDUP: use bounding boxes to determine submaps 
-    for (const_iterator it = this->begin(); it != this->end(); ++it) {
-      point3d origin_trans = (*it)->getOrigin().inv().transform(origin);
-      point3d direction_trans = (*it)->getOrigin().inv().rot().rotate(direction);
-      printf("ray from %.2f,%.2f,%.2f in dir %.2f,%.2f,%.2f in node %s\n",
-             origin_trans.x(), origin_trans.y(), origin_trans.z(),
-             direction_trans.x(), direction_trans.y(), direction_trans.z(),
-             (*it)->getId().c_str());
+    double min_dist = std::numeric_limits<double>::max();
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int c = 0; c < (int) candidates.size(); ++c) {
+      // no hit in this submap can be closer than the closest one so far
+      bool skip;
+#ifdef _OPENMP
+      #pragma omp critical (mapcollection_cast_ray)
+#endif
+      skip = (candidates[c].first > min_dist);
+      if (skip)
+        continue;
+
+      unsigned int i = candidates[c].second;
+      point3d origin_trans = inv_origins[i].transform(origin);
+      point3d direction_trans = inv_origins[i].rot().rotate(direction);
       point3d temp_endpoint;
-      if ((*it)->getMap()->castRay(origin_trans, direction_trans, temp_endpoint, ignoreUnknownCells, maxRange)) {
-        printf("hit obstacle in node %s\n", (*it)->getId().c_str());
+      if (nodes[i]->getMap()->castRay(origin_trans, direction_trans, temp_endpoint, ignoreUnknownCells, maxRange)) {
         double current_dist =  origin_trans.distance(temp_endpoint);
-        if (current_dist < min_dist) {
-          min_dist = current_dist;
-          end = (*it)->getOrigin().transform(temp_endpoint);
+#ifdef _OPENMP
+        #pragma omp critical (mapcollection_cast_ray)
+#endif
+        {
+          if (current_dist < min_dist) {
+            min_dist = current_dist;
+            end = nodes[i]->getOrigin().transform(temp_endpoint);
+          }
+          hit_obstacle = true;
         }
-        hit_obstacle = true;
       } // end if hit obst
     } // end for
     return hit_obstacle;
   }
 
+  template <class MAPNODE>
+  void MapCollection<MAPNODE>::updateIndex() const {
+    const unsigned int num_nodes = (unsigned int) nodes.size();
+    inv_origins.resize(num_nodes);
+    node_revisions.resize(num_nodes);
+    bbx_min.resize(num_nodes);
+    bbx_max.resize(num_nodes);
+    bvh_indices.clear();
+    bvh.clear();
+
+    for (unsigned int i = 0; i < num_nodes; ++i) {
+      pose6d origin = nodes[i]->getOrigin();
+      inv_origins[i] = origin.inv();
+      node_revisions[i] = nodes[i]->getRevision();
+
+      typename MAPNODE::TreeType* map = nodes[i]->getMap();
+      if (!map || map->size() == 0) // nothing to find in empty submaps
+        continue;
+
+      double min[3], max[3];
+      map->getMetricMin(min[0], min[1], min[2]);
+      map->getMetricMax(max[0], max[1], max[2]);
+
+      // bounding box of the transformed corners, enlarged by the resolution against rounding
+      const float pad = (float) map->getResolution();
+      point3d& bmin = bbx_min[i];
+      point3d& bmax = bbx_max[i];
+      for (unsigned int c = 0; c < 8; ++c) {
+        point3d corner = origin.transform(point3d((float) ((c & 1) ? max[0] : min[0]),
+                                                  (float) ((c & 2) ? max[1] : min[1]),
+                                                  (float) ((c & 4) ? max[2] : min[2])));
+        for (unsigned int j = 0; j < 3; ++j) {
+          if (c == 0 || corner(j) - pad < bmin(j)) bmin(j) = corner(j) - pad;
+          if (c == 0 || corner(j) + pad > bmax(j)) bmax(j) = corner(j) + pad;
+        }
+      }
+      bvh_indices.push_back(i);
+    }
+
+    if (!bvh_indices.empty()) {
+      bvh.reserve(2 * bvh_indices.size());
+      buildBVHRecurs(0, (unsigned int) bvh_indices.size());
+    }
+    index_valid = true;
+  }
+
+  template <class MAPNODE>
+  bool MapCollection<MAPNODE>::nodesChanged() const {
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      if (nodes[i]->getRevision() != node_revisions[i])
+        return true;
+    }
+    return false;
+  }
+
+  template <class MAPNODE>
+  void MapCollection<MAPNODE>::buildBVHRecurs(unsigned int first, unsigned int count) const {
+    const unsigned int node_idx = (unsigned int) bvh.size();
+    bvh.push_back(BVHNode());
+
+    point3d min = bbx_min[bvh_indices[first]];
+    point3d max = bbx_max[bvh_indices[first]];
+    for (unsigned int k = first + 1; k < first + count; ++k) {
+      unsigned int i = bvh_indices[k];
+      for (unsigned int j = 0; j < 3; ++j) {
+        if (bbx_min[i](j) < min(j)) min(j) = bbx_min[i](j);
+        if (bbx_max[i](j) > max(j)) max(j) = bbx_max[i](j);
+      }
+    }
+    bvh[node_idx].min = min;
+    bvh[node_idx].max = max;
+    bvh[node_idx].right = 0;
+    bvh[node_idx].first = first;
+    bvh[node_idx].count = count;
+
+    if (count <= 2)
+      return;
+
+    // split at the median of the box centers along the longest axis
+    unsigned int axis = 0;
+    for (unsigned int j = 1; j < 3; ++j) {
+      if (max(j) - min(j) > max(axis) - min(axis))
+        axis = j;
+    }
+    std::vector<std::pair<float, unsigned int> > centers(count);
+    for (unsigned int k = 0; k < count; ++k) {
+      unsigned int i = bvh_indices[first + k];
+      centers[k] = std::make_pair(bbx_min[i](axis) + bbx_max[i](axis), i);
+    }
+    std::nth_element(centers.begin(), centers.begin() + count/2, centers.end());
+    for (unsigned int k = 0; k < count; ++k)
+      bvh_indices[first + k] = centers[k].second;
+
+    bvh[node_idx].count = 0;
+    buildBVHRecurs(first, count/2);
+    bvh[node_idx].right = (unsigned int) bvh.size();
+    buildBVHRecurs(first + count/2, count - count/2);
+  }
+
+  template <class MAPNODE>
+  bool MapCollection<MAPNODE>::inBBX(const point3d& p, const point3d& min, const point3d& max) {
+    return (p.x() >= min.x() && p.y() >= min.y() && p.z() >= min.z()
+            && p.x() <= max.x() && p.y() <= max.y() && p.z() <= max.z());
+  }
+
+  template <class MAPNODE>
+  bool MapCollection<MAPNODE>::intersectRayBBX(const point3d& origin, const point3d& inv_direction,
+                                               const point3d& min, const point3d& max, double& t_entry) {
+    double t_min = 0.0;
+    double t_max = std::numeric_limits<double>::max();
+    for (unsigned int j = 0; j < 3; ++j) {
+      double t1 = (min(j) - origin(j)) * inv_direction(j);
+      double t2 = (max(j) - origin(j)) * inv_direction(j);
+      if (t1 > t2) std::swap(t1, t2);
+      if (t1 > t_min) t_min = t1;
+      if (t2 < t_max) t_max = t2;
+      if (t_min > t_max) return false;
+    }
+    t_entry = t_min;
+    return true;
+  }
+
+  template <class MAPNODE>
+  void MapCollection<MAPNODE>::getCandidates(const point3d& p, std::vector<unsigned int>& candidates) const {
+    candidates.clear();
+    if (bvh.empty())
+      return;
+
+    std::vector<unsigned int> stack(1, 0);
+    while (!stack.empty()) {
+      unsigned int idx = stack.back();
+      stack.pop_back();
+      const BVHNode& bvh_node = bvh[idx];
+      if (!inBBX(p, bvh_node.min, bvh_node.max))
+        continue;
+
+      if (bvh_node.count > 0) {
+        for (unsigned int k = bvh_node.first; k < bvh_node.first + bvh_node.count; ++k) {
+          unsigned int i = bvh_indices[k];
+          if (inBBX(p, bbx_min[i], bbx_max[i]))
+            candidates.push_back(i);
+        }
+      } else {
+        stack.push_back(idx + 1);
+        stack.push_back(bvh_node.right);
+      }
+    }
+    // same order as a linear search
+    std::sort(candidates.begin(), candidates.end());
+  }
+
+  template <class MAPNODE>
+  void MapCollection<MAPNODE>::getCandidates(const point3d& origin, const point3d& direction, double max_range,
+                                             std::vector<std::pair<double, unsigned int> >& candidates) const {
+    candidates.clear();
+    if (bvh.empty())
+      return;
+
+    point3d inv_direction (1.0f / direction.x(), 1.0f / direction.y(), 1.0f / direction.z());
+    std::vector<unsigned int> stack(1, 0);
+    double t_entry;
+    while (!stack.empty()) {
+      unsigned int idx = stack.back();
+      stack.pop_back();
+      const BVHNode& bvh_node = bvh[idx];
+      if (!intersectRayBBX(origin, inv_direction, bvh_node.min, bvh_node.max, t_entry)
+          || (max_range >= 0.0 && t_entry > max_range))
+        continue;
+
+      if (bvh_node.count > 0) {
+        for (unsigned int k = bvh_node.first; k < bvh_node.first + bvh_node.count; ++k) {
+          unsigned int i = bvh_indices[k];
+          if (!intersectRayBBX(origin, inv_direction, bbx_min[i], bbx_max[i], t_entry)
+              || (max_range >= 0.0 && t_entry > max_range))
+            continue;
+
+          // distance of origin to the box: lower bound for the distance of hits inside
+          double dist_sq = 0.0;
+          for (unsigned int j = 0; j < 3; ++j) {
+            double d = std::max(std::max(bbx_min[i](j) - origin(j), origin(j) - bbx_max[i](j)), 0.0f);
+            dist_sq += d * d;
+          }
+          candidates.push_back(std::make_pair(sqrt(dist_sq), i));
+        }
+      } else {
+        stack.push_back(idx + 1);
+        stack.push_back(bvh_node.right);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end());
+  }
+
   
   template <class MAPNODE>
   bool MapCollection<MAPNODE>::writePointcloud(std::string filename) {
@@ -60,6 +60,12 @@ namespace octomap {
     inline void setId(std::string newid) { id = newid; }
 
     inline pose6d getOrigin() { return origin; }
+    inline void setOrigin(const pose6d& neworigin) { origin = neworigin; ++revision; }
+
+    /// call after modifying the map returned by getMap(), so that a MapCollection updates its index
+    inline void mapChanged() { ++revision; }
+    /// incremented by every change of the origin or the map, see MapCollection::updateIndex()
+    inline unsigned int getRevision() const { return revision; }
 
     // returns cloud of voxel centers in global reference frame
     Pointcloud generatePointcloud();
@@ -69,6 +75,7 @@ namespace octomap {
     TREETYPE*    node_map;  // occupancy grid map
     pose6d       origin;    // origin and orientation relative to parent
     std::string  id;
+    unsigned int revision;
 
     void clear();
     bool readMap(std::string filename);
@@ -34,21 +34,21 @@
 namespace octomap {
 
   template <class TREETYPE>
-  MapNode<TREETYPE>::MapNode(): node_map(0) {
+  MapNode<TREETYPE>::MapNode(): node_map(0), revision(0) {
   }
 
   template <class TREETYPE>
-  MapNode<TREETYPE>::MapNode(TREETYPE* in_node_map, pose6d in_origin) {
+  MapNode<TREETYPE>::MapNode(TREETYPE* in_node_map, pose6d in_origin): revision(0) {
   	this->node_map = in_node_map;
   	this->origin = in_origin;
   }
 
   template <class TREETYPE>
-  MapNode<TREETYPE>::MapNode(const Pointcloud& in_cloud, pose6d in_origin): node_map(0) {
+  MapNode<TREETYPE>::MapNode(const Pointcloud& in_cloud, pose6d in_origin): node_map(0), revision(0) {
   }
 
   template <class TREETYPE>
-  MapNode<TREETYPE>::MapNode(std::string filename, pose6d in_origin): node_map(0){
+  MapNode<TREETYPE>::MapNode(std::string filename, pose6d in_origin): node_map(0), revision(0){
   	readMap(filename);
   	this->origin = in_origin;
   	id = filename;
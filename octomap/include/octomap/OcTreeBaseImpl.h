@@ -43,7 +43,9 @@
 
 #include "octomap_types.h"
 #include "OcTreeKey.h"
+#include "octomap_atomic.h"
 #include "ScanGraph.h"
+#include "OcTreeDataNode.h"
 
 
 namespace octomap {
@@ -89,6 +91,96 @@ namespace octomap {
     OcTreeBaseImpl(const OcTreeBaseImpl<NODE,INTERFACE>& rhs);
 
 
+    /**
+     * Turns "target" into a copy-on-write snapshot of this tree: Both trees
+     * share all nodes below the root, so this is O(1) instead of a deep copy.
+     * The children arrays of the nodes are reference counted (see OcTreeChildArray),
+     * whenever one of the trees modifies a shared node, it first copies the
+     * path from its root down to that node together with the siblings on the
+     * path (path copying). The other tree keeps seeing the unmodified version,
+     * and nodes are deallocated when the last tree referencing them is cleared
+     * or deleted. Trees without snapshots use no additional memory.
+     *
+     * This enables cheap consistent read-only views for other threads while
+     * the mapping thread keeps inserting: take the snapshot in the mapping
+     * thread, hand it to a reader, and delete it there when done. Reference
+     * counting is atomic, so the snapshot may be deleted in any thread.
+     *
+     * Previous content of target is cleared, its resolution is set to this
+     * tree's resolution. All modifications through the tree API (updateNode(),
+     * setNodeValue(), deleteNode(), prune(), ...) respect sharing. Nodes obtained
+     * from search() or iterators must not be modified directly while they may
+     * be shared, use searchUnshared() instead. Whole-tree operations such as
+     * updateInnerOccupancy(), prune() and expand() copy all shared nodes they visit.
+     *
+     * @param target tree to hold the snapshot, must not be this tree
+     */
+    void snapshot(OcTreeBaseImpl<NODE,INTERFACE>& target) const;
+
+    /**
+     * Enables (or disables) the concurrent read mode: While a single thread
+     * modifies the tree with updateNode(), setNodeValue(), insertPointCloud(),
+     * insertRay(), deleteNode(), prune() or clear(), any number of other threads
+     * can query it with search(), isNodeOccupied(), castRay() and iterators.
+     * Each reading thread has to hold a ReadGuard for the duration of its queries
+     * and while it uses the returned node pointers.
+     *
+     * New nodes are fully initialized before they become visible, and pruning
+     * replaces all children of a node at once. Nodes removed by the writer are
+     * only deallocated after all readers that could have seen them released
+     * their ReadGuard (epoch-based reclamation). Readers see each node either
+     * before or after an update, but a query may combine nodes from before and
+     * after an updateNode() call. Use snapshot() if you need a consistent version
+     * of the whole tree.
+     *
+     * Change the mode only while no other thread accesses the tree. Other
+     * modifications (e.g. merge(), expand(), updateInnerOccupancy()) are not
+     * safe for concurrent readers.
+     */
+    void enableConcurrentReads(bool enable);
+    bool isConcurrentReadsEnabled() const { return concurrent_reads; }
+
+    /**
+     * Deallocates nodes removed from the tree in concurrent read mode as soon as
+     * no ReadGuard can reference them any longer. This is called automatically
+     * when nodes are removed, you only need to call it (from the writing thread)
+     * to free memory early.
+     */
+    void reclaimRetiredNodes();
+
+    /**
+     * Marks a thread as reader of a tree in concurrent read mode (see
+     * enableConcurrentReads()) for the lifetime of the guard:
+     * \code
+     * {
+     *   OcTree::ReadGuard guard(tree);
+     *   OcTreeNode* n = tree.search(p);
+     *   if (n && tree.isNodeOccupied(n)) ...
+     * }
+     * \endcode
+     * Guards are cheap (one atomic operation each way) and should be short-lived,
+     * since nodes removed while they exist cannot be deallocated. Outside of
+     * concurrent read mode, guards do nothing.
+     *
+     * @note At most max_concurrent_readers guards can exist at the same time
+     * (per tree). Additional ones wait, yielding their time slice, until a guard
+     * is released, so more reading threads than that only add latency. Do not
+     * nest guards of the same tree in one thread, this can deadlock when all
+     * slots are taken.
+     */
+    class ReadGuard {
+    public:
+      explicit ReadGuard(const OcTreeBaseImpl<NODE,INTERFACE>& tree);
+      ~ReadGuard();
+    private:
+      ReadGuard(const ReadGuard&);
+      ReadGuard& operator=(const ReadGuard&);
+      uint32_t* slot;
+    };
+
+    /// number of ReadGuards that can exist at the same time, see ReadGuard
+    static const unsigned int max_concurrent_readers = 64;
+
     /**
      * Swap contents of two octrees, i.e., only the underlying
      * pointer / tree structure. You have to ensure yourself that the
@@ -97,6 +189,18 @@ namespace octomap {
      */
     void swapContent(OcTreeBaseImpl<NODE,INTERFACE>& rhs);
 
+    /**
+     * Replaces the content of this tree by a copy of the structure of
+     * another tree, which may use a different node type (e.g. to convert
+     * between OcTree and OcTreeQuantized). The data of each node is converted
+     * by calling convert(const OTHER_NODE& from, NODE& to). The resolution
+     * of other is copied, the tree depths have to match.
+     *
+     * @return false if the tree depths do not match
+     */
+    template <class OTHER_NODE, class OTHER_INTERFACE, class CONVERTER>
+    bool copyStructure(const OcTreeBaseImpl<OTHER_NODE,OTHER_INTERFACE>& other, CONVERTER convert);
+
     /// Comparison between two octrees, all meta data, all
     /// nodes, and the structure must be identical
     bool operator== (const OcTreeBaseImpl<NODE,INTERFACE>& rhs) const;
@@ -199,6 +303,14 @@ namespace octomap {
      */
     NODE* search(const OcTreeKey& key, unsigned int depth = 0) const;
 
+    /**
+     *  Same as search(), but all nodes on the path to the returned node that are
+     *  shared with a snapshot of this tree are copied first (see snapshot()).
+     *  Use this instead of search() if you want to modify the returned node directly.
+     *  @return pointer to node if found, NULL otherwise
+     */
+    NODE* searchUnshared(const OcTreeKey& key, unsigned int depth = 0);
+
     /**
      *  Delete a node (if exists) given a 3d point. Will always
      *  delete at the lowest level unless depth !=0, and expand pruned inner nodes as needed.
@@ -274,9 +386,42 @@ namespace octomap {
 
     // -- access tree nodes  ------------------
 
-    /// return centers of leafs that do NOT exist (but could) in a given bounding box
+    /// return centers of leafs that do NOT exist (but could) in a given bounding box,
+    /// appended to node_centers. depth is the level of the leafs (0: tree_depth),
+    /// see getUnknownBlocks() for a compact representation of large unknown volumes.
+    void getUnknownLeafCenters(std::vector<point3d>& node_centers, point3d pmin, point3d pmax, unsigned int depth = 0) const;
+
+    /// \deprecated std::list version of getUnknownLeafCenters(), use the std::vector version instead
     void getUnknownLeafCenters(point3d_list& node_centers, point3d pmin, point3d pmax, unsigned int depth = 0) const;
 
+    /**
+     * Extracts the unknown space in a bounding box as maximal unknown blocks, i.e.
+     * nodes that do not exist in the tree and whose parent does. Unknown subtrees
+     * are detected from missing children in a single traversal, without searching
+     * for individual voxels. Blocks are appended to centers and sizes.
+     *
+     * @param centers center coordinates of the unknown blocks
+     * @param sizes edge lengths of the unknown blocks
+     * @param pmin minimum corner of the bounding box
+     * @param pmax maximum corner of the bounding box
+     * @param max_depth finest level of the blocks (0: tree_depth). Unknown space
+     *   below this level is ignored, blocks crossing the bounding box at this
+     *   level are included.
+     * @param min_depth coarsest level of the blocks, larger blocks are split (default: 0)
+     */
+    void getUnknownBlocks(std::vector<point3d>& centers, std::vector<double>& sizes,
+                          const point3d& pmin, const point3d& pmax,
+                          unsigned int max_depth = 0, unsigned int min_depth = 0) const;
+
+    /**
+     * Calls visitor(const OcTreeKey& key, unsigned int depth) for each maximal
+     * unknown block in a bounding box, see getUnknownBlocks(). key is the center
+     * key of the block at the given depth (as returned by iterator::getKey()).
+     */
+    template <class VISITOR>
+    void forEachUnknownBlock(const point3d& pmin, const point3d& pmax, VISITOR& visitor,
+                             unsigned int max_depth = 0, unsigned int min_depth = 0) const;
+
 
     // -- raytracing  -----------------------
 
@@ -284,14 +429,41 @@ namespace octomap {
     * Traces a ray from origin to end (excluding), returning an
     * OcTreeKey of all nodes traversed by the beam. You still need to check
     * if a node at that coordinate exists (e.g. with search()).
+    * Rays leaving the volume covered by the tree's keys are clipped to it
+    * (then including the last node before the border).
     *
     * @param origin start coordinate of ray
     * @param end end coordinate of ray
     * @param ray KeyRay structure that holds the keys of all nodes traversed by the ray, excluding "end"
-    * @return Success of operation. Returning false usually means that one of the coordinates is out of the OcTree's range
+    * @return Success of operation. Returning false means that the ray lies completely outside of the OcTree's range
     */
     bool computeRayKeys(const point3d& origin, const point3d& end, KeyRay& ray) const;
 
+   /**
+    * Same as computeRayKeys(), but traverses the nodes at the given depth
+    * instead of the leaf level. The keys returned in ray are the center keys
+    * of the traversed nodes at that depth (see coordToKey(const point3d&, unsigned)).
+    *
+    * @param depth depth of the traversed nodes (1..tree_depth)
+    */
+    bool computeRayKeys(const point3d& origin, const point3d& end, KeyRay& ray, unsigned int depth) const;
+
+   /**
+    * Clips the segment from origin to end to the axis-aligned box [min, max]
+    * (slab method).
+    *
+    * @param origin start of the segment
+    * @param end end of the segment
+    * @param min minimum corner of the box
+    * @param max maximum corner of the box
+    * @param clipped_origin start of the part of the segment inside the box
+    * @param clipped_end end of the part of the segment inside the box
+    * @return false if the segment does not intersect the box
+    */
+    static bool clipSegmentToBox(const point3d& origin, const point3d& end,
+                                 const point3d& min, const point3d& max,
+                                 point3d& clipped_origin, point3d& clipped_end);
+
 
    /**
     * Traces a ray from origin to end (excluding), returning the
@@ -518,11 +690,36 @@ namespace octomap {
     
     /// Recursively delete a node and all children. Deallocates memory
     /// but does NOT set the node ptr to NULL nor updates tree size.
+    /// Nodes that are still shared with a snapshot are only released.
+    /// In concurrent read mode, deallocation is deferred until no reader can access the nodes.
     void deleteNodeRecurs(NODE* node);
 
+    /// Adds a fully initialized child (which may have children itself) to node,
+    /// making it visible to concurrent readers. Increases tree size by one.
+    void attachNodeChild(NODE* node, unsigned int childIdx, NODE* child);
+
+    /// Sets a fully initialized root node in an empty tree, see attachNodeChild()
+    void attachRoot(NODE* node);
+
+    /// Removes a child (including its subtree) from node without deallocating it and updates tree size.
+    /// The caller owns the returned subtree, which can be attached to another tree. Snapshots keep
+    /// their access. In concurrent read mode, the caller receives a copy of the child that shares
+    /// its children until the readers have left the original.
+    NODE* detachNodeChild(NODE* node, unsigned int childIdx);
+
+    /// Copy-on-write: If the children of node are shared with a snapshot, they are
+    /// replaced by private copies (sharing their own children) first. node must not be shared.
+    /// @return ptr to the child, which can be modified in place
+    NODE* unshareNodeChild(NODE* node, unsigned int childIdx);
+
     /// recursive call of deleteNode()
     bool deleteNodeRecurs(NODE* node, unsigned int depth, unsigned int max_depth, const OcTreeKey& key);
 
+    /// recursive call of copyStructure()
+    template <class OTHER_NODE, class OTHER_INTERFACE, class CONVERTER>
+    void copyStructureRecurs(const OcTreeBaseImpl<OTHER_NODE,OTHER_INTERFACE>& other, const OTHER_NODE* other_node,
+                             NODE* node, CONVERTER& convert);
+
     /// recursive call of prune()
     void pruneRecurs(NODE* node, unsigned int depth, unsigned int max_depth, unsigned int& num_pruned);
 
@@ -531,6 +728,26 @@ namespace octomap {
     
     size_t getNumLeafNodesRecurs(const NODE* parent) const;
 
+    /// recursive call of forEachUnknownBlock(), node may be NULL (unknown)
+    template <class VISITOR>
+    void forEachUnknownBlockRecurs(const NODE* node, const OcTreeKey& node_min_key, unsigned int depth,
+                                   const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                   unsigned int min_depth, unsigned int max_depth, VISITOR& visitor) const;
+
+    /// visitor of forEachUnknownBlock() collecting the blocks for getUnknownBlocks()
+    struct UnknownBlockCollector {
+      UnknownBlockCollector(const OcTreeBaseImpl<NODE,INTERFACE>& tree, std::vector<point3d>& centers, std::vector<double>* sizes)
+        : tree(tree), centers(centers), sizes(sizes) {}
+      void operator()(const OcTreeKey& key, unsigned int depth) {
+        centers.push_back(tree.keyToCoord(key, depth));
+        if (sizes)
+          sizes->push_back(tree.getNodeSize(depth));
+      }
+      const OcTreeBaseImpl<NODE,INTERFACE>& tree;
+      std::vector<point3d>& centers;
+      std::vector<double>* sizes; ///< may be NULL
+    };
+
   private:
     /// Assignment operator is private: don't (re-)assign octrees
     /// (const-parameters can't be changed) -  use the copy constructor instead.
@@ -538,6 +755,56 @@ namespace octomap {
 
   protected:  
     void allocNodeChildren(NODE* node);
+    /// allocates the children array of node, initialized with a single child (may be NULL)
+    void allocNodeChildren(NODE* node, unsigned int childIdx, NODE* child);
+
+    /// @return the childIdx-th child of node or NULL if it does not exist. Unlike
+    /// nodeChildExists() followed by getNodeChild(), this does not race with a
+    /// concurrent writer pruning node (see enableConcurrentReads()).
+    NODE* loadNodeChild(NODE* node, unsigned int childIdx) const;
+
+    /// Copy-on-write: Replaces shared children of node by private copies, which
+    /// share their own children. Releases the reference to the shared children.
+    void unshareNodeChildren(NODE* node);
+
+    /// Deletes all children of node (including their subtrees) at once, concurrent
+    /// readers see either all or none of them. Children still shared with a
+    /// snapshot are only released. Updates the tree size.
+    void deleteNodeChildren(NODE* node);
+
+    /// Releases a reference to a children array, deallocating the array and
+    /// the nodes below it when it was the last one
+    void releaseNodeChildren(AbstractOcTreeNode** children);
+
+    /// deallocates node and its children (respecting references of snapshots)
+    void freeNodeRecurs(NODE* node);
+    /// hands removed nodes over to reclamation in concurrent read mode
+    void retireNodes(NODE* node, AbstractOcTreeNode** children);
+    /// deallocates all retired nodes removed before the given epoch
+    void freeRetiredNodes(uint32_t epoch);
+
+    /// node(s) removed from the tree in concurrent read mode, awaiting deallocation
+    struct RetiredNodes {
+      RetiredNodes(NODE* node, AbstractOcTreeNode** children, uint32_t epoch)
+        : node(node), children(children), epoch(epoch) {}
+      NODE* node; ///< subtree to delete, may be NULL
+      AbstractOcTreeNode** children; ///< detached children array to release, may be NULL
+      uint32_t epoch; ///< read epoch at the time of removal
+    };
+
+    /// epoch announced by an active ReadGuard (0: unused), one per cache line.
+    /// Only accessed with the functions in octomap_atomic.h.
+    struct ReaderSlot {
+      ReaderSlot() : epoch(0) {}
+      uint32_t epoch;
+      char padding[64 - sizeof(uint32_t)];
+    };
+
+    bool concurrent_reads; ///< concurrent read mode enabled, see enableConcurrentReads()
+    uint32_t read_epoch; ///< current epoch for reclamation of nodes in concurrent read mode
+    mutable std::vector<ReaderSlot> reader_slots;
+    std::vector<RetiredNodes> retired_nodes;
+    size_t retired_nodes_limit; ///< reclamation is attempted when retired_nodes exceeds this size
 
     NODE* root; ///< Pointer to the root NODE, NULL for empty tree
 
@@ -67,6 +67,7 @@ namespace octomap {
   template <class NODE,class I>
   OcTreeBaseImpl<NODE,I>::~OcTreeBaseImpl(){
     clear();
+    freeRetiredNodes(std::numeric_limits<uint32_t>::max());
   }
 
 
@@ -93,6 +94,10 @@ namespace octomap {
     }
     size_changed = true;
 
+    concurrent_reads = false;
+    read_epoch = 1;
+    retired_nodes_limit = 1024;
+
     // create as many KeyRays as there are OMP_THREADS defined,
     // one buffer for each thread
 #ifdef _OPENMP
@@ -110,6 +115,118 @@ namespace octomap {
 
   }
 
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::enableConcurrentReads(bool enable){
+    if (enable == concurrent_reads)
+      return;
+
+    concurrent_reads = enable;
+    if (enable){
+      reader_slots.resize(max_concurrent_readers);
+    } else {
+      // no readers left, deallocate everything
+      freeRetiredNodes(std::numeric_limits<uint32_t>::max());
+      reader_slots.clear();
+    }
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::reclaimRetiredNodes(){
+    if (retired_nodes.empty())
+      return;
+
+    // readers entering from now on can no longer reach any retired node
+    uint32_t min_epoch = atomicIncrement(&read_epoch);
+    for (size_t i = 0; i < reader_slots.size(); ++i){
+      uint32_t epoch = atomicLoad(&reader_slots[i].epoch);
+      if (epoch != 0 && epoch < min_epoch)
+        min_epoch = epoch;
+    }
+
+    freeRetiredNodes(min_epoch);
+    // try again when the number of retired nodes has doubled
+    retired_nodes_limit = std::max(size_t(1024), 2*retired_nodes.size());
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::retireNodes(NODE* node, AbstractOcTreeNode** children){
+    retired_nodes.push_back(RetiredNodes(node, children, read_epoch));
+    if (retired_nodes.size() >= retired_nodes_limit)
+      reclaimRetiredNodes();
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::freeRetiredNodes(uint32_t epoch){
+    size_t num_kept = 0;
+    for (size_t i = 0; i < retired_nodes.size(); ++i){
+      RetiredNodes& retired = retired_nodes[i];
+      if (retired.epoch >= epoch){
+        retired_nodes[num_kept++] = retired;
+        continue;
+      }
+
+      if (retired.node)
+        freeNodeRecurs(retired.node);
+      if (retired.children)
+        releaseNodeChildren(retired.children);
+    }
+    retired_nodes.erase(retired_nodes.begin() + num_kept, retired_nodes.end());
+  }
+
+  template <class NODE,class I>
+  OcTreeBaseImpl<NODE,I>::ReadGuard::ReadGuard(const OcTreeBaseImpl<NODE,I>& tree)
+    : slot(NULL)
+  {
+    if (!tree.concurrent_reads)
+      return;
+
+    // announce the current epoch in a free slot, the writer does not deallocate
+    // nodes removed in this or a later epoch while the slot is occupied
+    const uint32_t epoch = atomicLoad(&tree.read_epoch);
+    while (true){
+      for (size_t i = 0; i < tree.reader_slots.size(); ++i){
+        uint32_t* candidate = &(tree.reader_slots[i].epoch);
+        if (atomicLoad(candidate) == 0 && atomicCompareAndSwap(candidate, 0, epoch)){
+          slot = candidate;
+          return;
+        }
+      }
+      // all slots are taken: let the other readers finish
+      yieldThread();
+    }
+  }
+
+  template <class NODE,class I>
+  OcTreeBaseImpl<NODE,I>::ReadGuard::~ReadGuard(){
+    if (slot)
+      atomicStore(slot, uint32_t(0)); // all reads are finished before the slot is freed
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::snapshot(OcTreeBaseImpl<NODE,I>& target) const{
+    if (&target == this){
+      OCTOMAP_ERROR("Error in snapshot: a tree cannot be a snapshot of itself\n");
+      return;
+    }
+    assert(target.tree_depth == tree_depth && target.tree_max_val == tree_max_val);
+
+    target.clear();
+    if (target.resolution != resolution)
+      target.setResolution(resolution);
+
+    if (root){
+      // the root is copied, all nodes below it are shared
+      target.root = new NODE();
+      target.root->copyData(*root);
+      if (root->children != NULL){
+        OcTreeChildArray::acquire(root->children);
+        target.root->children = root->children;
+      }
+      target.tree_size = tree_size;
+      target.size_changed = true;
+    }
+  }
+
   template <class NODE,class I>
   void OcTreeBaseImpl<NODE,I>::swapContent(OcTreeBaseImpl<NODE,I>& other){
     NODE* this_root = root;
@@ -121,6 +238,48 @@ namespace octomap {
     other.tree_size = this_size;
   }
 
+  template <class NODE,class I>
+  template <class OTHER_NODE, class OTHER_INTERFACE, class CONVERTER>
+  bool OcTreeBaseImpl<NODE,I>::copyStructure(const OcTreeBaseImpl<OTHER_NODE,OTHER_INTERFACE>& other, CONVERTER convert){
+    if (other.getTreeDepth() != tree_depth){
+      OCTOMAP_ERROR("Trying to copy the structure of a tree with different depth (%u instead of %u)\n",
+                    other.getTreeDepth(), tree_depth);
+      return false;
+    }
+
+    this->clear();
+    if (resolution != other.getResolution())
+      setResolution(other.getResolution());
+
+    const OTHER_NODE* other_root = other.getRoot();
+    if (other_root == NULL)
+      return true;
+
+    // the new root is attached when completely initialized (for concurrent readers)
+    NODE* new_root = new NODE();
+    convert(*other_root, *new_root);
+    copyStructureRecurs(other, other_root, new_root, convert);
+    attachRoot(new_root);
+    return true;
+  }
+
+  template <class NODE,class I>
+  template <class OTHER_NODE, class OTHER_INTERFACE, class CONVERTER>
+  void OcTreeBaseImpl<NODE,I>::copyStructureRecurs(const OcTreeBaseImpl<OTHER_NODE,OTHER_INTERFACE>& other,
+                                                   const OTHER_NODE* other_node, NODE* node, CONVERTER& convert){
+    if (!other.nodeHasChildren(other_node))
+      return;
+
+    for (unsigned int i=0; i<8; i++) {
+      if (other.nodeChildExists(other_node, i)) {
+        const OTHER_NODE* other_child = other.getNodeChild(other_node, i);
+        NODE* child = createNodeChild(node, i);
+        convert(*other_child, *child);
+        copyStructureRecurs(other, other_child, child, convert);
+      }
+    }
+  }
+
   template <class NODE,class I>
   bool OcTreeBaseImpl<NODE,I>::operator== (const OcTreeBaseImpl<NODE,I>& other) const{
     if (tree_depth != other.tree_depth || tree_max_val != other.tree_max_val
@@ -171,26 +330,69 @@ namespace octomap {
 
   template <class NODE,class I>
   NODE* OcTreeBaseImpl<NODE,I>::createNodeChild(NODE* node, unsigned int childIdx){
+    NODE* newNode = new NODE();
+    attachNodeChild(node, childIdx, newNode);
+    return newNode;
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::attachNodeChild(NODE* node, unsigned int childIdx, NODE* child){
     assert(childIdx < 8);
     if (node->children == NULL) {
-      allocNodeChildren(node);
+      allocNodeChildren(node, childIdx, child);
+    } else {
+      unshareNodeChildren(node);
+      assert (node->children[childIdx] == NULL);
+      // child is initialized before it becomes visible
+      atomicStore(&node->children[childIdx], static_cast<AbstractOcTreeNode*>(child));
     }
-    assert (node->children[childIdx] == NULL);
-    NODE* newNode = new NODE();
-    node->children[childIdx] = static_cast<AbstractOcTreeNode*>(newNode);
 
     tree_size++;
     size_changed = true;
+  }
 
-    return newNode;
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::attachRoot(NODE* node){
+    assert(root == NULL);
+    atomicStore(&root, node);
+    tree_size++;
+    size_changed = true;
+  }
+
+  template <class NODE,class I>
+  NODE* OcTreeBaseImpl<NODE,I>::detachNodeChild(NODE* node, unsigned int childIdx){
+    unshareNodeChildren(node);
+    NODE* child = getNodeChild(node, childIdx);
+    size_t num_removed = 1;
+    calcNumNodesRecurs(child, num_removed);
+    atomicStore(&node->children[childIdx], static_cast<AbstractOcTreeNode*>(NULL));
+
+    tree_size -= num_removed;
+    size_changed = true;
+
+    if (!concurrent_reads)
+      return child;
+
+    // readers may still access child: the caller gets a copy sharing its
+    // children, the original is deallocated once the readers have left
+    NODE* copy = new NODE();
+    copy->copyData(*child);
+    if (child->children != NULL){
+      OcTreeChildArray::acquire(child->children);
+      copy->children = child->children;
+    }
+    retireNodes(child, NULL);
+    return copy;
   }
 
   template <class NODE,class I>
   void OcTreeBaseImpl<NODE,I>::deleteNodeChild(NODE* node, unsigned int childIdx){
     assert((childIdx < 8) && (node->children != NULL));
     assert(node->children[childIdx] != NULL);
-    delete static_cast<NODE*>(node->children[childIdx]); // TODO delete check if empty
-    node->children[childIdx] = NULL;
+    unshareNodeChildren(node);
+    NODE* child = static_cast<NODE*>(node->children[childIdx]);
+    atomicStore(&node->children[childIdx], static_cast<AbstractOcTreeNode*>(NULL));
+    deleteNodeRecurs(child); // TODO delete check if empty
 
     tree_size--;
     size_changed = true;
@@ -199,15 +401,26 @@ namespace octomap {
   template <class NODE,class I>
   NODE* OcTreeBaseImpl<NODE,I>::getNodeChild(NODE* node, unsigned int childIdx) const{
     assert((childIdx < 8) && (node->children != NULL));
-    assert(node->children[childIdx] != NULL);
-    return static_cast<NODE*>(node->children[childIdx]);
+    AbstractOcTreeNode** children = atomicLoad(&node->children);
+    assert(children[childIdx] != NULL);
+    return static_cast<NODE*>(atomicLoad(&children[childIdx]));
   }
 
   template <class NODE,class I>
   const NODE* OcTreeBaseImpl<NODE,I>::getNodeChild(const NODE* node, unsigned int childIdx) const{
     assert((childIdx < 8) && (node->children != NULL));
-    assert(node->children[childIdx] != NULL);
-    return static_cast<const NODE*>(node->children[childIdx]);
+    AbstractOcTreeNode** children = atomicLoad(&node->children);
+    assert(children[childIdx] != NULL);
+    return static_cast<const NODE*>(atomicLoad(&children[childIdx]));
+  }
+
+  template <class NODE,class I>
+  NODE* OcTreeBaseImpl<NODE,I>::loadNodeChild(NODE* node, unsigned int childIdx) const{
+    assert(childIdx < 8);
+    AbstractOcTreeNode** children = atomicLoad(&node->children);
+    if (children == NULL)
+      return NULL;
+    return static_cast<NODE*>(atomicLoad(&children[childIdx]));
   }
 
   template <class NODE,class I>
@@ -234,7 +447,8 @@ namespace octomap {
   template <class NODE,class I>
   bool OcTreeBaseImpl<NODE,I>::nodeChildExists(const NODE* node, unsigned int childIdx) const{
     assert(childIdx < 8);
-    if ((node->children != NULL) && (node->children[childIdx] != NULL))
+    AbstractOcTreeNode** children = atomicLoad(&node->children);
+    if ((children != NULL) && (atomicLoad(&children[childIdx]) != NULL))
       return true;
     else
       return false;
@@ -242,11 +456,12 @@ namespace octomap {
 
   template <class NODE,class I>
   bool OcTreeBaseImpl<NODE,I>::nodeHasChildren(const NODE* node) const {
-    if (node->children == NULL)
+    AbstractOcTreeNode** children = atomicLoad(&node->children);
+    if (children == NULL)
       return false;
 
     for (unsigned int i = 0; i<8; i++){
-      if (node->children[i] != NULL)
+      if (atomicLoad(&children[i]) != NULL)
         return true;
     }
     return false;
@@ -257,9 +472,24 @@ namespace octomap {
   void OcTreeBaseImpl<NODE,I>::expandNode(NODE* node){
     assert(!nodeHasChildren(node));
 
+    // initialize all children first, then add them at once
+    AbstractOcTreeNode** children = OcTreeChildArray::allocate();
     for (unsigned int k=0; k<8; k++) {
-      NODE* newNode = createNodeChild(node, k);
+      NODE* newNode = new NODE();
       newNode->copyData(*node);
+      children[k] = static_cast<AbstractOcTreeNode*>(newNode);
+    }
+
+    AbstractOcTreeNode** empty_children = node->children;
+    atomicStore(&node->children, children);
+    tree_size += 8;
+    size_changed = true;
+
+    if (empty_children != NULL){
+      if (concurrent_reads)
+        retireNodes(NULL, empty_children);
+      else
+        releaseNodeChildren(empty_children);
     }
   }
 
@@ -273,25 +503,91 @@ namespace octomap {
     node->copyData(*(getNodeChild(node, 0)));
 
     // delete children (known to be leafs at this point!)
-    for (unsigned int i=0;i<8;i++) {
-      deleteNodeChild(node, i);
-    }
-    delete[] node->children;
-    node->children = NULL;
+    deleteNodeChildren(node);
 
     return true;
   }
 
   template <class NODE,class I>
   void OcTreeBaseImpl<NODE,I>::allocNodeChildren(NODE* node){
+    allocNodeChildren(node, 0, NULL);
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::allocNodeChildren(NODE* node, unsigned int childIdx, NODE* child){
     // TODO NODE*
-    node->children = new AbstractOcTreeNode*[8];
+    AbstractOcTreeNode** children = OcTreeChildArray::allocate();
+    children[childIdx] = static_cast<AbstractOcTreeNode*>(child);
+    atomicStore(&node->children, children);
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::deleteNodeChildren(NODE* node){
+    if (node->children == NULL)
+      return;
+
+    size_t num_removed = 0;
+    calcNumNodesRecurs(node, num_removed);
+
+    // detach all children at once, concurrent readers see either all or none of them
+    AbstractOcTreeNode** children = node->children;
+    atomicStore(&node->children, static_cast<AbstractOcTreeNode**>(NULL));
+
+    tree_size -= num_removed;
+    size_changed = true;
+
+    if (concurrent_reads)
+      retireNodes(NULL, children);
+    else
+      releaseNodeChildren(children);
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::releaseNodeChildren(AbstractOcTreeNode** children){
+    if (OcTreeChildArray::release(children) > 0) // still referenced by a snapshot
+      return;
+
     for (unsigned int i=0; i<8; i++) {
-      node->children[i] = NULL;
+      if (children[i] != NULL)
+        freeNodeRecurs(static_cast<NODE*>(children[i]));
     }
+    OcTreeChildArray::deallocate(children);
   }
 
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::unshareNodeChildren(NODE* node){
+    if (node->children == NULL || !OcTreeChildArray::isShared(node->children))
+      return;
 
+    // private copies of the children, which share their own children
+    AbstractOcTreeNode** shared = node->children;
+    AbstractOcTreeNode** children = OcTreeChildArray::allocate();
+    for (unsigned int i=0; i<8; i++) {
+      if (shared[i] != NULL){
+        NODE* child = static_cast<NODE*>(shared[i]);
+        NODE* copy = new NODE();
+        copy->copyData(*child);
+        if (child->children != NULL){
+          OcTreeChildArray::acquire(child->children);
+          copy->children = child->children;
+        }
+        children[i] = static_cast<AbstractOcTreeNode*>(copy);
+      }
+    }
+    atomicStore(&node->children, children);
+
+    // drop the reference to the original (deallocated if no snapshot holds it any longer)
+    if (concurrent_reads)
+      retireNodes(NULL, shared);
+    else
+      releaseNodeChildren(shared);
+  }
+
+  template <class NODE,class I>
+  NODE* OcTreeBaseImpl<NODE,I>::unshareNodeChild(NODE* node, unsigned int childIdx){
+    unshareNodeChildren(node);
+    return getNodeChild(node, childIdx);
+  }
 
   template <class NODE,class I>
   inline key_type OcTreeBaseImpl<NODE,I>::coordToKey(double coordinate, unsigned depth) const{
@@ -433,7 +729,8 @@ namespace octomap {
   template <class NODE,class I>
   NODE* OcTreeBaseImpl<NODE,I>::search (const OcTreeKey& key, unsigned int depth) const {
     assert(depth <= tree_depth);
-    if (root == NULL)
+    NODE* curNode = atomicLoad(&root);
+    if (curNode == NULL)
       return NULL;
 
     if (depth == 0)
@@ -446,23 +743,57 @@ namespace octomap {
     if (depth != tree_depth)
       key_at_depth = adjustKeyAtDepth(key, depth);
 
-    NODE* curNode (root);
 
     int diff = tree_depth - depth;
 
     // follow nodes down to requested level (for diff = 0 it's the last level)
     for (int i=(tree_depth-1); i>=diff; --i) {
       unsigned int pos = computeChildIdx(key_at_depth, i);
-      if (nodeChildExists(curNode, pos)) {
-        // cast needed: (nodes need to ensure it's the right pointer)
-        curNode = getNodeChild(curNode, pos);
+      // the children are only loaded once, they may be pruned by a concurrent writer
+      AbstractOcTreeNode** children = atomicLoad(&curNode->children);
+      NODE* child = (children != NULL) ? static_cast<NODE*>(atomicLoad(&children[pos])) : NULL;
+      if (child != NULL) {
+        curNode = child;
       } else {
         // we expected a child but did not get it
         // is the current node a leaf already?
-        if (!nodeHasChildren(curNode)) { // TODO similar check to nodeChildExists?
+        for (unsigned int k = 0; children != NULL && k < 8; ++k) {
+          if (atomicLoad(&children[k]) != NULL)
+            return NULL; // it is not, search failed
+        }
+        return curNode;
+      }
+    } // end for
+    return curNode;
+  }
+
+  template <class NODE,class I>
+  NODE* OcTreeBaseImpl<NODE,I>::searchUnshared(const OcTreeKey& key, unsigned int depth) {
+    assert(depth <= tree_depth);
+    if (root == NULL)
+      return NULL;
+
+    if (depth == 0)
+      depth = tree_depth;
+
+    // generate appropriate key_at_depth for queried depth
+    OcTreeKey key_at_depth = key;
+    if (depth != tree_depth)
+      key_at_depth = adjustKeyAtDepth(key, depth);
+
+    NODE* curNode (root);
+
+    int diff = tree_depth - depth;
+
+    // same as search(), unsharing the nodes along the path
+    for (int i=(tree_depth-1); i>=diff; --i) {
+      unsigned int pos = computeChildIdx(key_at_depth, i);
+      if (nodeChildExists(curNode, pos)) {
+        curNode = unshareNodeChild(curNode, pos);
+      } else {
+        if (!nodeHasChildren(curNode)) {
           return curNode;
         } else {
-          // it is not, search failed
           return NULL;
         }
       }
@@ -511,9 +842,10 @@ namespace octomap {
   template <class NODE,class I>
   void OcTreeBaseImpl<NODE,I>::clear() {
     if (this->root){
-      deleteNodeRecurs(root);
+      NODE* old_root = root;
+      atomicStore(&this->root, static_cast<NODE*>(NULL));
+      deleteNodeRecurs(old_root);
       this->tree_size = 0;
-      this->root = NULL;
       // max extent of tree changed:
       this->size_changed = true;
     }
@@ -542,32 +874,58 @@ namespace octomap {
   bool OcTreeBaseImpl<NODE,I>::computeRayKeys(const point3d& origin,
                                           const point3d& end,
                                           KeyRay& ray) const {
+    return computeRayKeys(origin, end, ray, tree_depth);
+  }
+
+  template <class NODE,class I>
+  bool OcTreeBaseImpl<NODE,I>::computeRayKeys(const point3d& origin,
+                                          const point3d& end,
+                                          KeyRay& ray, unsigned int depth) const {
 
     // see "A Faster Voxel Traversal Algorithm for Ray Tracing" by Amanatides & Woo
     // basically: DDA in 3D
 
+    assert(depth > 0 && depth <= tree_depth);
     ray.reset();
 
     OcTreeKey key_origin, key_end;
-    if ( !OcTreeBaseImpl<NODE,I>::coordToKeyChecked(origin, key_origin) ||
-         !OcTreeBaseImpl<NODE,I>::coordToKeyChecked(end, key_end) ) {
-      OCTOMAP_WARNING_STR("coordinates ( "
-                << origin << " -> " << end << ") out of bounds in computeRayKeys");
-      return false;
+    point3d ray_origin = origin;
+    point3d ray_end = end;
+    bool end_clipped = false;
+    if ( !OcTreeBaseImpl<NODE,I>::coordToKeyChecked(origin, depth, key_origin) ||
+         !OcTreeBaseImpl<NODE,I>::coordToKeyChecked(end, depth, key_end) ) {
+      // clip to the volume covered by keys (slightly shrunk against rounding)
+      end_clipped = !OcTreeBaseImpl<NODE,I>::coordToKeyChecked(end, depth, key_end);
+      const float bound = float((this->tree_max_val - 0.01) * this->resolution);
+      if ( !clipSegmentToBox(origin, end, point3d(-bound, -bound, -bound), point3d(bound, bound, bound),
+                             ray_origin, ray_end) ||
+           !OcTreeBaseImpl<NODE,I>::coordToKeyChecked(ray_origin, depth, key_origin) ||
+           !OcTreeBaseImpl<NODE,I>::coordToKeyChecked(ray_end, depth, key_end) ) {
+        OCTOMAP_WARNING_STR("coordinates ( "
+                  << origin << " -> " << end << ") out of bounds in computeRayKeys");
+        return false;
+      }
     }
 
 
-    if (key_origin == key_end)
+    if (key_origin == key_end) {
+      if (end_clipped)
+        ray.addKey(key_end); // the real end lies beyond
       return true; // same tree cell, we're done.
+    }
 
     ray.addKey(key_origin);
 
     // Initialization phase -------------------------------------------------------
 
-    point3d direction = (end - origin);
+    point3d direction = (ray_end - ray_origin);
     float length = (float) direction.norm();
     direction /= length; // normalize vector
 
+    // keys of nodes at depth are (1 << (tree_depth - depth)) apart
+    const int key_step = 1 << (tree_depth - depth);
+    const double node_size = this->getNodeSize(depth);
+
     int    step[3];
     double tMax[3];
     double tDelta[3];
@@ -583,11 +941,11 @@ namespace octomap {
       // compute tMax, tDelta
       if (step[i] != 0) {
         // corner point of voxel (in direction of ray)
-        double voxelBorder = this->keyToCoord(current_key[i]);
-        voxelBorder += (float) (step[i] * this->resolution * 0.5);
+        double voxelBorder = this->keyToCoord(current_key[i], depth);
+        voxelBorder += (float) (step[i] * node_size * 0.5);
 
-        tMax[i] = ( voxelBorder - origin(i) ) / direction(i);
-        tDelta[i] = this->resolution / fabs( direction(i) );
+        tMax[i] = ( voxelBorder - ray_origin(i) ) / direction(i);
+        tDelta[i] = node_size / fabs( direction(i) );
       }
       else {
         tMax[i] =  std::numeric_limits<double>::max( );
@@ -613,7 +971,7 @@ namespace octomap {
       }
 
       // advance in direction "dim"
-      current_key[dim] += step[dim];
+      current_key[dim] += step[dim] * key_step;
       tMax[dim] += tDelta[dim];
 
       assert (current_key[dim] < 2*this->tree_max_val);
@@ -644,6 +1002,38 @@ namespace octomap {
 
     } // end while
 
+    if (end_clipped)
+      ray.addKey(key_end); // the real end lies beyond
+
+    return true;
+  }
+
+  template <class NODE,class I>
+  bool OcTreeBaseImpl<NODE,I>::clipSegmentToBox(const point3d& origin, const point3d& end,
+                                                const point3d& min, const point3d& max,
+                                                point3d& clipped_origin, point3d& clipped_end) {
+    // parameters of the segment: origin + t * (end - origin), t in [0, 1]
+    const point3d direction = end - origin;
+    double t_min = 0.0;
+    double t_max = 1.0;
+    for (unsigned int i = 0; i < 3; ++i) {
+      if (direction(i) == 0.0f) {
+        // parallel to the slab
+        if (origin(i) < min(i) || origin(i) > max(i))
+          return false;
+        continue;
+      }
+      double t1 = (min(i) - origin(i)) / direction(i);
+      double t2 = (max(i) - origin(i)) / direction(i);
+      if (t1 > t2) std::swap(t1, t2);
+      if (t1 > t_min) t_min = t1;
+      if (t2 < t_max) t_max = t2;
+      if (t_min > t_max)
+        return false;
+    }
+
+    clipped_origin = (t_min > 0.0) ? origin + direction * float(t_min) : origin;
+    clipped_end = (t_max < 1.0) ? origin + direction * float(t_max) : end;
     return true;
   }
 
@@ -663,13 +1053,18 @@ namespace octomap {
     assert(node);
     // TODO: maintain tree size?
 
+    if (concurrent_reads)
+      retireNodes(node, NULL);
+    else
+      freeNodeRecurs(node);
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::freeNodeRecurs(NODE* node){
+    assert(node);
+
     if (node->children != NULL) {
-      for (unsigned int i=0; i<8; i++) {
-        if (node->children[i] != NULL){
-          this->deleteNodeRecurs(static_cast<NODE*>(node->children[i]));
-        }
-      }
-      delete[] node->children;
+      releaseNodeChildren(node->children);
       node->children = NULL;
     } // else: node has no children
 
@@ -699,7 +1094,7 @@ namespace octomap {
     }
 
     // follow down further, fix inner nodes on way back up
-    bool deleteChild = deleteNodeRecurs(getNodeChild(node, pos), depth+1, max_depth, key);
+    bool deleteChild = deleteNodeRecurs(unshareNodeChild(node, pos), depth+1, max_depth, key);
     if (deleteChild){
       // TODO: lazy eval?
       // TODO delete check depth, what happens to inner nodes with children?
@@ -707,11 +1102,9 @@ namespace octomap {
 
       if (!nodeHasChildren(node))
         return true;
-      else{
-        node->updateOccupancyChildren(); // TODO: occupancy?
-      }
     }
-    // node did not lose a child, or still has other children
+    // node still has children: update it, a node below may have lost a child
+    node->updateOccupancyChildren(); // TODO: occupancy?
     return false;
   }
 
@@ -724,7 +1117,7 @@ namespace octomap {
     if (depth < max_depth) {
       for (unsigned int i=0; i<8; i++) {
         if (nodeChildExists(node, i)) {
-          pruneRecurs(getNodeChild(node, i), depth+1, max_depth, num_pruned);
+          pruneRecurs(unshareNodeChild(node, i), depth+1, max_depth, num_pruned);
         }
       }
     } // end if depth
@@ -753,7 +1146,7 @@ namespace octomap {
     // recursively expand children
     for (unsigned int i=0; i<8; i++) {
       if (nodeChildExists(node, i)) { // TODO double check (node != NULL)
-        expandRecurs(getNodeChild(node, i), depth+1, max_depth);
+        expandRecurs(unshareNodeChild(node, i), depth+1, max_depth);
       }
     }
   }
@@ -1039,45 +1432,96 @@ namespace octomap {
   size_t OcTreeBaseImpl<NODE,I>::memoryUsage() const{
     size_t num_leaf_nodes = this->getNumLeafNodes();
     size_t num_inner_nodes = tree_size - num_leaf_nodes;
-    return (sizeof(OcTreeBaseImpl<NODE,I>) + memoryUsageNode() * tree_size + num_inner_nodes * sizeof(NODE*[8]));
+    return (sizeof(OcTreeBaseImpl<NODE,I>) + memoryUsageNode() * tree_size + num_inner_nodes * sizeof(OcTreeChildArray));
   }
 
   template <class NODE,class I>
-  void OcTreeBaseImpl<NODE,I>::getUnknownLeafCenters(point3d_list& node_centers, point3d pmin, point3d pmax, unsigned int depth) const {
+  void OcTreeBaseImpl<NODE,I>::getUnknownLeafCenters(std::vector<point3d>& node_centers, point3d pmin, point3d pmax, unsigned int depth) const {
 
     assert(depth <= tree_depth);
     if (depth == 0)
       depth = tree_depth;
 
-    point3d pmin_clamped = this->keyToCoord(this->coordToKey(pmin, depth), depth);
-    point3d pmax_clamped = this->keyToCoord(this->coordToKey(pmax, depth), depth);
-
-    float diff[3];
-    unsigned int steps[3];
-    float step_size = this->resolution * pow(2, tree_depth-depth);
-    for (int i=0;i<3;++i) {
-      diff[i] = pmax_clamped(i) - pmin_clamped(i);
-      steps[i] = floor(diff[i] / step_size);
-      //      std::cout << "bbx " << i << " size: " << diff[i] << " " << steps[i] << " steps\n";
-    }
-
-    point3d p = pmin_clamped;
-    NODE* res;
-    for (unsigned int x=0; x<steps[0]; ++x) {
-      p.x() += step_size;
-      for (unsigned int y=0; y<steps[1]; ++y) {
-        p.y() += step_size;
-        for (unsigned int z=0; z<steps[2]; ++z) {
-          //          std::cout << "querying p=" << p << std::endl;
-          p.z() += step_size;
-          res = this->search(p,depth);
-          if (res == NULL) {
-            node_centers.push_back(p);
-          }
-        }
-        p.z() = pmin_clamped.z();
-      }
-      p.y() = pmin_clamped.y();
+    UnknownBlockCollector collector(*this, node_centers, NULL);
+    forEachUnknownBlock(pmin, pmax, collector, depth, depth);
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::getUnknownLeafCenters(point3d_list& node_centers, point3d pmin, point3d pmax, unsigned int depth) const {
+    std::vector<point3d> centers;
+    getUnknownLeafCenters(centers, pmin, pmax, depth);
+    node_centers.insert(node_centers.end(), centers.begin(), centers.end());
+  }
+
+  template <class NODE,class I>
+  void OcTreeBaseImpl<NODE,I>::getUnknownBlocks(std::vector<point3d>& centers, std::vector<double>& sizes,
+                                                const point3d& pmin, const point3d& pmax,
+                                                unsigned int max_depth, unsigned int min_depth) const {
+    UnknownBlockCollector collector(*this, centers, &sizes);
+    forEachUnknownBlock(pmin, pmax, collector, max_depth, min_depth);
+  }
+
+  template <class NODE,class I>
+  template <class VISITOR>
+  void OcTreeBaseImpl<NODE,I>::forEachUnknownBlock(const point3d& pmin, const point3d& pmax, VISITOR& visitor,
+                                                   unsigned int max_depth, unsigned int min_depth) const {
+    assert(max_depth <= tree_depth);
+    if (max_depth == 0)
+      max_depth = tree_depth;
+    if (min_depth > max_depth)
+      min_depth = max_depth;
+
+    // bounding box in keys, clamped to the key range
+    OcTreeKey min_key, max_key;
+    for (unsigned int i = 0; i < 3; ++i) {
+      if (pmin(i) > pmax(i))
+        return;
+      if (!coordToKeyChecked(pmin(i), min_key[i]))
+        min_key[i] = (pmin(i) < 0.0) ? 0 : key_type(2*tree_max_val - 1);
+      if (!coordToKeyChecked(pmax(i), max_key[i]))
+        max_key[i] = (pmax(i) < 0.0) ? 0 : key_type(2*tree_max_val - 1);
+    }
+
+    forEachUnknownBlockRecurs(root, OcTreeKey(0, 0, 0), 0, min_key, max_key, min_depth, max_depth, visitor);
+  }
+
+  template <class NODE,class I>
+  template <class VISITOR>
+  void OcTreeBaseImpl<NODE,I>::forEachUnknownBlockRecurs(const NODE* node, const OcTreeKey& node_min_key, unsigned int depth,
+                                                         const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                                         unsigned int min_depth, unsigned int max_depth, VISITOR& visitor) const {
+    const unsigned int size = 1 << (tree_depth - depth);
+    bool inside = true;
+    for (unsigned int i = 0; i < 3; ++i) {
+      const unsigned int lower = node_min_key[i];
+      const unsigned int upper = lower + size - 1;
+      if (upper < min_key[i] || lower > max_key[i])
+        return;
+      if (lower < min_key[i] || upper > max_key[i])
+        inside = false;
+    }
+
+    if (node != NULL) {
+      // leafs above max_depth are known entirely (pruned)
+      if (depth == max_depth || !nodeHasChildren(node))
+        return;
+    } else if (depth == max_depth || (inside && depth >= min_depth)) {
+      OcTreeKey center_key;
+      for (unsigned int i = 0; i < 3; ++i)
+        center_key[i] = key_type(node_min_key[i] + size / 2);
+      visitor(center_key, depth);
+      return;
+    }
+
+    // descend into the (possibly missing) children
+    const unsigned int child_size = size >> 1;
+    OcTreeKey child_min_key;
+    for (unsigned int i = 0; i < 8; ++i) {
+      for (unsigned int j = 0; j < 3; ++j)
+        child_min_key[j] = key_type(node_min_key[j] + ((i & (1 << j)) ? child_size : 0));
+
+      const NODE* child = (node != NULL && nodeChildExists(node, i)) ? getNodeChild(node, i) : NULL;
+      forEachUnknownBlockRecurs(child, child_min_key, depth + 1, min_key, max_key, min_depth, max_depth, visitor);
     }
   }
 
@@ -36,7 +36,9 @@
 
 
 #include "octomap_types.h"
+#include "octomap_atomic.h"
 #include "assert.h"
+#include <stddef.h>
 
 namespace octomap {
 
@@ -48,6 +50,34 @@ namespace octomap {
   // forward declaration for friend in OcTreeDataNode
   template<typename NODE,typename I> class OcTreeBaseImpl;
 
+  /**
+   * Array of the eight children of a node. Nodes only store a pointer to
+   * "children", the reference count in front of it tracks how many nodes
+   * share the array (and thus all nodes below it) between copy-on-write
+   * snapshots of a tree, see OcTreeBaseImpl::snapshot(). Keeping the count
+   * here instead of in each node leaves the node size unchanged and adds
+   * nothing to the allocation size of the array on common allocators.
+   */
+  struct OcTreeChildArray {
+    uint32_t ref_count;
+    AbstractOcTreeNode* children[8];
+
+    /// @return a new array without children, referenced once
+    static AbstractOcTreeNode** allocate();
+    /// deallocates an array returned by allocate()
+    static void deallocate(AbstractOcTreeNode** children);
+
+    /// @return true if children is referenced by more than one node and must not be modified
+    static bool isShared(AbstractOcTreeNode* const* children);
+    /// atomically increases the reference count of children
+    static void acquire(AbstractOcTreeNode** children);
+    /// atomically decreases the reference count of children, @return the new count
+    static uint32_t release(AbstractOcTreeNode** children);
+
+  private:
+    static OcTreeChildArray* header(AbstractOcTreeNode* const* children);
+  };
+
   /**
    * Basic node in the OcTree that can hold arbitrary data of type T in value.
    * This is the base class for nodes used in an OcTree. The used implementation
@@ -122,7 +152,8 @@ namespace octomap {
 
     /// pointer to array of children, may be NULL
     /// @note The tree class manages this pointer, the array, and the memory for it!
-    /// The children of a node are always enforced to be the same type as the node
+    /// The children of a node are always enforced to be the same type as the node.
+    /// The array is allocated by OcTreeChildArray and may be shared with snapshots.
     AbstractOcTreeNode** children;
     /// stored data (payload)
     T value;
@@ -129,10 +129,42 @@ namespace octomap {
   // ============================================================
   template <typename T>
   void OcTreeDataNode<T>::allocChildren() {
-    children = new AbstractOcTreeNode*[8];
+    children = OcTreeChildArray::allocate();
+  }
+
+  // ============================================================
+  // =  OcTreeChildArray  =======================================
+  // ============================================================
+
+  inline OcTreeChildArray* OcTreeChildArray::header(AbstractOcTreeNode* const* children) {
+    return reinterpret_cast<OcTreeChildArray*>(reinterpret_cast<char*>(const_cast<AbstractOcTreeNode**>(children))
+                                               - offsetof(OcTreeChildArray, children));
+  }
+
+  inline AbstractOcTreeNode** OcTreeChildArray::allocate() {
+    OcTreeChildArray* array = new OcTreeChildArray;
+    array->ref_count = 1;
     for (unsigned int i=0; i<8; i++) {
-      children[i] = NULL;
+      array->children[i] = NULL;
     }
+    return array->children;
+  }
+
+  inline void OcTreeChildArray::deallocate(AbstractOcTreeNode** children) {
+    delete header(children);
+  }
+
+  inline bool OcTreeChildArray::isShared(AbstractOcTreeNode* const* children) {
+    return atomicLoad(&header(children)->ref_count) > 1;
+  }
+
+  inline void OcTreeChildArray::acquire(AbstractOcTreeNode** children) {
+    atomicIncrement(&header(children)->ref_count);
+  }
+
+  inline uint32_t OcTreeChildArray::release(AbstractOcTreeNode** children) {
+    assert(header(children)->ref_count > 0);
+    return atomicDecrement(&header(children)->ref_count);
   }
 
 
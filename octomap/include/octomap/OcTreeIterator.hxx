@@ -175,9 +175,9 @@
         key_type center_offset_key = tree->tree_max_val >> s.depth;
         // push on stack in reverse order
         for (int i=7; i>=0; --i) {
-          if (tree->nodeChildExists(top.node,i)) {
+          s.node = tree->loadNodeChild(top.node, i);
+          if (s.node != NULL) {
             computeChildKey(i, center_offset_key, top.key, s.key);
-            s.node = tree->getNodeChild(top.node, i);
             //OCTOMAP_DEBUG_STR("Current depth: " << int(top.depth) << " new: "<< int(s.depth) << " child#" << i <<" ptr: "<<s.node);
             stack.push(s);
             assert(s.depth <= maxDepth);
@@ -438,7 +438,8 @@
         key_type center_offset_key = this->tree->tree_max_val >> s.depth;
         // push on stack in reverse order
         for (int i=7; i>=0; --i) {
-          if (this->tree->nodeChildExists(top.node, i)) {
+          s.node = this->tree->loadNodeChild(top.node, i);
+          if (s.node != NULL) {
             computeChildKey(i, center_offset_key, top.key, s.key);
 
             // overlap of query bbx and child bbx?
@@ -446,7 +447,6 @@
                 && (minKey[1] <= (s.key[1] + center_offset_key)) && (maxKey[1] >= (s.key[1] - center_offset_key))
                 && (minKey[2] <= (s.key[2] + center_offset_key)) && (maxKey[2] >= (s.key[2] - center_offset_key)))
             {
-              s.node = this->tree->getNodeChild(top.node, i);
               this->stack.push(s);
               assert(s.depth <= this->maxDepth);
             }
@@ -58,16 +58,20 @@ namespace octomap {
     OcTreeNode();
     ~OcTreeNode();
 
+    /// Copy the payload (log odds occupancy) from rhs into this node, see setLogOdds()
+    void copyData(const OcTreeNode& from){ setLogOdds(from.getLogOdds()); }
+
     
     // -- node occupancy  ----------------------------
 
     /// \return occupancy probability of node
-    inline double getOccupancy() const { return probability(value); }
+    inline double getOccupancy() const { return probability(getLogOdds()); }
 
     /// \return log odds representation of occupancy probability of node
-    inline float getLogOdds() const{ return value; }
+    /// (atomic, the node may be updated concurrently, see OcTreeBaseImpl::enableConcurrentReads())
+    inline float getLogOdds() const{ return atomicLoad(&value); }
     /// sets log odds occupancy of node
-    inline void setLogOdds(float l) { value = l; }
+    inline void setLogOdds(float l) { atomicStore(&value, l); }
 
     /**
      * @return mean of all children's occupancy probabilities, in log odds
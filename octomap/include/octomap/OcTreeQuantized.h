@@ -0,0 +1,298 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_OCTREE_QUANTIZED_H
+#define OCTOMAP_OCTREE_QUANTIZED_H
+
+
+#include <octomap/OcTreeBase.h>
+#include <octomap/OcTree.h>
+
+namespace octomap {
+
+  /**
+   * Occupancy node which stores its log-odds as 16 bit fixed point number
+   * (log_odds_scale steps per unit) instead of a float. Since all values are
+   * clamped to a small range anyway (see OcTreeQuantized), this keeps a
+   * resolution of about 0.001 in log-odds.
+   *
+   * Nodes are allocated from a pool of node-sized slots instead of the general
+   * heap, which saves the bookkeeping overhead of malloc (on 64 bit glibc, a
+   * 16 byte node otherwise occupies 32 bytes). Memory of deleted nodes is reused
+   * for new quantized nodes, but not returned to the system.
+   */
+  class OcTreeNodeQuantized : public OcTreeDataNode<int16_t> {
+
+  public:
+    /// fixed point steps per unit of log-odds (range: +-32)
+    static const int log_odds_scale = 1024;
+
+    OcTreeNodeQuantized() : OcTreeDataNode<int16_t>(0) {}
+
+    /// allocates a node from the node pool (thread-safe)
+    static void* operator new(size_t size);
+    /// returns a node to the node pool (thread-safe)
+    static void operator delete(void* p, size_t size);
+
+    /// \return occupancy probability of node
+    inline double getOccupancy() const { return probability(getLogOdds()); }
+
+    /// \return log odds representation of occupancy probability of node
+    inline float getLogOdds() const { return dequantize(value); }
+    /// sets log odds occupancy of node (rounded to the fixed point resolution)
+    inline void setLogOdds(float l) { value = quantize(l); }
+
+    /// @return maximum of children's fixed point log-odds
+    int16_t getMaxChildValue() const;
+
+    /// update this node's occupancy according to its children's maximum occupancy
+    inline void updateOccupancyChildren() {
+      value = getMaxChildValue();  // conservative
+    }
+
+    /// @return log_odds converted to fixed point, saturated to the value range
+    static int16_t quantize(double log_odds);
+    /// @return fixed point value converted to log-odds
+    static inline float dequantize(int16_t q) { return float(q) / log_odds_scale; }
+  };
+
+
+  /**
+   * Occupancy octree with quantized log-odds (see OcTreeNodeQuantized).
+   * Hit and miss updates are saturating integer additions, bounded by the
+   * clamping thresholds. The sensor model parameters and update functions
+   * mirror those of OcTree, maps can be converted from and to OcTree.
+   *
+   * On 64 bit platforms, nodes have the same size as OcTreeNode since the size
+   * is dominated by the children pointer. The memory savings come from the
+   * pooled allocation of the nodes (see OcTreeNodeQuantized), the value takes
+   * half the space in .ot files.
+   */
+  class OcTreeQuantized : public OcTreeBase <OcTreeNodeQuantized> {
+
+  public:
+    /// Default constructor, sets resolution of leafs
+    OcTreeQuantized(double resolution);
+
+    /// Converts an OcTree (map and sensor model parameters), see fromOcTree()
+    explicit OcTreeQuantized(const OcTree& tree);
+
+    /// virtual constructor: creates a new object of same type
+    /// (Covariant return type requires an up-to-date compiler)
+    OcTreeQuantized* create() const {return new OcTreeQuantized(resolution); }
+
+    std::string getTreeType() const {return "OcTreeQuantized";}
+
+    /// Replaces the content of this tree by the map and sensor model parameters
+    /// of tree. Log-odds are rounded to the fixed point resolution.
+    void fromOcTree(const OcTree& tree);
+
+    /// Replaces the content of tree by this tree's map and sensor model parameters
+    void toOcTree(OcTree& tree) const;
+
+    // -- occupancy queries
+
+    /// queries whether a node is occupied according to the tree's parameter for "occupancy"
+    inline bool isNodeOccupied(const OcTreeNodeQuantized* node) const{
+      return (node->getValue() >= occ_prob_thres);
+    }
+
+    /// queries whether a node is occupied according to the tree's parameter for "occupancy"
+    inline bool isNodeOccupied(const OcTreeNodeQuantized& node) const{
+      return (node.getValue() >= occ_prob_thres);
+    }
+
+    /// queries whether a node is at the clamping threshold according to the tree's parameter
+    inline bool isNodeAtThreshold(const OcTreeNodeQuantized* node) const{
+      return (node->getValue() >= clamping_thres_max || node->getValue() <= clamping_thres_min);
+    }
+
+    /// queries whether a node is at the clamping threshold according to the tree's parameter
+    inline bool isNodeAtThreshold(const OcTreeNodeQuantized& node) const{
+      return (node.getValue() >= clamping_thres_max || node.getValue() <= clamping_thres_min);
+    }
+
+    // -- update functions
+
+    /**
+     * Manipulate log_odds value of a voxel by changing it by log_odds_update (relative).
+     * This only works if key is at the lowest octree level
+     *
+     * @param key OcTreeKey of the NODE that is to be updated
+     * @param log_odds_update value to be added (+) to log_odds value of node
+     * @param lazy_eval whether update of inner nodes is omitted after the update (default: false).
+     *   This speeds up the insertion, but you need to call updateInnerOccupancy() when done.
+     * @return pointer to the updated NODE
+     */
+    OcTreeNodeQuantized* updateNode(const OcTreeKey& key, float log_odds_update, bool lazy_eval = false);
+
+    /// Same as updateNode(const OcTreeKey&, float, bool) for a 3d point
+    OcTreeNodeQuantized* updateNode(const point3d& value, float log_odds_update, bool lazy_eval = false);
+
+    /**
+     * Integrate occupancy measurement.
+     *
+     * @param key OcTreeKey of the NODE that is to be updated
+     * @param occupied true if the node was measured occupied, else false
+     * @param lazy_eval whether update of inner nodes is omitted after the update (default: false).
+     * @return pointer to the updated NODE
+     */
+    OcTreeNodeQuantized* updateNode(const OcTreeKey& key, bool occupied, bool lazy_eval = false);
+
+    /// Same as updateNode(const OcTreeKey&, bool, bool) for a 3d point
+    OcTreeNodeQuantized* updateNode(const point3d& value, bool occupied, bool lazy_eval = false);
+
+    /**
+     * Set log_odds value of voxel to log_odds_value, clamped to the
+     * clamping thresholds. This only works if key is at the lowest octree level
+     * @return pointer to the updated NODE
+     */
+    OcTreeNodeQuantized* setNodeValue(const OcTreeKey& key, float log_odds_value, bool lazy_eval = false);
+
+    /// Same as setNodeValue(const OcTreeKey&, float, bool) for a 3d point
+    OcTreeNodeQuantized* setNodeValue(const point3d& value, float log_odds_value, bool lazy_eval = false);
+
+    /**
+     * Integrate a Pointcloud (in global reference frame) with ray casting,
+     * see OccupancyOcTreeBase::insertPointCloud(). Each voxel is updated only
+     * once per scan, occupied endpoints take precedence over free cells.
+     *
+     * @param scan Pointcloud (measurement endpoints), in global reference frame
+     * @param sensor_origin measurement origin in global reference frame
+     * @param maxrange maximum range for how long individual beams are inserted (default -1: complete beam)
+     * @param lazy_eval whether update of inner nodes is omitted after the update (default: false).
+     */
+    void insertPointCloud(const Pointcloud& scan, const octomap::point3d& sensor_origin,
+                          double maxrange=-1., bool lazy_eval = false);
+
+    /// Updates the occupancy of all inner nodes to reflect their children's occupancy.
+    /// If you performed batch-updates with lazy evaluation enabled, you must call this
+    /// before any queries to ensure correct multi-resolution behavior.
+    void updateInnerOccupancy();
+
+    /// integrate a "hit" measurement according to the tree's sensor model
+    inline void integrateHit(OcTreeNodeQuantized* node) const { updateNodeLogOdds(node, prob_hit); }
+
+    /// integrate a "miss" measurement according to the tree's sensor model
+    inline void integrateMiss(OcTreeNodeQuantized* node) const { updateNodeLogOdds(node, prob_miss); }
+
+    /// update fixed point log-odds value of node by adding update,
+    /// saturating at the clamping thresholds
+    inline void updateNodeLogOdds(OcTreeNodeQuantized* node, int16_t update) const {
+      int value = int(node->getValue()) + update;
+      if (value < clamping_thres_min)
+        value = clamping_thres_min;
+      else if (value > clamping_thres_max)
+        value = clamping_thres_max;
+      node->setValue(int16_t(value));
+    }
+
+    //-- parameters for occupancy and sensor model, as in AbstractOccupancyOcTree
+    // (stored in fixed point)
+
+    /// sets the threshold for occupancy (sensor model)
+    void setOccupancyThres(double prob){occ_prob_thres = OcTreeNodeQuantized::quantize(logodds(prob)); }
+    /// sets the probability for a "hit" (will be converted to logodds) - sensor model
+    void setProbHit(double prob){prob_hit = OcTreeNodeQuantized::quantize(logodds(prob)); assert(prob_hit >= 0);}
+    /// sets the probability for a "miss" (will be converted to logodds) - sensor model
+    void setProbMiss(double prob){prob_miss = OcTreeNodeQuantized::quantize(logodds(prob)); assert(prob_miss <= 0);}
+    /// sets the minimum threshold for occupancy clamping (sensor model)
+    void setClampingThresMin(double thresProb){clamping_thres_min = OcTreeNodeQuantized::quantize(logodds(thresProb)); }
+    /// sets the maximum threshold for occupancy clamping (sensor model)
+    void setClampingThresMax(double thresProb){clamping_thres_max = OcTreeNodeQuantized::quantize(logodds(thresProb)); }
+
+    /// @return threshold (probability) for occupancy - sensor model
+    double getOccupancyThres() const {return probability(getOccupancyThresLog()); }
+    /// @return threshold (logodds) for occupancy - sensor model
+    float getOccupancyThresLog() const {return OcTreeNodeQuantized::dequantize(occ_prob_thres); }
+    /// @return probability for a "hit" in the sensor model (probability)
+    double getProbHit() const {return probability(getProbHitLog()); }
+    /// @return probability for a "hit" in the sensor model (logodds)
+    float getProbHitLog() const {return OcTreeNodeQuantized::dequantize(prob_hit); }
+    /// @return probability for a "miss"  in the sensor model (probability)
+    double getProbMiss() const {return probability(getProbMissLog()); }
+    /// @return probability for a "miss"  in the sensor model (logodds)
+    float getProbMissLog() const {return OcTreeNodeQuantized::dequantize(prob_miss); }
+    /// @return minimum threshold for occupancy clamping in the sensor model (probability)
+    double getClampingThresMin() const {return probability(getClampingThresMinLog()); }
+    /// @return minimum threshold for occupancy clamping in the sensor model (logodds)
+    float getClampingThresMinLog() const {return OcTreeNodeQuantized::dequantize(clamping_thres_min); }
+    /// @return maximum threshold for occupancy clamping in the sensor model (probability)
+    double getClampingThresMax() const {return probability(getClampingThresMaxLog()); }
+    /// @return maximum threshold for occupancy clamping in the sensor model (logodds)
+    float getClampingThresMaxLog() const {return OcTreeNodeQuantized::dequantize(clamping_thres_max); }
+
+  protected:
+    /// recursive call of updateNode() and setNodeValue() (if set_value is true)
+    OcTreeNodeQuantized* updateNodeRecurs(OcTreeNodeQuantized* node, bool node_just_created, const OcTreeKey& key,
+                                          unsigned int depth, int16_t value, bool set_value, bool lazy_eval);
+
+    void updateInnerOccupancyRecurs(OcTreeNodeQuantized* node, unsigned int depth);
+
+    // occupancy parameters of tree, stored as fixed point log-odds:
+    int16_t clamping_thres_min;
+    int16_t clamping_thres_max;
+    int16_t prob_hit;
+    int16_t prob_miss;
+    int16_t occ_prob_thres;
+
+    /**
+     * Static member object which ensures that this OcTree's prototype
+     * ends up in the classIDMapping only once. You need this as a
+     * static member in any derived octree class in order to read .ot
+     * files through the AbstractOcTree factory. You should also call
+     * ensureLinking() once from the constructor.
+     */
+    class StaticMemberInitializer{
+    public:
+      StaticMemberInitializer() {
+        OcTreeQuantized* tree = new OcTreeQuantized(0.1);
+        tree->clearKeyRays();
+        AbstractOcTree::registerTreeType(tree);
+      }
+
+      /**
+      * Dummy function to ensure that MSVC does not drop the
+      * StaticMemberInitializer, causing this tree failing to register.
+      * Needs to be called from the constructor of this octree.
+      */
+      void ensureLinking() {};
+    };
+    /// to ensure static initialization (only once)
+    static StaticMemberInitializer ocTreeQuantizedMemberInit;
+
+  };
+
+} // end namespace
+
+#endif
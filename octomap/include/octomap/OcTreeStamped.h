@@ -45,9 +45,9 @@ namespace octomap {
   class OcTreeNodeStamped : public OcTreeNode {
 
   public:
-    OcTreeNodeStamped() : OcTreeNode(), timestamp(0) {}
+    OcTreeNodeStamped() : OcTreeNode(), timestamp(0), min_timestamp(0) {}
 
-    OcTreeNodeStamped(const OcTreeNodeStamped& rhs) : OcTreeNode(rhs), timestamp(rhs.timestamp) {}
+    OcTreeNodeStamped(const OcTreeNodeStamped& rhs) : OcTreeNode(rhs), timestamp(rhs.timestamp), min_timestamp(rhs.min_timestamp) {}
 
     bool operator==(const OcTreeNodeStamped& rhs) const{
       return (rhs.value == value && rhs.timestamp == timestamp);
@@ -56,21 +56,29 @@ namespace octomap {
     void copyData(const OcTreeNodeStamped& from){
       OcTreeNode::copyData(from);
       timestamp = from.getTimestamp();
+      min_timestamp = from.getMinTimestamp();
     }
 
     // timestamp
+    /// @return time of the last update (the most recent one below inner nodes)
     inline unsigned int getTimestamp() const { return timestamp; }
-    inline void updateTimestamp() { timestamp = (unsigned int) time(NULL);}
-    inline void setTimestamp(unsigned int t) {timestamp = t; }
+    /// @return oldest timestamp of the leafs below an inner node, same as getTimestamp() for leafs
+    inline unsigned int getMinTimestamp() const { return min_timestamp; }
+    inline void updateTimestamp() { setTimestamp((unsigned int) time(NULL)); }
+    inline void setTimestamp(unsigned int t) { timestamp = t; min_timestamp = t; }
 
     // update occupancy and timesteps of inner nodes
     inline void updateOccupancyChildren() {
       this->setLogOdds(this->getMaxChildLogOdds());  // conservative
-      updateTimestamp();
+      updateTimestampChildren();
     }
 
+    /// sets the most recent and the oldest timestamp of the children (inner nodes)
+    void updateTimestampChildren();
+
   protected:
     unsigned int timestamp;
+    unsigned int min_timestamp; ///< oldest timestamp below this node (grows the node from 16 to 24 bytes)
   };
 
 
@@ -90,12 +98,60 @@ namespace octomap {
     //! \return timestamp of last update
     unsigned int getLastUpdateTime();
 
+    /**
+     * Sets the clock of the tree: all following updates are stamped with time (e.g. the
+     * time of the current scan) instead of the system time, which is read on every update.
+     * Time needs to be larger than 0, which marks nodes that were never updated.
+     */
+    void setCurrentTime(unsigned int time) { current_time = time; use_current_time = true; }
+
+    /// Stamps all following updates with the system time again, time(NULL) (default)
+    void useSystemTime() { use_current_time = false; }
+
+    /// @return time used to stamp updates, see setCurrentTime()
+    unsigned int getCurrentTime() const { return use_current_time ? current_time : (unsigned int) time(NULL); }
+
+    /**
+     * Integrates a miss (without updating the timestamp) into all occupied leafs that were
+     * not updated within time_thres before the current time (see getCurrentTime()). Subtrees
+     * whose oldest leaf is recent enough or that are free are skipped, so only outdated parts
+     * of the tree are visited. Requires inner nodes to be up to date, see updateInnerOccupancy().
+     */
     void degradeOutdatedNodes(unsigned int time_thres);
 
+    /**
+     * Lazy alternative to degradeOutdatedNodes(): one miss is integrated for every decay_interval
+     * elapsed since the last update of an occupied node, when the node is queried with
+     * getDecayedLogOdds() or updated again. No sweep over the tree is needed. The stored
+     * occupancy (e.g. used by isNodeOccupied()) is not decayed until the node is updated.
+     *
+     * @param decay_interval time per integrated miss, 0 disables the lazy decay (default)
+     */
+    void setDecayInterval(unsigned int decay_interval) { this->decay_interval = decay_interval; }
+    unsigned int getDecayInterval() const { return decay_interval; }
+
+    /// @return log-odds of node at the current time with the lazy decay applied, see setDecayInterval()
+    float getDecayedLogOdds(const OcTreeNodeStamped* node) const;
+
+    /// @return true if node is occupied at the current time with the lazy decay applied
+    bool isNodeOccupiedDecayed(const OcTreeNodeStamped* node) const {
+      return getDecayedLogOdds(node) >= this->occ_prob_thres_log;
+    }
+
     virtual void updateNodeLogOdds(OcTreeNodeStamped* node, const float& update) const;
     void integrateMissNoTime(OcTreeNodeStamped* node) const;
 
   protected:
+    /// recursive call of degradeOutdatedNodes(), node is occupied and outdated
+    void degradeOutdatedNodesRecurs(OcTreeNodeStamped* node, unsigned int query_time, unsigned int time_thres);
+
+    /// @return log-odds of node with one miss integrated per decay_interval elapsed until query_time
+    float decayLogOdds(const OcTreeNodeStamped* node, unsigned int query_time) const;
+
+    unsigned int current_time; ///< time to stamp updates with, see setCurrentTime()
+    bool use_current_time;
+    unsigned int decay_interval; ///< lazy decay, 0: disabled
+
     /**
      * Static member object which ensures that this OcTree's prototype
      * ends up in the classIDMapping only once. You need this as a
@@ -0,0 +1,221 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_OCTREE_STATS_H
+#define OCTOMAP_OCTREE_STATS_H
+
+
+#include <octomap/OcTreeNode.h>
+#include <octomap/OccupancyOcTreeBase.h>
+
+namespace octomap {
+
+  /**
+   * Occupancy node which also stores statistics of its subtree: the occupied and
+   * free volume and the minimum and maximum log-odds of the leafs below. Volumes are
+   * fixed point fractions of the node's own volume (volume_scale: the whole node), so
+   * they remain valid when nodes are pruned or expanded. A voxel counts as occupied if
+   * its log-odds is >= 0, i.e. with the default occupancy threshold of 0.5.
+   * Leafs derive their statistics from their log-odds, inner nodes aggregate them in
+   * updateOccupancyChildren().
+   */
+  class OcTreeNodeStats : public OcTreeNode {
+
+  public:
+    /// fixed point volume of a whole node, 8^16: a voxel at full depth below the root is 1
+    static const uint64_t volume_scale = uint64_t(1) << 48;
+
+    OcTreeNodeStats() : OcTreeNode(), occupied_volume(0), free_volume(0), min_log_odds(0), max_log_odds(0) {}
+
+    OcTreeNodeStats(const OcTreeNodeStats& rhs) : OcTreeNode(rhs), occupied_volume(rhs.occupied_volume),
+      free_volume(rhs.free_volume), min_log_odds(rhs.min_log_odds), max_log_odds(rhs.max_log_odds) {}
+
+    bool operator==(const OcTreeNodeStats& rhs) const{
+      return (rhs.value == value);
+    }
+
+    void copyData(const OcTreeNodeStats& from){
+      OcTreeNode::copyData(from);
+      occupied_volume = from.occupied_volume;
+      free_volume = from.free_volume;
+      min_log_odds = from.min_log_odds;
+      max_log_odds = from.max_log_odds;
+    }
+
+    // subtree statistics
+    /// @return occupied fraction of the node's volume, in units of 1/volume_scale
+    inline uint64_t getOccupiedVolume() const {
+      return hasChildNodes() ? occupied_volume : (value >= 0.0f ? volume_scale : 0);
+    }
+    /// @return free fraction of the node's volume, in units of 1/volume_scale
+    inline uint64_t getFreeVolume() const {
+      return hasChildNodes() ? free_volume : (value >= 0.0f ? 0 : volume_scale);
+    }
+    /// @return known (occupied or free) fraction of the node's volume, in units of 1/volume_scale
+    inline uint64_t getKnownVolume() const {
+      return hasChildNodes() ? occupied_volume + free_volume : volume_scale;
+    }
+    /// @return minimum log-odds of the leafs below an inner node, own log-odds for leafs
+    inline float getMinLogOdds() const { return hasChildNodes() ? min_log_odds : value; }
+    /// @return maximum log-odds of the leafs below an inner node, own log-odds for leafs
+    inline float getMaxLogOdds() const { return hasChildNodes() ? max_log_odds : value; }
+
+    // update occupancy and statistics of inner nodes
+    inline void updateOccupancyChildren() {
+      this->setLogOdds(this->getMaxChildLogOdds());  // conservative
+      updateStatsChildren();
+    }
+
+    /// aggregates the statistics of the children (inner nodes)
+    void updateStatsChildren();
+
+  protected:
+    /// same as OcTreeBaseImpl::nodeHasChildren()
+    inline bool hasChildNodes() const {
+      if (children == NULL)
+        return false;
+      for (unsigned int i=0; i<8; i++) {
+        if (children[i] != NULL)
+          return true;
+      }
+      return false;
+    }
+
+    uint64_t occupied_volume; ///< inner nodes only, see getOccupiedVolume()
+    uint64_t free_volume;     ///< inner nodes only, see getFreeVolume()
+    float min_log_odds;       ///< inner nodes only, see getMinLogOdds()
+    float max_log_odds;       ///< inner nodes only, see getMaxLogOdds()
+  };
+
+
+  /**
+   * Occupancy octree which maintains statistics of all subtrees (see OcTreeNodeStats)
+   * during updates and pruning. Range queries (occupied, free and unknown volume,
+   * range of log-odds, whether anything occupied, free or unknown is in a box) are
+   * answered from the highest nodes completely inside of the box, visiting only
+   * nodes along its border instead of all leafs. As with the occupancy of inner
+   * nodes, the statistics need to be updated with updateInnerOccupancy() after
+   * lazy updates.
+   */
+  class OcTreeStats : public OccupancyOcTreeBase <OcTreeNodeStats> {
+
+  public:
+    /// Statistics of an axis-aligned bounding box, see getStatsBBX()
+    struct BBXStats {
+      uint64_t occupied; ///< number of occupied voxels (at full depth)
+      uint64_t free;     ///< number of free voxels
+      uint64_t unknown;  ///< number of unknown voxels
+      float min_log_odds; ///< minimum log-odds of the known voxels, NaN if there are none
+      float max_log_odds; ///< maximum log-odds of the known voxels, NaN if there are none
+    };
+
+    /// Default constructor, sets resolution of leafs
+    OcTreeStats(double resolution);
+
+    /// virtual constructor: creates a new object of same type
+    /// (Covariant return type requires an up-to-date compiler)
+    OcTreeStats* create() const {return new OcTreeStats(resolution); }
+
+    std::string getTreeType() const {return "OcTreeStats";}
+
+    /**
+     * Computes the number of occupied, free and unknown voxels and the range of log-odds in
+     * an axis-aligned bounding box (min_key and max_key included). Voxels are classified with
+     * the tree's occupancy threshold. With the default threshold of 0.5, the stored volumes of
+     * nodes inside of the box are used directly. Otherwise, nodes whose log-odds are all on
+     * one side of the threshold are used as a whole.
+     *
+     * @return false if the bounding box is invalid
+     */
+    bool getStatsBBX(const OcTreeKey& min_key, const OcTreeKey& max_key, BBXStats& stats) const;
+
+    /// Coordinate version of getStatsBBX()
+    bool getStatsBBX(const point3d& min, const point3d& max, BBXStats& stats) const;
+
+    /// @return true if there is an occupied voxel in the bounding box (min_key and max_key included)
+    bool anyOccupiedBBX(const OcTreeKey& min_key, const OcTreeKey& max_key) const;
+    /// @return true if there is a free voxel in the bounding box (min_key and max_key included)
+    bool anyFreeBBX(const OcTreeKey& min_key, const OcTreeKey& max_key) const;
+    /// @return true if there is an unknown voxel in the bounding box (min_key and max_key included)
+    bool anyUnknownBBX(const OcTreeKey& min_key, const OcTreeKey& max_key) const;
+
+    /// Reads the tree and computes the statistics of inner nodes
+    std::istream& readData(std::istream &s);
+    /// Reads the tree (.bt) and computes the statistics of inner nodes
+    std::istream& readBinaryData(std::istream &s);
+
+  protected:
+    /// voxel classes of anyBBXRecurs()
+    enum VoxelClass { OCCUPIED, FREE, UNKNOWN };
+
+    /// recursive call of getStatsBBX(), node overlaps the box
+    void getStatsBBXRecurs(const OcTreeNodeStats* node, unsigned int depth, const OcTreeKey& node_min_key,
+                           const OcTreeKey& min_key, const OcTreeKey& max_key, BBXStats& stats) const;
+
+    /// recursive call of anyOccupiedBBX(), anyFreeBBX() and anyUnknownBBX(), node overlaps the box
+    bool anyBBXRecurs(const OcTreeNodeStats* node, unsigned int depth, const OcTreeKey& node_min_key,
+                      const OcTreeKey& min_key, const OcTreeKey& max_key, VoxelClass voxel_class) const;
+
+    /// @return false and reports an error if the box is invalid
+    bool checkBBX(const OcTreeKey& min_key, const OcTreeKey& max_key, const char* function) const;
+
+    /**
+     * Static member object which ensures that this OcTree's prototype
+     * ends up in the classIDMapping only once. You need this as a
+     * static member in any derived octree class in order to read .ot
+     * files through the AbstractOcTree factory. You should also call
+     * ensureLinking() once from the constructor.
+     */
+    class StaticMemberInitializer{
+    public:
+      StaticMemberInitializer() {
+        OcTreeStats* tree = new OcTreeStats(0.1);
+        tree->clearKeyRays();
+        AbstractOcTree::registerTreeType(tree);
+      }
+
+      /**
+      * Dummy function to ensure that MSVC does not drop the
+      * StaticMemberInitializer, causing this tree failing to register.
+      * Needs to be called from the constructor of this octree.
+      */
+      void ensureLinking() {};
+    };
+    /// to ensure static initialization (only once)
+    static StaticMemberInitializer ocTreeStatsMemberInit;
+
+  };
+
+} // end namespace
+
+#endif
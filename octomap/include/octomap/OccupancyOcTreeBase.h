@@ -35,6 +35,7 @@
 #define OCTOMAP_OCCUPANCY_OCTREE_BASE_H
 
 
+#include <limits>
 #include <list>
 #include <stdlib.h>
 #include <vector>
@@ -43,10 +44,32 @@
 #include "octomap_utils.h"
 #include "OcTreeBaseImpl.h"
 #include "AbstractOccupancyOcTree.h"
+#include "RangeDepthPolicy.h"
+#include "CollisionShape.h"
 
 
 namespace octomap {
 
+  /**
+   * One cell (column) of a 2D projection of an occupancy octree,
+   * see OccupancyOcTreeBase::getProjectionBBX(). Heights are in meters.
+   */
+  struct ProjectionCell {
+    ProjectionCell()
+      : min_z(std::numeric_limits<float>::quiet_NaN()), max_z(std::numeric_limits<float>::quiet_NaN()),
+        obstacle_z(std::numeric_limits<float>::quiet_NaN()), occupancy(-1) {}
+
+    /// bottom of the lowest occupied voxel in the column, NaN if there is none
+    float min_z;
+    /// top of the highest occupied voxel in the column, NaN if there is none
+    float max_z;
+    /// bottom of the first occupied voxel above the ground (lower end of the
+    /// z band), i.e. the clearance above the ground, NaN if there is none
+    float obstacle_z;
+    /// occupancy in the z band: -1 unknown, 0 free or 1 occupied
+    int8_t occupancy;
+  };
+
   /**
    * Base implementation for Occupancy Octrees (e.g. for mapping).
    * AbstractOccupancyOcTree serves as a common
@@ -145,6 +168,58 @@ namespace octomap {
      */
      virtual void insertPointCloudRays(const Pointcloud& scan, const point3d& sensor_origin, double maxrange = -1., bool lazy_eval = false);
 
+    /**
+     * Integrate a Pointcloud (in global reference frame) with a resolution that
+     * decreases with the distance from the sensor. Parts of the beams are traced
+     * and updated at the depth the policy assigns to their range, so that distant
+     * free space and endpoints are updated as coarse nodes (with a single update
+     * of the whole node). Near the sensor, the result is the same as with
+     * insertPointCloud(). As there, each node is updated only once and occupied
+     * nodes have a preference over free ones (of any size).
+     *
+     * @param scan Pointcloud (measurement endpoints), in global reference frame
+     * @param sensor_origin measurement origin in global reference frame
+     * @param policy assigns the update depth to ranges, see RangeDepthPolicy
+     * @param maxrange maximum range for how long individual beams are inserted (default -1: complete beam)
+     * @param lazy_eval whether update of inner nodes is omitted after the update (default: false).
+     *   This speeds up the insertion, but you need to call updateInnerOccupancy() when done.
+     */
+    void insertPointCloudMultiRes(const Pointcloud& scan, const point3d& sensor_origin,
+                                  const RangeDepthPolicy& policy, double maxrange = -1., bool lazy_eval = false);
+
+    /**
+     * Integrate a depth image of a pinhole camera without converting it to a
+     * Pointcloud first. Free space near the camera is carved by projecting each
+     * voxel of the view frustum into the image once (instead of tracing one ray
+     * per pixel through it), only the far parts of the beams are ray traced.
+     * As in insertPointCloud(), each voxel is updated only once and occupied
+     * voxels have a preference over free ones.
+     *
+     * The camera frame is the usual optical frame: z forward (along the
+     * depth), x right (along image columns) and y down (along image rows).
+     *
+     * @param depth depth image in meters (z-distance along the optical axis), row-major
+     *   width x height. Pixels <= 0 or NaN have no measurement.
+     * @param width image width in pixels
+     * @param height image height in pixels
+     * @param fx focal length in x, in pixels
+     * @param fy focal length in y, in pixels
+     * @param cx principal point x, in pixels
+     * @param cy principal point y, in pixels
+     * @param sensor_pose pose of the camera (optical frame) in the global reference frame
+     * @param min_depth pixels with a smaller depth are ignored (default 0: all)
+     * @param max_depth pixels with a larger depth only clear space up to max_depth
+     *   (default -1: unlimited)
+     * @param downsample use only the nearest measurement of each block of
+     *   downsample x downsample pixels (default 1: all pixels)
+     * @param lazy_eval whether update of inner nodes is omitted after the update (default: false).
+     *   This speeds up the insertion, but you need to call updateInnerOccupancy() when done.
+     */
+    void insertDepthImage(const float* depth, unsigned int width, unsigned int height,
+                          double fx, double fy, double cx, double cy, const pose6d& sensor_pose,
+                          double min_depth = 0.0, double max_depth = -1.0, unsigned int downsample = 1,
+                          bool lazy_eval = false);
+
      /**
       * Set log_odds value of voxel to log_odds_value. This only works if key is at the lowest
       * octree level
@@ -258,6 +333,43 @@ namespace octomap {
      */
     virtual NODE* updateNode(double x, double y, double z, bool occupied, bool lazy_eval = false);
 
+    /**
+     * Sets the log-odds of all voxels in the axis-aligned box [min_key, max_key]
+     * (inclusive) to log_odds_value, clamped to the clamping thresholds. Nodes
+     * completely inside the box are written as a whole (replacing their children),
+     * the tree is only refined along the boundary of the box. The cost is thus
+     * proportional to the surface of the box instead of its volume.
+     *
+     * With change detection enabled, nodes written as a whole are reported with
+     * their key at their depth (see adjustKeyAtDepth()).
+     *
+     * @param min_key minimum OcTreeKey of the box
+     * @param max_key maximum OcTreeKey of the box
+     * @param log_odds_value log-odds value to be set
+     * @param unknown_only only set voxels in unknown space, known voxels stay unchanged
+     * @param lazy_eval whether update of inner nodes is omitted after the update (default: false).
+     *   This speeds up the insertion, but you need to call updateInnerOccupancy() when done.
+     */
+    void setNodeValueBBX(const OcTreeKey& min_key, const OcTreeKey& max_key, float log_odds_value,
+                         bool unknown_only = false, bool lazy_eval = false);
+
+    /// Coordinate version of setNodeValueBBX(), min and max are included in the box
+    void setNodeValueBBX(const point3d& min, const point3d& max, float log_odds_value,
+                         bool unknown_only = false, bool lazy_eval = false);
+
+    /**
+     * Same as setNodeValueBBX(), but changes the log-odds of all voxels in the box by
+     * log_odds_update (relative, with clamping, see updateNodeLogOdds()) as updateNode()
+     * would for each of them. Existing nodes inside the box are visited down to their
+     * leafs, unknown space inside the box is created with coarse nodes.
+     */
+    void updateNodeBBX(const OcTreeKey& min_key, const OcTreeKey& max_key, float log_odds_update,
+                       bool unknown_only = false, bool lazy_eval = false);
+
+    /// Coordinate version of updateNodeBBX(), min and max are included in the box
+    void updateNodeBBX(const point3d& min, const point3d& max, float log_odds_update,
+                       bool unknown_only = false, bool lazy_eval = false);
+
 
     /**
      * Creates the maximum likelihood map by calling toMaxLikelihood on all
@@ -266,6 +378,48 @@ namespace octomap {
      */
     virtual void toMaxLikelihood();
 
+    /**
+     * Merges another occupancy tree into this one (e.g. for multi-robot mapping).
+     * Both trees are traversed simultaneously and the log-odds of overlapping
+     * nodes are added with clamping (see updateNodeLogOdds()), nodes only known
+     * in "other" are copied. Pruned nodes at any depth are merged as a whole:
+     * a pruned node in "other" is applied to all leafs below the corresponding
+     * node in this tree, and nodes in this tree are only expanded when "other" has
+     * finer structure there. With OpenMP, the subtrees below the root are merged
+     * in parallel.
+     *
+     * @note Merging does not report changes to the change detection (see enableChangeDetection()).
+     *
+     * @param other tree to be merged into this one, needs to have the same resolution
+     * @param lazy_eval whether update of inner nodes is omitted after the update (default: false).
+     *   This speeds up the merge, but you need to call updateInnerOccupancy() when done.
+     * @return success of operation (false if the resolutions differ)
+     */
+    bool merge(const OccupancyOcTreeBase<NODE>& other, bool lazy_eval = false);
+
+    /**
+     * Merges another occupancy tree into this one, after moving it by "offset".
+     * The offset has to be a pure translation which is a multiple of the resolution,
+     * so that the keys of both trees stay aligned. The structural merge then starts
+     * at the coarsest depth where nodes of both trees coincide, which is the root
+     * for a zero offset and deeper for offsets that are not a multiple of large
+     * node sizes. Nodes that are moved out of the tree bounds are dropped.
+     *
+     * @param other tree to be merged into this one, needs to have the same resolution
+     * @param offset translation applied to "other" before merging
+     * @param lazy_eval whether update of inner nodes is omitted after the update (default: false).
+     *   This speeds up the merge, but you need to call updateInnerOccupancy() when done.
+     * @return success of operation (false for different resolutions or non-aligned offsets)
+     */
+    bool merge(const OccupancyOcTreeBase<NODE>& other, const pose6d& offset, bool lazy_eval = false);
+
+    /**
+     * Turns "target" into a copy-on-write snapshot of this tree (see
+     * OcTreeBaseImpl::snapshot()) and copies the sensor model and clamping
+     * parameters. Change detection and BBX settings of target are not changed.
+     */
+    void snapshot(OccupancyOcTreeBase<NODE>& target) const;
+
     /**
      * Insert one ray between origin and end into the tree.
      * integrateMissOnRay() is called for the ray, the end point is updated as occupied.
@@ -327,7 +481,306 @@ namespace octomap {
 		 * @return True if the input voxel is known in the occupancy grid, and false if it is unknown.
 		 */
 		bool getNormals(const point3d& point, std::vector<point3d>& normals, bool unknownStatus=true) const;
-	
+
+    //-- surface extraction
+
+    /**
+     * Extracts the surface between occupied and free space in an axis-aligned bounding box
+     * as an indexed triangle mesh, using the marching cubes tables of getNormals(). The cubes
+     * are formed by the centers of neighboring voxels at the finest resolution. Vertices lie
+     * in the middle of the voxel faces (no interpolation) and are shared by all adjacent
+     * triangles. The map is processed in blocks of 32^3 voxels (in parallel with OpenMP),
+     * each block is rasterized once instead of searching the corners of every cube.
+     * Only blocks near occupied leafs (free leafs if unknownStatus is true) are visited.
+     * Output is deterministic, independent of the number of threads.
+     *
+     * @param min_key minimum OcTreeKey of the bounding box, voxels outside are treated as unknown
+     * @param max_key maximum OcTreeKey of the bounding box
+     * @param[out] vertices vertex coordinates (previous content is discarded)
+     * @param[out] normals normal of each vertex, the normalized sum of the adjacent triangle
+     *   normals, pointing to free space
+     * @param[out] triangles three vertex indices per triangle, counter-clockwise when seen from free space
+     * @param unknownStatus consider unknown cells as free (default, false) or occupied (true)
+     * @return number of triangles
+     */
+    size_t getMeshBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                      std::vector<point3d>& vertices, std::vector<point3d>& normals,
+                      std::vector<unsigned int>& triangles, bool unknownStatus = false) const;
+
+    /// Coordinate version of getMeshBBX(), @return number of triangles
+    size_t getMeshBBX(const point3d& min, const point3d& max,
+                      std::vector<point3d>& vertices, std::vector<point3d>& normals,
+                      std::vector<unsigned int>& triangles, bool unknownStatus = false) const;
+
+    /// Extracts the surface of the whole map, see getMeshBBX(). @return number of triangles
+    size_t getMesh(std::vector<point3d>& vertices, std::vector<point3d>& normals,
+                   std::vector<unsigned int>& triangles, bool unknownStatus = false) const;
+
+    /**
+     * Extracts the surface of the whole map with getMesh() and writes it to a file.
+     * The format is chosen by the file extension: binary PLY (".ply") or Wavefront OBJ (".obj").
+     * @return success of the operation
+     */
+    bool writeMesh(const std::string& filename, bool unknownStatus = false) const;
+
+    /**
+     * Writes an indexed triangle mesh (e.g. from getMeshBBX()) to a binary PLY (".ply")
+     * or Wavefront OBJ (".obj") file, depending on the file extension.
+     * @return success of the operation
+     */
+    static bool writeMesh(const std::string& filename, const std::vector<point3d>& vertices,
+                          const std::vector<point3d>& normals, const std::vector<unsigned int>& triangles);
+
+    //-- bulk extraction of bounding boxes (e.g. local maps for planning)
+
+    /**
+     * Writes center, size and log-odds of all leafs in an axis-aligned bounding box
+     * to contiguous arrays. Results are appended, so you can clear() and reuse the
+     * same vectors to avoid reallocations. Subtrees are culled as a whole by their key
+     * range and, if only occupied leafs are requested, by the (maximum) occupancy of
+     * inner nodes. This requires inner nodes to be up to date, see updateInnerOccupancy().
+     *
+     * @param min_key minimum OcTreeKey to be included in the bounding box
+     * @param max_key maximum OcTreeKey to be included in the bounding box
+     * @param[out] centers center coordinates of all leafs in the bounding box
+     * @param[out] sizes side length of each leaf
+     * @param[out] log_odds occupancy (log-odds) of each leaf
+     * @param occupied_only only output occupied leafs (default: false)
+     * @param max_depth maximum depth of the traversal, deeper nodes are reported
+     *   by their parent at max_depth (default 0: full tree depth)
+     * @return number of leafs written
+     */
+    size_t getLeafsBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                       std::vector<point3d>& centers, std::vector<float>& sizes,
+                       std::vector<float>& log_odds, bool occupied_only = false,
+                       unsigned int max_depth = 0) const;
+
+    /// Coordinate version of getLeafsBBX(), @return number of leafs written
+    size_t getLeafsBBX(const point3d& min, const point3d& max,
+                       std::vector<point3d>& centers, std::vector<float>& sizes,
+                       std::vector<float>& log_odds, bool occupied_only = false,
+                       unsigned int max_depth = 0) const;
+
+    /**
+     * Rasterizes an axis-aligned bounding box into a dense occupancy grid with cells
+     * of size getNodeSize(depth). The grid is stored in x-major order, i.e. cell (x,y,z)
+     * is at index x + size_x*(y + size_y*z). The cell (0,0,0) is the node at "depth"
+     * that contains min_key. Cells are -1 (unknown), 0 (free) or 1 (occupied).
+     * Nodes coarser than "depth" are written into all cells they cover, finer
+     * nodes are represented by their (maximum) inner node occupancy.
+     *
+     * @param min_key minimum OcTreeKey to be included in the grid
+     * @param max_key maximum OcTreeKey to be included in the grid
+     * @param[out] grid dense occupancy grid, resized to size_x*size_y*size_z
+     * @param[out] size_x number of cells in x direction
+     * @param[out] size_y number of cells in y direction
+     * @param[out] size_z number of cells in z direction
+     * @param depth depth of the grid cells (default 0: full tree depth)
+     * @return false if the bounding box is invalid
+     */
+    bool getOccupancyGridBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                             std::vector<int8_t>& grid, unsigned int& size_x,
+                             unsigned int& size_y, unsigned int& size_z,
+                             unsigned int depth = 0) const;
+
+    /**
+     * Same as getOccupancyGridBBX(), but only stores one bit per cell (true: occupied).
+     *
+     * @param unknown_as_occupied whether unknown cells are set (conservative, default) or not
+     * @return false if the bounding box is invalid
+     */
+    bool getOccupancyBitsBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                             std::vector<bool>& grid, unsigned int& size_x,
+                             unsigned int& size_y, unsigned int& size_z,
+                             unsigned int depth = 0, bool unknown_as_occupied = true) const;
+
+    /**
+     * Projects an axis-aligned bounding box onto a 2D grid in the xy plane with cells of
+     * size getNodeSize(depth), e.g. the occupancy grid and height map of a ground robot.
+     * The grid is stored in x-major order (cell (x,y) is at index x + size_x*y), cell (0,0)
+     * is the column of nodes at "depth" containing min_key. For each column, the lowest and
+     * highest occupied voxel, the first obstacle above the ground and the occupancy within
+     * the z band [band_min_z, band_max_z] are computed (see ProjectionCell), considering the
+     * voxels within the z range of the bounding box. As in getOccupancyGridBBX(), cells cover
+     * whole nodes at "depth" in x and y. Free subtrees outside of the band and free
+     * subtrees of already known cells are skipped as a whole, which requires inner nodes
+     * to be up to date (see updateInnerOccupancy()).
+     *
+     * @param min_key minimum OcTreeKey of the bounding box
+     * @param max_key maximum OcTreeKey of the bounding box
+     * @param band_min_z lower end of the z band (the ground), in meters
+     * @param band_max_z upper end of the z band, in meters
+     * @param[out] grid projection, resized to size_x*size_y
+     * @param[out] size_x number of cells in x direction
+     * @param[out] size_y number of cells in y direction
+     * @param depth depth of the grid cells (default 0: full tree depth)
+     * @return false if the bounding box or the band is invalid
+     */
+    bool getProjectionBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                          double band_min_z, double band_max_z, std::vector<ProjectionCell>& grid,
+                          unsigned int& size_x, unsigned int& size_y, unsigned int depth = 0) const;
+
+    /**
+     * Updates a projection from getProjectionBBX() (with the same parameters) incrementally.
+     * Only the columns containing the keys reported by change detection are computed again,
+     * call resetChangeDetection() afterwards. Changes which are not reported at full depth
+     * (e.g. from setNodeValueBBX()) or deleted nodes are not detected, compute the whole
+     * projection again in that case.
+     *
+     * @return number of updated cells, 0 on error (e.g. change detection is disabled)
+     */
+    size_t updateProjectionBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                               double band_min_z, double band_max_z, std::vector<ProjectionCell>& grid,
+                               unsigned int depth = 0) const;
+
+    //-- sliding window
+
+    /**
+     * Removes everything outside of an axis-aligned bounding box, e.g. to keep the memory
+     * bounded during long-term operation by only mapping a region around the robot (see
+     * moveWindow()). Subtrees completely outside the box are removed as a whole, only nodes
+     * along its border are visited. Leafs crossing the border are kept.
+     *
+     * @param min_key minimum OcTreeKey of the box to keep
+     * @param max_key maximum OcTreeKey of the box to keep
+     * @param spill if not NULL, the removed subtrees are moved (not copied) into this tree
+     *   at the same position, replacing its nodes there. It can be written to disk with
+     *   write() and the subtrees can be brought back with restoreBBX() when the
+     *   region is revisited. Needs to have the same resolution.
+     * @return number of nodes removed
+     */
+    size_t cropBBX(const OcTreeKey& min_key, const OcTreeKey& max_key, OccupancyOcTreeBase<NODE>* spill = NULL);
+
+    /// Coordinate version of cropBBX(), min and max are included in the box
+    size_t cropBBX(const point3d& min, const point3d& max, OccupancyOcTreeBase<NODE>* spill = NULL);
+
+    /**
+     * Moves the subtrees of spill intersecting an axis-aligned bounding box back into this
+     * tree, reverting cropBBX(). A subtree is only restored if this tree has no node at its
+     * position, i.e. space that was mapped again after leaving the box keeps the new data.
+     * Restored subtrees are removed from spill.
+     *
+     * @param spill tree holding the subtrees removed by cropBBX()
+     * @param min_key minimum OcTreeKey of the box to restore
+     * @param max_key maximum OcTreeKey of the box to restore
+     * @return number of nodes restored
+     */
+    size_t restoreBBX(OccupancyOcTreeBase<NODE>& spill, const OcTreeKey& min_key, const OcTreeKey& max_key);
+
+    /// Coordinate version of restoreBBX(), min and max are included in the box
+    size_t restoreBBX(OccupancyOcTreeBase<NODE>& spill, const point3d& min, const point3d& max);
+
+    /**
+     * Sliding window: moves the mapped region to the box center +- half_size, removing
+     * everything outside (see cropBBX()). If spill is given, the removed subtrees are kept
+     * there and the region entering the window is restored from it (see restoreBBX()).
+     * Call this whenever the robot moved, e.g. before inserting a new scan.
+     *
+     * @return false if the window is out of the bounds of the tree (nothing is changed)
+     */
+    bool moveWindow(const point3d& center, const point3d& half_size, OccupancyOcTreeBase<NODE>* spill = NULL);
+
+    //-- collision checks
+
+    /**
+     * Checks whether shape intersects an occupied node. The tree is descended
+     * only into subtrees which intersect the shape and contain occupied nodes,
+     * as inner nodes store the maximum occupancy of their children (this requires
+     * them to be up to date, see updateInnerOccupancy()). Returns at the first
+     * occupied leaf found. Free and unknown space are not in collision.
+     *
+     * @param shape geometric primitive in map coordinates
+     * @return true if the shape intersects an occupied node
+     */
+    bool collides(const CollisionShape& shape) const;
+
+    /// @return true if the sphere intersects an occupied node, see collides()
+    bool collidesSphere(const point3d& center, double radius) const {
+      return collides(CollisionShape::sphere(center, radius));
+    }
+
+    /// @return true if the axis-aligned box intersects an occupied node, see collides()
+    bool collidesBox(const point3d& min, const point3d& max) const {
+      return collides(CollisionShape::box(min, max));
+    }
+
+    /// @return true if the oriented box (half_extents along the axes of pose) intersects an occupied node, see collides()
+    bool collidesOrientedBox(const pose6d& pose, const point3d& half_extents) const {
+      return collides(CollisionShape::orientedBox(pose, half_extents));
+    }
+
+    /// @return true if the capsule (segment p1-p2 with radius) intersects an occupied node, see collides()
+    bool collidesCapsule(const point3d& p1, const point3d& p2, double radius) const {
+      return collides(CollisionShape::capsule(p1, p2, radius));
+    }
+
+    /**
+     * Checks a trajectory of a robot for collisions, parallelized with OpenMP.
+     *
+     * @param poses poses of the robot along the trajectory, in map coordinates
+     * @param robot shapes making up the robot, in robot coordinates
+     * @return index of the first pose in collision, -1 if the trajectory is free
+     */
+    int firstCollision(const std::vector<pose6d>& poses, const std::vector<CollisionShape>& robot) const;
+
+    //-- nearest neighbor queries for occupied nodes
+
+    /**
+     * Finds the k occupied leafs nearest to query by a best-first descent of the tree.
+     * The distance of a leaf is the distance from query to its cube (0 if inside),
+     * pruned leafs are reported as a whole. Subtrees are skipped if their cube is
+     * farther away than the k-th result or their (maximum) inner occupancy is free,
+     * this requires inner nodes to be up to date, see updateInnerOccupancy().
+     *
+     * @param query query point
+     * @param k maximum number of leafs to return
+     * @param[out] centers centers of the nearest occupied leafs, sorted by distance
+     * @param[out] sizes side length of each leaf
+     * @param[out] distances distance of each leaf to query
+     * @param max_distance only consider leafs within this distance (default -1: unlimited)
+     * @return number of leafs found
+     */
+    size_t getKNearestOccupied(const point3d& query, unsigned int k,
+                               std::vector<point3d>& centers, std::vector<float>& sizes,
+                               std::vector<float>& distances, double max_distance = -1.0) const;
+
+    /**
+     * Finds the occupied leaf nearest to query, see getKNearestOccupied().
+     *
+     * @param query query point
+     * @param[out] center center of the nearest occupied leaf
+     * @param[out] distance distance from query to the leaf's cube (0 if inside)
+     * @param max_distance only consider leafs within this distance (default -1: unlimited)
+     * @return false if there is no occupied leaf (within max_distance)
+     */
+    bool getNearestOccupied(const point3d& query, point3d& center, float& distance,
+                            double max_distance = -1.0) const;
+
+    /**
+     * Distances of many query points to their nearest occupied leaf (e.g. clearance
+     * costs along a path), parallelized with OpenMP.
+     *
+     * @param queries query points
+     * @param[out] distances distance of each query point to its nearest occupied leaf,
+     *   max_distance (or the largest float) if there is none
+     * @param max_distance only consider leafs within this distance (default -1: unlimited)
+     */
+    void getNearestOccupiedDistances(const std::vector<point3d>& queries, std::vector<float>& distances,
+                                     double max_distance = -1.0) const;
+
+    /**
+     * Finds all occupied leafs whose cube is within radius of query.
+     * Results are appended, the order is arbitrary.
+     *
+     * @param query query point
+     * @param radius search radius
+     * @param[out] centers centers of the occupied leafs
+     * @param[out] sizes side length of each leaf
+     * @return number of leafs found
+     */
+    size_t getOccupiedInRadius(const point3d& query, double radius,
+                               std::vector<point3d>& centers, std::vector<float>& sizes) const;
+
     //-- set BBX limit (limits tree updates to this bounding box)
 
     ///  use or ignore BBX limit (default: ignore)
@@ -403,6 +856,41 @@ namespace octomap {
                        KeySet& occupied_cells,
                        double maxrange);
 
+    /**
+     * Helper for insertPointCloudMultiRes(). Computes all octree nodes affected by
+     * the point cloud integration, each at the depth assigned by the policy.
+     * Cells are returned as center keys at their depth (see adjustKeyAtDepth()),
+     * free_cells[d] and occupied_cells[d] hold the cells at depth d. Free cells
+     * which contain or lie within an occupied cell are dropped, as well as free
+     * cells within a coarser free cell.
+     *
+     * @param scan point cloud measurement to be integrated
+     * @param origin origin of the sensor for ray casting
+     * @param policy assigns the update depth to ranges
+     * @param free_cells keys of nodes to be cleared, per depth (resized to tree_depth+1)
+     * @param occupied_cells keys of nodes to be marked occupied, per depth (resized to tree_depth+1)
+     * @param maxrange maximum range for raycasting (-1: unlimited)
+     * @return false if the policy is not valid for this tree
+     */
+    bool computeMultiResUpdate(const Pointcloud& scan, const octomap::point3d& origin,
+                               const RangeDepthPolicy& policy,
+                               std::vector<KeySet>& free_cells,
+                               std::vector<KeySet>& occupied_cells,
+                               double maxrange);
+
+    /**
+     * Helper for insertDepthImage(). Computes all octree nodes affected by the
+     * depth image integration at once, see insertDepthImage() for the parameters.
+     * Here, occupied nodes have a preference over free ones.
+     *
+     * @param free_cells keys of nodes to be cleared
+     * @param occupied_cells keys of nodes to be marked occupied
+     */
+    void computeDepthImageUpdate(const float* depth, unsigned int width, unsigned int height,
+                                 double fx, double fy, double cx, double cy, const pose6d& sensor_pose,
+                                 double min_depth, double max_depth, unsigned int downsample,
+                                 KeySet& free_cells, KeySet& occupied_cells);
+
 
     // -- I/O  -----------------------------------------
 
@@ -486,6 +974,105 @@ namespace octomap {
     
     void toMaxLikelihoodRecurs(NODE* node, unsigned int depth, unsigned int max_depth);
 
+    /// recursive call of merge(), merges src_node into node at the same depth
+    void mergeRecurs(NODE* node, bool node_just_created, const NODE* src_node,
+                     unsigned int depth, bool lazy_eval);
+
+    /// merge() for offsets: descends to "key" at target_depth and merges src_node there
+    void mergeAtKeyRecurs(NODE* node, bool node_just_created, const OcTreeKey& key,
+                          unsigned int depth, unsigned int target_depth,
+                          const NODE* src_node, bool lazy_eval);
+
+    /// merge() for offsets: enumerates all nodes of src at target_depth (splitting coarser leafs)
+    void mergeOffsetRecurs(const NODE* src_node, unsigned int depth, const OcTreeKey& src_min_key,
+                           unsigned int target_depth, const int key_offset[3], bool lazy_eval);
+
+    /// recursive call of setNodeValueBBX() (set_value) and updateNodeBBX(),
+    /// node_min_key is the lowest key covered by node
+    void updateBBXRecurs(NODE* node, bool node_just_created, unsigned int depth, const OcTreeKey& node_min_key,
+                         const OcTreeKey& min_key, const OcTreeKey& max_key, float value,
+                         bool set_value, bool unknown_only, bool lazy_eval);
+
+    /// recursive call of cropBBX() (outside) and restoreBBX(): moves the children of node outside
+    /// of / intersecting the box into target (if not NULL), @return number of nodes moved
+    size_t moveSubtreesRecurs(NODE* node, unsigned int depth, const OcTreeKey& node_min_key,
+                              const OcTreeKey& min_key, const OcTreeKey& max_key, bool outside,
+                              OccupancyOcTreeBase<NODE>* target);
+
+    /// places a detached subtree (see detachNodeChild()) with num_nodes nodes at depth, key is
+    /// any key covered by it. Existing nodes at its position are replaced (replace) or kept,
+    /// dropping the subtree. Inner nodes are merged by moveSubtreesRecurs() beforehand.
+    /// @return true if the subtree was inserted
+    bool insertSubtree(NODE* subtree, size_t num_nodes, unsigned int depth, const OcTreeKey& key, bool replace);
+
+    /// recursive call of insertSubtree()
+    bool insertSubtreeRecurs(NODE* node, bool node_just_created, unsigned int depth, NODE* subtree,
+                             size_t num_nodes, unsigned int subtree_depth, const OcTreeKey& key, bool replace);
+
+    /// helper for insertPointCloudMultiRes(): updates the node with center key
+    /// at depth as a whole (clipped to the BBX limit, if set)
+    void updateNodeAtDepth(const OcTreeKey& key, unsigned int depth, float log_odds_update, bool lazy_eval);
+
+    /// element of the priority queue in getKNearestOccupied(), top() is the nearest
+    struct NearestEntry {
+      double distance_sq;
+      const NODE* node;
+      unsigned int depth;
+      OcTreeKey node_min_key;
+      bool operator< (const NearestEntry& other) const { return distance_sq > other.distance_sq; }
+    };
+
+    /// @return squared distance from p to the cube of the node at depth (0 if inside)
+    double nodeDistanceSq(const point3d& p, const OcTreeKey& node_min_key, unsigned int depth) const;
+
+    /// recursive call of getOccupiedInRadius(), node_min_key is the lowest key covered by node
+    void getOccupiedInRadiusRecurs(const NODE* node, unsigned int depth, const OcTreeKey& node_min_key,
+                                   const point3d& query, double radius_sq,
+                                   std::vector<point3d>& centers, std::vector<float>& sizes) const;
+
+    /// recursive call of collides(), node_min_key is the lowest key covered by node
+    bool collidesRecurs(const NODE* node, unsigned int depth, const OcTreeKey& node_min_key,
+                        const CollisionShape& shape) const;
+
+    /// recursive call of getLeafsBBX(), node_min_key is the lowest key covered by node
+    void getLeafsBBXRecurs(const NODE* node, unsigned int depth, const OcTreeKey& node_min_key,
+                           const OcTreeKey& min_key, const OcTreeKey& max_key,
+                           unsigned int max_depth, bool occupied_only,
+                           std::vector<point3d>& centers, std::vector<float>& sizes,
+                           std::vector<float>& log_odds) const;
+
+    /// recursive call of getOccupancyGridBBX() and getOccupancyBitsBBX()
+    template <class CELL>
+    void getGridBBXRecurs(const NODE* node, unsigned int depth, const OcTreeKey& node_min_key,
+                          const OcTreeKey& grid_min_key, const OcTreeKey& max_key,
+                          unsigned int grid_depth, const unsigned int grid_size[3],
+                          std::vector<CELL>& grid, CELL occupied_value, CELL free_value) const;
+
+    /// computes the grid dimensions for getOccupancyGridBBX(), @return false for invalid bbx
+    bool computeGridBBX(const OcTreeKey& min_key, const OcTreeKey& max_key, unsigned int depth,
+                        OcTreeKey& grid_min_key, unsigned int grid_size[3]) const;
+
+    /// collects the blocks of getMeshBBX() that may contain surface cubes next to seed leafs
+    void getMeshBlocksRecurs(const NODE* node, unsigned int depth, const OcTreeKey& node_min_key,
+                             const OcTreeKey& min_key, const OcTreeKey& max_key, bool seed_occupied,
+                             std::vector<uint64_t>& blocks) const;
+
+    /// runs marching cubes on one block of getMeshBBX(), appends 3 edge codes per triangle
+    void getMeshBlock(uint64_t block, const OcTreeKey& min_key, const OcTreeKey& max_key,
+                      bool unknownStatus, std::vector<uint64_t>& triangle_edges) const;
+
+    /// converts the z band of getProjectionBBX() to keys, clamped to the tree bounds
+    bool computeProjectionBand(double band_min_z, double band_max_z,
+                               key_type& band_min_key, key_type& band_max_key) const;
+
+    /// recursive call of getProjectionBBX(), the cells in [clip_min_key, clip_max_key]
+    /// are written, cell (0,0) of grid is the column containing grid_min_key
+    void getProjectionBBXRecurs(const NODE* node, unsigned int depth, const OcTreeKey& node_min_key,
+                                const OcTreeKey& grid_min_key, const OcTreeKey& clip_min_key,
+                                const OcTreeKey& clip_max_key, unsigned int grid_depth, unsigned int size_x,
+                                key_type band_min_key, key_type band_max_key,
+                                std::vector<ProjectionCell>& grid) const;
+
 
   protected:
     bool use_bbx_limit;  ///< use bounding box for queries (needs to be set)?
@@ -33,6 +33,12 @@
 
 #include <bitset>
 #include <algorithm>
+#include <limits>
+#include <queue>
+#include <math.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
 
 #include <octomap/MCTables.h>
 
@@ -170,8 +176,13 @@ namespace octomap {
                                                 KeySet& free_cells, KeySet& occupied_cells,
                                                 double maxrange)
   {
-
-
+    // volume covered by the nodes within the bbx keys
+    point3d bbx_key_min, bbx_key_max;
+    if (use_bbx_limit) {
+      const float half_res = float(this->resolution * 0.5);
+      bbx_key_min = this->keyToCoord(bbx_min_key) - point3d(half_res, half_res, half_res);
+      bbx_key_max = this->keyToCoord(bbx_max_key) + point3d(half_res, half_res, half_res);
+    }
 
 #ifdef _OPENMP
     omp_set_num_threads(this->keyrays.size());
@@ -234,18 +245,18 @@ namespace octomap {
             }
           }
 
-          // update freespace, break as soon as bbx limit is reached
-          if (this->computeRayKeys(origin, p, *keyray)){
-            for(KeyRay::reverse_iterator rit=keyray->rbegin(); rit != keyray->rend(); rit++) {
-              if (inBBX(*rit)) {
+          // update freespace, only the part of the ray within the bbx is traced
+          point3d clipped_origin, clipped_end;
+          if (this->clipSegmentToBox(origin, p, bbx_key_min, bbx_key_max, clipped_origin, clipped_end)
+              && this->computeRayKeys(clipped_origin, p, *keyray)){
 #ifdef _OPENMP
-                #pragma omp critical (free_insert)
+            #pragma omp critical (free_insert)
 #endif
-                {
-                  free_cells.insert(*rit);
-                }
+            {
+              for(KeyRay::iterator it=keyray->begin(); it != keyray->end(); ++it) {
+                if (inBBX(*it)) // against rounding at the border
+                  free_cells.insert(*it);
               }
-              else break;
             }
           } // end if compute ray
         } // end if in BBX and not maxrange
@@ -263,19 +274,425 @@ namespace octomap {
     }
   }
 
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::insertPointCloudMultiRes(const Pointcloud& scan, const point3d& sensor_origin,
+                                                           const RangeDepthPolicy& policy, double maxrange,
+                                                           bool lazy_eval) {
+    std::vector<KeySet> free_cells, occupied_cells;
+    if (!computeMultiResUpdate(scan, sensor_origin, policy, free_cells, occupied_cells, maxrange))
+      return;
+
+    // insert data into tree, coarse cells are updated as a whole -----------
+    for (unsigned int depth = 1; depth <= this->tree_depth; ++depth) {
+      for (KeySet::iterator it = free_cells[depth].begin(); it != free_cells[depth].end(); ++it)
+        updateNodeAtDepth(*it, depth, this->prob_miss_log, lazy_eval);
+      for (KeySet::iterator it = occupied_cells[depth].begin(); it != occupied_cells[depth].end(); ++it)
+        updateNodeAtDepth(*it, depth, this->prob_hit_log, lazy_eval);
+    }
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::computeMultiResUpdate(const Pointcloud& scan, const octomap::point3d& origin,
+                                                        const RangeDepthPolicy& policy,
+                                                        std::vector<KeySet>& free_cells,
+                                                        std::vector<KeySet>& occupied_cells,
+                                                        double maxrange)
+  {
+    if (!policy.isValid(this->tree_depth)) {
+      OCTOMAP_ERROR("Error in computeMultiResUpdate: depths of policy are out of range or increase with range\n");
+      return false;
+    }
+
+    free_cells.assign(this->tree_depth+1, KeySet());
+    occupied_cells.assign(this->tree_depth+1, KeySet());
+
+#ifdef _OPENMP
+    omp_set_num_threads(this->keyrays.size());
+    #pragma omp parallel for schedule(guided)
+#endif
+    for (int i = 0; i < (int)scan.size(); ++i) {
+      const point3d& p = scan[i];
+      unsigned threadIdx = 0;
+#ifdef _OPENMP
+      threadIdx = omp_get_thread_num();
+#endif
+      KeyRay* keyray = &(this->keyrays.at(threadIdx));
+
+      if (use_bbx_limit && !inBBX(p))
+        continue;
+
+      point3d direction = p - origin;
+      double length = direction.norm();
+      bool is_maxrange = (maxrange >= 0.0) && (length > maxrange);
+      double ray_length = is_maxrange ? maxrange : length;
+      if (length > 0.0)
+        direction /= (float) length;
+
+      // free cells: trace the part of the beam within each range level at its depth.
+      // The cell containing the end of a part is skipped (as in computeRayKeys()),
+      // it lies within the first (coarser) cell of the next part.
+      point3d segment_start = origin;
+      for (size_t l = 0; l < policy.numLevels(); ++l) {
+        double level_start = (l == 0) ? 0.0 : policy.getLevelRange(l);
+        if (level_start >= ray_length)
+          break;
+        bool last = (l+1 == policy.numLevels()) || (policy.getLevelRange(l+1) >= ray_length);
+        point3d segment_end;
+        if (!last)
+          segment_end = origin + direction * (float) policy.getLevelRange(l+1);
+        else if (is_maxrange)
+          segment_end = origin + direction * (float) maxrange;
+        else
+          segment_end = p;
+
+        unsigned int depth = policy.getLevelDepth(l);
+        if (this->computeRayKeys(segment_start, segment_end, *keyray, depth)){
+#ifdef _OPENMP
+          #pragma omp critical (free_insert)
+#endif
+          {
+            free_cells[depth].insert(keyray->begin(), keyray->end());
+          }
+        }
+        segment_start = segment_end;
+      }
+
+      // occupied endpoint
+      if (!is_maxrange) {
+        unsigned int depth = policy.getDepth(length);
+        OcTreeKey key;
+        if (this->coordToKeyChecked(p, depth, key)){
+#ifdef _OPENMP
+          #pragma omp critical (occupied_insert)
+#endif
+          {
+            occupied_cells[depth].insert(key);
+          }
+        }
+      }
+    } // end for all points, end of parallel OMP loop
+
+    // octree cells are either nested or disjoint, so that all conflicts are found
+    // by looking up the cell's ancestor keys at coarser depths
+
+    // occupied cells within a coarser occupied cell are updated with it
+    for (unsigned int depth = 2; depth <= this->tree_depth; ++depth) {
+      for (KeySet::iterator it = occupied_cells[depth].begin(); it != occupied_cells[depth].end(); ){
+        bool contained = false;
+        for (unsigned int d = 1; d < depth && !contained; ++d)
+          contained = !occupied_cells[d].empty()
+                      && occupied_cells[d].find(this->adjustKeyAtDepth(*it, d)) != occupied_cells[d].end();
+        if (contained)
+          it = occupied_cells[depth].erase(it);
+        else
+          ++it;
+      }
+    }
+
+    // prefer occupied cells over free ones: drop free cells which contain or
+    // lie within an occupied cell (of any size)
+    std::vector<KeySet> occupied_ancestors(this->tree_depth+1);
+    for (unsigned int depth = 1; depth <= this->tree_depth; ++depth) {
+      for (KeySet::iterator it = occupied_cells[depth].begin(); it != occupied_cells[depth].end(); ++it){
+        for (unsigned int d = 1; d <= depth; ++d){
+          if (!free_cells[d].empty())
+            occupied_ancestors[d].insert(this->adjustKeyAtDepth(*it, d));
+        }
+      }
+    }
+    for (unsigned int depth = 1; depth <= this->tree_depth; ++depth) {
+      for (KeySet::iterator it = free_cells[depth].begin(); it != free_cells[depth].end(); ){
+        bool conflict = occupied_ancestors[depth].find(*it) != occupied_ancestors[depth].end();
+        for (unsigned int d = 1; d < depth && !conflict; ++d)
+          conflict = !occupied_cells[d].empty()
+                     && occupied_cells[d].find(this->adjustKeyAtDepth(*it, d)) != occupied_cells[d].end();
+        if (conflict)
+          it = free_cells[depth].erase(it);
+        else
+          ++it;
+      }
+    }
+
+    // free cells within a coarser free cell are updated with it
+    for (unsigned int depth = 2; depth <= this->tree_depth; ++depth) {
+      for (KeySet::iterator it = free_cells[depth].begin(); it != free_cells[depth].end(); ){
+        bool contained = false;
+        for (unsigned int d = 1; d < depth && !contained; ++d)
+          contained = !free_cells[d].empty()
+                      && free_cells[d].find(this->adjustKeyAtDepth(*it, d)) != free_cells[d].end();
+        if (contained)
+          it = free_cells[depth].erase(it);
+        else
+          ++it;
+      }
+    }
+
+    return true;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::insertDepthImage(const float* depth, unsigned int width, unsigned int height,
+                                                   double fx, double fy, double cx, double cy,
+                                                   const pose6d& sensor_pose, double min_depth, double max_depth,
+                                                   unsigned int downsample, bool lazy_eval) {
+    KeySet free_cells, occupied_cells;
+    computeDepthImageUpdate(depth, width, height, fx, fy, cx, cy, sensor_pose, min_depth, max_depth,
+                            downsample, free_cells, occupied_cells);
+
+    // insert data into tree  -----------------------
+    for (KeySet::iterator it = free_cells.begin(); it != free_cells.end(); ++it) {
+      updateNode(*it, false, lazy_eval);
+    }
+    for (KeySet::iterator it = occupied_cells.begin(); it != occupied_cells.end(); ++it) {
+      updateNode(*it, true, lazy_eval);
+    }
+  }
+
+  /// helper for computeDepthImageUpdate(): restricts [t_min, t_max] to alpha + beta*t >= 0,
+  /// returns false if the interval becomes empty
+  inline bool clipLinearConstraint(double alpha, double beta, double& t_min, double& t_max) {
+    if (fabs(beta) < 1e-12)
+      return alpha >= 0.0;
+    double t = -alpha / beta;
+    if (beta > 0.0)
+      t_min = std::max(t_min, t);
+    else
+      t_max = std::min(t_max, t);
+    return t_min <= t_max;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::computeDepthImageUpdate(const float* depth, unsigned int width, unsigned int height,
+                                                          double fx, double fy, double cx, double cy,
+                                                          const pose6d& sensor_pose, double min_depth, double max_depth,
+                                                          unsigned int downsample,
+                                                          KeySet& free_cells, KeySet& occupied_cells)
+  {
+    if (depth == NULL || width == 0 || height == 0 || fx <= 0.0 || fy <= 0.0) {
+      OCTOMAP_ERROR("Error in computeDepthImageUpdate: invalid image size or intrinsics\n");
+      return;
+    }
+    if (downsample == 0)
+      downsample = 1;
+    const bool use_max_depth = (max_depth > 0.0);
+
+    // nearest measurement of each block of downsample x downsample pixels -------
+    const unsigned int block_cols = (width + downsample - 1) / downsample;
+    const unsigned int block_rows = (height + downsample - 1) / downsample;
+    std::vector<float> block_depth(block_cols * block_rows, 0.0f); // 0: no measurement
+    std::vector<unsigned int> block_pixel(block_cols * block_rows, 0);
+    for (unsigned int v = 0; v < height; ++v) {
+      for (unsigned int u = 0; u < width; ++u) {
+        float d = depth[v * width + u];
+        // no measurement: invalid (also NaN), too close, or infinite without max_depth
+        if (!(d > 0.0f) || d < min_depth || (!use_max_depth && d == std::numeric_limits<float>::infinity()))
+          continue;
+        unsigned int b = (v / downsample) * block_cols + u / downsample;
+        if (block_depth[b] == 0.0f || d < block_depth[b]) {
+          block_depth[b] = d;
+          block_pixel[b] = v * width + u;
+        }
+      }
+    }
+
+    // measurements beyond max_depth only clear space up to max_depth
+    double max_block_depth = 0.0;
+    for (size_t b = 0; b < block_depth.size(); ++b) {
+      if (use_max_depth && block_depth[b] > max_depth)
+        block_depth[b] = float(max_depth);
+      max_block_depth = std::max(max_block_depth, double(block_depth[b]));
+    }
+    if (max_block_depth == 0.0)
+      return; // nothing measured
+
+    const point3d& sensor_origin = sensor_pose.trans();
+    std::vector<double> rot; // camera to world, row major
+    sensor_pose.rot().toRotMatrix(rot);
+
+    // Near the camera, a voxel covers at least one block of pixels. There, free space is
+    // carved by projecting each voxel of the frustum into the image (each voxel is visited
+    // once). Farther away, the remaining parts of the beams are traced.
+    const double carve_depth = std::min(max_block_depth, std::min(fx, fy) * this->resolution / downsample);
+
+    // occupied endpoints ----------------------------------------------------
+    for (size_t b = 0; b < block_depth.size(); ++b) {
+      if (block_depth[b] == 0.0f)
+        continue;
+      unsigned int u = block_pixel[b] % width;
+      unsigned int v = block_pixel[b] / width;
+      double d = depth[block_pixel[b]];
+      if (use_max_depth && d > max_depth)
+        continue; // not a measurement of an obstacle
+      point3d p = sensor_pose.transform(point3d(float((u - cx) * d / fx), float((v - cy) * d / fy), float(d)));
+      OcTreeKey key;
+      if (this->coordToKeyChecked(p, key) && (!use_bbx_limit || inBBX(key)))
+        occupied_cells.insert(key);
+    }
+
+    // free space near the camera: project voxels of the frustum -------------
+    OcTreeKey origin_key;
+    if (this->coordToKeyChecked(sensor_origin, origin_key) && (!use_bbx_limit || inBBX(origin_key)))
+      free_cells.insert(origin_key);
+
+    // frustum up to carve_depth, pixel borders at -0.5 and size-0.5
+    const double u_min = -0.5 - cx, u_max = width - 0.5 - cx;
+    const double v_min = -0.5 - cy, v_max = height - 0.5 - cy;
+    double bbx_lo[3], bbx_hi[3];
+    for (unsigned int i = 0; i < 3; ++i)
+      bbx_lo[i] = bbx_hi[i] = sensor_origin(i);
+    for (unsigned int c = 0; c < 4; ++c) {
+      point3d corner = sensor_pose.transform(point3d(float(((c & 1) ? u_max : u_min) * carve_depth / fx),
+                                                     float(((c & 2) ? v_max : v_min) * carve_depth / fy),
+                                                     float(carve_depth)));
+      for (unsigned int i = 0; i < 3; ++i) {
+        bbx_lo[i] = std::min(bbx_lo[i], double(corner(i)));
+        bbx_hi[i] = std::max(bbx_hi[i], double(corner(i)));
+      }
+    }
+    // key range of the frustum's bounding box, clipped to the map (and BBX limit)
+    int key_lo[3], key_hi[3];
+    for (unsigned int i = 0; i < 3; ++i) {
+      key_lo[i] = std::max(0, int(floor(this->resolution_factor * bbx_lo[i])) + int(this->tree_max_val));
+      key_hi[i] = std::min(int(2 * this->tree_max_val) - 1,
+                           int(floor(this->resolution_factor * bbx_hi[i])) + int(this->tree_max_val));
+      if (use_bbx_limit) {
+        key_lo[i] = std::max(key_lo[i], int(bbx_min_key[i]));
+        key_hi[i] = std::min(key_hi[i], int(bbx_max_key[i]));
+      }
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int kx = key_lo[0]; kx <= key_hi[0]; ++kx) {
+      std::vector<OcTreeKey> slice_cells;
+      const double x = this->keyToCoord(key_type(kx)) - sensor_origin.x();
+      for (int ky = key_lo[1]; ky <= key_hi[1]; ++ky) {
+        const double y = this->keyToCoord(key_type(ky)) - sensor_origin.y();
+        // camera coordinates along the column: cam = a + z * b (world z)
+        double a[3], b[3];
+        for (unsigned int j = 0; j < 3; ++j) {
+          a[j] = rot[j] * x + rot[3+j] * y - rot[6+j] * sensor_origin.z();
+          b[j] = rot[6+j];
+        }
+        // clip the column to the frustum (all constraints are linear in z)
+        double z_min = this->keyToCoord(key_type(key_lo[2]));
+        double z_max = this->keyToCoord(key_type(key_hi[2]));
+        if (!clipLinearConstraint(a[2], b[2], z_min, z_max)
+            || !clipLinearConstraint(carve_depth - a[2], -b[2], z_min, z_max)
+            || !clipLinearConstraint(fx * a[0] - u_min * a[2], fx * b[0] - u_min * b[2], z_min, z_max)
+            || !clipLinearConstraint(u_max * a[2] - fx * a[0], u_max * b[2] - fx * b[0], z_min, z_max)
+            || !clipLinearConstraint(fy * a[1] - v_min * a[2], fy * b[1] - v_min * b[2], z_min, z_max)
+            || !clipLinearConstraint(v_max * a[2] - fy * a[1], v_max * b[2] - fy * b[1], z_min, z_max))
+          continue;
+
+        int kz_lo = std::max(key_lo[2], int(floor(this->resolution_factor * z_min)) + int(this->tree_max_val));
+        int kz_hi = std::min(key_hi[2], int(floor(this->resolution_factor * z_max)) + int(this->tree_max_val));
+        for (int kz = kz_lo; kz <= kz_hi; ++kz) {
+          const double z = this->keyToCoord(key_type(kz));
+          const double cam_z = a[2] + z * b[2];
+          if (cam_z <= 0.0 || cam_z >= carve_depth)
+            continue;
+          int u = int(floor(fx * (a[0] + z * b[0]) / cam_z + cx + 0.5));
+          int v = int(floor(fy * (a[1] + z * b[1]) / cam_z + cy + 0.5));
+          if (u < 0 || v < 0 || u >= int(width) || v >= int(height))
+            continue;
+          // voxel center in front of the measurement?
+          if (cam_z < block_depth[(v / downsample) * block_cols + u / downsample])
+            slice_cells.push_back(OcTreeKey(key_type(kx), key_type(ky), key_type(kz)));
+        }
+      }
+#ifdef _OPENMP
+      #pragma omp critical (free_insert)
+#endif
+      {
+        free_cells.insert(slice_cells.begin(), slice_cells.end());
+      }
+    }
+
+    // free space beyond carve_depth: trace the rest of the beams ------------
+#ifdef _OPENMP
+    omp_set_num_threads(this->keyrays.size());
+    #pragma omp parallel for schedule(guided)
+#endif
+    for (int b = 0; b < (int) block_depth.size(); ++b) {
+      if (block_depth[b] <= carve_depth)
+        continue;
+      unsigned threadIdx = 0;
+#ifdef _OPENMP
+      threadIdx = omp_get_thread_num();
+#endif
+      KeyRay* keyray = &(this->keyrays.at(threadIdx));
+
+      unsigned int u = block_pixel[b] % width;
+      unsigned int v = block_pixel[b] / width;
+      point3d dir(float((u - cx) / fx), float((v - cy) / fy), 1.0f);
+      point3d start = sensor_pose.transform(dir * float(carve_depth));
+      point3d end = sensor_pose.transform(dir * block_depth[b]);
+      if (this->computeRayKeys(start, end, *keyray)){
+#ifdef _OPENMP
+        #pragma omp critical (free_insert)
+#endif
+        {
+          for (KeyRay::iterator it = keyray->begin(); it != keyray->end(); ++it) {
+            if (!use_bbx_limit || inBBX(*it))
+              free_cells.insert(*it);
+          }
+        }
+      }
+    }
+
+    // prefer occupied cells over free ones (and make sets disjunct)
+    for(KeySet::iterator it = free_cells.begin(), end=free_cells.end(); it!= end; ){
+      if (occupied_cells.find(*it) != occupied_cells.end()){
+        it = free_cells.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::updateNodeAtDepth(const OcTreeKey& key, unsigned int depth,
+                                                    float log_odds_update, bool lazy_eval) {
+    if (depth == this->tree_depth) {
+      if (!use_bbx_limit || inBBX(key))
+        updateNode(key, log_odds_update, lazy_eval);
+      return;
+    }
+
+    // key range covered by the node, clipped to the BBX limit
+    const unsigned int diff = this->tree_depth - depth;
+    OcTreeKey min_key, max_key;
+    for (unsigned int i=0; i<3; ++i) {
+      unsigned int node_min = key[i] - (1 << (diff-1));
+      unsigned int node_max = node_min + (1 << diff) - 1;
+      if (use_bbx_limit) {
+        node_min = std::max(node_min, (unsigned int) bbx_min_key[i]);
+        node_max = std::min(node_max, (unsigned int) bbx_max_key[i]);
+        if (node_min > node_max)
+          return;
+      }
+      min_key[i] = key_type(node_min);
+      max_key[i] = key_type(node_max);
+    }
+    updateNodeBBX(min_key, max_key, log_odds_update, false, lazy_eval);
+  }
+
   template <class NODE>
   NODE* OccupancyOcTreeBase<NODE>::setNodeValue(const OcTreeKey& key, float log_odds_value, bool lazy_eval) {
     // clamp log odds within range:
     log_odds_value = std::min(std::max(log_odds_value, this->clamping_thres_min), this->clamping_thres_max);
 
-    bool createdRoot = false;
     if (this->root == NULL){
-      this->root = new NODE();
-      this->tree_size++;
-      createdRoot = true;
+      // new root is attached when completely initialized (for concurrent readers)
+      NODE* new_root = new NODE();
+      NODE* retval = setNodeValueRecurs(new_root, true, key, 0, log_odds_value, lazy_eval);
+      this->attachRoot(new_root);
+      return retval;
     }
 
-    return setNodeValueRecurs(this->root, createdRoot, key, 0, log_odds_value, lazy_eval);
+    return setNodeValueRecurs(this->root, false, key, 0, log_odds_value, lazy_eval);
   }
 
   template <class NODE>
@@ -310,14 +727,15 @@ namespace octomap {
       return leaf;
     }
 
-    bool createdRoot = false;
     if (this->root == NULL){
-      this->root = new NODE();
-      this->tree_size++;
-      createdRoot = true;
+      // new root is attached when completely initialized (for concurrent readers)
+      NODE* new_root = new NODE();
+      NODE* retval = updateNodeRecurs(new_root, true, key, 0, log_odds_update, lazy_eval);
+      this->attachRoot(new_root);
+      return retval;
     }
 
-    return updateNodeRecurs(this->root, createdRoot, key, 0, log_odds_update, lazy_eval);
+    return updateNodeRecurs(this->root, false, key, 0, log_odds_update, lazy_eval);
   }
 
   template <class NODE>
@@ -363,6 +781,152 @@ namespace octomap {
     return updateNode(key, occupied, lazy_eval);
   }
 
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::setNodeValueBBX(const OcTreeKey& min_key, const OcTreeKey& max_key, float log_odds_value,
+                                                  bool unknown_only, bool lazy_eval) {
+    for (unsigned int i=0; i<3; ++i) {
+      if (min_key[i] > max_key[i]) {
+        OCTOMAP_ERROR("Error in setNodeValueBBX: min key is larger than max key\n");
+        return;
+      }
+    }
+
+    // clamp log odds within range:
+    log_odds_value = std::min(std::max(log_odds_value, this->clamping_thres_min), this->clamping_thres_max);
+
+    if (this->root == NULL){
+      // new root is attached when completely initialized (for concurrent readers)
+      NODE* new_root = new NODE();
+      updateBBXRecurs(new_root, true, 0, OcTreeKey(0, 0, 0), min_key, max_key, log_odds_value, true, unknown_only, lazy_eval);
+      this->attachRoot(new_root);
+      return;
+    }
+
+    updateBBXRecurs(this->root, false, 0, OcTreeKey(0, 0, 0), min_key, max_key, log_odds_value, true, unknown_only, lazy_eval);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::setNodeValueBBX(const point3d& min, const point3d& max, float log_odds_value,
+                                                  bool unknown_only, bool lazy_eval) {
+    OcTreeKey min_key, max_key;
+    if (!this->coordToKeyChecked(min, min_key) || !this->coordToKeyChecked(max, max_key)) {
+      OCTOMAP_ERROR_STR("Error in setNodeValueBBX: [" << min << "] - [" << max << "] is out of OcTree bounds!");
+      return;
+    }
+
+    setNodeValueBBX(min_key, max_key, log_odds_value, unknown_only, lazy_eval);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::updateNodeBBX(const OcTreeKey& min_key, const OcTreeKey& max_key, float log_odds_update,
+                                                bool unknown_only, bool lazy_eval) {
+    for (unsigned int i=0; i<3; ++i) {
+      if (min_key[i] > max_key[i]) {
+        OCTOMAP_ERROR("Error in updateNodeBBX: min key is larger than max key\n");
+        return;
+      }
+    }
+
+    if (this->root == NULL){
+      NODE* new_root = new NODE();
+      updateBBXRecurs(new_root, true, 0, OcTreeKey(0, 0, 0), min_key, max_key, log_odds_update, false, unknown_only, lazy_eval);
+      this->attachRoot(new_root);
+      return;
+    }
+
+    updateBBXRecurs(this->root, false, 0, OcTreeKey(0, 0, 0), min_key, max_key, log_odds_update, false, unknown_only, lazy_eval);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::updateNodeBBX(const point3d& min, const point3d& max, float log_odds_update,
+                                                bool unknown_only, bool lazy_eval) {
+    OcTreeKey min_key, max_key;
+    if (!this->coordToKeyChecked(min, min_key) || !this->coordToKeyChecked(max, max_key)) {
+      OCTOMAP_ERROR_STR("Error in updateNodeBBX: [" << min << "] - [" << max << "] is out of OcTree bounds!");
+      return;
+    }
+
+    updateNodeBBX(min_key, max_key, log_odds_update, unknown_only, lazy_eval);
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::updateBBXRecurs(NODE* node, bool node_just_created, unsigned int depth,
+                                                  const OcTreeKey& node_min_key, const OcTreeKey& min_key,
+                                                  const OcTreeKey& max_key, float value, bool set_value,
+                                                  bool unknown_only, bool lazy_eval) {
+    assert(node);
+
+    const unsigned int node_size = 1 << (this->tree_depth - depth);
+    bool covered = true;
+    for (unsigned int j=0; j<3 && covered; ++j)
+      covered = (node_min_key[j] >= min_key[j]) && (node_min_key[j] + node_size - 1 <= max_key[j]);
+
+    if (!node_just_created && !this->nodeHasChildren(node)) {
+      // existing leaf (possibly pruned) is known space
+      if (unknown_only)
+        return;
+      if (!covered)
+        this->expandNode(node);
+    }
+
+    // write the whole node: new and existing leafs, or all children replaced by a new value
+    if (covered && (node_just_created || !this->nodeHasChildren(node) || (set_value && !unknown_only))) {
+      bool occ_before = this->isNodeOccupied(node);
+      if (this->nodeHasChildren(node))
+        this->deleteNodeChildren(node);
+
+      if (set_value)
+        node->setLogOdds(value);
+      else
+        updateNodeLogOdds(node, value);
+
+      if (use_change_detection) {
+        OcTreeKey key = this->adjustKeyAtDepth(node_min_key, depth);
+        if (node_just_created){
+          changed_keys.insert(std::pair<OcTreeKey,bool>(key, true));
+        } else if (occ_before != this->isNodeOccupied(node)) {
+          KeyBoolMap::iterator it = changed_keys.find(key);
+          if (it == changed_keys.end())
+            changed_keys.insert(std::pair<OcTreeKey,bool>(key, false));
+          else if (it->second == false)
+            changed_keys.erase(it);
+        }
+      }
+      return;
+    }
+
+    // refine along the boundary of the box (or below known inner nodes)
+    const unsigned int child_size = node_size >> 1;
+    OcTreeKey child_min_key;
+    for (unsigned int i=0; i<8; ++i) {
+      bool overlaps = true;
+      for (unsigned int j=0; j<3 && overlaps; ++j) {
+        unsigned int child_min = node_min_key[j] + ((i & (1 << j)) ? child_size : 0);
+        child_min_key[j] = key_type(child_min);
+        overlaps = (child_min <= max_key[j]) && (child_min + child_size - 1 >= min_key[j]);
+      }
+      if (!overlaps)
+        continue;
+
+      if (this->nodeChildExists(node, i)) {
+        updateBBXRecurs(this->unshareNodeChild(node, i), false, depth+1, child_min_key, min_key, max_key,
+                        value, set_value, unknown_only, lazy_eval);
+      } else {
+        // attached when completely initialized (for concurrent readers)
+        NODE* child = new NODE();
+        updateBBXRecurs(child, true, depth+1, child_min_key, min_key, max_key,
+                        value, set_value, unknown_only, lazy_eval);
+        this->attachNodeChild(node, i, child);
+      }
+    }
+
+    if (!lazy_eval) {
+      // prune node if possible, otherwise set own probability
+      if (!this->pruneNode(node))
+        node->updateOccupancyChildren();
+    }
+  }
+
   template <class NODE>
   NODE* OccupancyOcTreeBase<NODE>::updateNodeRecurs(NODE* node, bool node_just_created, const OcTreeKey& key,
                                                     unsigned int depth, const float& log_odds_update, bool lazy_eval) {
@@ -373,24 +937,32 @@ namespace octomap {
     // follow down to last level
     if (depth < this->tree_depth) {
       unsigned int pos = computeChildIdx(key, this->tree_depth -1 - depth);
+      NODE* child;
       if (!this->nodeChildExists(node, pos)) {
         // child does not exist, but maybe it's a pruned node?
         if (!this->nodeHasChildren(node) && !node_just_created ) {
           // current node does not have children AND it is not a new node
           // -> expand pruned node
           this->expandNode(node);
+          child = this->getNodeChild(node, pos);
         }
         else {
-          // not a pruned node, create requested child
-          this->createNodeChild(node, pos);
+          // not a pruned node, create requested child. It is attached to
+          // the tree when completely initialized (for concurrent readers)
+          child = new NODE();
           created_node = true;
         }
+      } else {
+        child = this->unshareNodeChild(node, pos);
       }
 
+      NODE* retval = updateNodeRecurs(child, created_node, key, depth+1, log_odds_update, lazy_eval);
+      if (created_node)
+        this->attachNodeChild(node, pos, child);
+
       if (lazy_eval)
-        return updateNodeRecurs(this->getNodeChild(node, pos), created_node, key, depth+1, log_odds_update, lazy_eval);
+        return retval;
       else {
-        NODE* retval = updateNodeRecurs(this->getNodeChild(node, pos), created_node, key, depth+1, log_odds_update, lazy_eval);
         // prune node if possible, otherwise set own probability
         // note: combining both did not lead to a speedup!
         if (this->pruneNode(node)){
@@ -437,24 +1009,32 @@ namespace octomap {
     // follow down to last level
     if (depth < this->tree_depth) {
       unsigned int pos = computeChildIdx(key, this->tree_depth -1 - depth);
+      NODE* child;
       if (!this->nodeChildExists(node, pos)) {
         // child does not exist, but maybe it's a pruned node?
         if (!this->nodeHasChildren(node) && !node_just_created ) {
           // current node does not have children AND it is not a new node
           // -> expand pruned node
           this->expandNode(node);
+          child = this->getNodeChild(node, pos);
         }
         else {
-          // not a pruned node, create requested child
-          this->createNodeChild(node, pos);
+          // not a pruned node, create requested child. It is attached to
+          // the tree when completely initialized (for concurrent readers)
+          child = new NODE();
           created_node = true;
         }
+      } else {
+        child = this->unshareNodeChild(node, pos);
       }
 
+      NODE* retval = setNodeValueRecurs(child, created_node, key, depth+1, log_odds_value, lazy_eval);
+      if (created_node)
+        this->attachNodeChild(node, pos, child);
+
       if (lazy_eval)
-        return setNodeValueRecurs(this->getNodeChild(node, pos), created_node, key, depth+1, log_odds_value, lazy_eval);
+        return retval;
       else {
-        NODE* retval = setNodeValueRecurs(this->getNodeChild(node, pos), created_node, key, depth+1, log_odds_value, lazy_eval);
         // prune node if possible, otherwise set own probability
         // note: combining both did not lead to a speedup!
         if (this->pruneNode(node)){
@@ -492,8 +1072,9 @@ namespace octomap {
 
   template <class NODE>
   void OccupancyOcTreeBase<NODE>::updateInnerOccupancy(){
-    if (this->root)
+    if (this->root){
       this->updateInnerOccupancyRecurs(this->root, 0);
+    }
   }
 
   template <class NODE>
@@ -506,7 +1087,7 @@ namespace octomap {
       if (depth < this->tree_depth){
         for (unsigned int i=0; i<8; i++) {
           if (this->nodeChildExists(node, i)) {
-            updateInnerOccupancyRecurs(this->getNodeChild(node, i), depth+1);
+            updateInnerOccupancyRecurs(this->unshareNodeChild(node, i), depth+1);
           }
         }
       }
@@ -537,7 +1118,7 @@ namespace octomap {
     if (depth < max_depth) {
       for (unsigned int i=0; i<8; i++) {
         if (this->nodeChildExists(node, i)) {
-          toMaxLikelihoodRecurs(this->getNodeChild(node, i), depth+1, max_depth);
+          toMaxLikelihoodRecurs(this->unshareNodeChild(node, i), depth+1, max_depth);
         }
       }
     }
@@ -548,39 +1129,305 @@ namespace octomap {
   }
 
   template <class NODE>
-  bool OccupancyOcTreeBase<NODE>::getNormals(const point3d& point, std::vector<point3d>& normals,
-                                             bool unknownStatus) const {
-    normals.clear();
-
-    OcTreeKey init_key;
-    if ( !OcTreeBaseImpl<NODE,AbstractOccupancyOcTree>::coordToKeyChecked(point, init_key) ) {
-      OCTOMAP_WARNING_STR("Voxel out of bounds");
+  bool OccupancyOcTreeBase<NODE>::merge(const OccupancyOcTreeBase<NODE>& other, bool lazy_eval) {
+    if (&other == this) {
+      OCTOMAP_ERROR("Error in merge: cannot merge a tree into itself\n");
+      return false;
+    }
+    if (this->tree_depth != other.tree_depth || fabs(this->resolution - other.resolution) > 1e-9) {
+      OCTOMAP_ERROR("Error in merge: trees need to have the same resolution (%f vs. %f)\n",
+                    this->resolution, other.resolution);
       return false;
     }
 
-    // OCTOMAP_WARNING("Normal for %f, %f, %f\n", point.x(), point.y(), point.z());
+    if (other.root == NULL)
+      return true;
 
-    int vertex_values[8];
+    bool createdRoot = false;
+    if (this->root == NULL){
+      this->root = new NODE();
+      this->tree_size++;
+      createdRoot = true;
+    }
 
-    OcTreeKey current_key;
-    NODE* current_node;
+#ifdef _OPENMP
+    if (this->nodeHasChildren(other.root) && !this->concurrent_reads) {
+      // create the first level sequentially, then merge the subtrees below in parallel.
+      // Each subtree is merged by a separate (empty) worker tree of the same type,
+      // so that the bookkeeping of the tree size does not race.
+      if (createdRoot)
+        this->root->copyData(*(other.root));
+      else if (!this->nodeHasChildren(this->root))
+        this->expandNode(this->root);
+
+      bool created[8];
+      std::vector<OccupancyOcTreeBase<NODE>*> workers(8, (OccupancyOcTreeBase<NODE>*) NULL);
+      for (unsigned int i=0; i<8; ++i) {
+        created[i] = false;
+        if (!this->nodeChildExists(other.root, i))
+          continue;
+
+        if (!this->nodeChildExists(this->root, i)) {
+          this->createNodeChild(this->root, i);
+          created[i] = true;
+        } else {
+          this->unshareNodeChild(this->root, i);
+        }
+        workers[i] = dynamic_cast<OccupancyOcTreeBase<NODE>*>(this->create());
+        assert(workers[i]);
+        workers[i]->clearKeyRays();
+        workers[i]->clamping_thres_min = this->clamping_thres_min;
+        workers[i]->clamping_thres_max = this->clamping_thres_max;
+        workers[i]->prob_hit_log = this->prob_hit_log;
+        workers[i]->prob_miss_log = this->prob_miss_log;
+        workers[i]->occ_prob_thres_log = this->occ_prob_thres_log;
+      }
 
-    // There is 8 neighbouring sets
-    // The current cube can be at any of the 8 vertex
-    int x_index[4][4] = {{1, 1, 0, 0}, {1, 1, 0, 0}, {0, 0 -1, -1}, {0, 0 -1, -1}};
-    int y_index[4][4] = {{1, 0, 0, 1}, {0, -1, -1, 0}, {0, -1, -1, 0}, {1, 0, 0, 1}};
-    int z_index[2][2] = {{0, 1}, {-1, 0}};
+      #pragma omp parallel for schedule(dynamic)
+      for (int i=0; i<8; ++i) {
+        if (workers[i])
+          workers[i]->mergeRecurs(this->getNodeChild(this->root, i), created[i],
+                                  this->getNodeChild(other.root, i), 1, lazy_eval);
+      }
 
-    // Iterate over the 8 neighboring sets
-    for(int m = 0; m < 2; ++m){
-      for(int l = 0; l < 4; ++l){
+      for (unsigned int i=0; i<8; ++i) {
+        if (workers[i]) {
+          // worker tree sizes started at 0 and may have wrapped around when
+          // nodes were pruned, unsigned addition still yields the right total
+          this->tree_size += workers[i]->tree_size;
+          delete workers[i]; // does not delete any nodes, its root is NULL
+        }
+      }
 
-        int k = 0;
-        // Iterate over the cubes
-        for(int j = 0; j < 2; ++j){
-          for(int i = 0; i < 4; ++i){
-            current_key[0] = init_key[0] + x_index[l][i];
-            current_key[1] = init_key[1] + y_index[l][i];
+      if (!lazy_eval) {
+        if (!this->pruneNode(this->root))
+          this->root->updateOccupancyChildren();
+      }
+    } else
+#endif
+    mergeRecurs(this->root, createdRoot, other.root, 0, lazy_eval);
+
+    this->size_changed = true;
+    return true;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::merge(const OccupancyOcTreeBase<NODE>& other, const pose6d& offset, bool lazy_eval) {
+    if (fabs(fabs(offset.rot().u()) - 1.0) > 1e-6) {
+      OCTOMAP_ERROR("Error in merge: the offset must not contain a rotation\n");
+      return false;
+    }
+
+    int key_offset[3];
+    for (unsigned int i=0; i<3; ++i) {
+      double steps = offset.trans()(i) * this->resolution_factor;
+      key_offset[i] = (int) floor(steps + 0.5);
+      if (fabs(steps - key_offset[i]) > 1e-3) {
+        OCTOMAP_ERROR("Error in merge: the offset needs to be a multiple of the resolution\n");
+        return false;
+      }
+    }
+
+    if (key_offset[0] == 0 && key_offset[1] == 0 && key_offset[2] == 0)
+      return merge(other, lazy_eval);
+
+    if (&other == this) {
+      OCTOMAP_ERROR("Error in merge: cannot merge a tree into itself\n");
+      return false;
+    }
+    if (this->tree_depth != other.tree_depth || fabs(this->resolution - other.resolution) > 1e-9) {
+      OCTOMAP_ERROR("Error in merge: trees need to have the same resolution (%f vs. %f)\n",
+                    this->resolution, other.resolution);
+      return false;
+    }
+
+    if (other.root == NULL)
+      return true;
+
+    // coarsest depth at which moved nodes of "other" coincide with nodes of this tree
+    unsigned int target_depth = 0;
+    for (; target_depth < this->tree_depth; ++target_depth) {
+      int node_size = 1 << (this->tree_depth - target_depth);
+      if (key_offset[0] % node_size == 0 && key_offset[1] % node_size == 0 && key_offset[2] % node_size == 0)
+        break;
+    }
+
+    mergeOffsetRecurs(other.root, 0, OcTreeKey(0, 0, 0), target_depth, key_offset, lazy_eval);
+
+    this->size_changed = true;
+    return true;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::snapshot(OccupancyOcTreeBase<NODE>& target) const {
+    OcTreeBaseImpl<NODE,AbstractOccupancyOcTree>::snapshot(target);
+
+    target.clamping_thres_min = this->clamping_thres_min;
+    target.clamping_thres_max = this->clamping_thres_max;
+    target.prob_hit_log = this->prob_hit_log;
+    target.prob_miss_log = this->prob_miss_log;
+    target.occ_prob_thres_log = this->occ_prob_thres_log;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::mergeRecurs(NODE* node, bool node_just_created, const NODE* src_node,
+                                              unsigned int depth, bool lazy_eval) {
+    assert(node && src_node);
+
+    if (node_just_created) // unknown in this tree: take over the payload
+      node->copyData(*src_node);
+
+    if (!this->nodeHasChildren(src_node)) {
+      // leaf in src, possibly pruned
+      if (node_just_created) {
+        node->setLogOdds(std::min(std::max(src_node->getLogOdds(), this->clamping_thres_min), this->clamping_thres_max));
+      } else if (!this->nodeHasChildren(node)) {
+        updateNodeLogOdds(node, src_node->getLogOdds());
+      } else {
+        // the pruned src node covers all children, there is no need to expand it
+        for (unsigned int i=0; i<8; ++i) {
+          if (this->nodeChildExists(node, i))
+            mergeRecurs(this->unshareNodeChild(node, i), false, src_node, depth+1, lazy_eval);
+          else
+            mergeRecurs(this->createNodeChild(node, i), true, src_node, depth+1, lazy_eval);
+        }
+        if (!lazy_eval) {
+          if (!this->pruneNode(node))
+            node->updateOccupancyChildren();
+        }
+      }
+      return;
+    }
+
+    // src has finer structure here:
+    if (!node_just_created && !this->nodeHasChildren(node)) {
+      assert(depth < this->tree_depth);
+      this->expandNode(node);
+    }
+
+    for (unsigned int i=0; i<8; ++i) {
+      if (!this->nodeChildExists(src_node, i))
+        continue;
+
+      if (this->nodeChildExists(node, i))
+        mergeRecurs(this->unshareNodeChild(node, i), false, this->getNodeChild(src_node, i), depth+1, lazy_eval);
+      else
+        mergeRecurs(this->createNodeChild(node, i), true, this->getNodeChild(src_node, i), depth+1, lazy_eval);
+    }
+
+    if (!lazy_eval) {
+      if (!this->pruneNode(node))
+        node->updateOccupancyChildren();
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::mergeAtKeyRecurs(NODE* node, bool node_just_created, const OcTreeKey& key,
+                                                   unsigned int depth, unsigned int target_depth,
+                                                   const NODE* src_node, bool lazy_eval) {
+    assert(node);
+
+    if (depth == target_depth) {
+      mergeRecurs(node, node_just_created, src_node, depth, lazy_eval);
+      return;
+    }
+
+    bool created_node = false;
+    unsigned int pos = computeChildIdx(key, this->tree_depth - 1 - depth);
+    if (!this->nodeChildExists(node, pos)) {
+      if (!this->nodeHasChildren(node) && !node_just_created) {
+        // pruned node: expand first
+        this->expandNode(node);
+      } else {
+        this->createNodeChild(node, pos);
+        created_node = true;
+      }
+    }
+
+    mergeAtKeyRecurs(this->unshareNodeChild(node, pos), created_node, key, depth+1, target_depth, src_node, lazy_eval);
+
+    if (!lazy_eval) {
+      if (!this->pruneNode(node))
+        node->updateOccupancyChildren();
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::mergeOffsetRecurs(const NODE* src_node, unsigned int depth, const OcTreeKey& src_min_key,
+                                                    unsigned int target_depth, const int key_offset[3], bool lazy_eval) {
+    assert(src_node);
+
+    if (depth == target_depth) {
+      // the moved node coincides with a node of this tree
+      const int node_size = 1 << (this->tree_depth - depth);
+      OcTreeKey key;
+      for (unsigned int i=0; i<3; ++i) {
+        int k = int(src_min_key[i]) + key_offset[i];
+        if (k < 0 || k + node_size > int(2*this->tree_max_val))
+          return; // moved out of the tree bounds
+        key[i] = key_type(k);
+      }
+
+      bool createdRoot = false;
+      if (this->root == NULL){
+        this->root = new NODE();
+        this->tree_size++;
+        createdRoot = true;
+      }
+      mergeAtKeyRecurs(this->root, createdRoot, key, 0, target_depth, src_node, lazy_eval);
+      return;
+    }
+
+    // leafs above the target depth are split into (virtual) children of the same value
+    const bool is_leaf = !this->nodeHasChildren(src_node);
+    const unsigned int child_size = 1 << (this->tree_depth - depth - 1);
+    OcTreeKey child_min_key;
+    for (unsigned int i=0; i<8; ++i) {
+      if (!is_leaf && !this->nodeChildExists(src_node, i))
+        continue;
+
+      for (unsigned int j=0; j<3; ++j)
+        child_min_key[j] = key_type(src_min_key[j] + ((i & (1 << j)) ? child_size : 0));
+
+      const NODE* child = is_leaf ? src_node : this->getNodeChild(src_node, i);
+      mergeOffsetRecurs(child, depth+1, child_min_key, target_depth, key_offset, lazy_eval);
+    }
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::getNormals(const point3d& point, std::vector<point3d>& normals,
+                                             bool unknownStatus) const {
+    normals.clear();
+
+    OcTreeKey init_key;
+    if ( !OcTreeBaseImpl<NODE,AbstractOccupancyOcTree>::coordToKeyChecked(point, init_key) ) {
+      OCTOMAP_WARNING_STR("Voxel out of bounds");
+      return false;
+    }
+
+    // OCTOMAP_WARNING("Normal for %f, %f, %f\n", point.x(), point.y(), point.z());
+
+    int vertex_values[8];
+
+    OcTreeKey current_key;
+    NODE* current_node;
+
+    // There is 8 neighbouring sets
+    // The current cube can be at any of the 8 vertex
+    int x_index[4][4] = {{1, 1, 0, 0}, {1, 1, 0, 0}, {0, 0 -1, -1}, {0, 0 -1, -1}};
+    int y_index[4][4] = {{1, 0, 0, 1}, {0, -1, -1, 0}, {0, -1, -1, 0}, {1, 0, 0, 1}};
+    int z_index[2][2] = {{0, 1}, {-1, 0}};
+
+    // Iterate over the 8 neighboring sets
+    for(int m = 0; m < 2; ++m){
+      for(int l = 0; l < 4; ++l){
+
+        int k = 0;
+        // Iterate over the cubes
+        for(int j = 0; j < 2; ++j){
+          for(int i = 0; i < 4; ++i){
+            current_key[0] = init_key[0] + x_index[l][i];
+            current_key[1] = init_key[1] + y_index[l][i];
             current_key[2] = init_key[2] + z_index[m][j];
             current_node = this->search(current_key);
 
@@ -635,6 +1482,1144 @@ namespace octomap {
     return true;
   }
 
+  // block size of getMeshBBX() is 2^MESH_BLOCK_BITS voxels in each direction
+  static const unsigned int MESH_BLOCK_BITS = 5;
+
+  // cube corners (offsets from the lowest corner) and edges (lowest corner, axis),
+  // numbered as the vertices and edges of vertexList in MCTables.h
+  static const unsigned int meshCubeCorners[8][3] = {
+    {1, 1, 0}, {1, 0, 0}, {0, 0, 0}, {0, 1, 0}, {1, 1, 1}, {1, 0, 1}, {0, 0, 1}, {0, 1, 1}};
+  static const unsigned int meshCubeEdges[12][4] = {
+    {1, 0, 0, 1}, {0, 0, 0, 0}, {0, 0, 0, 1}, {0, 1, 0, 0},
+    {1, 0, 1, 1}, {0, 0, 1, 0}, {0, 0, 1, 1}, {0, 1, 1, 0},
+    {1, 1, 0, 2}, {1, 0, 0, 2}, {0, 0, 0, 2}, {0, 1, 0, 2}};
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::getMeshBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                               std::vector<point3d>& vertices, std::vector<point3d>& normals,
+                                               std::vector<unsigned int>& triangles, bool unknownStatus) const {
+    vertices.clear();
+    normals.clear();
+    triangles.clear();
+    for (unsigned int i=0; i<3; ++i) {
+      if (min_key[i] > max_key[i]) {
+        OCTOMAP_ERROR("Error in getMeshBBX: min key is larger than max key\n");
+        return 0;
+      }
+    }
+    if (this->root == NULL)
+      return 0;
+
+    // only cubes next to a leaf differing from unknown space can contain the surface
+    std::vector<uint64_t> blocks;
+    getMeshBlocksRecurs(this->root, 0, OcTreeKey(0, 0, 0), min_key, max_key, !unknownStatus, blocks);
+    std::sort(blocks.begin(), blocks.end());
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+    // triangles as edge codes, per block
+    std::vector<std::vector<uint64_t> > block_triangles(blocks.size());
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < (int) blocks.size(); ++i)
+      getMeshBlock(blocks[i], min_key, max_key, unknownStatus, block_triangles[i]);
+
+    // shared vertices: unique edge codes in sorted order
+    std::vector<size_t> offsets(blocks.size() + 1, 0);
+    for (size_t i = 0; i < blocks.size(); ++i)
+      offsets[i+1] = offsets[i] + block_triangles[i].size();
+    std::vector<uint64_t> edges;
+    edges.reserve(offsets.back());
+    for (size_t i = 0; i < blocks.size(); ++i)
+      edges.insert(edges.end(), block_triangles[i].begin(), block_triangles[i].end());
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    vertices.resize(edges.size());
+    const double half_size = 0.5 * this->resolution;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int i = 0; i < (int) edges.size(); ++i) {
+      const uint64_t code = edges[i];
+      point3d& v = vertices[i];
+      v = this->keyToCoord(OcTreeKey(key_type(code >> 2), key_type(code >> 18), key_type(code >> 34)));
+      v(code & 3) += (float) half_size;
+    }
+
+    triangles.resize(offsets.back());
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < (int) blocks.size(); ++i) {
+      const std::vector<uint64_t>& block_edges = block_triangles[i];
+      for (size_t j = 0; j < block_edges.size(); ++j)
+        triangles[offsets[i] + j] = (unsigned int) (std::lower_bound(edges.begin(), edges.end(), block_edges[j])
+                                                    - edges.begin());
+    }
+
+    // area weighted vertex normals
+    normals.assign(vertices.size(), point3d(0, 0, 0));
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+      const point3d& p1 = vertices[triangles[i]];
+      point3d n = (vertices[triangles[i+1]] - p1).cross(vertices[triangles[i+2]] - p1);
+      normals[triangles[i]] += n;
+      normals[triangles[i+1]] += n;
+      normals[triangles[i+2]] += n;
+    }
+    for (size_t i = 0; i < normals.size(); ++i) {
+      if (normals[i].norm() > 0.0)
+        normals[i].normalize();
+    }
+
+    return triangles.size() / 3;
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::getMeshBBX(const point3d& min, const point3d& max,
+                                               std::vector<point3d>& vertices, std::vector<point3d>& normals,
+                                               std::vector<unsigned int>& triangles, bool unknownStatus) const {
+    OcTreeKey min_key, max_key;
+    if (!this->coordToKeyChecked(min, min_key) || !this->coordToKeyChecked(max, max_key)) {
+      OCTOMAP_ERROR_STR("Error in getMeshBBX: [" << min << "] - [" << max << "] is out of OcTree bounds!");
+      vertices.clear();
+      normals.clear();
+      triangles.clear();
+      return 0;
+    }
+
+    return getMeshBBX(min_key, max_key, vertices, normals, triangles, unknownStatus);
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::getMesh(std::vector<point3d>& vertices, std::vector<point3d>& normals,
+                                            std::vector<unsigned int>& triangles, bool unknownStatus) const {
+    const key_type max_key = key_type((1 << this->tree_depth) - 1);
+    return getMeshBBX(OcTreeKey(0, 0, 0), OcTreeKey(max_key, max_key, max_key),
+                      vertices, normals, triangles, unknownStatus);
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::writeMesh(const std::string& filename, bool unknownStatus) const {
+    std::vector<point3d> vertices, normals;
+    std::vector<unsigned int> triangles;
+    getMesh(vertices, normals, triangles, unknownStatus);
+    return writeMesh(filename, vertices, normals, triangles);
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::writeMesh(const std::string& filename, const std::vector<point3d>& vertices,
+                                            const std::vector<point3d>& normals,
+                                            const std::vector<unsigned int>& triangles) {
+    const std::string::size_type dot = filename.rfind('.');
+    std::string extension = (dot == std::string::npos) ? "" : filename.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension != "ply" && extension != "obj") {
+      OCTOMAP_ERROR_STR("Error in writeMesh: unknown mesh format of " << filename << " (use .ply or .obj)");
+      return false;
+    }
+    if (normals.size() != vertices.size() || triangles.size() % 3 != 0) {
+      OCTOMAP_ERROR("Error in writeMesh: invalid mesh\n");
+      return false;
+    }
+
+    std::ofstream file(filename.c_str(), std::ios_base::out | std::ios_base::binary);
+    if (!file.is_open()) {
+      OCTOMAP_ERROR_STR("Filestream to " << filename << " not open, nothing written.");
+      return false;
+    }
+
+    if (extension == "ply") {
+      const uint16_t endian_test = 1;
+      const bool little_endian = *((const uint8_t*) &endian_test) == 1;
+      file << "ply\nformat " << (little_endian ? "binary_little_endian" : "binary_big_endian") << " 1.0\n"
+           << "comment generated by OctoMap\n"
+           << "element vertex " << vertices.size() << "\n"
+           << "property float x\nproperty float y\nproperty float z\n"
+           << "property float nx\nproperty float ny\nproperty float nz\n"
+           << "element face " << triangles.size() / 3 << "\n"
+           << "property list uchar int vertex_indices\nend_header\n";
+
+      // write in one block per element type
+      std::vector<float> vertex_data(6 * vertices.size());
+      for (size_t i = 0; i < vertices.size(); ++i) {
+        for (unsigned int j = 0; j < 3; ++j) {
+          vertex_data[6*i + j] = vertices[i](j);
+          vertex_data[6*i + 3 + j] = normals[i](j);
+        }
+      }
+      if (!vertex_data.empty())
+        file.write((const char*) &vertex_data[0], vertex_data.size() * sizeof(float));
+
+      const size_t face_bytes = 1 + 3 * sizeof(int32_t);
+      std::vector<char> face_data(face_bytes * (triangles.size() / 3));
+      for (size_t i = 0; i < triangles.size() / 3; ++i) {
+        char* face = &face_data[face_bytes * i];
+        face[0] = 3;
+        for (unsigned int j = 0; j < 3; ++j) {
+          int32_t index = (int32_t) triangles[3*i + j];
+          memcpy(face + 1 + j * sizeof(int32_t), &index, sizeof(int32_t));
+        }
+      }
+      if (!face_data.empty())
+        file.write(&face_data[0], face_data.size());
+    }
+    else {
+      file << "# generated by OctoMap\n";
+      // formatted into a buffer, much faster than stream operators
+      std::string buffer;
+      char line[128];
+      for (size_t i = 0; i < vertices.size(); ++i) {
+        snprintf(line, sizeof(line), "v %g %g %g\n", vertices[i].x(), vertices[i].y(), vertices[i].z());
+        buffer += line;
+      }
+      for (size_t i = 0; i < normals.size(); ++i) {
+        snprintf(line, sizeof(line), "vn %g %g %g\n", normals[i].x(), normals[i].y(), normals[i].z());
+        buffer += line;
+      }
+      for (size_t i = 0; i < triangles.size(); i += 3) {
+        // indices start at 1
+        snprintf(line, sizeof(line), "f %u//%u %u//%u %u//%u\n", triangles[i] + 1, triangles[i] + 1,
+                 triangles[i+1] + 1, triangles[i+1] + 1, triangles[i+2] + 1, triangles[i+2] + 1);
+        buffer += line;
+        if (buffer.size() > (1 << 20)) {
+          file << buffer;
+          buffer.clear();
+        }
+      }
+      file << buffer;
+    }
+
+    file.close();
+    return !file.fail();
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getMeshBlocksRecurs(const NODE* node, unsigned int depth,
+                                                      const OcTreeKey& node_min_key,
+                                                      const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                                      bool seed_occupied, std::vector<uint64_t>& blocks) const {
+    assert(node);
+
+    if (!this->nodeHasChildren(node)) {
+      if (this->isNodeOccupied(node) != seed_occupied)
+        return;
+
+      // cubes differing from the leaf have their lowest corner one voxel below or
+      // on the upper border of the leaf, only the blocks containing these are needed
+      const unsigned int node_size = 1 << (this->tree_depth - depth);
+      const unsigned int max_cube = (1 << this->tree_depth) - 2;
+      unsigned int lo[3], hi[3];
+      for (unsigned int i=0; i<3; ++i) {
+        unsigned int node_lo = std::max((unsigned int) node_min_key[i], (unsigned int) min_key[i]);
+        unsigned int node_hi = std::min((unsigned int) node_min_key[i] + node_size - 1, (unsigned int) max_key[i]);
+        lo[i] = ((node_lo > 0) ? node_lo - 1 : 0) >> MESH_BLOCK_BITS;
+        hi[i] = std::min(node_hi, max_cube) >> MESH_BLOCK_BITS;
+      }
+
+      for (unsigned int z=lo[2]; z<=hi[2]; ++z) {
+        for (unsigned int y=lo[1]; y<=hi[1]; ++y) {
+          const bool border = (z == lo[2] || z == hi[2] || y == lo[1] || y == hi[1]);
+          for (unsigned int x=lo[0]; x<=hi[0]; x = (border || x == hi[0]) ? x+1 : hi[0]) {
+            blocks.push_back(((uint64_t) z << 32) | ((uint64_t) y << 16) | x);
+          }
+        }
+      }
+      return;
+    }
+
+    const unsigned int child_size = 1 << (this->tree_depth - depth - 1);
+    OcTreeKey child_min_key;
+    for (unsigned int i=0; i<8; ++i) {
+      if (!this->nodeChildExists(node, i))
+        continue;
+
+      bool overlaps = true;
+      for (unsigned int j=0; j<3 && overlaps; ++j) {
+        unsigned int child_min = node_min_key[j] + ((i & (1 << j)) ? child_size : 0);
+        child_min_key[j] = key_type(child_min);
+        overlaps = (child_min <= max_key[j]) && (child_min + child_size - 1 >= min_key[j]);
+      }
+
+      if (overlaps)
+        getMeshBlocksRecurs(this->getNodeChild(node, i), depth+1, child_min_key, min_key, max_key,
+                            seed_occupied, blocks);
+    }
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getMeshBlock(uint64_t block, const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                               bool unknownStatus, std::vector<uint64_t>& triangle_edges) const {
+    const unsigned int block_size = 1 << MESH_BLOCK_BITS;
+    const unsigned int max_cube = (1 << this->tree_depth) - 2;
+    unsigned int block_min[3] = {(unsigned int) (block & 0xFFFF) << MESH_BLOCK_BITS,
+                                 (unsigned int) ((block >> 16) & 0xFFFF) << MESH_BLOCK_BITS,
+                                 (unsigned int) (block >> 32) << MESH_BLOCK_BITS};
+
+    // lowest corners of the cubes of this block, and the voxels of their corners inside the BBX
+    unsigned int cube_lo[3], cube_hi[3];
+    OcTreeKey grid_min_key, grid_max_key;
+    unsigned int grid_size[3];
+    for (unsigned int i=0; i<3; ++i) {
+      cube_lo[i] = std::max(block_min[i], (min_key[i] > 0) ? (unsigned int) min_key[i] - 1 : 0u);
+      cube_hi[i] = std::min(std::min(block_min[i] + block_size - 1, (unsigned int) max_key[i]), max_cube);
+      if (cube_lo[i] > cube_hi[i])
+        return;
+      grid_min_key[i] = key_type(std::max(cube_lo[i], (unsigned int) min_key[i]));
+      grid_max_key[i] = key_type(std::min(cube_hi[i] + 1, (unsigned int) max_key[i]));
+      grid_size[i] = grid_max_key[i] - grid_min_key[i] + 1;
+    }
+
+    std::vector<uint8_t> grid(size_t(grid_size[0]) * grid_size[1] * grid_size[2], unknownStatus);
+    getGridBBXRecurs<uint8_t>(this->root, 0, OcTreeKey(0, 0, 0), grid_min_key, grid_max_key, this->tree_depth,
+                              grid_size, grid, 1, 0);
+
+    for (unsigned int z=cube_lo[2]; z<=cube_hi[2]; ++z) {
+      for (unsigned int y=cube_lo[1]; y<=cube_hi[1]; ++y) {
+        for (unsigned int x=cube_lo[0]; x<=cube_hi[0]; ++x) {
+          const unsigned int cube[3] = {x, y, z};
+          int cube_index = 0;
+          for (unsigned int k=0; k<8; ++k) {
+            bool inside = true;
+            size_t idx = 0;
+            for (int j=2; j>=0; --j) {
+              const unsigned int c = cube[j] + meshCubeCorners[k][j];
+              inside = inside && c >= grid_min_key[j] && c <= grid_max_key[j];
+              idx = idx * grid_size[j] + (c - grid_min_key[j]);
+            }
+            if (inside ? grid[idx] : unknownStatus)
+              cube_index |= (1 << k);
+          }
+
+          if (edgeTable[cube_index] == 0)
+            continue;
+
+          for (int i = 0; triTable[cube_index][i] != -1; ++i) {
+            const unsigned int* edge = meshCubeEdges[triTable[cube_index][i]];
+            triangle_edges.push_back((((uint64_t) (z + edge[2]) << 32) | ((uint64_t) (y + edge[1]) << 16)
+                                      | (uint64_t) (x + edge[0])) << 2 | edge[3]);
+          }
+        }
+      }
+    }
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::getLeafsBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                                std::vector<point3d>& centers, std::vector<float>& sizes,
+                                                std::vector<float>& log_odds, bool occupied_only,
+                                                unsigned int max_depth) const {
+    assert(max_depth <= this->tree_depth);
+    if (this->root == NULL)
+      return 0;
+
+    if (max_depth == 0)
+      max_depth = this->tree_depth;
+
+    size_t num_before = centers.size();
+    getLeafsBBXRecurs(this->root, 0, OcTreeKey(0, 0, 0), min_key, max_key, max_depth, occupied_only,
+                      centers, sizes, log_odds);
+
+    return centers.size() - num_before;
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::getLeafsBBX(const point3d& min, const point3d& max,
+                                                std::vector<point3d>& centers, std::vector<float>& sizes,
+                                                std::vector<float>& log_odds, bool occupied_only,
+                                                unsigned int max_depth) const {
+    OcTreeKey min_key, max_key;
+    if (!this->coordToKeyChecked(min, min_key) || !this->coordToKeyChecked(max, max_key)) {
+      OCTOMAP_ERROR_STR("Error in getLeafsBBX: [" << min << "] - [" << max << "] is out of OcTree bounds!");
+      return 0;
+    }
+
+    return getLeafsBBX(min_key, max_key, centers, sizes, log_odds, occupied_only, max_depth);
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::collides(const CollisionShape& shape) const {
+    if (this->root == NULL)
+      return false;
+
+    return collidesRecurs(this->root, 0, OcTreeKey(0, 0, 0), shape);
+  }
+
+  template <class NODE>
+  int OccupancyOcTreeBase<NODE>::firstCollision(const std::vector<pose6d>& poses,
+                                                const std::vector<CollisionShape>& robot) const {
+    int first = -1;
+    if (this->root == NULL)
+      return first;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < (int) poses.size(); ++i) {
+      int current_first;
+#ifdef _OPENMP
+      #pragma omp atomic read
+#endif
+      current_first = first;
+      if (current_first >= 0 && current_first < i)
+        continue; // an earlier pose already collides
+
+      for (size_t j = 0; j < robot.size(); ++j) {
+        if (collides(robot[j].transform(poses[i]))) {
+#ifdef _OPENMP
+          #pragma omp critical (first_collision)
+#endif
+          {
+            if (first < 0 || i < first)
+              first = i;
+          }
+          break;
+        }
+      }
+    }
+    return first;
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::getKNearestOccupied(const point3d& query, unsigned int k,
+                                                        std::vector<point3d>& centers, std::vector<float>& sizes,
+                                                        std::vector<float>& distances, double max_distance) const {
+    centers.clear();
+    sizes.clear();
+    distances.clear();
+    if (this->root == NULL || k == 0 || !this->isNodeOccupied(this->root))
+      return 0;
+
+    const double max_distance_sq = (max_distance >= 0.0) ? max_distance * max_distance
+                                                         : std::numeric_limits<double>::max();
+
+    // best-first: the distance to a node's cube is a lower bound for all leafs below,
+    // so leafs are popped in the order of their distance
+    std::priority_queue<NearestEntry> queue;
+    NearestEntry entry;
+    entry.node = this->root;
+    entry.depth = 0;
+    entry.node_min_key = OcTreeKey(0, 0, 0);
+    entry.distance_sq = nodeDistanceSq(query, entry.node_min_key, 0);
+    if (entry.distance_sq <= max_distance_sq)
+      queue.push(entry);
+
+    while (!queue.empty() && centers.size() < k) {
+      const NearestEntry top = queue.top();
+      queue.pop();
+
+      if (!this->nodeHasChildren(top.node)) {
+        centers.push_back(this->keyToCoord(top.node_min_key, top.depth));
+        sizes.push_back(float(this->getNodeSize(top.depth)));
+        distances.push_back(float(sqrt(top.distance_sq)));
+        continue;
+      }
+
+      const unsigned int child_size = 1 << (this->tree_depth - top.depth - 1);
+      for (unsigned int i=0; i<8; ++i) {
+        if (!this->nodeChildExists(top.node, i))
+          continue;
+        const NODE* child = this->getNodeChild(top.node, i);
+        // inner nodes store the maximum occupancy of their children
+        if (!this->isNodeOccupied(child))
+          continue;
+
+        entry.node = child;
+        entry.depth = top.depth + 1;
+        for (unsigned int j=0; j<3; ++j)
+          entry.node_min_key[j] = top.node_min_key[j] + ((i & (1 << j)) ? child_size : 0);
+        entry.distance_sq = nodeDistanceSq(query, entry.node_min_key, entry.depth);
+        if (entry.distance_sq <= max_distance_sq)
+          queue.push(entry);
+      }
+    }
+
+    return centers.size();
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::getNearestOccupied(const point3d& query, point3d& center, float& distance,
+                                                     double max_distance) const {
+    std::vector<point3d> centers;
+    std::vector<float> sizes, distances;
+    if (getKNearestOccupied(query, 1, centers, sizes, distances, max_distance) == 0)
+      return false;
+
+    center = centers[0];
+    distance = distances[0];
+    return true;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getNearestOccupiedDistances(const std::vector<point3d>& queries,
+                                                              std::vector<float>& distances,
+                                                              double max_distance) const {
+    const float no_distance = (max_distance >= 0.0) ? float(max_distance) : std::numeric_limits<float>::max();
+    distances.resize(queries.size());
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < (int) queries.size(); ++i) {
+      point3d center;
+      float distance;
+      if (getNearestOccupied(queries[i], center, distance, max_distance))
+        distances[i] = distance;
+      else
+        distances[i] = no_distance;
+    }
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::getOccupiedInRadius(const point3d& query, double radius,
+                                                        std::vector<point3d>& centers,
+                                                        std::vector<float>& sizes) const {
+    if (this->root == NULL || radius < 0.0)
+      return 0;
+
+    size_t num_before = centers.size();
+    getOccupiedInRadiusRecurs(this->root, 0, OcTreeKey(0, 0, 0), query, radius * radius, centers, sizes);
+    return centers.size() - num_before;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getOccupiedInRadiusRecurs(const NODE* node, unsigned int depth,
+                                                            const OcTreeKey& node_min_key,
+                                                            const point3d& query, double radius_sq,
+                                                            std::vector<point3d>& centers,
+                                                            std::vector<float>& sizes) const {
+    assert(node);
+
+    // inner nodes store the maximum occupancy of their children:
+    // no occupied leaf can be below a free inner node
+    if (!this->isNodeOccupied(node) || nodeDistanceSq(query, node_min_key, depth) > radius_sq)
+      return;
+
+    if (!this->nodeHasChildren(node)) {
+      centers.push_back(this->keyToCoord(node_min_key, depth));
+      sizes.push_back(float(this->getNodeSize(depth)));
+      return;
+    }
+
+    const unsigned int child_size = 1 << (this->tree_depth - depth - 1);
+    OcTreeKey child_min_key;
+    for (unsigned int i=0; i<8; ++i) {
+      if (!this->nodeChildExists(node, i))
+        continue;
+
+      for (unsigned int j=0; j<3; ++j)
+        child_min_key[j] = node_min_key[j] + ((i & (1 << j)) ? child_size : 0);
+      getOccupiedInRadiusRecurs(this->getNodeChild(node, i), depth+1, child_min_key, query, radius_sq,
+                                centers, sizes);
+    }
+  }
+
+  template <class NODE>
+  double OccupancyOcTreeBase<NODE>::nodeDistanceSq(const point3d& p, const OcTreeKey& node_min_key,
+                                                   unsigned int depth) const {
+    const point3d center = this->keyToCoord(node_min_key, depth);
+    const double half_size = 0.5 * this->getNodeSize(depth);
+    double distance_sq = 0.0;
+    for (unsigned int i=0; i<3; ++i) {
+      double d = fabs(p(i) - center(i)) - half_size;
+      if (d > 0.0)
+        distance_sq += d * d;
+    }
+    return distance_sq;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::collidesRecurs(const NODE* node, unsigned int depth, const OcTreeKey& node_min_key,
+                                                 const CollisionShape& shape) const {
+    assert(node);
+
+    // inner nodes store the maximum occupancy of their children:
+    // no occupied leaf can be below a free inner node
+    if (!this->isNodeOccupied(node))
+      return false;
+
+    if (!shape.intersectsCube(this->keyToCoord(node_min_key, depth), 0.5 * this->getNodeSize(depth)))
+      return false;
+
+    if (!this->nodeHasChildren(node))
+      return true;
+
+    const unsigned int child_size = 1 << (this->tree_depth - depth - 1);
+    OcTreeKey child_min_key;
+    for (unsigned int i=0; i<8; ++i) {
+      if (!this->nodeChildExists(node, i))
+        continue;
+
+      for (unsigned int j=0; j<3; ++j)
+        child_min_key[j] = node_min_key[j] + ((i & (1 << j)) ? child_size : 0);
+      if (collidesRecurs(this->getNodeChild(node, i), depth+1, child_min_key, shape))
+        return true;
+    }
+    return false;
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getLeafsBBXRecurs(const NODE* node, unsigned int depth, const OcTreeKey& node_min_key,
+                                                    const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                                    unsigned int max_depth, bool occupied_only,
+                                                    std::vector<point3d>& centers, std::vector<float>& sizes,
+                                                    std::vector<float>& log_odds) const {
+    assert(node);
+
+    // inner nodes store the maximum occupancy of their children:
+    // no occupied leaf can be below a free inner node
+    if (occupied_only && !this->isNodeOccupied(node))
+      return;
+
+    if (depth == max_depth || !this->nodeHasChildren(node)) {
+      // any key within the node maps to its center at this depth
+      centers.push_back(this->keyToCoord(node_min_key, depth));
+      sizes.push_back(float(this->getNodeSize(depth)));
+      log_odds.push_back(node->getLogOdds());
+      return;
+    }
+
+    const unsigned int child_size = 1 << (this->tree_depth - depth - 1);
+    OcTreeKey child_min_key;
+    for (unsigned int i=0; i<8; ++i) {
+      if (!this->nodeChildExists(node, i))
+        continue;
+
+      bool overlaps = true;
+      for (unsigned int j=0; j<3 && overlaps; ++j) {
+        unsigned int child_min = node_min_key[j] + ((i & (1 << j)) ? child_size : 0);
+        child_min_key[j] = key_type(child_min);
+        overlaps = (child_min <= max_key[j]) && (child_min + child_size - 1 >= min_key[j]);
+      }
+
+      if (overlaps)
+        getLeafsBBXRecurs(this->getNodeChild(node, i), depth+1, child_min_key, min_key, max_key,
+                          max_depth, occupied_only, centers, sizes, log_odds);
+    }
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::computeGridBBX(const OcTreeKey& min_key, const OcTreeKey& max_key, unsigned int depth,
+                                                 OcTreeKey& grid_min_key, unsigned int grid_size[3]) const {
+    const unsigned int diff = this->tree_depth - depth;
+    for (unsigned int i=0; i<3; ++i) {
+      if (min_key[i] > max_key[i]) {
+        OCTOMAP_ERROR("Error in occupancy grid extraction: min key is larger than max key\n");
+        return false;
+      }
+      grid_min_key[i] = key_type((min_key[i] >> diff) << diff);
+      grid_size[i] = (max_key[i] >> diff) - (min_key[i] >> diff) + 1;
+    }
+    return true;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::getOccupancyGridBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                                      std::vector<int8_t>& grid, unsigned int& size_x,
+                                                      unsigned int& size_y, unsigned int& size_z,
+                                                      unsigned int depth) const {
+    assert(depth <= this->tree_depth);
+    if (depth == 0)
+      depth = this->tree_depth;
+
+    OcTreeKey grid_min_key;
+    unsigned int grid_size[3];
+    if (!computeGridBBX(min_key, max_key, depth, grid_min_key, grid_size))
+      return false;
+
+    size_x = grid_size[0];
+    size_y = grid_size[1];
+    size_z = grid_size[2];
+    grid.assign(size_t(size_x) * size_y * size_z, -1); // unknown
+
+    if (this->root == NULL)
+      return true;
+
+    const unsigned int diff = this->tree_depth - depth;
+    OcTreeKey grid_max_key;
+    for (unsigned int i=0; i<3; ++i)
+      grid_max_key[i] = key_type(grid_min_key[i] + (grid_size[i] << diff) - 1);
+
+    getGridBBXRecurs<int8_t>(this->root, 0, OcTreeKey(0, 0, 0), grid_min_key, grid_max_key, depth, grid_size,
+                             grid, 1, 0);
+    return true;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::getOccupancyBitsBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                                      std::vector<bool>& grid, unsigned int& size_x,
+                                                      unsigned int& size_y, unsigned int& size_z,
+                                                      unsigned int depth, bool unknown_as_occupied) const {
+    assert(depth <= this->tree_depth);
+    if (depth == 0)
+      depth = this->tree_depth;
+
+    OcTreeKey grid_min_key;
+    unsigned int grid_size[3];
+    if (!computeGridBBX(min_key, max_key, depth, grid_min_key, grid_size))
+      return false;
+
+    size_x = grid_size[0];
+    size_y = grid_size[1];
+    size_z = grid_size[2];
+    grid.assign(size_t(size_x) * size_y * size_z, unknown_as_occupied);
+
+    if (this->root == NULL)
+      return true;
+
+    const unsigned int diff = this->tree_depth - depth;
+    OcTreeKey grid_max_key;
+    for (unsigned int i=0; i<3; ++i)
+      grid_max_key[i] = key_type(grid_min_key[i] + (grid_size[i] << diff) - 1);
+
+    getGridBBXRecurs<bool>(this->root, 0, OcTreeKey(0, 0, 0), grid_min_key, grid_max_key, depth, grid_size,
+                           grid, true, false);
+    return true;
+  }
+
+  template <class NODE>
+  template <class CELL>
+  void OccupancyOcTreeBase<NODE>::getGridBBXRecurs(const NODE* node, unsigned int depth, const OcTreeKey& node_min_key,
+                                                   const OcTreeKey& grid_min_key, const OcTreeKey& grid_max_key,
+                                                   unsigned int grid_depth, const unsigned int grid_size[3],
+                                                   std::vector<CELL>& grid, CELL occupied_value, CELL free_value) const {
+    assert(node);
+
+    if (depth == grid_depth || !this->nodeHasChildren(node)) {
+      // node covers one or more grid cells completely, fill its intersection with the grid
+      const unsigned int diff = this->tree_depth - grid_depth;
+      const unsigned int node_size = 1 << (this->tree_depth - depth);
+      unsigned int lo[3], hi[3];
+      for (unsigned int i=0; i<3; ++i) {
+        unsigned int node_max = node_min_key[i] + node_size - 1;
+        lo[i] = (std::max((unsigned int) node_min_key[i], (unsigned int) grid_min_key[i]) - grid_min_key[i]) >> diff;
+        hi[i] = (std::min(node_max, (unsigned int) grid_max_key[i]) - grid_min_key[i]) >> diff;
+      }
+
+      const CELL value = this->isNodeOccupied(node) ? occupied_value : free_value;
+      for (unsigned int z=lo[2]; z<=hi[2]; ++z) {
+        for (unsigned int y=lo[1]; y<=hi[1]; ++y) {
+          size_t idx = size_t(grid_size[0]) * (y + size_t(grid_size[1]) * z);
+          for (unsigned int x=lo[0]; x<=hi[0]; ++x)
+            grid[idx + x] = value;
+        }
+      }
+      return;
+    }
+
+    const unsigned int child_size = 1 << (this->tree_depth - depth - 1);
+    OcTreeKey child_min_key;
+    for (unsigned int i=0; i<8; ++i) {
+      if (!this->nodeChildExists(node, i))
+        continue;
+
+      bool overlaps = true;
+      for (unsigned int j=0; j<3 && overlaps; ++j) {
+        unsigned int child_min = node_min_key[j] + ((i & (1 << j)) ? child_size : 0);
+        child_min_key[j] = key_type(child_min);
+        overlaps = (child_min <= grid_max_key[j]) && (child_min + child_size - 1 >= grid_min_key[j]);
+      }
+
+      if (overlaps)
+        getGridBBXRecurs<CELL>(this->getNodeChild(node, i), depth+1, child_min_key, grid_min_key, grid_max_key,
+                               grid_depth, grid_size, grid, occupied_value, free_value);
+    }
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::computeProjectionBand(double band_min_z, double band_max_z,
+                                                        key_type& band_min_key, key_type& band_max_key) const {
+    if (band_min_z > band_max_z) {
+      OCTOMAP_ERROR("Error in projection: band_min_z is larger than band_max_z\n");
+      return false;
+    }
+
+    const double band[2] = {band_min_z, band_max_z};
+    key_type* band_keys[2] = {&band_min_key, &band_max_key};
+    for (unsigned int i=0; i<2; ++i) {
+      if (!this->coordToKeyChecked(band[i], *band_keys[i]))
+        *band_keys[i] = (band[i] < 0.0) ? 0 : key_type(2 * this->tree_max_val - 1);
+    }
+    return true;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::getProjectionBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                                   double band_min_z, double band_max_z,
+                                                   std::vector<ProjectionCell>& grid,
+                                                   unsigned int& size_x, unsigned int& size_y,
+                                                   unsigned int depth) const {
+    assert(depth <= this->tree_depth);
+    if (depth == 0)
+      depth = this->tree_depth;
+
+    OcTreeKey grid_min_key;
+    unsigned int grid_size[3];
+    key_type band_min_key, band_max_key;
+    if (!computeGridBBX(min_key, max_key, depth, grid_min_key, grid_size)
+        || !computeProjectionBand(band_min_z, band_max_z, band_min_key, band_max_key))
+      return false;
+
+    size_x = grid_size[0];
+    size_y = grid_size[1];
+    grid.assign(size_t(size_x) * size_y, ProjectionCell());
+
+    if (this->root == NULL)
+      return true;
+
+    // columns of the whole grid, z is only clipped to the bounding box
+    const unsigned int diff = this->tree_depth - depth;
+    OcTreeKey clip_min_key (grid_min_key[0], grid_min_key[1], min_key[2]);
+    OcTreeKey clip_max_key (key_type(grid_min_key[0] + (size_x << diff) - 1),
+                            key_type(grid_min_key[1] + (size_y << diff) - 1), max_key[2]);
+    getProjectionBBXRecurs(this->root, 0, OcTreeKey(0, 0, 0), grid_min_key, clip_min_key, clip_max_key,
+                           depth, size_x, band_min_key, band_max_key, grid);
+    return true;
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::updateProjectionBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                                        double band_min_z, double band_max_z,
+                                                        std::vector<ProjectionCell>& grid,
+                                                        unsigned int depth) const {
+    assert(depth <= this->tree_depth);
+    if (depth == 0)
+      depth = this->tree_depth;
+
+    if (!use_change_detection) {
+      OCTOMAP_ERROR("Error in updateProjectionBBX: change detection is disabled\n");
+      return 0;
+    }
+
+    OcTreeKey grid_min_key;
+    unsigned int grid_size[3];
+    key_type band_min_key, band_max_key;
+    if (!computeGridBBX(min_key, max_key, depth, grid_min_key, grid_size)
+        || !computeProjectionBand(band_min_z, band_max_z, band_min_key, band_max_key))
+      return 0;
+
+    if (grid.size() != size_t(grid_size[0]) * grid_size[1]) {
+      OCTOMAP_ERROR("Error in updateProjectionBBX: grid does not match the bounding box\n");
+      return 0;
+    }
+
+    // columns containing changes inside of the bounding box
+    const unsigned int diff = this->tree_depth - depth;
+    std::vector<size_t> cells;
+    for (KeyBoolMap::const_iterator it = changed_keys.begin(); it != changed_keys.end(); ++it) {
+      const OcTreeKey& key = it->first;
+      bool inside = key[2] >= min_key[2] && key[2] <= max_key[2];
+      for (unsigned int i=0; i<2 && inside; ++i)
+        inside = key[i] >= grid_min_key[i] && ((unsigned int) (key[i] - grid_min_key[i]) >> diff) < grid_size[i];
+      if (inside)
+        cells.push_back(((key[0] - grid_min_key[0]) >> diff)
+                        + size_t(grid_size[0]) * ((key[1] - grid_min_key[1]) >> diff));
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    for (size_t i = 0; i < cells.size(); ++i) {
+      const size_t cell = cells[i];
+      grid[cell] = ProjectionCell();
+      if (this->root == NULL)
+        continue;
+
+      OcTreeKey clip_min_key (key_type(grid_min_key[0] + ((cell % grid_size[0]) << diff)),
+                              key_type(grid_min_key[1] + ((cell / grid_size[0]) << diff)), min_key[2]);
+      OcTreeKey clip_max_key (key_type(clip_min_key[0] + (1 << diff) - 1),
+                              key_type(clip_min_key[1] + (1 << diff) - 1), max_key[2]);
+      getProjectionBBXRecurs(this->root, 0, OcTreeKey(0, 0, 0), grid_min_key, clip_min_key, clip_max_key,
+                             depth, grid_size[0], band_min_key, band_max_key, grid);
+    }
+    return cells.size();
+  }
+
+  template <class NODE>
+  void OccupancyOcTreeBase<NODE>::getProjectionBBXRecurs(const NODE* node, unsigned int depth,
+                                                         const OcTreeKey& node_min_key,
+                                                         const OcTreeKey& grid_min_key,
+                                                         const OcTreeKey& clip_min_key,
+                                                         const OcTreeKey& clip_max_key,
+                                                         unsigned int grid_depth, unsigned int size_x,
+                                                         key_type band_min_key, key_type band_max_key,
+                                                         std::vector<ProjectionCell>& grid) const {
+    assert(node);
+
+    const unsigned int diff = this->tree_depth - grid_depth;
+    const unsigned int node_size = 1 << (this->tree_depth - depth);
+    const unsigned int z_lo = std::max((unsigned int) node_min_key[2], (unsigned int) clip_min_key[2]);
+    const unsigned int z_hi = std::min((unsigned int) node_min_key[2] + node_size - 1, (unsigned int) clip_max_key[2]);
+    const bool occupied = this->isNodeOccupied(node);
+    const bool in_band = (z_lo <= band_max_key) && (z_hi >= band_min_key);
+
+    // free subtrees (inner nodes store the maximum occupancy) only matter for
+    // the band occupancy of cells that are still unknown
+    if (!occupied) {
+      if (!in_band)
+        return;
+      if (depth >= grid_depth
+          && grid[((node_min_key[0] - grid_min_key[0]) >> diff)
+                  + size_t(size_x) * ((node_min_key[1] - grid_min_key[1]) >> diff)].occupancy >= 0)
+        return;
+    }
+
+    if (this->nodeHasChildren(node)) {
+      const unsigned int child_size = node_size >> 1;
+      OcTreeKey child_min_key;
+      for (unsigned int i=0; i<8; ++i) {
+        if (!this->nodeChildExists(node, i))
+          continue;
+
+        bool overlaps = true;
+        for (unsigned int j=0; j<3 && overlaps; ++j) {
+          unsigned int child_min = node_min_key[j] + ((i & (1 << j)) ? child_size : 0);
+          child_min_key[j] = key_type(child_min);
+          overlaps = (child_min <= clip_max_key[j]) && (child_min + child_size - 1 >= clip_min_key[j]);
+        }
+
+        if (overlaps)
+          getProjectionBBXRecurs(this->getNodeChild(node, i), depth+1, child_min_key, grid_min_key, clip_min_key,
+                                 clip_max_key, grid_depth, size_x, band_min_key, band_max_key, grid);
+      }
+      return;
+    }
+
+    // leaf: project its part inside the clipping box into all cells it covers
+    unsigned int lo[2], hi[2];
+    for (unsigned int i=0; i<2; ++i) {
+      unsigned int node_max = node_min_key[i] + node_size - 1;
+      lo[i] = (std::max((unsigned int) node_min_key[i], (unsigned int) clip_min_key[i]) - grid_min_key[i]) >> diff;
+      hi[i] = (std::min(node_max, (unsigned int) clip_max_key[i]) - grid_min_key[i]) >> diff;
+    }
+
+    const float half_size = float(0.5 * this->resolution);
+    const float bottom = float(this->keyToCoord(key_type(z_lo))) - half_size;
+    const float top = float(this->keyToCoord(key_type(z_hi))) + half_size;
+    const bool above_ground = z_hi >= band_min_key;
+    const float obstacle = float(this->keyToCoord(key_type(std::max(z_lo, (unsigned int) band_min_key)))) - half_size;
+
+    for (unsigned int y=lo[1]; y<=hi[1]; ++y) {
+      for (unsigned int x=lo[0]; x<=hi[0]; ++x) {
+        ProjectionCell& cell = grid[x + size_t(size_x) * y];
+        if (occupied) {
+          // comparisons with NaN are false: the first value is always taken
+          if (!(cell.min_z <= bottom))
+            cell.min_z = bottom;
+          if (!(cell.max_z >= top))
+            cell.max_z = top;
+          if (above_ground && !(cell.obstacle_z <= obstacle))
+            cell.obstacle_z = obstacle;
+          if (in_band)
+            cell.occupancy = 1;
+        }
+        else if (cell.occupancy < 0) {
+          cell.occupancy = 0;
+        }
+      }
+    }
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::cropBBX(const OcTreeKey& min_key, const OcTreeKey& max_key,
+                                            OccupancyOcTreeBase<NODE>* spill) {
+    for (unsigned int i=0; i<3; ++i) {
+      if (min_key[i] > max_key[i]) {
+        OCTOMAP_ERROR("Error in cropBBX: min key is larger than max key\n");
+        return 0;
+      }
+    }
+    if (spill != NULL && (spill == this || this->tree_depth != spill->tree_depth
+                          || fabs(this->resolution - spill->resolution) > 1e-9)) {
+      OCTOMAP_ERROR("Error in cropBBX: spill needs to be another tree with the same resolution\n");
+      return 0;
+    }
+
+    if (this->root == NULL || !this->nodeHasChildren(this->root))
+      return 0;
+
+    size_t num_removed = moveSubtreesRecurs(this->root, 0, OcTreeKey(0, 0, 0), min_key, max_key, true, spill);
+    if (!this->nodeHasChildren(this->root)) {
+      this->clear();
+      num_removed++;
+    }
+    return num_removed;
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::cropBBX(const point3d& min, const point3d& max,
+                                            OccupancyOcTreeBase<NODE>* spill) {
+    OcTreeKey min_key, max_key;
+    if (!this->coordToKeyChecked(min, min_key) || !this->coordToKeyChecked(max, max_key)) {
+      OCTOMAP_ERROR_STR("Error in cropBBX: [" << min << "] - [" << max << "] is out of OcTree bounds!");
+      return 0;
+    }
+
+    return cropBBX(min_key, max_key, spill);
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::restoreBBX(OccupancyOcTreeBase<NODE>& spill,
+                                               const OcTreeKey& min_key, const OcTreeKey& max_key) {
+    for (unsigned int i=0; i<3; ++i) {
+      if (min_key[i] > max_key[i]) {
+        OCTOMAP_ERROR("Error in restoreBBX: min key is larger than max key\n");
+        return 0;
+      }
+    }
+    if (&spill == this || this->tree_depth != spill.tree_depth || fabs(this->resolution - spill.resolution) > 1e-9) {
+      OCTOMAP_ERROR("Error in restoreBBX: spill needs to be another tree with the same resolution\n");
+      return 0;
+    }
+
+    if (spill.root == NULL || !spill.nodeHasChildren(spill.root))
+      return 0;
+
+    size_t num_restored = spill.moveSubtreesRecurs(spill.root, 0, OcTreeKey(0, 0, 0), min_key, max_key, false, this);
+    if (!spill.nodeHasChildren(spill.root))
+      spill.clear();
+    return num_restored;
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::restoreBBX(OccupancyOcTreeBase<NODE>& spill,
+                                               const point3d& min, const point3d& max) {
+    OcTreeKey min_key, max_key;
+    if (!this->coordToKeyChecked(min, min_key) || !this->coordToKeyChecked(max, max_key)) {
+      OCTOMAP_ERROR_STR("Error in restoreBBX: [" << min << "] - [" << max << "] is out of OcTree bounds!");
+      return 0;
+    }
+
+    return restoreBBX(spill, min_key, max_key);
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::moveWindow(const point3d& center, const point3d& half_size,
+                                             OccupancyOcTreeBase<NODE>* spill) {
+    OcTreeKey min_key, max_key;
+    if (!this->coordToKeyChecked(center - half_size, min_key) || !this->coordToKeyChecked(center + half_size, max_key)) {
+      OCTOMAP_ERROR_STR("Error in moveWindow: window around [" << center << "] is out of OcTree bounds!");
+      return false;
+    }
+
+    cropBBX(min_key, max_key, spill);
+    if (spill != NULL)
+      restoreBBX(*spill, min_key, max_key);
+    return true;
+  }
+
+  template <class NODE>
+  size_t OccupancyOcTreeBase<NODE>::moveSubtreesRecurs(NODE* node, unsigned int depth, const OcTreeKey& node_min_key,
+                                                       const OcTreeKey& min_key, const OcTreeKey& max_key, bool outside,
+                                                       OccupancyOcTreeBase<NODE>* target) {
+    assert(node);
+
+    size_t num_moved = 0;
+    const unsigned int child_size = 1 << (this->tree_depth - depth - 1);
+    OcTreeKey child_min_key;
+    for (unsigned int i=0; i<8; ++i) {
+      if (!this->nodeChildExists(node, i))
+        continue;
+
+      bool overlaps = true;
+      bool inside = true;
+      for (unsigned int j=0; j<3; ++j) {
+        unsigned int child_min = node_min_key[j] + ((i & (1 << j)) ? child_size : 0);
+        child_min_key[j] = key_type(child_min);
+        overlaps = overlaps && (child_min <= max_key[j]) && (child_min + child_size - 1 >= min_key[j]);
+        inside = inside && (child_min >= min_key[j]) && (child_min + child_size - 1 <= max_key[j]);
+      }
+
+      // subtrees are moved as a whole, leafs crossing the border stay where they are (crop)
+      // or are moved completely (restore)
+      const bool has_children = this->nodeHasChildren(this->getNodeChild(node, i));
+      bool move = outside ? !overlaps : (inside || (overlaps && !has_children));
+      bool descend = !move && overlaps && !inside && has_children;
+      if (move && target != NULL && has_children) {
+        // merge with an inner node at the same position in target (holding other subtrees)
+        const NODE* target_node = target->search(child_min_key, depth+1);
+        if (target_node != NULL && target->nodeHasChildren(target_node)) {
+          move = false;
+          descend = true;
+        }
+      }
+
+      if (move) {
+        size_t num_nodes = 1;
+        this->calcNumNodesRecurs(this->getNodeChild(node, i), num_nodes);
+        NODE* subtree = this->detachNodeChild(node, i);
+        if (target == NULL) {
+          this->deleteNodeRecurs(subtree);
+          num_moved += num_nodes;
+        } else if (target->insertSubtree(subtree, num_nodes, depth+1, child_min_key, outside)) {
+          num_moved += num_nodes;
+        }
+      } else if (descend) {
+        NODE* child = this->unshareNodeChild(node, i);
+        num_moved += moveSubtreesRecurs(child, depth+1, child_min_key, min_key, max_key, outside, target);
+        if (!this->nodeHasChildren(child))
+          this->deleteNodeChild(node, i); // inner node without children left
+      }
+    }
+
+    if (this->nodeHasChildren(node))
+      node->updateOccupancyChildren();
+    return num_moved;
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::insertSubtree(NODE* subtree, size_t num_nodes, unsigned int depth,
+                                                const OcTreeKey& key, bool replace) {
+    assert(depth > 0);
+
+    if (this->root == NULL) {
+      NODE* new_root = new NODE();
+      insertSubtreeRecurs(new_root, true, 0, subtree, num_nodes, depth, key, replace);
+      this->attachRoot(new_root);
+      return true;
+    }
+
+    return insertSubtreeRecurs(this->root, false, 0, subtree, num_nodes, depth, key, replace);
+  }
+
+  template <class NODE>
+  bool OccupancyOcTreeBase<NODE>::insertSubtreeRecurs(NODE* node, bool node_just_created, unsigned int depth,
+                                                      NODE* subtree, size_t num_nodes, unsigned int subtree_depth,
+                                                      const OcTreeKey& key, bool replace) {
+    if (!node_just_created && !this->nodeHasChildren(node)) {
+      // existing leaf covers the position of the subtree
+      if (!replace) {
+        this->deleteNodeRecurs(subtree);
+        return false;
+      }
+      this->expandNode(node);
+    }
+
+    const unsigned int pos = computeChildIdx(key, this->tree_depth - 1 - depth);
+    if (depth + 1 == subtree_depth) {
+      if (this->nodeChildExists(node, pos)) {
+        if (!replace) {
+          this->deleteNodeRecurs(subtree);
+          return false;
+        }
+        this->deleteNodeRecurs(this->detachNodeChild(node, pos));
+      }
+      this->attachNodeChild(node, pos, subtree);
+      this->tree_size += num_nodes - 1; // attachNodeChild() counts the subtree root only
+    } else if (this->nodeChildExists(node, pos)) {
+      if (!insertSubtreeRecurs(this->unshareNodeChild(node, pos), false, depth+1, subtree, num_nodes,
+                               subtree_depth, key, replace))
+        return false;
+    } else {
+      // attached when completely initialized (for concurrent readers)
+      NODE* child = new NODE();
+      insertSubtreeRecurs(child, true, depth+1, subtree, num_nodes, subtree_depth, key, replace);
+      this->attachNodeChild(node, pos, child);
+    }
+
+    node->updateOccupancyChildren();
+    return true;
+  }
+
   template <class NODE>
   bool OccupancyOcTreeBase<NODE>::castRay(const point3d& origin, const point3d& directionP, point3d& end,
                                           bool ignoreUnknown, double maxRange) const {
@@ -0,0 +1,130 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_RANGE_DEPTH_POLICY_H
+#define OCTOMAP_RANGE_DEPTH_POLICY_H
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+namespace octomap {
+
+  /**
+   * Maps the range of a measurement (distance from the sensor) to the octree
+   * depth at which it is integrated, see
+   * OccupancyOcTreeBase::insertPointCloudMultiRes(). A policy consists of
+   * levels (min_range, depth): all ranges from min_range up to the next level
+   * are integrated at depth. Depths have to decrease (=get coarser) with range.
+   *
+   * Example: full resolution up to 5m, nodes of 2x2x2 voxels up to 10m and
+   * 4x4x4 voxels beyond (tree depth 16):
+   * \code
+   * RangeDepthPolicy policy;
+   * policy.addLevel(5.0, 15);
+   * policy.addLevel(10.0, 14);
+   * \endcode
+   */
+  class RangeDepthPolicy {
+  public:
+    /// Default policy: maximum depth (full resolution) at all ranges
+    explicit RangeDepthPolicy(unsigned int max_depth = 16) {
+      levels.push_back(std::make_pair(0.0, max_depth));
+    }
+
+    /**
+     * Policy which integrates measurements at max_depth up to full_resolution_range
+     * and one level coarser for each doubling of the range beyond, but not
+     * coarser than min_depth.
+     */
+    RangeDepthPolicy(double full_resolution_range, unsigned int min_depth, unsigned int max_depth = 16) {
+      levels.push_back(std::make_pair(0.0, max_depth));
+      double range = full_resolution_range;
+      for (unsigned int depth = max_depth; depth > min_depth; --depth, range *= 2.0)
+        levels.push_back(std::make_pair(range, depth-1));
+    }
+
+    /**
+     * Integrate measurements from min_range on (up to the next level) at depth.
+     * Replaces an existing level at the same min_range.
+     */
+    void addLevel(double min_range, unsigned int depth) {
+      std::vector<Level>::iterator it = std::lower_bound(levels.begin(), levels.end(),
+                                                         std::make_pair(min_range, 0u), compareRange);
+      if (it != levels.end() && it->first == min_range)
+        it->second = depth;
+      else
+        levels.insert(it, std::make_pair(min_range, depth));
+    }
+
+    /// @return depth at which a measurement at range is integrated
+    unsigned int getDepth(double range) const {
+      std::vector<Level>::const_iterator it = std::upper_bound(levels.begin(), levels.end(),
+                                                               std::make_pair(range, 0u), compareRange);
+      if (it == levels.begin())
+        return it->second;
+      return (it-1)->second;
+    }
+
+    /// number of levels (range intervals) of the policy
+    size_t numLevels() const { return levels.size(); }
+    /// start of range interval i
+    double getLevelRange(size_t i) const { return levels[i].first; }
+    /// depth of range interval i
+    unsigned int getLevelDepth(size_t i) const { return levels[i].second; }
+
+    /// @return true if the depths of all levels are valid for tree_depth and do not increase with range
+    bool isValid(unsigned int tree_depth) const {
+      for (size_t i = 0; i < levels.size(); ++i) {
+        if (levels[i].second == 0 || levels[i].second > tree_depth)
+          return false;
+        if (i > 0 && levels[i].second > levels[i-1].second)
+          return false;
+      }
+      return true;
+    }
+
+  protected:
+    typedef std::pair<double, unsigned int> Level;
+
+    static bool compareRange(const Level& a, const Level& b) {
+      return a.first < b.first;
+    }
+
+    /// (min_range, depth), sorted by min_range
+    std::vector<Level> levels;
+  };
+
+} // end namespace
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OCTOMAP_ATOMIC_H_
+#define OCTOMAP_ATOMIC_H_
+
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace octomap {
+
+  // Minimal portable atomic operations, used for the reference counts of shared
+  // children arrays and for concurrent readers (epochs, node pointers).
+  // The read-modify-write operations imply a full memory barrier.
+
+  /// @return *value (a pointer or a 32 bit integer or float), later loads and
+  /// stores are not reordered before it (acquire)
+  template <typename T>
+  inline T atomicLoad(const volatile T* value) {
+#if defined(_MSC_VER)
+    T result = *value; // volatile loads have acquire semantics
+    _ReadWriteBarrier();
+    return result;
+#else
+    T result;
+    __atomic_load(value, &result, __ATOMIC_ACQUIRE);
+    return result;
+#endif
+  }
+
+  /// sets *value, earlier loads and stores are not reordered after it (release),
+  /// e.g. to publish a fully initialized node to concurrent readers
+  template <typename T>
+  inline void atomicStore(volatile T* value, T new_value) {
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+    *value = new_value; // volatile stores have release semantics
+#else
+    __atomic_store(value, &new_value, __ATOMIC_RELEASE);
+#endif
+  }
+
+  /// atomically increments *value, @return the new value
+  inline uint32_t atomicIncrement(volatile uint32_t* value) {
+#if defined(_MSC_VER)
+    return (uint32_t) _InterlockedIncrement(reinterpret_cast<volatile long*>(value));
+#else
+    return __sync_add_and_fetch(value, 1);
+#endif
+  }
+
+  /// atomically decrements *value, @return the new value
+  inline uint32_t atomicDecrement(volatile uint32_t* value) {
+#if defined(_MSC_VER)
+    return (uint32_t) _InterlockedDecrement(reinterpret_cast<volatile long*>(value));
+#else
+    return __sync_sub_and_fetch(value, 1);
+#endif
+  }
+
+  /// atomically sets *value to new_value if it equals expected, @return true on success
+  inline bool atomicCompareAndSwap(volatile uint32_t* value, uint32_t expected, uint32_t new_value) {
+#if defined(_MSC_VER)
+    return (uint32_t) _InterlockedCompareExchange(reinterpret_cast<volatile long*>(value),
+                                                  (long) new_value, (long) expected) == expected;
+#else
+    return __sync_bool_compare_and_swap(value, expected, new_value);
+#endif
+  }
+
+  /// gives up the time slice of the calling thread, used while waiting for a
+  /// resource held by another thread
+  void yieldThread();
+
+} // namespace
+
+#endif
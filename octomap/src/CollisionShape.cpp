@@ -0,0 +1,259 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <limits>
+
+#include <octomap/CollisionShape.h>
+
+namespace octomap {
+
+  CollisionShape CollisionShape::sphere(const point3d& center, double radius){
+    CollisionShape shape(SPHERE);
+    shape.center = center;
+    shape.radius = radius;
+    shape.updateBBX();
+    return shape;
+  }
+
+  CollisionShape CollisionShape::box(const point3d& min, const point3d& max){
+    CollisionShape shape(BOX);
+    shape.p1 = min;
+    shape.p2 = max;
+    shape.updateBBX();
+    return shape;
+  }
+
+  CollisionShape CollisionShape::orientedBox(const pose6d& pose, const point3d& half_extents){
+    CollisionShape shape(ORIENTED_BOX);
+    shape.center = pose.trans();
+    shape.axes[0] = pose.rot().rotate(point3d(1.0f, 0.0f, 0.0f));
+    shape.axes[1] = pose.rot().rotate(point3d(0.0f, 1.0f, 0.0f));
+    shape.axes[2] = pose.rot().rotate(point3d(0.0f, 0.0f, 1.0f));
+    shape.half_extents = half_extents;
+    shape.updateBBX();
+    return shape;
+  }
+
+  CollisionShape CollisionShape::capsule(const point3d& p1, const point3d& p2, double radius){
+    CollisionShape shape(CAPSULE);
+    shape.p1 = p1;
+    shape.p2 = p2;
+    shape.radius = radius;
+    shape.updateBBX();
+    return shape;
+  }
+
+  CollisionShape CollisionShape::transform(const pose6d& pose) const {
+    CollisionShape result(*this);
+    switch (type) {
+    case SPHERE:
+      result.center = pose.transform(center);
+      break;
+    case CAPSULE:
+      result.p1 = pose.transform(p1);
+      result.p2 = pose.transform(p2);
+      break;
+    case BOX:
+      result.type = ORIENTED_BOX;
+      result.center = pose.transform((p1 + p2) * 0.5f);
+      result.axes[0] = pose.rot().rotate(point3d(1.0f, 0.0f, 0.0f));
+      result.axes[1] = pose.rot().rotate(point3d(0.0f, 1.0f, 0.0f));
+      result.axes[2] = pose.rot().rotate(point3d(0.0f, 0.0f, 1.0f));
+      result.half_extents = (p2 - p1) * 0.5f;
+      break;
+    case ORIENTED_BOX:
+      result.center = pose.transform(center);
+      for (unsigned int i = 0; i < 3; ++i)
+        result.axes[i] = pose.rot().rotate(axes[i]);
+      break;
+    }
+    result.updateBBX();
+    return result;
+  }
+
+  void CollisionShape::updateBBX(){
+    switch (type) {
+    case SPHERE: {
+      float r = float(radius);
+      bbx_min = center - point3d(r, r, r);
+      bbx_max = center + point3d(r, r, r);
+      break;
+    }
+    case BOX:
+      bbx_min = p1;
+      bbx_max = p2;
+      break;
+    case ORIENTED_BOX:
+      for (unsigned int i = 0; i < 3; ++i) {
+        float extent = 0.0f;
+        for (unsigned int j = 0; j < 3; ++j)
+          extent += fabs(axes[j](i)) * half_extents(j);
+        bbx_min(i) = center(i) - extent;
+        bbx_max(i) = center(i) + extent;
+      }
+      break;
+    case CAPSULE:
+      for (unsigned int i = 0; i < 3; ++i) {
+        bbx_min(i) = std::min(p1(i), p2(i)) - float(radius);
+        bbx_max(i) = std::max(p1(i), p2(i)) + float(radius);
+      }
+      break;
+    }
+  }
+
+  bool CollisionShape::intersectsCube(const point3d& cube_center, double half_size) const {
+    // bounding boxes first (exact for BOX)
+    for (unsigned int i = 0; i < 3; ++i) {
+      if (bbx_min(i) > cube_center(i) + half_size || bbx_max(i) < cube_center(i) - half_size)
+        return false;
+    }
+
+    switch (type) {
+    case SPHERE: {
+      double dist_sq = 0.0;
+      for (unsigned int i = 0; i < 3; ++i) {
+        double d = fabs(center(i) - cube_center(i)) - half_size;
+        if (d > 0.0)
+          dist_sq += d * d;
+      }
+      return dist_sq <= radius * radius;
+    }
+    case BOX:
+      return true;
+    case ORIENTED_BOX:
+      return orientedBoxIntersectsCube(cube_center, half_size);
+    case CAPSULE:
+      return segmentCubeDistanceSq(cube_center, half_size) <= radius * radius;
+    }
+    return true;
+  }
+
+  bool CollisionShape::orientedBoxIntersectsCube(const point3d& cube_center, double h) const {
+    // separating axis test, see Ericson: "Real-Time Collision Detection", 4.4.1
+    // R[i][j]: world axis i in terms of box axis j
+    double R[3][3], absR[3][3];
+    const double eps = 1e-9;
+    for (unsigned int i = 0; i < 3; ++i) {
+      for (unsigned int j = 0; j < 3; ++j) {
+        R[i][j] = axes[j](i);
+        absR[i][j] = fabs(R[i][j]) + eps;
+      }
+    }
+    double t[3];
+    for (unsigned int i = 0; i < 3; ++i)
+      t[i] = center(i) - cube_center(i);
+    const double b[3] = { half_extents(0), half_extents(1), half_extents(2) };
+
+    // axes of the cube
+    for (unsigned int i = 0; i < 3; ++i) {
+      double rb = b[0] * absR[i][0] + b[1] * absR[i][1] + b[2] * absR[i][2];
+      if (fabs(t[i]) > h + rb)
+        return false;
+    }
+    // axes of the box
+    for (unsigned int j = 0; j < 3; ++j) {
+      double ra = h * (absR[0][j] + absR[1][j] + absR[2][j]);
+      if (fabs(t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j]) > ra + b[j])
+        return false;
+    }
+    // cross products of both
+    for (unsigned int i = 0; i < 3; ++i) {
+      unsigned int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+      for (unsigned int j = 0; j < 3; ++j) {
+        unsigned int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+        double ra = h * (absR[i2][j] + absR[i1][j]);
+        double rb = b[j1] * absR[i][j2] + b[j2] * absR[i][j1];
+        if (fabs(t[i2] * R[i1][j] - t[i1] * R[i2][j]) > ra + rb)
+          return false;
+      }
+    }
+    return true;
+  }
+
+  double CollisionShape::segmentCubeDistanceSq(const point3d& cube_center, double h) const {
+    // The squared distance of p1 + s*(p2-p1) to the cube is a convex, piecewise
+    // quadratic function of s. Its pieces end where the segment crosses a face plane.
+    const point3d d = p2 - p1;
+    double breaks[8];
+    unsigned int num_breaks = 0;
+    breaks[num_breaks++] = 0.0;
+    breaks[num_breaks++] = 1.0;
+    for (unsigned int i = 0; i < 3; ++i) {
+      if (d(i) == 0.0f)
+        continue;
+      for (int side = -1; side <= 1; side += 2) {
+        double s = (cube_center(i) + side * h - p1(i)) / d(i);
+        if (s > 0.0 && s < 1.0)
+          breaks[num_breaks++] = s;
+      }
+    }
+    // at most 8 breakpoints, insertion sort
+    for (unsigned int k = 1; k < num_breaks; ++k) {
+      double s = breaks[k];
+      unsigned int l = k;
+      for (; l > 0 && breaks[l-1] > s; --l)
+        breaks[l] = breaks[l-1];
+      breaks[l] = s;
+    }
+
+    double min_dist_sq = std::numeric_limits<double>::max();
+    for (unsigned int k = 0; k + 1 < num_breaks; ++k) {
+      double s0 = breaks[k], s1 = breaks[k+1];
+      double s_mid = 0.5 * (s0 + s1);
+      // quadratic a*s^2 + b*s + c on this piece
+      double a = 0.0, b = 0.0, c = 0.0;
+      for (unsigned int i = 0; i < 3; ++i) {
+        double x = p1(i) + s_mid * d(i);
+        double bound;
+        if (x < cube_center(i) - h)
+          bound = cube_center(i) - h;
+        else if (x > cube_center(i) + h)
+          bound = cube_center(i) + h;
+        else
+          continue; // inside the slab
+        double offset = p1(i) - bound;
+        a += d(i) * d(i);
+        b += 2.0 * offset * d(i);
+        c += offset * offset;
+      }
+      double s = s0;
+      if (a > 0.0)
+        s = std::min(std::max(-b / (2.0 * a), s0), s1);
+      min_dist_sq = std::min(min_dist_sq, (a * s + b) * s + c);
+    }
+    return std::max(min_dist_sq, 0.0);
+  }
+
+} // end namespace
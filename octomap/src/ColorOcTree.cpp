@@ -32,6 +32,7 @@
  */
 
 #include <octomap/ColorOcTree.h>
+#include <algorithm>
 
 namespace octomap {
 
@@ -97,7 +98,7 @@ namespace octomap {
                                              uint8_t r,
                                              uint8_t g,
                                              uint8_t b) {
-    ColorOcTreeNode* n = search (key);
+    ColorOcTreeNode* n = searchUnshared(key);
     if (n != 0) {
       n->setColor(r, g, b);
     }
@@ -115,11 +116,7 @@ namespace octomap {
       node->setColor(node->getAverageChildColor());
 
     // delete children
-    for (unsigned int i=0;i<8;i++) {
-      deleteNodeChild(node, i);
-    }
-    delete[] node->children;
-    node->children = NULL;
+    deleteNodeChildren(node);
 
     return true;
   }
@@ -147,7 +144,7 @@ namespace octomap {
                                                  uint8_t r,
                                                  uint8_t g,
                                                  uint8_t b) {
-    ColorOcTreeNode* n = search(key);
+    ColorOcTreeNode* n = searchUnshared(key);
     if (n != 0) {
       if (n->isColorSet()) {
         ColorOcTreeNode::Color prev_color = n->getColor();
@@ -164,28 +161,120 @@ namespace octomap {
                                                    uint8_t r,
                                                    uint8_t g,
                                                    uint8_t b) {
-    ColorOcTreeNode* n = search (key);
+    ColorOcTreeNode* n = searchUnshared(key);
     if (n != 0) {
-      if (n->isColorSet()) {
-        ColorOcTreeNode::Color prev_color = n->getColor();
-        double node_prob = n->getOccupancy();
-        uint8_t new_r = (uint8_t) ((double) prev_color.r * node_prob
-                                               +  (double) r * (0.99-node_prob));
-        uint8_t new_g = (uint8_t) ((double) prev_color.g * node_prob
-                                               +  (double) g * (0.99-node_prob));
-        uint8_t new_b = (uint8_t) ((double) prev_color.b * node_prob
-                                               +  (double) b * (0.99-node_prob));
-        n->setColor(new_r, new_g, new_b);
-      }
-      else {
-        n->setColor(r, g, b);
-      }
+      integrateColor(n, r, g, b);
     }
     return n;
   }
 
+  void ColorOcTree::integrateColor(ColorOcTreeNode* n,
+                                   uint8_t r,
+                                   uint8_t g,
+                                   uint8_t b) const {
+    if (n->isColorSet()) {
+      ColorOcTreeNode::Color prev_color = n->getColor();
+      double node_prob = n->getOccupancy();
+      uint8_t new_r = (uint8_t) ((double) prev_color.r * node_prob
+                                             +  (double) r * (0.99-node_prob));
+      uint8_t new_g = (uint8_t) ((double) prev_color.g * node_prob
+                                             +  (double) g * (0.99-node_prob));
+      uint8_t new_b = (uint8_t) ((double) prev_color.b * node_prob
+                                             +  (double) b * (0.99-node_prob));
+      n->setColor(new_r, new_g, new_b);
+    }
+    else {
+      n->setColor(r, g, b);
+    }
+  }
+
+  // interleaves the key bits (x lowest), so that sorted codes are grouped by the child index on every level
+  static uint64_t mortonCode(const OcTreeKey& key) {
+    uint64_t code = 0;
+    for (int i = 15; i >= 0; --i) {
+      code = (code << 3) | (((uint64_t) (key[2] >> i) & 1) << 2)
+                         | (((uint64_t) (key[1] >> i) & 1) << 1)
+                         |  ((uint64_t) (key[0] >> i) & 1);
+    }
+    return code;
+  }
+
+  static bool compareMortonCodes(const std::pair<uint64_t, OcTreeKey>& a,
+                                 const std::pair<uint64_t, OcTreeKey>& b) {
+    return a.first < b.first;
+  }
+
+  void ColorOcTree::insertColoredPointCloud(const Pointcloud& scan,
+                                            const std::vector<ColorOcTreeNode::Color>& colors,
+                                            const point3d& sensor_origin,
+                                            double maxrange, bool lazy_eval, bool discretize) {
+    if (colors.size() != scan.size()) {
+      OCTOMAP_ERROR("Error in insertColoredPointCloud: %u colors for %u points\n",
+                    (unsigned int) colors.size(), (unsigned int) scan.size());
+      return;
+    }
+
+    KeySet free_cells, occupied_cells;
+    if (discretize)
+      computeDiscreteUpdate(scan, sensor_origin, free_cells, occupied_cells, maxrange);
+    else
+      computeUpdate(scan, sensor_origin, free_cells, occupied_cells, maxrange);
+
+    // free voxels and the points of occupied voxels in Morton order,
+    // the points of a voxel keep their order (colors are integrated sequentially)
+    std::vector<std::pair<uint64_t, OcTreeKey> > free_keys;
+    free_keys.reserve(free_cells.size());
+    for (KeySet::iterator it = free_cells.begin(); it != free_cells.end(); ++it)
+      free_keys.push_back(std::make_pair(mortonCode(*it), *it));
+    std::sort(free_keys.begin(), free_keys.end(), compareMortonCodes);
+
+    std::vector<std::pair<uint64_t, size_t> > occupied_points;
+    occupied_points.reserve(scan.size());
+    for (size_t i = 0; i < scan.size(); ++i) {
+      OcTreeKey key;
+      if (this->coordToKeyChecked(scan[i], key) && occupied_cells.find(key) != occupied_cells.end())
+        occupied_points.push_back(std::make_pair(mortonCode(key), i));
+    }
+    std::sort(occupied_points.begin(), occupied_points.end());
+
+    // leafs only, inner nodes are updated below
+    for (size_t i = 0; i < free_keys.size(); ++i)
+      updateNode(free_keys[i].second, false, true);
+
+    std::vector<uint64_t> occupied_codes;
+    occupied_codes.reserve(occupied_cells.size());
+    for (size_t i = 0; i < occupied_points.size(); ) {
+      const uint64_t code = occupied_points[i].first;
+      const OcTreeKey key = this->coordToKey(scan[occupied_points[i].second]);
+      ColorOcTreeNode* n = updateNode(key, true, true);
+      // the early abort of updateNode() may return a node shared with a snapshot
+      if (n->getLogOdds() >= this->clamping_thres_max)
+        n = searchUnshared(key);
+      for (; i < occupied_points.size() && occupied_points[i].first == code; ++i) {
+        const ColorOcTreeNode::Color& c = colors[occupied_points[i].second];
+        integrateColor(n, c.r, c.g, c.b);
+      }
+      occupied_codes.push_back(code);
+    }
+
+    if (lazy_eval || this->root == NULL)
+      return;
+
+    std::vector<uint64_t> codes(free_keys.size() + occupied_codes.size());
+    for (size_t i = 0; i < free_keys.size(); ++i)
+      codes[i] = free_keys[i].first;
+    std::copy(occupied_codes.begin(), occupied_codes.end(), codes.begin() + free_keys.size());
+    std::inplace_merge(codes.begin(), codes.begin() + free_keys.size(), codes.end());
+
+    if (!codes.empty())
+      updateInnerNodesRecurs(this->root, 0, &codes[0], &codes[0] + codes.size());
+  }
+
 
   void ColorOcTree::updateInnerOccupancy() {
+    if (this->root == NULL)
+      return;
+
     this->updateInnerOccupancyRecurs(this->root, 0);
   }
 
@@ -196,7 +285,7 @@ namespace octomap {
       if (depth < this->tree_depth){
         for (unsigned int i=0; i<8; i++) {
           if (nodeChildExists(node, i)) {
-            updateInnerOccupancyRecurs(getNodeChild(node, i), depth+1);
+            updateInnerOccupancyRecurs(unshareNodeChild(node, i), depth+1);
           }
         }
       }
@@ -205,6 +294,32 @@ namespace octomap {
     }
   }
 
+  void ColorOcTree::updateInnerNodesRecurs(ColorOcTreeNode* node, unsigned int depth,
+                                           const uint64_t* begin, const uint64_t* end) {
+    if (!nodeHasChildren(node))
+      return; // leaf, or pruned while updating
+
+    // the codes of each child form a consecutive range
+    const unsigned int shift = 3 * (this->tree_depth - 1 - depth);
+    const uint64_t* it = begin;
+    while (it != end) {
+      const unsigned int pos = (unsigned int) ((*it >> shift) & 7);
+      const uint64_t* child_end = it;
+      while (child_end != end && ((*child_end >> shift) & 7) == pos)
+        ++child_end;
+
+      if (depth + 1 < this->tree_depth && nodeChildExists(node, pos))
+        updateInnerNodesRecurs(unshareNodeChild(node, pos), depth+1, it, child_end);
+      it = child_end;
+    }
+
+    // prune node if possible, otherwise set own probability and color (as in updateNode())
+    if (!pruneNode(node)) {
+      node->updateOccupancyChildren();
+      node->updateColorChildren();
+    }
+  }
+
   void ColorOcTree::writeColorHistogram(std::string filename) {
 
 #ifdef _MSC_VER
@@ -83,7 +83,7 @@ namespace octomap {
         createNodeChild(curNode, pos);
       }
       // descent tree
-      curNode = getNodeChild(curNode, pos);
+      curNode = unshareNodeChild(curNode, pos);
       curNode->increaseCount(); // modify traversed nodes
     }
 
@@ -91,15 +91,23 @@ namespace octomap {
   }
 
 
-  void CountingOcTree::getCentersMinHits(point3d_list& node_centers, unsigned int min_hits) const {
+  void CountingOcTree::getCentersMinHits(std::vector<point3d>& node_centers, unsigned int min_hits) const {
+    if (this->root == NULL)
+      return;
 
     OcTreeKey root_key;
     root_key[0] = root_key[1] = root_key[2] = this->tree_max_val;
     getCentersMinHitsRecurs(node_centers, min_hits, this->tree_depth, this->root, 0, root_key);
   }
 
+  void CountingOcTree::getCentersMinHits(point3d_list& node_centers, unsigned int min_hits) const {
+    std::vector<point3d> centers;
+    getCentersMinHits(centers, min_hits);
+    node_centers.insert(node_centers.end(), centers.begin(), centers.end());
+  }
+
 
-  void CountingOcTree::getCentersMinHitsRecurs( point3d_list& node_centers,
+  void CountingOcTree::getCentersMinHitsRecurs( std::vector<point3d>& node_centers,
                                                 unsigned int& min_hits,
                                                 unsigned int max_depth,
                                                 CountingOcTreeNode* node, unsigned int depth,
@@ -89,7 +89,7 @@ namespace octomap {
   }
 
   void OcTreeNode::addValue(const float& logOdds) {
-    value += logOdds;
+    setLogOdds(getLogOdds() + logOdds);
   }
   
 } // end namespace
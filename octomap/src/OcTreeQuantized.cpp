@@ -0,0 +1,369 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <limits>
+
+#include <octomap/OcTreeQuantized.h>
+#include <octomap/octomap_atomic.h>
+
+namespace octomap {
+
+  /// implementation of OcTreeNodeQuantized  ---------------------------------
+
+  namespace {
+    /**
+     * Free list of node-sized slots shared by all quantized trees. Slots are
+     * allocated in blocks of slots_per_block and never given back, so that
+     * nodes can still be deleted during static destruction.
+     */
+    class NodePool {
+    public:
+      NodePool() : free_slots(NULL), lock(0) {}
+
+      void* allocate() {
+        acquire();
+        if (free_slots == NULL)
+          addBlock();
+        Slot* slot = free_slots;
+        free_slots = slot->next;
+        release();
+        return slot;
+      }
+
+      void deallocate(void* p) {
+        Slot* slot = static_cast<Slot*>(p);
+        acquire();
+        slot->next = free_slots;
+        free_slots = slot;
+        release();
+      }
+
+    private:
+      union Slot {
+        Slot* next;
+        char node[sizeof(OcTreeNodeQuantized)];
+      };
+
+      static const size_t slots_per_block = 4096;
+
+      void addBlock() {
+        Slot* block = static_cast<Slot*>(::operator new(slots_per_block * sizeof(Slot)));
+        for (size_t i = 0; i < slots_per_block - 1; ++i)
+          block[i].next = &block[i+1];
+        block[slots_per_block - 1].next = free_slots;
+        free_slots = block;
+      }
+
+      // spin lock, held only for a few instructions
+      void acquire() {
+        while (!atomicCompareAndSwap(&lock, 0, 1))
+          yieldThread();
+      }
+
+      void release() {
+        atomicStore(&lock, uint32_t(0));
+      }
+
+      Slot* free_slots;
+      uint32_t lock;
+    };
+
+    NodePool& nodePool() {
+      static NodePool* pool = new NodePool(); // intentionally never deleted, see NodePool
+      return *pool;
+    }
+
+    // create the pool during static initialization, before any threads exist
+    NodePool& nodePoolInit = nodePool();
+  }
+
+  void* OcTreeNodeQuantized::operator new(size_t size){
+    if (size != sizeof(OcTreeNodeQuantized)) // derived node type
+      return ::operator new(size);
+    return nodePool().allocate();
+  }
+
+  void OcTreeNodeQuantized::operator delete(void* p, size_t size){
+    if (p == NULL)
+      return;
+    if (size != sizeof(OcTreeNodeQuantized))
+      ::operator delete(p);
+    else
+      nodePool().deallocate(p);
+  }
+
+  int16_t OcTreeNodeQuantized::getMaxChildValue() const{
+    int16_t max = -std::numeric_limits<int16_t>::max();
+
+    if (children != NULL){
+      for (unsigned int i=0; i<8; i++) {
+        if (children[i] != NULL) {
+          int16_t v = static_cast<OcTreeNodeQuantized*>(children[i])->getValue();
+          if (v > max)
+            max = v;
+        }
+      }
+    }
+    return max;
+  }
+
+  int16_t OcTreeNodeQuantized::quantize(double log_odds){
+    const double max = std::numeric_limits<int16_t>::max();
+    double q = floor(log_odds * log_odds_scale + 0.5);
+    if (q > max)
+      q = max;
+    else if (q < -max)
+      q = -max;
+    return int16_t(q);
+  }
+
+
+  /// implementation of OcTreeQuantized  -------------------------------------
+
+  namespace {
+    // node conversions for copyStructure()
+    struct QuantizeNode {
+      void operator()(const OcTreeNode& from, OcTreeNodeQuantized& to) const {
+        to.setLogOdds(from.getLogOdds());
+      }
+    };
+
+    struct DequantizeNode {
+      void operator()(const OcTreeNodeQuantized& from, OcTreeNode& to) const {
+        to.setLogOdds(from.getLogOdds());
+      }
+    };
+  }
+
+  OcTreeQuantized::OcTreeQuantized(double in_resolution)
+   : OcTreeBase<OcTreeNodeQuantized>(in_resolution) {
+    // same defaults as AbstractOccupancyOcTree
+    setOccupancyThres(0.5);
+    setProbHit(0.7);
+    setProbMiss(0.4);
+    setClampingThresMin(0.1192);
+    setClampingThresMax(0.971);
+
+    ocTreeQuantizedMemberInit.ensureLinking();
+  }
+
+  OcTreeQuantized::OcTreeQuantized(const OcTree& tree)
+   : OcTreeBase<OcTreeNodeQuantized>(tree.getResolution()) {
+    fromOcTree(tree);
+    ocTreeQuantizedMemberInit.ensureLinking();
+  }
+
+  void OcTreeQuantized::fromOcTree(const OcTree& tree){
+    occ_prob_thres = OcTreeNodeQuantized::quantize(tree.getOccupancyThresLog());
+    prob_hit = OcTreeNodeQuantized::quantize(tree.getProbHitLog());
+    prob_miss = OcTreeNodeQuantized::quantize(tree.getProbMissLog());
+    clamping_thres_min = OcTreeNodeQuantized::quantize(tree.getClampingThresMinLog());
+    clamping_thres_max = OcTreeNodeQuantized::quantize(tree.getClampingThresMaxLog());
+
+    copyStructure(tree, QuantizeNode());
+  }
+
+  void OcTreeQuantized::toOcTree(OcTree& tree) const{
+    tree.setOccupancyThres(getOccupancyThres());
+    tree.setProbHit(getProbHit());
+    tree.setProbMiss(getProbMiss());
+    tree.setClampingThresMin(getClampingThresMin());
+    tree.setClampingThresMax(getClampingThresMax());
+
+    tree.copyStructure(*this, DequantizeNode());
+  }
+
+  OcTreeNodeQuantized* OcTreeQuantized::updateNode(const OcTreeKey& key, float log_odds_update, bool lazy_eval) {
+    int16_t update = OcTreeNodeQuantized::quantize(log_odds_update);
+
+    // early abort: no change will happen when the node is already at threshold
+    OcTreeNodeQuantized* leaf = this->search(key);
+    if (leaf
+        && ((update >= 0 && leaf->getValue() >= clamping_thres_max)
+        || (update <= 0 && leaf->getValue() <= clamping_thres_min)))
+    {
+      return leaf;
+    }
+
+    if (root == NULL){
+      // new root is attached when completely initialized (for concurrent readers)
+      OcTreeNodeQuantized* new_root = new OcTreeNodeQuantized();
+      OcTreeNodeQuantized* retval = updateNodeRecurs(new_root, true, key, 0, update, false, lazy_eval);
+      attachRoot(new_root);
+      return retval;
+    }
+
+    return updateNodeRecurs(root, false, key, 0, update, false, lazy_eval);
+  }
+
+  OcTreeNodeQuantized* OcTreeQuantized::updateNode(const point3d& value, float log_odds_update, bool lazy_eval) {
+    OcTreeKey key;
+    if (!coordToKeyChecked(value, key))
+      return NULL;
+
+    return updateNode(key, log_odds_update, lazy_eval);
+  }
+
+  OcTreeNodeQuantized* OcTreeQuantized::updateNode(const OcTreeKey& key, bool occupied, bool lazy_eval) {
+    return updateNode(key, occupied ? getProbHitLog() : getProbMissLog(), lazy_eval);
+  }
+
+  OcTreeNodeQuantized* OcTreeQuantized::updateNode(const point3d& value, bool occupied, bool lazy_eval) {
+    OcTreeKey key;
+    if (!coordToKeyChecked(value, key))
+      return NULL;
+
+    return updateNode(key, occupied, lazy_eval);
+  }
+
+  OcTreeNodeQuantized* OcTreeQuantized::setNodeValue(const OcTreeKey& key, float log_odds_value, bool lazy_eval) {
+    // clamp log odds within range:
+    int16_t value = OcTreeNodeQuantized::quantize(log_odds_value);
+    value = std::min(std::max(value, clamping_thres_min), clamping_thres_max);
+
+    if (root == NULL){
+      OcTreeNodeQuantized* new_root = new OcTreeNodeQuantized();
+      OcTreeNodeQuantized* retval = updateNodeRecurs(new_root, true, key, 0, value, true, lazy_eval);
+      attachRoot(new_root);
+      return retval;
+    }
+
+    return updateNodeRecurs(root, false, key, 0, value, true, lazy_eval);
+  }
+
+  OcTreeNodeQuantized* OcTreeQuantized::setNodeValue(const point3d& value, float log_odds_value, bool lazy_eval) {
+    OcTreeKey key;
+    if (!coordToKeyChecked(value, key))
+      return NULL;
+
+    return setNodeValue(key, log_odds_value, lazy_eval);
+  }
+
+  OcTreeNodeQuantized* OcTreeQuantized::updateNodeRecurs(OcTreeNodeQuantized* node, bool node_just_created, const OcTreeKey& key,
+                                                         unsigned int depth, int16_t value, bool set_value, bool lazy_eval) {
+    assert(node);
+
+    // at last level, update node, end of recursion
+    if (depth == tree_depth) {
+      if (set_value)
+        node->setValue(value);
+      else
+        updateNodeLogOdds(node, value);
+      return node;
+    }
+
+    // follow down to last level
+    bool created_node = false;
+    unsigned int pos = computeChildIdx(key, tree_depth - 1 - depth);
+    OcTreeNodeQuantized* child;
+    if (!nodeChildExists(node, pos)) {
+      // child does not exist, but maybe it's a pruned node?
+      if (!nodeHasChildren(node) && !node_just_created) {
+        expandNode(node);
+        child = getNodeChild(node, pos);
+      } else {
+        // attached when completely initialized (for concurrent readers)
+        child = new OcTreeNodeQuantized();
+        created_node = true;
+      }
+    } else {
+      child = unshareNodeChild(node, pos);
+    }
+
+    OcTreeNodeQuantized* retval = updateNodeRecurs(child, created_node, key, depth+1, value, set_value, lazy_eval);
+    if (created_node)
+      attachNodeChild(node, pos, child);
+
+    if (!lazy_eval) {
+      // prune node if possible, otherwise set own probability
+      if (pruneNode(node))
+        retval = node; // the just updated node no longer exists
+      else
+        node->updateOccupancyChildren();
+    }
+    return retval;
+  }
+
+  void OcTreeQuantized::insertPointCloud(const Pointcloud& scan, const octomap::point3d& sensor_origin,
+                                         double maxrange, bool lazy_eval) {
+    KeySet free_cells, occupied_cells;
+    KeyRay* keyray = &(keyrays.at(0));
+
+    for (size_t i = 0; i < scan.size(); ++i) {
+      const point3d& p = scan[i];
+      if ((maxrange < 0.0) || ((p - sensor_origin).norm() <= maxrange)) {
+        if (computeRayKeys(sensor_origin, p, *keyray))
+          free_cells.insert(keyray->begin(), keyray->end());
+
+        OcTreeKey key;
+        if (coordToKeyChecked(p, key))
+          occupied_cells.insert(key);
+      } else { // beam is cut at maxrange
+        point3d new_end = sensor_origin + (p - sensor_origin).normalized() * (float) maxrange;
+        if (computeRayKeys(sensor_origin, new_end, *keyray))
+          free_cells.insert(keyray->begin(), keyray->end());
+      }
+    }
+
+    // prefer occupied cells over free ones
+    for (KeySet::iterator it = free_cells.begin(); it != free_cells.end(); ++it) {
+      if (occupied_cells.find(*it) == occupied_cells.end())
+        updateNode(*it, false, lazy_eval);
+    }
+    for (KeySet::iterator it = occupied_cells.begin(); it != occupied_cells.end(); ++it) {
+      updateNode(*it, true, lazy_eval);
+    }
+  }
+
+  void OcTreeQuantized::updateInnerOccupancy(){
+    if (root)
+      updateInnerOccupancyRecurs(root, 0);
+  }
+
+  void OcTreeQuantized::updateInnerOccupancyRecurs(OcTreeNodeQuantized* node, unsigned int depth){
+    // only recurse and update for inner nodes:
+    if (nodeHasChildren(node)){
+      if (depth < tree_depth){
+        for (unsigned int i=0; i<8; i++) {
+          if (nodeChildExists(node, i))
+            updateInnerOccupancyRecurs(unshareNodeChild(node, i), depth+1);
+        }
+      }
+      node->updateOccupancyChildren();
+    }
+  }
+
+  OcTreeQuantized::StaticMemberInitializer OcTreeQuantized::ocTreeQuantizedMemberInit;
+
+} // end namespace
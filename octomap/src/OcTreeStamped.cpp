@@ -35,32 +35,93 @@
 
 namespace octomap {
 
+  void OcTreeNodeStamped::updateTimestampChildren() {
+    if (children == NULL)
+      return;
+
+    bool first = true;
+    for (unsigned int i=0; i<8; i++) {
+      if (children[i] != NULL) {
+        const OcTreeNodeStamped* child = static_cast<const OcTreeNodeStamped*>(children[i]);
+        if (first || child->getTimestamp() > timestamp)
+          timestamp = child->getTimestamp();
+        if (first || child->getMinTimestamp() < min_timestamp)
+          min_timestamp = child->getMinTimestamp();
+        first = false;
+      }
+    }
+  }
+
+
   OcTreeStamped::OcTreeStamped(double in_resolution)
-   : OccupancyOcTreeBase<OcTreeNodeStamped>(in_resolution) {
+   : OccupancyOcTreeBase<OcTreeNodeStamped>(in_resolution),
+     current_time(0), use_current_time(false), decay_interval(0) {
     ocTreeStampedMemberInit.ensureLinking();
   }
 
   unsigned int OcTreeStamped::getLastUpdateTime() {
     // this value is updated whenever inner nodes are
     // updated using updateOccupancyChildren()
+    if (root == NULL)
+      return 0;
     return root->getTimestamp();
   }
 
   void OcTreeStamped::degradeOutdatedNodes(unsigned int time_thres) {
-    unsigned int query_time = (unsigned int) time(NULL);
+    unsigned int query_time = getCurrentTime();
 
-    for(leaf_iterator it = this->begin_leafs(), end=this->end_leafs();
-        it!= end; ++it) {
-      if ( this->isNodeOccupied(*it)
-           && ((query_time - it->getTimestamp()) > time_thres) ) {
-        integrateMissNoTime(&*it);
-      }
+    if (root == NULL || !isNodeOccupied(root) || (query_time - root->getMinTimestamp()) <= time_thres)
+      return;
+
+    degradeOutdatedNodesRecurs(root, query_time, time_thres);
+  }
+
+  void OcTreeStamped::degradeOutdatedNodesRecurs(OcTreeNodeStamped* node, unsigned int query_time,
+                                                 unsigned int time_thres) {
+    if (!nodeHasChildren(node)) {
+      integrateMissNoTime(node);
+      return;
+    }
+
+    for (unsigned int i=0; i<8; i++) {
+      if (!nodeChildExists(node, i))
+        continue;
+
+      // inner nodes hold the maximum occupancy and the oldest timestamp below them
+      const OcTreeNodeStamped* child = getNodeChild(node, i);
+      if (isNodeOccupied(child) && (query_time - child->getMinTimestamp()) > time_thres)
+        degradeOutdatedNodesRecurs(unshareNodeChild(node, i), query_time, time_thres);
+    }
+    node->updateOccupancyChildren();
+  }
+
+  float OcTreeStamped::getDecayedLogOdds(const OcTreeNodeStamped* node) const {
+    if (decay_interval == 0)
+      return node->getLogOdds();
+    return decayLogOdds(node, getCurrentTime());
+  }
+
+  float OcTreeStamped::decayLogOdds(const OcTreeNodeStamped* node, unsigned int query_time) const {
+    float log_odds = node->getLogOdds();
+    if (node->getTimestamp() == 0 || query_time <= node->getTimestamp())
+      return log_odds;
+
+    // same as integrateMissNoTime() once per interval while the node is occupied
+    unsigned int num_misses = (query_time - node->getTimestamp()) / decay_interval;
+    for (unsigned int i=0; i<num_misses && log_odds >= occ_prob_thres_log; ++i) {
+      log_odds += prob_miss_log;
+      if (log_odds < clamping_thres_min)
+        log_odds = clamping_thres_min;
     }
+    return log_odds;
   }
 
   void OcTreeStamped::updateNodeLogOdds(OcTreeNodeStamped* node, const float& update) const {
+    unsigned int now = getCurrentTime();
+    if (decay_interval > 0)
+      node->setLogOdds(decayLogOdds(node, now)); // apply the decay until now first
     OccupancyOcTreeBase<OcTreeNodeStamped>::updateNodeLogOdds(node, update);
-    node->updateTimestamp();
+    node->setTimestamp(now);
   }
 
   void OcTreeStamped::integrateMissNoTime(OcTreeNodeStamped* node) const{
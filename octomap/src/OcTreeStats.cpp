@@ -0,0 +1,244 @@
+/*
+ * OctoMap - An Efficient Probabilistic 3D Mapping Framework Based on Octrees
+ * http://octomap.github.com/
+ *
+ * Copyright (c) 2009-2013, K.M. Wurm and A. Hornung, University of Freiburg
+ * All rights reserved.
+ * License: New BSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University of Freiburg nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "octomap/OcTreeStats.h"
+
+namespace octomap {
+
+  const uint64_t OcTreeNodeStats::volume_scale;
+
+  void OcTreeNodeStats::updateStatsChildren() {
+    occupied_volume = 0;
+    free_volume = 0;
+    if (children == NULL)
+      return;
+
+    bool first = true;
+    for (unsigned int i=0; i<8; i++) {
+      if (children[i] != NULL) {
+        const OcTreeNodeStats* child = static_cast<const OcTreeNodeStats*>(children[i]);
+        // a child covers an eighth of this node
+        occupied_volume += child->getOccupiedVolume() >> 3;
+        free_volume += child->getFreeVolume() >> 3;
+        if (first || child->getMinLogOdds() < min_log_odds)
+          min_log_odds = child->getMinLogOdds();
+        if (first || child->getMaxLogOdds() > max_log_odds)
+          max_log_odds = child->getMaxLogOdds();
+        first = false;
+      }
+    }
+  }
+
+
+  OcTreeStats::OcTreeStats(double in_resolution)
+   : OccupancyOcTreeBase<OcTreeNodeStats>(in_resolution) {
+    ocTreeStatsMemberInit.ensureLinking();
+  }
+
+  bool OcTreeStats::checkBBX(const OcTreeKey& min_key, const OcTreeKey& max_key, const char* function) const {
+    for (unsigned int i=0; i<3; ++i) {
+      if (min_key[i] > max_key[i]) {
+        OCTOMAP_ERROR("Error in %s: min key is larger than max key\n", function);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool OcTreeStats::getStatsBBX(const OcTreeKey& min_key, const OcTreeKey& max_key, BBXStats& stats) const {
+    stats.occupied = 0;
+    stats.free = 0;
+    stats.min_log_odds = std::numeric_limits<float>::quiet_NaN();
+    stats.max_log_odds = std::numeric_limits<float>::quiet_NaN();
+    if (!checkBBX(min_key, max_key, "getStatsBBX"))
+      return false;
+
+    if (root != NULL)
+      getStatsBBXRecurs(root, 0, OcTreeKey(0, 0, 0), min_key, max_key, stats);
+
+    stats.unknown = uint64_t(max_key[0] - min_key[0] + 1) * uint64_t(max_key[1] - min_key[1] + 1)
+                    * uint64_t(max_key[2] - min_key[2] + 1) - stats.occupied - stats.free;
+    return true;
+  }
+
+  bool OcTreeStats::getStatsBBX(const point3d& min, const point3d& max, BBXStats& stats) const {
+    OcTreeKey min_key, max_key;
+    if (!coordToKeyChecked(min, min_key) || !coordToKeyChecked(max, max_key)) {
+      OCTOMAP_ERROR_STR("Error in getStatsBBX: [" << min << "] - [" << max << "] is out of OcTree bounds!");
+      return false;
+    }
+    return getStatsBBX(min_key, max_key, stats);
+  }
+
+  bool OcTreeStats::anyOccupiedBBX(const OcTreeKey& min_key, const OcTreeKey& max_key) const {
+    if (!checkBBX(min_key, max_key, "anyOccupiedBBX") || root == NULL)
+      return false;
+    return anyBBXRecurs(root, 0, OcTreeKey(0, 0, 0), min_key, max_key, OCCUPIED);
+  }
+
+  bool OcTreeStats::anyFreeBBX(const OcTreeKey& min_key, const OcTreeKey& max_key) const {
+    if (!checkBBX(min_key, max_key, "anyFreeBBX") || root == NULL)
+      return false;
+    return anyBBXRecurs(root, 0, OcTreeKey(0, 0, 0), min_key, max_key, FREE);
+  }
+
+  bool OcTreeStats::anyUnknownBBX(const OcTreeKey& min_key, const OcTreeKey& max_key) const {
+    if (!checkBBX(min_key, max_key, "anyUnknownBBX"))
+      return false;
+    if (root == NULL)
+      return true;
+    return anyBBXRecurs(root, 0, OcTreeKey(0, 0, 0), min_key, max_key, UNKNOWN);
+  }
+
+  std::istream& OcTreeStats::readData(std::istream &s) {
+    OccupancyOcTreeBase<OcTreeNodeStats>::readData(s);
+    updateInnerOccupancy();
+    return s;
+  }
+
+  std::istream& OcTreeStats::readBinaryData(std::istream &s) {
+    OccupancyOcTreeBase<OcTreeNodeStats>::readBinaryData(s);
+    updateInnerOccupancy();
+    return s;
+  }
+
+  void OcTreeStats::getStatsBBXRecurs(const OcTreeNodeStats* node, unsigned int depth, const OcTreeKey& node_min_key,
+                                      const OcTreeKey& min_key, const OcTreeKey& max_key, BBXStats& stats) const {
+    const unsigned int node_size = 1 << (tree_depth - depth);
+    bool inside = true;
+    uint64_t overlap = 1;
+    for (unsigned int i=0; i<3; ++i) {
+      unsigned int lo = std::max((unsigned int) node_min_key[i], (unsigned int) min_key[i]);
+      unsigned int hi = std::min((unsigned int) node_min_key[i] + node_size - 1, (unsigned int) max_key[i]);
+      inside = inside && lo == node_min_key[i] && hi == node_min_key[i] + node_size - 1;
+      overlap *= hi - lo + 1;
+    }
+
+    const bool leaf = !nodeHasChildren(node);
+    if (inside || leaf) {
+      // volumes of the node are fractions of 8^(tree_depth-depth) voxels
+      const uint64_t known = leaf ? overlap : node->getKnownVolume() >> (3 * depth);
+      if (known == 0)
+        return;
+
+      const float min_log_odds = node->getMinLogOdds();
+      const float max_log_odds = node->getMaxLogOdds();
+      bool counted = true;
+      if (min_log_odds >= occ_prob_thres_log)
+        stats.occupied += known;
+      else if (max_log_odds < occ_prob_thres_log)
+        stats.free += known;
+      else if (occ_prob_thres_log == 0.0f) {
+        // the stored volumes use the default threshold
+        stats.occupied += node->getOccupiedVolume() >> (3 * depth);
+        stats.free += node->getFreeVolume() >> (3 * depth);
+      }
+      else
+        counted = false; // mixed inner node and a different threshold
+
+      if (counted) {
+        // comparisons with NaN are false: the first value is always taken
+        if (!(stats.min_log_odds <= min_log_odds))
+          stats.min_log_odds = min_log_odds;
+        if (!(stats.max_log_odds >= max_log_odds))
+          stats.max_log_odds = max_log_odds;
+        return;
+      }
+    }
+
+    const unsigned int child_size = node_size >> 1;
+    OcTreeKey child_min_key;
+    for (unsigned int i=0; i<8; ++i) {
+      if (!nodeChildExists(node, i))
+        continue;
+
+      bool overlaps = true;
+      for (unsigned int j=0; j<3 && overlaps; ++j) {
+        unsigned int child_min = node_min_key[j] + ((i & (1 << j)) ? child_size : 0);
+        child_min_key[j] = key_type(child_min);
+        overlaps = (child_min <= max_key[j]) && (child_min + child_size - 1 >= min_key[j]);
+      }
+
+      if (overlaps)
+        getStatsBBXRecurs(getNodeChild(node, i), depth+1, child_min_key, min_key, max_key, stats);
+    }
+  }
+
+  bool OcTreeStats::anyBBXRecurs(const OcTreeNodeStats* node, unsigned int depth, const OcTreeKey& node_min_key,
+                                 const OcTreeKey& min_key, const OcTreeKey& max_key, VoxelClass voxel_class) const {
+    const bool leaf = !nodeHasChildren(node);
+    if (voxel_class == OCCUPIED && node->getMaxLogOdds() < occ_prob_thres_log)
+      return false;
+    if (voxel_class == FREE && node->getMinLogOdds() >= occ_prob_thres_log)
+      return false;
+    if (voxel_class == UNKNOWN && leaf)
+      return false;
+
+    const unsigned int node_size = 1 << (tree_depth - depth);
+    bool inside = true;
+    for (unsigned int i=0; i<3 && inside; ++i)
+      inside = node_min_key[i] >= min_key[i] && node_min_key[i] + node_size - 1 <= max_key[i];
+
+    // a leaf of the requested class overlaps the box, or the whole subtree is inside
+    if (leaf || inside)
+      return (voxel_class != UNKNOWN) || node->getKnownVolume() < OcTreeNodeStats::volume_scale;
+
+    const unsigned int child_size = node_size >> 1;
+    OcTreeKey child_min_key;
+    for (unsigned int i=0; i<8; ++i) {
+      bool overlaps = true;
+      for (unsigned int j=0; j<3 && overlaps; ++j) {
+        unsigned int child_min = node_min_key[j] + ((i & (1 << j)) ? child_size : 0);
+        child_min_key[j] = key_type(child_min);
+        overlaps = (child_min <= max_key[j]) && (child_min + child_size - 1 >= min_key[j]);
+      }
+      if (!overlaps)
+        continue;
+
+      if (!nodeChildExists(node, i)) {
+        if (voxel_class == UNKNOWN)
+          return true;
+        continue;
+      }
+      if (anyBBXRecurs(getNodeChild(node, i), depth+1, child_min_key, min_key, max_key, voxel_class))
+        return true;
+    }
+    return false;
+  }
+
+  OcTreeStats::StaticMemberInitializer OcTreeStats::ocTreeStatsMemberInit;
+
+} // end namespace
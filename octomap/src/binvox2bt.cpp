@@ -229,8 +229,8 @@ int main(int argc, char **argv)
         cout.flush();
 
         // read voxel data
-        byte value;
-        byte count;
+        unsigned char value;
+        unsigned char count;
         int index = 0;
         int end_index = 0;
         unsigned nr_voxels = 0;
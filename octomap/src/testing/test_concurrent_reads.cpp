@@ -0,0 +1,212 @@
+// Stress test and throughput benchmark for the concurrent read mode
+// (OcTreeBaseImpl::enableConcurrentReads): one thread keeps modifying the tree
+// while several threads query it.
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <sys/time.h>
+
+#include <octomap/octomap.h>
+#include "testing.h"
+
+using namespace std;
+using namespace octomap;
+
+static const double res = 0.1;
+// static region, never modified by the writer
+static const point3d static_min(-2.0f, -2.0f, -2.0f);
+static const point3d static_max(-1.0f, -1.0f, -1.0f);
+// region toggled between free and occupied, always known
+static const point3d toggle_min(0.0f, 0.0f, 0.0f);
+static const point3d toggle_max(0.8f, 0.8f, 0.8f);
+// region in which nodes are created and deleted again
+static const point3d create_min(2.0f, 0.0f, 0.0f);
+static const point3d create_max(2.8f, 0.8f, 0.8f);
+
+double timediff(const timeval& start, const timeval& stop){
+  return (stop.tv_sec - start.tv_sec) + 1.0e-6 *(stop.tv_usec - start.tv_usec);
+}
+
+void setBox(OcTree& tree, const point3d& min, const point3d& max, float log_odds){
+  for (float x = min.x() + res/2; x < max.x(); x += res)
+    for (float y = min.y() + res/2; y < max.y(); y += res)
+      for (float z = min.z() + res/2; z < max.z(); z += res)
+        tree.setNodeValue(point3d(x, y, z), log_odds);
+}
+
+void deleteBox(OcTree& tree, const point3d& min, const point3d& max){
+  for (float x = min.x() + res/2; x < max.x(); x += res)
+    for (float y = min.y() + res/2; y < max.y(); y += res)
+      for (float z = min.z() + res/2; z < max.z(); z += res)
+        tree.deleteNode(point3d(x, y, z));
+}
+
+Pointcloud makeScan(const point3d& origin, double range, int steps){
+  Pointcloud cloud;
+  for (int i = 0; i < steps; ++i){
+    for (int j = 0; j < steps; ++j){
+      double yaw = 2.0 * M_PI * i / steps;
+      double pitch = M_PI * (j + 0.5) / steps - M_PI/2;
+      cloud.push_back(origin + point3d(float(range * cos(pitch) * cos(yaw)),
+                                       float(range * cos(pitch) * sin(yaw)),
+                                       float(range * sin(pitch))));
+    }
+  }
+  return cloud;
+}
+
+struct ReaderStats {
+  ReaderStats() : queries(0), errors(0) {}
+  size_t queries;
+  size_t errors;
+};
+
+void reader(const OcTree* tree, const std::atomic<bool>* running, ReaderStats* stats, unsigned int seed){
+  const float clamp_min = tree->getClampingThresMinLog();
+  const float clamp_max = tree->getClampingThresMaxLog();
+  while (running->load()){
+    OcTree::ReadGuard guard(*tree);
+    for (int i = 0; i < 100; ++i){
+      seed = seed * 1103515245 + 12345;
+      float u = float((seed >> 8) % 1000) / 1000.0f;
+      seed = seed * 1103515245 + 12345;
+      float v = float((seed >> 8) % 1000) / 1000.0f;
+
+      // static region: always occupied
+      point3d p_static = static_min + (static_max - static_min) * u;
+      OcTreeNode* node = tree->search(p_static);
+      if (!node || !tree->isNodeOccupied(node))
+        stats->errors++;
+
+      // toggled region: always known, exactly free or occupied
+      point3d p_toggle(toggle_min.x() + (toggle_max.x() - toggle_min.x()) * u,
+                       toggle_min.y() + (toggle_max.y() - toggle_min.y()) * v,
+                       toggle_min.z() + (toggle_max.z() - toggle_min.z()) * u * v);
+      node = tree->search(p_toggle);
+      if (!node || (node->getLogOdds() != clamp_min && node->getLogOdds() != clamp_max))
+        stats->errors++;
+
+      // created / deleted region: unknown or occupied, never partially initialized
+      point3d p_create(create_min.x() + (create_max.x() - create_min.x()) * v,
+                       create_min.y() + (create_max.y() - create_min.y()) * u,
+                       create_min.z() + (create_max.z() - create_min.z()) * v);
+      node = tree->search(p_create);
+      if (node && node->getLogOdds() != clamp_max)
+        stats->errors++;
+
+      // ray into the static region has to hit it
+      point3d end;
+      point3d origin(-1.5f + u * 0.4f, -1.5f, 1.0f);
+      if (!tree->castRay(origin, point3d(0.0f, 0.0f, -1.0f), end, true, 10.0)
+          || end.z() > static_max.z())
+        stats->errors++;
+
+      stats->queries += 4;
+    }
+  }
+}
+
+// holds a guard for a moment, more of these than reader slots have to take turns
+void shortReader(const OcTree* tree, std::atomic<unsigned int>* done){
+  OcTree::ReadGuard guard(*tree);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  if (tree->search(static_min) != NULL)
+    (*done)++;
+}
+
+// writer: modifies all regions except the static one, returns time used
+double writer(OcTree& tree, int iterations){
+  timeval start, stop;
+  gettimeofday(&start, NULL);
+  const float clamp_min = tree.getClampingThresMinLog();
+  const float clamp_max = tree.getClampingThresMaxLog();
+  Pointcloud scan = makeScan(point3d(6.0f, 6.0f, 6.0f), 3.0, 60);
+  for (int i = 0; i < iterations; ++i){
+    // toggling expands and prunes the region
+    setBox(tree, toggle_min, toggle_max, (i % 2) ? clamp_min : clamp_max);
+    setBox(tree, create_min, create_max, clamp_max);
+    tree.insertPointCloud(scan, point3d(6.0f, 6.0f, 6.0f));
+    deleteBox(tree, create_min, create_max);
+    if (i % 4 == 3)
+      tree.prune();
+  }
+  gettimeofday(&stop, NULL);
+  return timediff(start, stop);
+}
+
+void initTree(OcTree& tree){
+  setBox(tree, static_min, static_max, tree.getClampingThresMaxLog());
+  setBox(tree, toggle_min, toggle_max, tree.getClampingThresMinLog());
+}
+
+int main(int argc, char** argv) {
+  int iterations = 10;
+  if (argc > 1)
+    iterations = atoi(argv[1]);
+  unsigned int num_readers = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+
+  // reference: writer without readers
+  double time_alone;
+  {
+    OcTree tree(res);
+    initTree(tree);
+    tree.enableConcurrentReads(true);
+    time_alone = writer(tree, iterations);
+  }
+
+  OcTree tree(res);
+  initTree(tree);
+  tree.enableConcurrentReads(true);
+  EXPECT_TRUE(tree.isConcurrentReadsEnabled());
+
+  std::atomic<bool> running(true);
+  std::vector<ReaderStats> stats(num_readers);
+  std::vector<std::thread> readers;
+  timeval start, stop;
+  gettimeofday(&start, NULL);
+  for (unsigned int i = 0; i < num_readers; ++i)
+    readers.push_back(std::thread(reader, &tree, &running, &stats[i], 17 + i));
+
+  double time_concurrent = writer(tree, iterations);
+  running = false;
+  for (unsigned int i = 0; i < num_readers; ++i)
+    readers[i].join();
+  gettimeofday(&stop, NULL);
+
+  size_t queries = 0;
+  size_t errors = 0;
+  for (unsigned int i = 0; i < num_readers; ++i){
+    queries += stats[i].queries;
+    errors += stats[i].errors;
+  }
+  double elapsed = timediff(start, stop);
+
+  printf("Writer: %d iterations in %f s alone, %f s with %u concurrent readers\n",
+         iterations, time_alone, time_concurrent, num_readers);
+  printf("Readers: %zu queries in %f s (%.0f queries/s), %zu errors\n",
+         queries, elapsed, queries / elapsed, errors);
+
+  EXPECT_EQ(errors, size_t(0));
+  EXPECT_TRUE(queries > 0);
+
+  // the tree is consistent after concurrent operation
+  EXPECT_EQ(tree.size(), tree.calcNumNodes());
+
+  // more concurrent guards than reader slots
+  std::atomic<unsigned int> done(0);
+  const unsigned int num_short_readers = OcTree::max_concurrent_readers + 16;
+  readers.clear();
+  for (unsigned int i = 0; i < num_short_readers; ++i)
+    readers.push_back(std::thread(shortReader, &tree, &done));
+  for (unsigned int i = 0; i < num_short_readers; ++i)
+    readers[i].join();
+  EXPECT_EQ(done.load(), num_short_readers);
+  tree.enableConcurrentReads(false);
+  EXPECT_FALSE(tree.isConcurrentReadsEnabled());
+
+  std::cerr << "Test successful.\n";
+  return 0;
+}
@@ -207,6 +207,69 @@ void boundingBoxTest(OcTree* tree){
     }
 
   }
+
+  // bulk extraction into arrays must yield the same leafs:
+  std::vector<point3d> centers;
+  std::vector<float> sizes, logOdds;
+  EXPECT_EQ(tree->getLeafsBBX(bbxMinKey, bbxMaxKey, centers, sizes, logOdds), count);
+  EXPECT_EQ(centers.size(), count);
+  EXPECT_EQ(sizes.size(), count);
+  EXPECT_EQ(logOdds.size(), count);
+  size_t numOccupied = 0;
+  for (size_t i = 0; i < centers.size(); ++i){
+    OcTreeKey key = tree->coordToKey(centers[i]);
+    KeyVolumeMap::iterator bbxIt = bbxVoxels.find(key);
+    EXPECT_FALSE(bbxIt == bbxVoxels.end());
+    EXPECT_FLOAT_EQ(sizes[i], bbxIt->second);
+    EXPECT_EQ(logOdds[i], tree->search(key)->getLogOdds());
+    if (tree->isNodeOccupied(tree->search(key)))
+      numOccupied++;
+  }
+
+  centers.clear(); sizes.clear(); logOdds.clear();
+  EXPECT_EQ(tree->getLeafsBBX(bbxMinKey, bbxMaxKey, centers, sizes, logOdds, true), numOccupied);
+  for (size_t i = 0; i < centers.size(); ++i){
+    EXPECT_TRUE(logOdds[i] >= tree->getOccupancyThresLog());
+  }
+  std::cout << "Bulk bounding box extraction: " << numOccupied << " occupied leaf nodes\n";
+
+  // dense grid at finest level must match search() for every key:
+  std::vector<int8_t> grid;
+  std::vector<bool> bits;
+  unsigned int sx, sy, sz;
+  EXPECT_TRUE(tree->getOccupancyGridBBX(bbxMinKey, bbxMaxKey, grid, sx, sy, sz));
+  EXPECT_TRUE(tree->getOccupancyBitsBBX(bbxMinKey, bbxMaxKey, bits, sx, sy, sz));
+  EXPECT_EQ(grid.size(), size_t(sx)*sy*sz);
+  EXPECT_EQ(bits.size(), grid.size());
+  OcTreeKey key;
+  for (unsigned int z = 0; z < sz; ++z){
+    for (unsigned int y = 0; y < sy; ++y){
+      for (unsigned int x = 0; x < sx; ++x){
+        key = OcTreeKey(bbxMinKey[0] + x, bbxMinKey[1] + y, bbxMinKey[2] + z);
+        OcTreeNode* node = tree->search(key);
+        int8_t expected = node ? (tree->isNodeOccupied(node) ? 1 : 0) : -1;
+        size_t idx = x + sx*(y + sy*z);
+        EXPECT_EQ(int(grid[idx]), int(expected));
+        EXPECT_EQ(bool(bits[idx]), (expected != 0));
+      }
+    }
+  }
+
+  // coarse grid: each cell is occupied if any finer cell is
+  unsigned int depth = tree->getTreeDepth() - 2;
+  unsigned int csx, csy, csz;
+  EXPECT_TRUE(tree->getOccupancyGridBBX(bbxMinKey, bbxMaxKey, grid, csx, csy, csz, depth));
+  for (unsigned int z = 0; z < csz; ++z){
+    for (unsigned int y = 0; y < csy; ++y){
+      for (unsigned int x = 0; x < csx; ++x){
+        OcTreeKey cellKey = tree->adjustKeyAtDepth(bbxMinKey, depth);
+        cellKey = OcTreeKey(cellKey[0] + (x << 2), cellKey[1] + (y << 2), cellKey[2] + (z << 2));
+        OcTreeNode* node = tree->search(cellKey, depth);
+        int8_t expected = node ? (tree->isNodeOccupied(node) ? 1 : 0) : -1;
+        EXPECT_EQ(int(grid[x + csx*(y + csy*z)]), int(expected));
+      }
+    }
+  }
 }
 
 int main(int argc, char** argv) {
@@ -25,6 +25,109 @@ OcTree* generateSphereTree(point3d origin, float radius){
 	return tree;
 }
 
+// reference implementations: linear search over all submaps
+bool isOccupiedLinear(MapCollection<MapNode<OcTree> >& coll, const point3d& p){
+  for (MapCollection<MapNode<OcTree> >::iterator it = coll.begin(); it != coll.end(); ++it) {
+    OcTreeNode* n = (*it)->getMap()->search((*it)->getOrigin().inv().transform(p));
+    if (n && (*it)->getMap()->isNodeOccupied(n))
+      return true;
+  }
+  return false;
+}
+
+bool castRayLinear(MapCollection<MapNode<OcTree> >& coll, const point3d& origin, const point3d& direction,
+                   point3d& end, double maxRange){
+  bool hit = false;
+  double min_dist = 1e6;
+  for (MapCollection<MapNode<OcTree> >::iterator it = coll.begin(); it != coll.end(); ++it) {
+    point3d origin_trans = (*it)->getOrigin().inv().transform(origin);
+    point3d direction_trans = (*it)->getOrigin().inv().rot().rotate(direction);
+    point3d temp_end;
+    if ((*it)->getMap()->castRay(origin_trans, direction_trans, temp_end, true, maxRange)) {
+      double dist = origin_trans.distance(temp_end);
+      if (dist < min_dist) {
+        min_dist = dist;
+        end = (*it)->getOrigin().transform(temp_end);
+      }
+      hit = true;
+    }
+  }
+  return hit;
+}
+
+// many small submaps (boxes with an occupied top) in a rotated grid
+void testManySubmaps(){
+  MapCollection<MapNode<OcTree> > coll;
+  for (int i = 0; i < 10; ++i) {
+    for (int j = 0; j < 10; ++j) {
+      OcTree* tree = new OcTree(0.1);
+      for (float x = -0.5f; x < 0.5f; x += 0.1f)
+        for (float y = -0.5f; y < 0.5f; y += 0.1f)
+          for (float z = 0.05f; z < 0.5f; z += 0.1f)
+            tree->updateNode(point3d(x + 0.05f, y + 0.05f, z), z > 0.4f);
+      MapNode<OcTree>* node = new MapNode<OcTree>(tree, pose6d(i * 1.5, j * 1.5, 0.1 * i, 0.0, 0.0, 0.3 * j));
+      coll.addNode(node);
+    }
+  }
+
+  for (float x = -1.0f; x < 15.0f; x += 0.37f) {
+    for (float y = -1.0f; y < 15.0f; y += 0.41f) {
+      for (float z = -0.2f; z < 1.6f; z += 0.23f) {
+        point3d p (x, y, z);
+        EXPECT_EQ (coll.isOccupied(p), isOccupiedLinear(coll, p));
+      }
+      // rays from above and sideways
+      point3d origins[2] = {point3d(x, y, 5.0f), point3d(-3.0f, y, 0.47f + 0.03f * x)};
+      point3d directions[2] = {point3d(0.1f, 0.05f, -1.0f), point3d(1.0f, 0.02f * x, 0.0f)};
+      for (int r = 0; r < 2; ++r) {
+        point3d end, end_linear;
+        bool hit = coll.castRay(origins[r], directions[r], end, true, 20.0);
+        EXPECT_EQ (hit, castRayLinear(coll, origins[r], directions[r], end_linear, 20.0));
+        if (hit)
+          EXPECT_TRUE ((end - end_linear).norm() < 1e-4);
+      }
+    }
+  }
+}
+
+// moving a submap or changing its map updates the index
+void testChangedSubmaps(){
+  MapCollection<MapNode<OcTree> > coll;
+  std::vector<MapNode<OcTree>*> nodes;
+  for (int i = 0; i < 4; ++i) {
+    OcTree* tree = new OcTree(0.1);
+    for (float x = -0.5f; x < 0.5f; x += 0.1f)
+      for (float y = -0.5f; y < 0.5f; y += 0.1f)
+        tree->updateNode(point3d(x + 0.05f, y + 0.05f, 0.05f), true);
+    nodes.push_back(new MapNode<OcTree>(tree, pose6d(i * 2.0, 0.0, 0.0, 0.0, 0.0, 0.0)));
+    coll.addNode(nodes.back());
+  }
+
+  const point3d moved_point(1.0f, 5.0f, 0.05f);
+  const point3d ray_origin(1.0f, 5.0f, 3.0f);
+  const point3d ray_direction(0.0f, 0.0f, -1.0f);
+  point3d end;
+  EXPECT_TRUE (coll.isOccupied(point3d(2.0f, 0.0f, 0.05f)));
+  EXPECT_FALSE (coll.isOccupied(moved_point));
+  EXPECT_FALSE (coll.castRay(ray_origin, ray_direction, end, true, 10.0));
+
+  // move submap 1 from (2,0,0) to (1,5,0)
+  nodes[1]->setOrigin(pose6d(1.0, 5.0, 0.0, 0.0, 0.0, 0.0));
+  EXPECT_FALSE (coll.isOccupied(point3d(2.0f, 0.0f, 0.05f)));
+  EXPECT_TRUE (coll.isOccupied(moved_point));
+  EXPECT_TRUE (coll.castRay(ray_origin, ray_direction, end, true, 10.0));
+  EXPECT_TRUE ((end - point3d(1.05f, 5.05f, 0.05f)).norm() < 0.1f);
+  EXPECT_EQ (coll.queryNode(moved_point), nodes[1]);
+
+  // extend the map of submap 3 beyond its bounding box
+  const point3d extended_point(6.0f, 3.0f, 1.0f);
+  EXPECT_FALSE (coll.isOccupied(extended_point));
+  nodes[3]->getMap()->updateNode(point3d(0.05f, 3.05f, 1.05f), true);
+  nodes[3]->mapChanged();
+  EXPECT_TRUE (coll.isOccupied(extended_point));
+  EXPECT_EQ (coll.isOccupied(extended_point), isOccupiedLinear(coll, extended_point));
+}
+
 int main(int argc, char** argv) {
 
   // //Generate a MapCollection
@@ -137,5 +240,12 @@ int main(int argc, char** argv) {
   }
 
 
+  // indexed queries match a linear search
+  for (std::vector<point3d>::iterator it = query.begin(); it != query.end(); ++it)
+    EXPECT_EQ (collection.isOccupied(*it), isOccupiedLinear(collection, *it));
+
+  testManySubmaps();
+  testChangedSubmaps();
+
   return 0;
 }
@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include <string>
+#include <sstream>
+#include <map>
+#include <iterator>
 #ifdef _WIN32
   #include <Windows.h>  // to define Sleep()
 #else
@@ -9,13 +12,37 @@
 
 #include <octomap/octomap.h>
 #include <octomap/OcTreeStamped.h>
+#include <octomap/OcTreeStats.h>
+#include <octomap/ColorOcTree.h>
+#include <octomap/CountingOcTree.h>
+#include <octomap/OcTreeQuantized.h>
+#include <octomap/CountingOcTree.h>
+#include <octomap/FrontierTracker.h>
+#include <octomap/MCTables.h>
 #include <octomap/math/Utils.h>
 #include "testing.h"
+#ifdef __GLIBC__
+  #include <malloc.h>   // mallinfo2()
+#endif
  
 using namespace std;
 using namespace octomap;
 using namespace octomath;
 
+// point of pixel (u, v) at depth d of a pinhole camera at pose
+point3d pixelToPoint(const pose6d& pose, double fx, double fy, double cx, double cy,
+                     double u, double v, double d) {
+  return pose.transform(point3d(float((u - cx) * d / fx), float((v - cy) * d / fy), float(d)));
+}
+
+// 1: occupied, 0: free, -1: unknown
+int occupancyAt(const OcTree& tree, const point3d& p) {
+  OcTreeNode* node = tree.search(p);
+  if (!node)
+    return -1;
+  return tree.isNodeOccupied(node) ? 1 : 0;
+}
+
 int main(int argc, char** argv) {
 
   if (argc != 2){
@@ -200,6 +227,1217 @@ int main(int argc, char** argv) {
     EXPECT_FLOAT_EQ (0.025, p_inv.y());
     EXPECT_FLOAT_EQ (0.025, p_inv.z());
 
+  // ------------------------------------------------------------
+  } else if (test_name == "MergeTrees") {
+    const double res = 0.1;
+    OcTree tree_a (res);
+    OcTree tree_b (res);
+    // a: solid occupied cube (pruned) next to a free slab
+    for (int x=0; x<8; x++)
+      for (int y=0; y<8; y++)
+        for (int z=0; z<8; z++) {
+          tree_a.updateNode(point3d(x*res+0.05, y*res+0.05, z*res+0.05), true);
+          tree_a.updateNode(point3d(x*res+0.05, y*res+0.05, -z*res-0.05), false);
+        }
+    // b: sparse pattern partially overlapping a
+    for (int x=-4; x<12; x++)
+      for (int y=-4; y<12; y++)
+        for (int z=-4; z<12; z++) {
+          if ((x+y+z) % 3 == 0)
+            tree_b.updateNode(point3d(x*res+0.05, y*res+0.05, z*res+0.05), (x+z) % 2 == 0);
+        }
+    EXPECT_TRUE (tree_a.getNumLeafNodes() < 8*8*8*2);
+
+    OcTree merged (tree_a);
+    EXPECT_TRUE (merged.merge(tree_b));
+    merged.expand();
+    EXPECT_EQ (merged.size(), merged.calcNumNodes());
+
+    OcTree shifted (tree_a);
+    const int shift[3] = {3, 0, -2};
+    EXPECT_TRUE (shifted.merge(tree_b, pose6d(shift[0]*res, shift[1]*res, shift[2]*res, 0, 0, 0)));
+    EXPECT_EQ (shifted.size(), shifted.calcNumNodes());
+
+    const float clamp_min = tree_a.getClampingThresMinLog();
+    const float clamp_max = tree_a.getClampingThresMaxLog();
+    OcTreeKey start_key = tree_a.coordToKey(point3d(-1.0, -1.0, -1.0));
+    for (key_type x=start_key[0]; x<start_key[0]+30; x++)
+      for (key_type y=start_key[1]; y<start_key[1]+30; y++)
+        for (key_type z=start_key[2]; z<start_key[2]+30; z++) {
+          OcTreeNode* node_a = tree_a.search(OcTreeKey(x, y, z));
+          OcTreeNode* node_b = tree_b.search(OcTreeKey(x, y, z));
+          OcTreeNode* node_b_shifted = tree_b.search(OcTreeKey(x-shift[0], y-shift[1], z-shift[2]));
+
+          OcTreeNode* node_merged = merged.search(OcTreeKey(x, y, z));
+          if (!node_a && !node_b) {
+            EXPECT_FALSE (node_merged);
+          } else {
+            EXPECT_TRUE (node_merged);
+            float expected = 0.0f;
+            if (node_a) expected += node_a->getLogOdds();
+            if (node_b) expected += node_b->getLogOdds();
+            expected = std::min(std::max(expected, clamp_min), clamp_max);
+            EXPECT_FLOAT_EQ (expected, node_merged->getLogOdds());
+          }
+
+          OcTreeNode* node_shifted = shifted.search(OcTreeKey(x, y, z));
+          if (!node_a && !node_b_shifted) {
+            EXPECT_FALSE (node_shifted);
+          } else {
+            EXPECT_TRUE (node_shifted);
+            float expected = 0.0f;
+            if (node_a) expected += node_a->getLogOdds();
+            if (node_b_shifted) expected += node_b_shifted->getLogOdds();
+            expected = std::min(std::max(expected, clamp_min), clamp_max);
+            EXPECT_FLOAT_EQ (expected, node_shifted->getLogOdds());
+          }
+        }
+
+    // merging into an empty tree yields a copy
+    OcTree empty (res);
+    EXPECT_TRUE (empty.merge(tree_a));
+    EXPECT_TRUE (empty == tree_a);
+
+    // invalid merges
+    OcTree coarse (0.2);
+    EXPECT_FALSE (merged.merge(coarse));
+    EXPECT_FALSE (merged.merge(tree_b, pose6d(0.05, 0, 0, 0, 0, 0)));
+    EXPECT_FALSE (merged.merge(tree_b, pose6d(0, 0, 0, 0.5, 0, 0)));
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Snapshot") {
+    OcTree* tree = new OcTree(0.05);
+    for (int x=-20; x<20; x++)
+      for (int y=-20; y<20; y++)
+        for (int z=-20; z<20; z++) {
+          point3d p ((float) x*0.05f+0.01f, (float) y*0.05f+0.01f, (float) z*0.05f+0.01f);
+          tree->updateNode(p, z < 0);
+        }
+    OcTree reference (*tree); // deep copy
+
+    OcTree snapshot (0.1);
+    snapshot.updateNode(point3d(5.0, 5.0, 5.0), true); // previous content is discarded
+    tree->snapshot(snapshot);
+    EXPECT_TRUE (snapshot == reference);
+    EXPECT_EQ (snapshot.getResolution(), tree->getResolution());
+    EXPECT_TRUE (snapshot.getRoot() != tree->getRoot());
+    EXPECT_TRUE (tree->nodeHasChildren(tree->getRoot()));
+    EXPECT_EQ (snapshot.getNodeChild(snapshot.getRoot(), 0), tree->getNodeChild(tree->getRoot(), 0));
+
+    // apply the same modifications to the deep copy and the shared tree
+    OcTree expected (reference);
+    OcTree* trees[2] = {tree, &expected};
+    for (unsigned int t=0; t<2; ++t) {
+      trees[t]->updateNode(point3d(0.11f, 0.11f, 0.11f), false);
+      trees[t]->updateNode(point3d(3.0f, 3.0f, 3.0f), true);
+      trees[t]->setNodeValue(point3d(-0.51f, 0.21f, -0.31f), 0.0f);
+      for (int i=0; i<20; i++)
+        trees[t]->updateNode(point3d(-0.99f + i*0.05f, 0.51f, -0.21f), true, true);
+      trees[t]->updateInnerOccupancy();
+      trees[t]->deleteNode(point3d(0.51f, -0.51f, 0.51f));
+      trees[t]->searchUnshared(trees[t]->coordToKey(point3d(0.21f, 0.21f, -0.21f)))->setLogOdds(0.5f);
+      trees[t]->prune();
+    }
+    EXPECT_TRUE (*tree == expected);
+    EXPECT_TRUE (snapshot == reference);
+
+    // snapshot outlives the original tree, and can be modified itself
+    delete tree;
+    EXPECT_TRUE (snapshot == reference);
+    OcTree second (0.05);
+    snapshot.snapshot(second);
+    snapshot.updateNode(point3d(-0.26f, 0.26f, 0.26f), true);
+    EXPECT_TRUE (second == reference);
+    EXPECT_FALSE (snapshot == reference);
+    snapshot.clear();
+    EXPECT_TRUE (second == reference);
+
+    // derived trees modifying payload directly
+    ColorOcTree color_tree (0.05);
+    point3d p (0.11f, 0.11f, 0.11f);
+    color_tree.updateNode(p, true);
+    color_tree.setNodeColor(color_tree.coordToKey(p), 10, 20, 30);
+    ColorOcTree color_snapshot (0.05);
+    color_tree.snapshot(color_snapshot);
+    color_tree.setNodeColor(color_tree.coordToKey(p), 40, 50, 60);
+    EXPECT_TRUE (color_snapshot.search(p)->getColor() == ColorOcTreeNode::Color(10, 20, 30));
+    EXPECT_TRUE (color_tree.search(p)->getColor() == ColorOcTreeNode::Color(40, 50, 60));
+
+  // ------------------------------------------------------------
+  } else if (test_name == "NodeSize") {
+    // nodes only hold the children pointer and their payload, additional
+    // bookkeeping (e.g. for snapshots) must not grow them
+    if (sizeof(void*) == 8) {
+      EXPECT_EQ (sizeof(OcTreeNode), 16);
+      EXPECT_EQ (sizeof(ColorOcTreeNode), 16);
+      EXPECT_EQ (sizeof(OcTreeNodeStamped), 24); // timestamp and min_timestamp
+      EXPECT_EQ (sizeof(CountingOcTreeNode), 16);
+      EXPECT_EQ (sizeof(OcTreeDataNode<float>), 16);
+      EXPECT_EQ (sizeof(OcTreeNodeQuantized), 16);
+    }
+    EXPECT_TRUE (sizeof(OcTreeNode) <= 2*sizeof(void*));
+    EXPECT_TRUE (sizeof(CountingOcTreeNode) <= 2*sizeof(void*));
+
+  // ------------------------------------------------------------
+  } else if (test_name == "QuantizedTree") {
+    // same scan inserted into a float and a quantized tree
+    Pointcloud scan;
+    point3d origin (0.01f, 0.01f, 0.02f);
+    for (int i=-30; i<30; i++)
+      for (int j=-30; j<30; j++)
+        scan.push_back(point3d(2.01f, 0.03f*i, 0.03f*j));
+    OcTree tree (0.05);
+    OcTreeQuantized qtree (0.05);
+    for (int k=0; k<3; k++) {
+      tree.insertPointCloud(scan, origin);
+      qtree.insertPointCloud(scan, origin);
+    }
+    EXPECT_EQ (qtree.size(), tree.size());
+    const float eps = 4.0f / OcTreeNodeQuantized::log_odds_scale;
+    for (OcTree::leaf_iterator it = tree.begin_leafs(), end = tree.end_leafs(); it != end; ++it) {
+      OcTreeNodeQuantized* node = qtree.search(it.getKey(), it.getDepth());
+      EXPECT_TRUE (node);
+      EXPECT_TRUE (fabs(node->getLogOdds() - it->getLogOdds()) < eps);
+      EXPECT_EQ (qtree.isNodeOccupied(node), tree.isNodeOccupied(*it));
+    }
+
+    // saturating integer updates stop at the clamping thresholds
+    point3d p (0.51f, 0.51f, 0.51f);
+    for (int i=0; i<20; i++)
+      qtree.updateNode(p, true);
+    EXPECT_TRUE (qtree.isNodeAtThreshold(qtree.search(p)));
+    EXPECT_EQ (qtree.search(p)->getValue(), OcTreeNodeQuantized::quantize(qtree.getClampingThresMaxLog()));
+    for (int i=0; i<20; i++)
+      qtree.updateNode(p, false);
+    EXPECT_EQ (qtree.search(p)->getValue(), OcTreeNodeQuantized::quantize(qtree.getClampingThresMinLog()));
+    EXPECT_EQ (OcTreeNodeQuantized::quantize(1000.0), std::numeric_limits<int16_t>::max());
+
+    // conversion from and to OcTree
+    tree.setProbHit(0.8);
+    OcTreeQuantized converted (tree);
+    EXPECT_EQ (converted.size(), tree.size());
+    EXPECT_TRUE (fabs(converted.getProbHit() - 0.8) < 1e-3);
+    OcTree back (0.1);
+    converted.toOcTree(back);
+    EXPECT_EQ (back.size(), tree.size());
+    EXPECT_EQ (back.getResolution(), tree.getResolution());
+    EXPECT_TRUE (fabs(back.getProbHit() - 0.8) < 1e-3);
+    for (OcTree::leaf_iterator it = tree.begin_leafs(), end = tree.end_leafs(); it != end; ++it) {
+      OcTreeNode* node = back.search(it.getKey(), it.getDepth());
+      EXPECT_TRUE (node);
+      EXPECT_TRUE (fabs(node->getLogOdds() - it->getLogOdds()) < 1.0f / OcTreeNodeQuantized::log_odds_scale);
+    }
+
+    // read back through the AbstractOcTree factory
+    EXPECT_TRUE (converted.write("quantized.ot"));
+    AbstractOcTree* read_tree = AbstractOcTree::read("quantized.ot");
+    EXPECT_TRUE (read_tree);
+    EXPECT_EQ (read_tree->getTreeType(), "OcTreeQuantized");
+    OcTreeQuantized* read_qtree = dynamic_cast<OcTreeQuantized*>(read_tree);
+    EXPECT_TRUE (read_qtree);
+    EXPECT_TRUE (*read_qtree == converted);
+    delete read_tree;
+    remove("quantized.ot");
+
+
+  // ------------------------------------------------------------
+  } else if (test_name == "QuantizedMemory") {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    // checkerboard volume, which cannot be pruned
+    OcTree tree (0.05);
+    for (int x=0; x<40; x++)
+      for (int y=0; y<40; y++)
+        for (int z=0; z<40; z++)
+          tree.updateNode(point3d(x*0.05f+0.01f, y*0.05f+0.01f, z*0.05f+0.01f), (x+y+z) % 2 == 0, true);
+    tree.updateInnerOccupancy();
+
+    // the same map needs considerably less heap with pooled quantized nodes
+    // (the first quantized tree in this process, so the pool starts empty)
+    OcTreeQuantized quantized_map (0.05);
+    size_t heap_before = mallinfo2().uordblks;
+    quantized_map.fromOcTree(tree);
+    size_t quantized_heap = mallinfo2().uordblks - heap_before;
+    OcTree float_map (0.05);
+    heap_before = mallinfo2().uordblks;
+    quantized_map.toOcTree(float_map);
+    size_t float_heap = mallinfo2().uordblks - heap_before;
+    std::cout << "Heap for " << float_map.size() << " nodes: " << float_heap << " bytes (OcTree), "
+              << quantized_heap << " bytes (OcTreeQuantized)" << std::endl;
+    EXPECT_EQ (quantized_map.size(), tree.size());
+    EXPECT_TRUE (quantized_heap < 0.7 * float_heap);
+#endif
+
+  // ------------------------------------------------------------
+  } else if (test_name == "BBXUpdate") {
+    // bulk box operations have to match per-voxel updates
+    OcTree tree (0.05);
+    for (int i=0; i<50; i++) {
+      point3d p (-0.5f + 0.023f*i, 0.3f - 0.017f*i, 0.011f*i);
+      tree.updateNode(p, i%3 == 0);
+    }
+    OcTreeKey min_key = tree.coordToKey(point3d(-0.31f, -0.22f, 0.01f));
+    OcTreeKey max_key = tree.coordToKey(point3d(0.42f, 0.13f, 0.67f));
+
+    for (unsigned int mode=0; mode<4; ++mode) {
+      bool set_value = mode < 2;
+      bool unknown_only = (mode % 2) == 1;
+      float value = set_value ? 1.2f : -0.7f;
+      OcTree bulk (tree);
+      OcTree reference (tree);
+      reference.enableChangeDetection(true);
+      bulk.enableChangeDetection(true);
+      if (set_value)
+        bulk.setNodeValueBBX(min_key, max_key, value, unknown_only);
+      else
+        bulk.updateNodeBBX(min_key, max_key, value, unknown_only);
+
+      OcTreeKey k;
+      for (k[0] = min_key[0]; k[0] <= max_key[0]; ++k[0])
+        for (k[1] = min_key[1]; k[1] <= max_key[1]; ++k[1])
+          for (k[2] = min_key[2]; k[2] <= max_key[2]; ++k[2]) {
+            if (unknown_only && reference.search(k))
+              continue;
+            if (set_value)
+              reference.setNodeValue(k, value);
+            else
+              reference.updateNode(k, value);
+          }
+
+      bulk.prune();
+      reference.prune();
+      EXPECT_TRUE (bulk == reference);
+      EXPECT_EQ (bulk.size(), bulk.calcNumNodes());
+      EXPECT_TRUE (bulk.numChangesDetected() > 0);
+    }
+
+    // large box: cost and size depend on its surface only
+    OcTree large (0.05);
+    large.setNodeValueBBX(point3d(-10.0f, -10.0f, -10.0f), point3d(10.0f, 10.0f, 10.0f),
+                          large.getClampingThresMaxLog());
+    large.updateNodeBBX(point3d(-9.0f, -9.0f, -9.0f), point3d(9.0f, 9.0f, 9.0f),
+                        large.getProbMissLog() * 10);
+    EXPECT_TRUE (large.size() < 2000000);
+    EXPECT_TRUE (large.isNodeOccupied(large.search(point3d(9.99f, 0.0f, 0.0f))));
+    EXPECT_FALSE (large.isNodeOccupied(large.search(point3d(0.0f, 0.0f, 0.0f))));
+    EXPECT_FALSE (large.search(point3d(10.2f, 0.0f, 0.0f)));
+    EXPECT_EQ (large.size(), large.calcNumNodes());
+
+  // ------------------------------------------------------------
+  } else if (test_name == "MultiResInsert") {
+    OcTree tree (0.05);
+    // rays at a coarser depth step through adjacent nodes of that depth
+    KeyRay ray, ray_coarse;
+    point3d ray_origin (0.01f, 0.02f, 0.03f);
+    point3d ray_end (3.3f, -2.1f, 1.7f);
+    EXPECT_TRUE (tree.computeRayKeys(ray_origin, ray_end, ray));
+    EXPECT_TRUE (tree.computeRayKeys(ray_origin, ray_end, ray_coarse, 14));
+    EXPECT_TRUE (ray_coarse.size() > 0);
+    EXPECT_TRUE (ray_coarse.size() < ray.size());
+    EXPECT_TRUE (*ray_coarse.begin() == tree.coordToKey(ray_origin, 14));
+    for (KeyRay::iterator it = ray_coarse.begin(); it != ray_coarse.end(); ++it) {
+      EXPECT_TRUE (*it == tree.adjustKeyAtDepth(*it, 14));
+      if (it != ray_coarse.begin()) {
+        KeyRay::iterator prev = it - 1;
+        int steps = abs(int((*it)[0]) - int((*prev)[0])) + abs(int((*it)[1]) - int((*prev)[1]))
+                    + abs(int((*it)[2]) - int((*prev)[2]));
+        EXPECT_EQ (steps, 4);
+      }
+    }
+
+    // within the full resolution range, the result equals insertPointCloud()
+    Pointcloud near_scan;
+    for (int i=0; i<40; ++i)
+      for (int j=0; j<20; ++j) {
+        double yaw = 2.0 * M_PI * i / 40.0;
+        double pitch = M_PI * (j + 0.5) / 20.0 - M_PI/2;
+        near_scan.push_back(point3d(float(3.0 * cos(pitch) * cos(yaw)), float(3.0 * cos(pitch) * sin(yaw)),
+                                    float(3.0 * sin(pitch))));
+      }
+    point3d sensor_origin (0.01f, 0.02f, 0.03f);
+    RangeDepthPolicy policy (5.0, 12);
+    EXPECT_EQ (policy.getDepth(1.0), (unsigned) 16);
+    EXPECT_EQ (policy.getDepth(7.0), (unsigned) 15);
+    EXPECT_EQ (policy.getDepth(25.0), (unsigned) 13);
+    EXPECT_EQ (policy.getDepth(100.0), (unsigned) 12);
+    OcTree reference (0.05);
+    reference.insertPointCloud(near_scan, sensor_origin);
+    OcTree multires (0.05);
+    multires.insertPointCloudMultiRes(near_scan, sensor_origin, policy);
+    EXPECT_TRUE (multires == reference);
+
+    // far measurements are integrated as coarse nodes
+    Pointcloud far_scan;
+    for (int i=0; i<60; ++i)
+      for (int j=0; j<30; ++j)
+        far_scan.push_back(point3d(25.0f, -6.0f + 0.2f*i, -3.0f + 0.2f*j));
+    reference.insertPointCloud(far_scan, sensor_origin);
+    multires.enableChangeDetection(true);
+    multires.insertPointCloudMultiRes(far_scan, sensor_origin, policy);
+    EXPECT_EQ (multires.size(), multires.calcNumNodes());
+    EXPECT_TRUE (multires.size() < reference.size());
+    EXPECT_TRUE (multires.numChangesDetected() > 0);
+    for (size_t i=0; i<far_scan.size(); i+=97) {
+      OcTreeNode* node = multires.search(far_scan[i]);
+      EXPECT_TRUE (node);
+      EXPECT_TRUE (multires.isNodeOccupied(node));
+      // endpoint is a leaf at depth 13
+      EXPECT_TRUE (node == multires.search(far_scan[i], 13));
+      EXPECT_FALSE (multires.nodeHasChildren(node));
+      // halfway to the sensor, space is free
+      OcTreeNode* free_node = multires.search(sensor_origin + (far_scan[i] - sensor_origin) * 0.5);
+      EXPECT_TRUE (free_node);
+      EXPECT_FALSE (multires.isNodeOccupied(free_node));
+    }
+    // near field is unchanged by far measurements
+    OcTreeNode* near_node = multires.search(near_scan[5]);
+    EXPECT_TRUE (near_node);
+    EXPECT_TRUE (multires.isNodeOccupied(near_node));
+
+    // invalid policy: depth increasing with range
+    RangeDepthPolicy invalid;
+    invalid.addLevel(0.0, 14);
+    invalid.addLevel(5.0, 16);
+    EXPECT_FALSE (invalid.isValid(16));
+    size_t size_before = multires.size();
+    multires.insertPointCloudMultiRes(far_scan, sensor_origin, invalid);
+    EXPECT_EQ (multires.size(), size_before);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "DepthImage") {
+    // camera (optical frame) at (0.1, 0.2, 0.5) looking along +x
+    pose6d sensor_pose (0.1, 0.2, 0.5, -M_PI/2, 0.0, -M_PI/2);
+    const unsigned int width = 160, height = 120;
+    const double fx = 130.0, fy = 130.0, cx = 79.5, cy = 59.5;
+    std::vector<float> depth (width * height);
+    for (unsigned int v=0; v<height; ++v)
+      for (unsigned int u=0; u<width; ++u) {
+        float d = 3.0f;                           // wall
+        if (u > 25 && u < 50 && v > 25 && v < 50) // box in front of the wall
+          d = 2.0f;
+        if (u >= 100 && u < 115)                  // no measurements
+          d = (v % 2) ? 0.0f : std::numeric_limits<float>::quiet_NaN();
+        if (v >= 100)                             // beyond max_depth
+          d = 10.0f;
+        depth[v*width + u] = d;
+      }
+    const double max_depth = 5.0;
+
+    // without pixels beyond max_depth: free space is (almost) a subset of ray
+    // tracing all pixels, endpoints are the same
+    OcTree tree (0.05);
+    std::vector<float> depth_in_range (depth);
+    Pointcloud cloud;
+    for (unsigned int v=0; v<height; ++v)
+      for (unsigned int u=0; u<width; ++u) {
+        float d = depth[v*width + u];
+        if (d > 0.0f && d <= max_depth)
+          cloud.push_back(pixelToPoint(sensor_pose, fx, fy, cx, cy, u, v, d));
+        else
+          depth_in_range[v*width + u] = 0.0f;
+      }
+    KeySet free_image, occupied_image, free_rays, occupied_rays;
+    tree.computeDepthImageUpdate(&depth_in_range[0], width, height, fx, fy, cx, cy, sensor_pose, 0.0, max_depth, 1,
+                                 free_image, occupied_image);
+    tree.computeUpdate(cloud, sensor_pose.trans(), free_rays, occupied_rays, -1.0);
+    EXPECT_EQ (occupied_image.size(), occupied_rays.size());
+    size_t common = 0;
+    for (KeySet::iterator it = free_image.begin(); it != free_image.end(); ++it)
+      if (free_rays.find(*it) != free_rays.end())
+        ++common;
+    EXPECT_TRUE (free_image.size() > 0);
+    EXPECT_TRUE (common > free_image.size() * 0.95);
+    EXPECT_TRUE (common > free_rays.size() * 0.8);
+
+    tree.enableChangeDetection(true);
+    tree.insertDepthImage(&depth[0], width, height, fx, fy, cx, cy, sensor_pose, 0.0, max_depth);
+    EXPECT_EQ (tree.size(), tree.calcNumNodes());
+    EXPECT_TRUE (tree.numChangesDetected() > 0);
+    // wall, box and the space in front of them
+    EXPECT_EQ (occupancyAt(tree, pixelToPoint(sensor_pose, fx, fy, cx, cy, 70, 70, 3.0)), 1);
+    EXPECT_EQ (occupancyAt(tree, pixelToPoint(sensor_pose, fx, fy, cx, cy, 70, 70, 1.5)), 0);
+    EXPECT_EQ (occupancyAt(tree, pixelToPoint(sensor_pose, fx, fy, cx, cy, 37, 37, 2.0)), 1);
+    EXPECT_EQ (occupancyAt(tree, pixelToPoint(sensor_pose, fx, fy, cx, cy, 37, 37, 1.0)), 0);
+    EXPECT_EQ (occupancyAt(tree, pixelToPoint(sensor_pose, fx, fy, cx, cy, 37, 37, 2.6)), -1);
+    // no measurements: unknown
+    EXPECT_EQ (occupancyAt(tree, pixelToPoint(sensor_pose, fx, fy, cx, cy, 107, 60, 1.5)), -1);
+    // beyond max_depth: free up to max_depth, no endpoints
+    EXPECT_EQ (occupancyAt(tree, pixelToPoint(sensor_pose, fx, fy, cx, cy, 60, 110, 4.0)), 0);
+    EXPECT_EQ (occupancyAt(tree, pixelToPoint(sensor_pose, fx, fy, cx, cy, 60, 110, 6.0)), -1);
+
+    // downsampling uses fewer endpoints, but still clears the frustum
+    OcTree downsampled (0.05);
+    KeySet free_down, occupied_down;
+    downsampled.computeDepthImageUpdate(&depth[0], width, height, fx, fy, cx, cy, sensor_pose, 0.0, max_depth, 4,
+                                        free_down, occupied_down);
+    EXPECT_TRUE (occupied_down.size() < occupied_image.size());
+    downsampled.insertDepthImage(&depth[0], width, height, fx, fy, cx, cy, sensor_pose, 0.0, max_depth, 4);
+    EXPECT_EQ (occupancyAt(downsampled, pixelToPoint(sensor_pose, fx, fy, cx, cy, 70, 70, 1.5)), 0);
+    EXPECT_EQ (occupancyAt(downsampled, pixelToPoint(sensor_pose, fx, fy, cx, cy, 36, 36, 2.0)), 1);  // block of pixels 36..39
+
+    // min_depth: the box is ignored, but not the wall behind it
+    OcTree min_limited (0.05);
+    min_limited.insertDepthImage(&depth[0], width, height, fx, fy, cx, cy, sensor_pose, 2.5, max_depth);
+    EXPECT_EQ (occupancyAt(min_limited, pixelToPoint(sensor_pose, fx, fy, cx, cy, 37, 37, 2.0)), -1);
+    EXPECT_EQ (occupancyAt(min_limited, pixelToPoint(sensor_pose, fx, fy, cx, cy, 70, 70, 3.0)), 1);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "ClipRays") {
+    point3d clipped_origin, clipped_end;
+    point3d box_min (-1.0f, -1.0f, -1.0f), box_max (1.0f, 1.0f, 1.0f);
+    EXPECT_TRUE (OcTree::clipSegmentToBox(point3d(-3.0f, 0.5f, 0.0f), point3d(3.0f, 0.5f, 0.0f),
+                                          box_min, box_max, clipped_origin, clipped_end));
+    EXPECT_FLOAT_EQ (clipped_origin.x(), -1.0f);
+    EXPECT_FLOAT_EQ (clipped_end.x(), 1.0f);
+    EXPECT_FLOAT_EQ (clipped_end.y(), 0.5f);
+    // inside: unchanged
+    EXPECT_TRUE (OcTree::clipSegmentToBox(point3d(-0.5f, 0.0f, 0.2f), point3d(0.5f, 0.3f, 0.1f),
+                                          box_min, box_max, clipped_origin, clipped_end));
+    EXPECT_TRUE (clipped_origin == point3d(-0.5f, 0.0f, 0.2f));
+    EXPECT_TRUE (clipped_end == point3d(0.5f, 0.3f, 0.1f));
+    // parallel outside, ending before the box, passing by
+    EXPECT_FALSE (OcTree::clipSegmentToBox(point3d(-3.0f, 2.0f, 0.0f), point3d(3.0f, 2.0f, 0.0f),
+                                           box_min, box_max, clipped_origin, clipped_end));
+    EXPECT_FALSE (OcTree::clipSegmentToBox(point3d(-3.0f, 0.0f, 0.0f), point3d(-2.0f, 0.0f, 0.0f),
+                                           box_min, box_max, clipped_origin, clipped_end));
+    EXPECT_FALSE (OcTree::clipSegmentToBox(point3d(-3.0f, 0.0f, 0.0f), point3d(0.0f, 3.5f, 0.0f),
+                                           box_min, box_max, clipped_origin, clipped_end));
+
+    // rays leaving the map are clipped to its border
+    OcTree small_tree (0.01); // covers +-327.68m
+    KeyRay ray;
+    EXPECT_TRUE (small_tree.computeRayKeys(point3d(0.005f, 0.005f, 0.005f), point3d(400.0f, 0.005f, 0.005f), ray));
+    EXPECT_EQ (ray.size(), (size_t) 32768);
+    EXPECT_EQ ((*(ray.end()-1))[0], (key_type) 65535);
+    EXPECT_TRUE (small_tree.computeRayKeys(point3d(-400.0f, 0.005f, 0.005f), point3d(0.005f, 0.005f, 0.005f), ray));
+    EXPECT_EQ (ray.size(), (size_t) 32768);
+    EXPECT_EQ ((*ray.begin())[0], (key_type) 0);
+    EXPECT_FALSE (small_tree.computeRayKeys(point3d(400.0f, 400.0f, 0.0f), point3d(500.0f, 400.0f, 0.0f), ray));
+
+    // BBX mode: tracing only the part within the bbx gives the same cells as
+    // tracing the whole ray and keeping its end within the bbx
+    OcTree tree (0.05);
+    tree.setBBXMin(box_min);
+    tree.setBBXMax(box_max);
+    tree.useBBXLimit(true);
+    point3d origin (8.0f, 3.0f, 2.0f);
+    Pointcloud cloud;
+    for (int i=0; i<500; ++i)
+      cloud.push_back(point3d(-1.2f + 0.0049f*i, 0.9f - 0.0037f*i, -0.95f + 0.0041f*i));
+    KeySet free_cells, occupied_cells, reference_free;
+    tree.computeUpdate(cloud, origin, free_cells, occupied_cells, -1.0);
+    for (size_t i=0; i<cloud.size(); ++i) {
+      if (!tree.inBBX(cloud[i]) || !tree.computeRayKeys(origin, cloud[i], ray))
+        continue;
+      for (KeyRay::reverse_iterator rit = ray.rbegin(); rit != ray.rend() && tree.inBBX(*rit); ++rit)
+        reference_free.insert(*rit);
+    }
+    for (KeySet::iterator it = occupied_cells.begin(); it != occupied_cells.end(); ++it)
+      reference_free.erase(*it);
+    EXPECT_TRUE (free_cells.size() > 0);
+    EXPECT_EQ (free_cells.size(), reference_free.size());
+    for (KeySet::iterator it = free_cells.begin(); it != free_cells.end(); ++it)
+      EXPECT_TRUE (reference_free.find(*it) != reference_free.end());
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Collision") {
+    OcTree tree (0.1);
+    tree.setNodeValueBBX(point3d(-1.0f, -1.0f, -1.0f), point3d(2.95f, 2.95f, 1.95f), tree.getClampingThresMinLog());
+    tree.setNodeValueBBX(point3d(1.0f, 1.0f, 0.0f), point3d(1.95f, 1.95f, 0.95f), tree.getClampingThresMaxLog());
+    for (int i=0; i<40; ++i)
+      tree.updateNode(point3d(-0.95f + 0.097f*i, 2.5f - 0.061f*i, -0.8f + 0.043f*i), true);
+
+    // against the occupied box [1,2]x[1,2]x[0,1]
+    EXPECT_FALSE (tree.collidesSphere(point3d(0.5f, 1.5f, 0.5f), 0.45));
+    EXPECT_TRUE (tree.collidesSphere(point3d(0.5f, 1.5f, 0.5f), 0.55));
+    EXPECT_FALSE (tree.collidesBox(point3d(0.5f, 0.5f, 1.05f), point3d(2.5f, 2.5f, 1.5f)));
+    EXPECT_TRUE (tree.collidesBox(point3d(0.5f, 0.5f, 0.95f), point3d(2.5f, 2.5f, 1.5f)));
+    // rotated by 45 degrees: a face points to the box corner (axis-aligned bounds would collide)
+    EXPECT_FALSE (tree.collidesOrientedBox(pose6d(0.6, 0.6, 0.5, 0.0, 0.0, M_PI/4), point3d(0.3f, 0.3f, 0.3f)));
+    EXPECT_TRUE (tree.collidesOrientedBox(pose6d(0.85, 0.85, 0.5, 0.0, 0.0, M_PI/4), point3d(0.3f, 0.3f, 0.3f)));
+    EXPECT_FALSE (tree.collidesCapsule(point3d(0.5f, 0.5f, 0.5f), point3d(0.5f, 2.5f, 0.5f), 0.45));
+    EXPECT_TRUE (tree.collidesCapsule(point3d(0.5f, 0.5f, 0.5f), point3d(0.5f, 2.5f, 0.5f), 0.55));
+    // unknown space is not in collision
+    EXPECT_FALSE (tree.collidesSphere(point3d(10.0f, 10.0f, 10.0f), 2.0));
+
+    // hierarchical checks equal checking all occupied leafs
+    std::vector<CollisionShape> shapes;
+    for (int i=0; i<100; ++i) {
+      point3d c (-1.0f + 0.041f*i, 3.0f - 0.033f*i, -0.9f + 0.027f*i);
+      double r = 0.05 + 0.003 * (i % 40);
+      shapes.push_back(CollisionShape::sphere(c, r));
+      shapes.push_back(CollisionShape::box(c - point3d(float(r), float(r)*0.5f, 0.1f), c + point3d(0.1f, float(r), float(r))));
+      shapes.push_back(CollisionShape::orientedBox(pose6d(c.x(), c.y(), c.z(), 0.1*i, 0.3, -0.05*i),
+                                                   point3d(float(r), 0.5f*float(r), 0.2f)));
+      shapes.push_back(CollisionShape::capsule(c, c + point3d(0.3f, -0.2f, 0.01f*(i%7)), r));
+    }
+    unsigned int num_collisions = 0;
+    for (size_t i=0; i<shapes.size(); ++i) {
+      bool brute_force = false;
+      for (OcTree::leaf_iterator it = tree.begin_leafs(); it != tree.end_leafs() && !brute_force; ++it)
+        brute_force = tree.isNodeOccupied(*it) && shapes[i].intersectsCube(it.getCoordinate(), 0.5 * it.getSize());
+      EXPECT_EQ (tree.collides(shapes[i]), brute_force);
+      if (brute_force)
+        ++num_collisions;
+    }
+    EXPECT_TRUE (num_collisions > 20 && num_collisions < shapes.size() - 20);
+
+    // trajectory of a box-shaped robot, moving towards the occupied box
+    std::vector<CollisionShape> robot (1, CollisionShape::box(point3d(-0.2f, -0.2f, -0.2f), point3d(0.2f, 0.2f, 0.2f)));
+    std::vector<pose6d> trajectory;
+    for (int i=0; i<30; ++i)
+      trajectory.push_back(pose6d(-0.45 + 0.1*i, 1.5, 0.5, 0.0, 0.0, 0.0));
+    EXPECT_EQ (tree.firstCollision(trajectory, robot), 13);
+    trajectory.resize(13);
+    EXPECT_EQ (tree.firstCollision(trajectory, robot), -1);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "NearestOccupied") {
+    OcTree tree (0.1);
+    tree.setNodeValueBBX(point3d(-3.0f, -3.0f, -1.0f), point3d(2.95f, 2.95f, 0.95f), tree.getClampingThresMinLog());
+    // pruned occupied block and scattered voxels
+    tree.setNodeValueBBX(point3d(1.6f, 1.6f, 0.0f), point3d(2.35f, 2.35f, 0.75f), tree.getClampingThresMaxLog());
+    for (int i=0; i<60; ++i)
+      tree.setNodeValue(point3d(-2.9f + 0.091f*i, 2.7f - 0.087f*i, -0.9f + 0.029f*i), tree.getClampingThresMaxLog());
+
+    std::vector<point3d> queries;
+    for (int i=0; i<50; ++i)
+      queries.push_back(point3d(-4.0f + 0.17f*i, 3.5f - 0.13f*i, 1.5f - 0.05f*i));
+
+    std::vector<float> batch_distances;
+    tree.getNearestOccupiedDistances(queries, batch_distances);
+    EXPECT_EQ (batch_distances.size(), queries.size());
+
+    for (size_t q=0; q<queries.size(); ++q) {
+      // brute force: distances to all occupied leaf cubes
+      std::vector<float> all_distances;
+      for (OcTree::leaf_iterator it = tree.begin_leafs(); it != tree.end_leafs(); ++it) {
+        if (!tree.isNodeOccupied(*it))
+          continue;
+        double d_sq = 0.0;
+        for (unsigned int j=0; j<3; ++j) {
+          double d = fabs(queries[q](j) - it.getCoordinate()(j)) - 0.5 * it.getSize();
+          if (d > 0.0)
+            d_sq += d * d;
+        }
+        all_distances.push_back(float(sqrt(d_sq)));
+      }
+      std::sort(all_distances.begin(), all_distances.end());
+
+      point3d nearest;
+      float distance;
+      EXPECT_TRUE (tree.getNearestOccupied(queries[q], nearest, distance));
+      EXPECT_TRUE (fabs(distance - all_distances[0]) < 1e-4);
+      EXPECT_TRUE (fabs(batch_distances[q] - all_distances[0]) < 1e-4);
+      EXPECT_TRUE (tree.isNodeOccupied(tree.search(nearest)));
+
+      std::vector<point3d> centers;
+      std::vector<float> sizes, distances;
+      EXPECT_EQ (tree.getKNearestOccupied(queries[q], 5, centers, sizes, distances), (size_t) 5);
+      for (size_t i=0; i<5; ++i)
+        EXPECT_TRUE (fabs(distances[i] - all_distances[i]) < 1e-4);
+
+      // within a limited range
+      double max_distance = 0.5;
+      size_t num_in_range = std::upper_bound(all_distances.begin(), all_distances.end(), max_distance) - all_distances.begin();
+      EXPECT_EQ (tree.getKNearestOccupied(queries[q], 1000, centers, sizes, distances, max_distance), num_in_range);
+      EXPECT_EQ (tree.getNearestOccupied(queries[q], nearest, distance, max_distance), (num_in_range > 0));
+
+      centers.clear();
+      sizes.clear();
+      EXPECT_EQ (tree.getOccupiedInRadius(queries[q], max_distance, centers, sizes), num_in_range);
+    }
+
+    // free and unknown space only
+    OcTree free_tree (0.1);
+    free_tree.updateNode(point3d(1.0f, 1.0f, 1.0f), false);
+    point3d nearest;
+    float distance;
+    EXPECT_FALSE (free_tree.getNearestOccupied(point3d(0.0f, 0.0f, 0.0f), nearest, distance));
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Frontiers") {
+    OcTree tree (0.1);
+    tree.enableChangeDetection(true);
+    FrontierTracker<OcTree> frontier (tree);
+
+    Pointcloud scan;
+    for (int i=0; i<40; ++i)
+      for (int j=0; j<10; ++j)
+        scan.push_back(point3d(2.0f, -2.0f + 0.1f*i, -0.5f + 0.1f*j));
+    tree.insertPointCloud(scan, point3d(0.0f, 0.0f, 0.0f));
+    frontier.update();
+    EXPECT_TRUE (frontier.size() > 0);
+    EXPECT_EQ (tree.numChangesDetected(), (size_t) 0);
+
+    for (int step=0; step<2; ++step) {
+      // brute force: all free voxels with an unknown face neighbor
+      KeySet expected;
+      for (OcTree::leaf_iterator it = tree.begin_leafs(); it != tree.end_leafs(); ++it) {
+        if (tree.isNodeOccupied(*it))
+          continue;
+        unsigned int size = 1 << (tree.getTreeDepth() - it.getDepth());
+        OcTreeKey min_key = it.getIndexKey();
+        for (unsigned int x=0; x<size; ++x) for (unsigned int y=0; y<size; ++y) for (unsigned int z=0; z<size; ++z) {
+          OcTreeKey key (min_key[0]+x, min_key[1]+y, min_key[2]+z);
+          for (int n=0; n<6; ++n) {
+            OcTreeKey neighbor = key;
+            neighbor[n/2] += (n%2) ? 1 : -1;
+            if (!tree.search(neighbor)) {
+              expected.insert(key);
+              break;
+            }
+          }
+        }
+      }
+      EXPECT_EQ (frontier.size(), expected.size());
+      for (KeySet::const_iterator it = expected.begin(); it != expected.end(); ++it)
+        EXPECT_TRUE (frontier.isFrontier(*it));
+
+      FrontierTracker<OcTree> rebuilt (tree);
+      rebuilt.rebuild();
+      EXPECT_EQ (rebuilt.size(), expected.size());
+
+      std::vector<std::vector<OcTreeKey> > clusters;
+      frontier.getClusters(clusters);
+      EXPECT_TRUE (clusters.size() > 0);
+      size_t num_clustered = 0;
+      for (size_t i=0; i<clusters.size(); ++i)
+        num_clustered += clusters[i].size();
+      EXPECT_EQ (num_clustered, frontier.size());
+
+      // second scan from another viewpoint, tracked incrementally
+      scan.clear();
+      for (int i=0; i<30; ++i)
+        for (int j=0; j<10; ++j)
+          scan.push_back(point3d(-1.5f + 0.1f*i, 1.8f, -0.5f + 0.1f*j));
+      tree.insertPointCloud(scan, point3d(0.5f, -0.5f, 0.0f));
+      frontier.update();
+    }
+
+  // ------------------------------------------------------------
+  } else if (test_name == "UnknownSpace") {
+    OcTree tree (0.1);
+    Pointcloud scan;
+    for (int i=0; i<20; ++i)
+      for (int j=0; j<20; ++j)
+        scan.push_back(point3d(0.6f, -1.0f + 0.1f*i, -1.0f + 0.1f*j));
+    tree.insertPointCloud(scan, point3d(-0.35f, 0.05f, 0.05f));
+    tree.setNodeValueBBX(point3d(-0.75f, -0.75f, -0.75f), point3d(-0.45f, -0.45f, -0.45f), tree.getClampingThresMinLog());
+
+    point3d pmin (-0.75f, -0.75f, -0.75f);
+    point3d pmax (0.75f, 0.75f, 0.75f);
+    std::vector<point3d> centers;
+    std::vector<double> sizes;
+    tree.getUnknownBlocks(centers, sizes, pmin, pmax, 0, 13);
+    EXPECT_EQ (centers.size(), sizes.size());
+    for (size_t i=0; i<sizes.size(); ++i)
+      EXPECT_TRUE (sizes[i] <= tree.getNodeSize(13) + 1e-6);
+
+    std::vector<point3d> leaf_centers;
+    tree.getUnknownLeafCenters(leaf_centers, pmin, pmax);
+    point3d_list leaf_centers_list;
+    tree.getUnknownLeafCenters(leaf_centers_list, pmin, pmax);
+    EXPECT_EQ (leaf_centers_list.size(), leaf_centers.size());
+
+    // brute force: every unknown voxel is covered by exactly one block
+    OcTreeKey min_key = tree.coordToKey(pmin);
+    OcTreeKey max_key = tree.coordToKey(pmax);
+    size_t num_unknown = 0;
+    OcTreeKey key;
+    for (key[0] = min_key[0]; key[0] <= max_key[0]; ++key[0]) {
+      for (key[1] = min_key[1]; key[1] <= max_key[1]; ++key[1]) {
+        for (key[2] = min_key[2]; key[2] <= max_key[2]; ++key[2]) {
+          point3d p = tree.keyToCoord(key);
+          unsigned int num_covering = 0;
+          for (size_t i=0; i<centers.size(); ++i) {
+            point3d diff = p - centers[i];
+            if (fabs(diff.x()) < 0.5*sizes[i] && fabs(diff.y()) < 0.5*sizes[i] && fabs(diff.z()) < 0.5*sizes[i])
+              ++num_covering;
+          }
+          bool unknown = (tree.search(key) == NULL);
+          EXPECT_EQ (num_covering, (unknown ? 1u : 0u));
+          if (unknown)
+            ++num_unknown;
+        }
+      }
+    }
+    EXPECT_TRUE (num_unknown > 0);
+    EXPECT_TRUE (centers.size() < num_unknown);
+    EXPECT_EQ (leaf_centers.size(), num_unknown);
+
+    // an empty tree is a single unknown block
+    OcTree empty_tree (0.1);
+    centers.clear();
+    sizes.clear();
+    empty_tree.getUnknownBlocks(centers, sizes, point3d(-5000.0f, -5000.0f, -5000.0f), point3d(5000.0f, 5000.0f, 5000.0f));
+    EXPECT_EQ (centers.size(), (size_t) 1);
+    EXPECT_FLOAT_EQ (sizes[0], empty_tree.getNodeSize(0));
+
+    CountingOcTree counting_tree (0.1);
+    for (unsigned int i=0; i<10; ++i)
+      counting_tree.updateNode(point3d(0.05f*i, 0.0f, 0.0f));
+    std::vector<point3d> hit_centers;
+    counting_tree.getCentersMinHits(hit_centers, 2);
+    point3d_list hit_centers_list;
+    counting_tree.getCentersMinHits(hit_centers_list, 2);
+    EXPECT_EQ (hit_centers.size(), (size_t) 5);
+    EXPECT_EQ (hit_centers_list.size(), hit_centers.size());
+
+  // ------------------------------------------------------------
+  } else if (test_name == "SlidingWindow") {
+    OcTree tree (0.1);
+    srand(42);
+    for (unsigned int i=0; i<5000; ++i) {
+      point3d p ((rand() % 2000) * 0.01f - 10.0f, (rand() % 2000) * 0.01f - 10.0f, (rand() % 400) * 0.01f - 2.0f);
+      tree.updateNode(p, (rand() % 3) == 0);
+    }
+    tree.setNodeValueBBX(point3d(-3.0f, -3.0f, -1.0f), point3d(2.95f, 2.95f, 0.95f), tree.getClampingThresMinLog(), true);
+    tree.updateInnerOccupancy();
+    tree.prune();
+    OcTree reference (tree);
+    size_t num_leafs = tree.getNumLeafNodes();
+
+    // subtrees outside of the box are moved to the spill tree
+    OcTree spill (0.1);
+    point3d min (-4.0f, -2.0f, -1.0f), max (3.0f, 5.0f, 1.0f);
+    size_t num_removed = tree.cropBBX(min, max, &spill);
+    EXPECT_TRUE (num_removed > 0);
+    EXPECT_EQ (tree.size(), tree.calcNumNodes());
+    EXPECT_EQ (spill.size(), spill.calcNumNodes());
+    EXPECT_EQ (tree.getNumLeafNodes() + spill.getNumLeafNodes(), num_leafs);
+    OcTreeKey min_key = tree.coordToKey(min), max_key = tree.coordToKey(max);
+    for (OcTree::leaf_iterator it = tree.begin_leafs(); it != tree.end_leafs(); ++it) {
+      OcTreeKey key = it.getIndexKey();
+      unsigned int leaf_size = 1 << (tree.getTreeDepth() - it.getDepth());
+      for (unsigned int i=0; i<3; ++i) {
+        EXPECT_TRUE (key[i] <= max_key[i]);
+        EXPECT_TRUE (key[i] + leaf_size - 1 >= min_key[i]);
+      }
+    }
+    for (OcTree::leaf_iterator it = reference.begin_leafs(); it != reference.end_leafs(); ++it) {
+      OcTreeKey key = it.getIndexKey();
+      unsigned int leaf_size = 1 << (tree.getTreeDepth() - it.getDepth());
+      bool overlaps = true;
+      for (unsigned int i=0; i<3; ++i)
+        overlaps = overlaps && key[i] <= max_key[i] && key[i] + leaf_size - 1 >= min_key[i];
+      OcTreeNode* node = tree.search(it.getKey(), it.getDepth());
+      EXPECT_EQ ((node != NULL), overlaps);
+      if (node)
+        EXPECT_FLOAT_EQ (node->getLogOdds(), it->getLogOdds());
+    }
+
+    // the spilled subtrees can be stored on disk
+    std::stringstream spill_stream;
+    EXPECT_TRUE (spill.write(spill_stream));
+    OcTree* loaded_spill = dynamic_cast<OcTree*>(AbstractOcTree::read(spill_stream));
+    EXPECT_TRUE (loaded_spill);
+    EXPECT_TRUE (*loaded_spill == spill);
+
+    // sliding along, everything is restored when revisiting
+    const point3d half_size (3.0f, 3.0f, 2.0f);
+    EXPECT_TRUE (tree.moveWindow(point3d(2.0f, 2.0f, 0.0f), half_size, loaded_spill));
+    EXPECT_TRUE (tree.moveWindow(point3d(6.0f, 3.0f, 0.0f), half_size, loaded_spill));
+    EXPECT_TRUE (tree.moveWindow(point3d(-7.0f, -7.0f, 0.0f), half_size, loaded_spill));
+    EXPECT_EQ (tree.size(), tree.calcNumNodes());
+    EXPECT_EQ (loaded_spill->size(), loaded_spill->calcNumNodes());
+    EXPECT_EQ (tree.getNumLeafNodes() + loaded_spill->getNumLeafNodes(), num_leafs);
+    EXPECT_FALSE (tree.moveWindow(point3d(1e6f, 0.0f, 0.0f), half_size, loaded_spill));
+
+    tree.restoreBBX(*loaded_spill, point3d(-100.0f, -100.0f, -100.0f), point3d(100.0f, 100.0f, 100.0f));
+    EXPECT_EQ (loaded_spill->size(), (size_t) 0);
+    tree.updateInnerOccupancy();
+    EXPECT_TRUE (tree == reference);
+    delete loaded_spill;
+
+    // without spilling, memory is bounded by the window; snapshots are not affected
+    OcTree snapshot (0.1);
+    tree.snapshot(snapshot);
+    tree.cropBBX(min, max);
+    EXPECT_TRUE (tree.size() < reference.size());
+    EXPECT_TRUE (snapshot == reference);
+    tree.cropBBX(point3d(50.0f, 50.0f, 50.0f), point3d(51.0f, 51.0f, 51.0f));
+    EXPECT_EQ (tree.size(), (size_t) 0);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "StampedDecay") {
+    OcTreeStamped stamped_tree (0.1);
+    const float hit = stamped_tree.getProbHitLog();
+    const float miss = stamped_tree.getProbMissLog();
+    stamped_tree.setCurrentTime(100);
+    for (int x=0; x<10; x++)
+      for (int y=0; y<10; y++)
+        stamped_tree.updateNode(point3d(x*0.1f+0.05f, y*0.1f+0.05f, 0.05f), true);
+    stamped_tree.setCurrentTime(200);
+    for (int x=0; x<10; x++)
+      stamped_tree.updateNode(point3d(x*0.1f+0.05f, -1.05f, 0.05f), true);
+    EXPECT_EQ (stamped_tree.getLastUpdateTime(), 200u);
+    EXPECT_EQ (stamped_tree.getRoot()->getMinTimestamp(), 100u);
+
+    OcTreeStamped snapshot (0.1);
+    stamped_tree.snapshot(snapshot);
+
+    // only the leafs updated at time 100 are outdated
+    stamped_tree.setCurrentTime(250);
+    stamped_tree.degradeOutdatedNodes(100);
+    OcTreeNodeStamped* old_node = stamped_tree.search(point3d(0.55f, 0.55f, 0.05f));
+    OcTreeNodeStamped* new_node = stamped_tree.search(point3d(0.55f, -1.05f, 0.05f));
+    EXPECT_TRUE (old_node && new_node);
+    EXPECT_FLOAT_EQ (old_node->getLogOdds(), (hit + miss));
+    EXPECT_EQ (old_node->getTimestamp(), 100u);
+    EXPECT_FLOAT_EQ (new_node->getLogOdds(), hit);
+    EXPECT_FLOAT_EQ (stamped_tree.getRoot()->getLogOdds(), hit);
+    EXPECT_FLOAT_EQ (snapshot.search(point3d(0.55f, 0.55f, 0.05f))->getLogOdds(), hit);
+    for (OcTreeStamped::leaf_iterator it = stamped_tree.begin_leafs(); it != stamped_tree.end_leafs(); ++it)
+      EXPECT_FLOAT_EQ (it->getLogOdds(), ((it->getTimestamp() == 100u) ? (hit + miss) : hit));
+
+    // lazy decay: one miss per interval while occupied, applied on query and update
+    OcTreeStamped lazy_tree (0.1);
+    lazy_tree.setDecayInterval(10);
+    lazy_tree.setCurrentTime(100);
+    point3d p (0.05f, 0.05f, 0.05f);
+    lazy_tree.updateNode(p, true);
+    OcTreeNodeStamped* node = lazy_tree.search(p);
+    EXPECT_FLOAT_EQ (lazy_tree.getDecayedLogOdds(node), hit);
+    lazy_tree.setCurrentTime(125);
+    EXPECT_FLOAT_EQ (lazy_tree.getDecayedLogOdds(node), (hit + 2*miss));
+    EXPECT_TRUE (lazy_tree.isNodeOccupiedDecayed(node));
+    lazy_tree.setCurrentTime(1000);
+    float decayed = hit;
+    while (decayed >= 0.0f)
+      decayed += miss;
+    EXPECT_FLOAT_EQ (lazy_tree.getDecayedLogOdds(node), decayed);
+    EXPECT_FALSE (lazy_tree.isNodeOccupiedDecayed(node));
+    EXPECT_FLOAT_EQ (node->getLogOdds(), hit);
+    lazy_tree.updateNode(p, true);
+    EXPECT_FLOAT_EQ (node->getLogOdds(), (decayed + hit));
+    EXPECT_EQ (node->getTimestamp(), 1000u);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "ColorPointCloud") {
+    ColorOcTree reference (0.05);
+    ColorOcTree color_tree (0.05);
+    ColorOcTree lazy_tree (0.05);
+    ColorOcTree snapshot (0.05);
+    srand(42);
+    for (int s=0; s<3; s++) {
+      Pointcloud cloud;
+      std::vector<ColorOcTreeNode::Color> colors;
+      for (int i=0; i<2000; i++) {
+        cloud.push_back((rand()%200)*0.01f + 1.0f, (rand()%200)*0.01f - 1.0f, (rand()%40)*0.01f);
+        colors.push_back(ColorOcTreeNode::Color(rand()%256, rand()%256, rand()%256));
+      }
+      point3d origin (0.0f, 0.0f, 0.1f*s);
+      reference.insertPointCloud(cloud, origin, -1., true);
+      for (size_t i=0; i<cloud.size(); i++)
+        reference.integrateNodeColor(cloud[i].x(), cloud[i].y(), cloud[i].z(), colors[i].r, colors[i].g, colors[i].b);
+      reference.updateInnerOccupancy();
+      reference.prune();
+
+      color_tree.insertColoredPointCloud(cloud, colors, origin);
+      lazy_tree.insertColoredPointCloud(cloud, colors, origin, -1., true);
+      if (s == 0)
+        color_tree.snapshot(snapshot);
+    }
+    EXPECT_TRUE (color_tree == reference);
+    lazy_tree.updateInnerOccupancy();
+    lazy_tree.prune();
+    EXPECT_TRUE (lazy_tree == reference);
+
+    // the snapshot is not changed by later insertions
+    EXPECT_FALSE (snapshot == color_tree);
+    ColorOcTree first_scan (0.05);
+    srand(42);
+    Pointcloud cloud;
+    std::vector<ColorOcTreeNode::Color> colors;
+    for (int i=0; i<2000; i++) {
+      cloud.push_back((rand()%200)*0.01f + 1.0f, (rand()%200)*0.01f - 1.0f, (rand()%40)*0.01f);
+      colors.push_back(ColorOcTreeNode::Color(rand()%256, rand()%256, rand()%256));
+    }
+    first_scan.insertColoredPointCloud(cloud, colors, point3d(0.0f, 0.0f, 0.0f));
+    EXPECT_TRUE (snapshot == first_scan);
+
+    // number of colors has to match the number of points
+    colors.pop_back();
+    size_t num_nodes = first_scan.size();
+    first_scan.insertColoredPointCloud(cloud, colors, point3d(0.0f, 0.0f, 0.0f));
+    EXPECT_EQ (first_scan.size(), num_nodes);
+    EXPECT_TRUE (snapshot == first_scan);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "MarchingCubes") {
+    OcTree tree (0.1);
+    point3d center (0.05f, 0.05f, 0.05f);
+    tree.updateNode(center, true);
+    std::vector<point3d> vertices, normals;
+    std::vector<unsigned int> triangles;
+    // a single voxel: one vertex per face, normals pointing to free space
+    EXPECT_EQ (tree.getMesh(vertices, normals, triangles), 8u);
+    EXPECT_EQ (vertices.size(), 6u);
+    for (size_t i=0; i<vertices.size(); i++) {
+      point3d dir = vertices[i] - center;
+      EXPECT_FLOAT_EQ (dir.norm(), 0.05);
+      EXPECT_FLOAT_EQ (normals[i].dot(dir.normalized()), 1.0);
+    }
+    for (size_t i=0; i<triangles.size(); i+=3) {
+      const point3d& p1 = vertices[triangles[i]];
+      EXPECT_TRUE ((vertices[triangles[i+1]] - p1).cross(vertices[triangles[i+2]] - p1).dot(p1 - center) > 0.0);
+    }
+    // unknown space as occupied: the single voxel is inside
+    EXPECT_EQ (tree.getMesh(vertices, normals, triangles, true), 0u);
+
+    // random blob, including pruned nodes and free space
+    srand(7);
+    for (int i=0; i<3000; i++) {
+      point3d p ((rand()%40)*0.1f - 2.0f, (rand()%40)*0.1f - 2.0f, (rand()%20)*0.1f - 1.0f);
+      tree.updateNode(p, (rand()%3) != 0);
+    }
+    tree.setNodeValueBBX(point3d(-1.6f, -1.6f, -0.8f), point3d(-0.05f, -0.05f, 0.75f), tree.getClampingThresMaxLog());
+    tree.prune();
+    OcTreeKey min_key = tree.coordToKey(point3d(-1.0f, -1.5f, -0.5f));
+    OcTreeKey max_key = tree.coordToKey(point3d(1.5f, 1.0f, 0.5f));
+    for (int unknown=0; unknown<2; unknown++) {
+      size_t num_triangles = tree.getMeshBBX(min_key, max_key, vertices, normals, triangles, unknown == 1);
+      EXPECT_TRUE (num_triangles > 0);
+      EXPECT_EQ (triangles.size(), 3*num_triangles);
+      EXPECT_EQ (normals.size(), vertices.size());
+
+      // same as marching cubes with a search() per corner, outside of the BBX is unknown
+      size_t expected = 0;
+      for (int x=min_key[0]-1; x<=max_key[0]; x++) {
+        for (int y=min_key[1]-1; y<=max_key[1]; y++) {
+          for (int z=min_key[2]-1; z<=max_key[2]; z++) {
+            const int corners[8][3] = {{1,1,0}, {1,0,0}, {0,0,0}, {0,1,0}, {1,1,1}, {1,0,1}, {0,0,1}, {0,1,1}};
+            int cube_index = 0;
+            for (int k=0; k<8; k++) {
+              OcTreeKey key (x + corners[k][0], y + corners[k][1], z + corners[k][2]);
+              bool occupied = (unknown == 1);
+              bool in_bbx = true;
+              for (int j=0; j<3; j++)
+                in_bbx = in_bbx && key[j] >= min_key[j] && key[j] <= max_key[j];
+              OcTreeNode* node = in_bbx ? tree.search(key) : NULL;
+              if (node)
+                occupied = tree.isNodeOccupied(node);
+              if (occupied)
+                cube_index |= (1 << k);
+            }
+            for (int i=0; triTable[cube_index][i] != -1; i+=3)
+              expected++;
+          }
+        }
+      }
+      EXPECT_EQ (num_triangles, expected);
+
+      // closed surface: every edge is shared by two triangles, vertices are shared
+      std::map<std::pair<unsigned int, unsigned int>, int> edges;
+      for (size_t i=0; i<triangles.size(); i+=3) {
+        for (int k=0; k<3; k++) {
+          unsigned int a = triangles[i+k], b = triangles[i+(k+1)%3];
+          edges[std::make_pair(std::min(a, b), std::max(a, b))]++;
+        }
+      }
+      for (std::map<std::pair<unsigned int, unsigned int>, int>::iterator it = edges.begin(); it != edges.end(); ++it)
+        EXPECT_EQ (it->second % 2, 0);
+      EXPECT_TRUE (vertices.size() < triangles.size() / 2);
+    }
+
+    // the whole map in binary PLY and OBJ
+    size_t num_triangles = tree.getMesh(vertices, normals, triangles);
+    EXPECT_TRUE (tree.writeMesh("mesh.ply"));
+    EXPECT_TRUE (tree.writeMesh("mesh.obj"));
+    EXPECT_FALSE (tree.writeMesh("mesh.vrml"));
+    std::ifstream ply ("mesh.ply", std::ios_base::binary);
+    std::string line;
+    size_t num_vertices_read = 0, num_faces_read = 0;
+    while (std::getline(ply, line) && line != "end_header") {
+      std::istringstream fields (line);
+      std::string keyword, element;
+      fields >> keyword >> element;
+      if (keyword == "element" && element == "vertex")
+        fields >> num_vertices_read;
+      if (keyword == "element" && element == "face")
+        fields >> num_faces_read;
+    }
+    EXPECT_EQ (num_vertices_read, vertices.size());
+    EXPECT_EQ (num_faces_read, num_triangles);
+    std::vector<char> data ((std::istreambuf_iterator<char>(ply)), std::istreambuf_iterator<char>());
+    EXPECT_EQ (data.size(), 24*vertices.size() + 13*num_triangles);
+    std::ifstream obj ("mesh.obj");
+    size_t num_lines = 0;
+    while (std::getline(obj, line))
+      num_lines++;
+    EXPECT_EQ (num_lines, 1 + 2*vertices.size() + num_triangles);
+    ply.close();
+    obj.close();
+    remove("mesh.ply");
+    remove("mesh.obj");
+
+  // ------------------------------------------------------------
+  } else if (test_name == "Projection") {
+    OcTree tree (0.1);
+    // floor, a table (legs and top) and a free corridor with an unknown hole
+    for (int x=0; x<20; x++) {
+      for (int y=0; y<20; y++) {
+        tree.updateNode(point3d(x*0.1f+0.05f, y*0.1f+0.05f, 0.05f), true);
+        for (int z=1; z<15; z++)
+          if (!(x == 15 && y == 15) && !(x == 3 && z > 5))
+            tree.updateNode(point3d(x*0.1f+0.05f, y*0.1f+0.05f, z*0.1f+0.05f), false);
+      }
+    }
+    for (int z=1; z<8; z++)
+      tree.updateNode(point3d(0.55f, 0.55f, z*0.1f+0.05f), true);
+    for (int x=5; x<10; x++)
+      for (int y=5; y<10; y++)
+        tree.updateNode(point3d(x*0.1f+0.05f, y*0.1f+0.05f, 0.75f), true);
+    tree.prune();
+
+    OcTreeKey min_key = tree.coordToKey(point3d(0.05f, 0.05f, 0.05f));
+    OcTreeKey max_key = tree.coordToKey(point3d(1.95f, 1.95f, 1.45f));
+    std::vector<ProjectionCell> grid;
+    unsigned int size_x, size_y;
+    EXPECT_TRUE (tree.getProjectionBBX(min_key, max_key, 0.1, 0.5, grid, size_x, size_y));
+    EXPECT_EQ (size_x, 20u);
+    EXPECT_EQ (size_y, 20u);
+    EXPECT_EQ (grid.size(), 400u);
+    const ProjectionCell& leg = grid[5 + 20*5];
+    EXPECT_FLOAT_EQ (leg.min_z, 0.0);
+    EXPECT_FLOAT_EQ (leg.max_z, 0.8);
+    EXPECT_FLOAT_EQ (leg.obstacle_z, 0.1);
+    EXPECT_EQ (leg.occupancy, 1);
+    const ProjectionCell& table = grid[7 + 20*7];
+    EXPECT_FLOAT_EQ (table.max_z, 0.8);
+    EXPECT_FLOAT_EQ (table.obstacle_z, 0.7);
+    EXPECT_EQ (table.occupancy, 0);
+    const ProjectionCell& floor = grid[15 + 20*3];
+    EXPECT_FLOAT_EQ (floor.max_z, 0.1);
+    EXPECT_TRUE (floor.obstacle_z != floor.obstacle_z); // NaN: nothing above the ground
+    EXPECT_EQ (floor.occupancy, 0);
+    EXPECT_EQ (grid[15 + 20*15].occupancy, -1);
+    EXPECT_EQ (grid[3 + 20*10].occupancy, 0); // free in the band, unknown above
+
+    // coarser cells and band above everything
+    EXPECT_TRUE (tree.getProjectionBBX(min_key, max_key, 1.0, 1.4, grid, size_x, size_y, tree.getTreeDepth()-1));
+    EXPECT_EQ (size_x, 10u);
+    EXPECT_EQ (grid[2 + 10*2].occupancy, 0);
+    EXPECT_FLOAT_EQ (grid[2 + 10*2].max_z, 0.8);
+    EXPECT_TRUE (grid[2 + 10*2].obstacle_z != grid[2 + 10*2].obstacle_z);
+    EXPECT_EQ (grid[1 + 10*5].occupancy, 0); // free at x == 2, unknown at x == 3
+    EXPECT_FALSE (tree.getProjectionBBX(min_key, max_key, 1.0, 0.5, grid, size_x, size_y));
+
+    // incremental update from change detection
+    EXPECT_TRUE (tree.getProjectionBBX(min_key, max_key, 0.1, 0.5, grid, size_x, size_y));
+    EXPECT_EQ (tree.updateProjectionBBX(min_key, max_key, 0.1, 0.5, grid), 0u); // disabled
+    tree.enableChangeDetection(true);
+    for (int i=0; i<3; i++) {
+      tree.updateNode(point3d(1.55f, 1.55f, 0.35f), true);
+      tree.updateNode(point3d(0.75f, 0.75f, 0.75f), false);
+      tree.updateNode(point3d(0.05f, 0.05f, 2.05f), true); // outside of the BBX
+    }
+    EXPECT_EQ (tree.updateProjectionBBX(min_key, max_key, 0.1, 0.5, grid), 2u);
+    tree.resetChangeDetection();
+    std::vector<ProjectionCell> reference;
+    EXPECT_TRUE (tree.getProjectionBBX(min_key, max_key, 0.1, 0.5, reference, size_x, size_y));
+    for (size_t i=0; i<grid.size(); i++) {
+      EXPECT_EQ (grid[i].occupancy, reference[i].occupancy);
+      EXPECT_TRUE (grid[i].max_z == reference[i].max_z || (grid[i].max_z != grid[i].max_z && reference[i].max_z != reference[i].max_z));
+      EXPECT_TRUE (grid[i].obstacle_z == reference[i].obstacle_z || (grid[i].obstacle_z != grid[i].obstacle_z && reference[i].obstacle_z != reference[i].obstacle_z));
+    }
+    EXPECT_EQ (grid[15 + 20*15].occupancy, 1);
+    EXPECT_FLOAT_EQ (grid[15 + 20*15].obstacle_z, 0.3);
+    EXPECT_TRUE (grid[7 + 20*7].obstacle_z != grid[7 + 20*7].obstacle_z);
+
+  // ------------------------------------------------------------
+  } else if (test_name == "StatsQueries") {
+    OcTreeStats stats_tree (0.1);
+    OcTreeKey min_key (32760, 32760, 32760);
+    OcTreeKey max_key (32770, 32770, 32770);
+    OcTreeStats::BBXStats stats;
+    EXPECT_TRUE (stats_tree.getStatsBBX(min_key, max_key, stats));
+    EXPECT_EQ (stats.unknown, 1331u);
+    EXPECT_TRUE (stats_tree.anyUnknownBBX(min_key, max_key));
+    EXPECT_FALSE (stats_tree.anyOccupiedBBX(min_key, max_key));
+    EXPECT_FALSE (stats_tree.getStatsBBX(max_key, min_key, stats));
+
+    // lazy updates, pruned blocks and a deleted subtree
+    srand(11);
+    for (int i=0; i<20000; i++) {
+      point3d p ((rand()%60)*0.1f - 3.0f, (rand()%60)*0.1f - 3.0f, (rand()%30)*0.1f - 1.0f);
+      stats_tree.updateNode(p, (rand()%3) == 0, true);
+    }
+    stats_tree.updateInnerOccupancy();
+    stats_tree.setNodeValueBBX(point3d(-3.2f, -3.2f, -1.6f), point3d(-1.65f, -1.65f, -0.85f),
+                               stats_tree.getClampingThresMaxLog());
+    stats_tree.setNodeValueBBX(point3d(1.6f, 1.6f, 0.0f), point3d(3.15f, 3.15f, 0.75f),
+                               stats_tree.getClampingThresMinLog());
+    stats_tree.deleteNode(point3d(0.05f, 0.05f, 0.05f), stats_tree.getTreeDepth()-3);
+    stats_tree.prune();
+
+    std::stringstream stream;
+    EXPECT_TRUE (stats_tree.write(stream));
+    AbstractOcTree* read_tree = AbstractOcTree::read(stream);
+    OcTreeStats* stats_tree_read = dynamic_cast<OcTreeStats*>(read_tree);
+    EXPECT_TRUE (stats_tree_read);
+
+    for (int t=0; t<3; t++) {
+      OcTreeStats* tree = (t == 2) ? stats_tree_read : &stats_tree;
+      tree->setOccupancyThres((t == 1) ? 0.7 : 0.5);
+      for (int q=0; q<100; q++) {
+        for (int i=0; i<3; i++) {
+          int a = 32768 - 40 + rand()%80, b = 32768 - 40 + rand()%80;
+          min_key[i] = key_type(std::min(a, b));
+          max_key[i] = key_type(std::max(a, b));
+        }
+        // reference from all leafs
+        uint64_t occupied = 0, free = 0;
+        float min_log_odds = 0.0f, max_log_odds = 0.0f;
+        for (OcTreeStats::leaf_iterator it = tree->begin_leafs(); it != tree->end_leafs(); ++it) {
+          unsigned int size = 1 << (tree->getTreeDepth() - it.getDepth());
+          OcTreeKey key = it.getIndexKey();
+          uint64_t overlap = 1;
+          for (int i=0; i<3; i++) {
+            int lo = std::max((int) key[i], (int) min_key[i]);
+            int hi = std::min((int) (key[i] + size - 1), (int) max_key[i]);
+            overlap *= (hi >= lo) ? (hi - lo + 1) : 0;
+          }
+          if (overlap == 0)
+            continue;
+          if (occupied + free == 0 || it->getLogOdds() < min_log_odds)
+            min_log_odds = it->getLogOdds();
+          if (occupied + free == 0 || it->getLogOdds() > max_log_odds)
+            max_log_odds = it->getLogOdds();
+          if (tree->isNodeOccupied(*it))
+            occupied += overlap;
+          else
+            free += overlap;
+        }
+        uint64_t volume = uint64_t(max_key[0] - min_key[0] + 1) * (max_key[1] - min_key[1] + 1)
+                          * (max_key[2] - min_key[2] + 1);
+
+        EXPECT_TRUE (tree->getStatsBBX(min_key, max_key, stats));
+        EXPECT_EQ (stats.occupied, occupied);
+        EXPECT_EQ (stats.free, free);
+        EXPECT_EQ (stats.unknown, volume - occupied - free);
+        if (occupied + free > 0) {
+          EXPECT_EQ (stats.min_log_odds, min_log_odds);
+          EXPECT_EQ (stats.max_log_odds, max_log_odds);
+        }
+        else {
+          EXPECT_TRUE (stats.min_log_odds != stats.min_log_odds); // NaN
+        }
+        EXPECT_EQ (tree->anyOccupiedBBX(min_key, max_key), (occupied > 0));
+        EXPECT_EQ (tree->anyFreeBBX(min_key, max_key), (free > 0));
+        EXPECT_EQ (tree->anyUnknownBBX(min_key, max_key), (volume > occupied + free));
+      }
+    }
+
+    // the whole tree from the statistics of the root
+    stats_tree.setOccupancyThres(0.5);
+    const OcTreeNodeStats* root = stats_tree.getRoot();
+    EXPECT_EQ (root->getOccupiedVolume() + root->getFreeVolume(), root->getKnownVolume());
+    EXPECT_TRUE (stats_tree.getStatsBBX(point3d(-3.5f, -3.5f, -2.0f), point3d(3.5f, 3.5f, 2.5f), stats));
+    EXPECT_EQ (stats.occupied, root->getOccupiedVolume());
+    EXPECT_EQ (stats.free, root->getFreeVolume());
+    delete read_tree;
+
   // ------------------------------------------------------------
   } else {
     std::cerr << "Invalid test name specified: " << test_name << std::endl;
@@ -900,13 +900,9 @@ void ViewerGui::setNodesInBBX(const point3d& min, const point3d& max, bool occup
       OcTreeKey maxKey(0,0,0);
       octree->coordToKeyChecked(min, minKey);
       octree->coordToKeyChecked(max, maxKey);
-      OcTreeKey k;
-      for (k[0] = minKey[0]; k[0] < maxKey[0]; ++k[0]){
-        for (k[1] = minKey[1]; k[1] < maxKey[1]; ++k[1]){
-          for (k[2] = minKey[2]; k[2] < maxKey[2]; ++k[2]){
-            octree->updateNode(k, logodds);
-          }
-        }
+      // the max corner is excluded from the box
+      if (minKey[0] < maxKey[0] && minKey[1] < maxKey[1] && minKey[2] < maxKey[2]){
+        octree->updateNodeBBX(minKey, OcTreeKey(maxKey[0]-1, maxKey[1]-1, maxKey[2]-1), logodds);
       }
     }
 
@@ -928,15 +924,10 @@ void ViewerGui::setNonNodesInBBX(const point3d& min, const point3d& max, bool oc
       OcTreeKey maxKey(0,0,0);
       octree->coordToKeyChecked(min, minKey);
       octree->coordToKeyChecked(max, maxKey);
-      OcTreeKey k;
-      for (k[0] = minKey[0]; k[0] < maxKey[0]; ++k[0]){
-        for (k[1] = minKey[1]; k[1] < maxKey[1]; ++k[1]){
-          for (k[2] = minKey[2]; k[2] < maxKey[2]; ++k[2]){
-            OcTreeNode* n = octree->search(k);
-            if(!n)
-              octree->updateNode(k, logodds);
-          }
-        }
+      // the max corner is excluded from the box
+      if (minKey[0] < maxKey[0] && minKey[1] < maxKey[1] && minKey[2] < maxKey[2]){
+        // only unknown space in the box:
+        octree->updateNodeBBX(minKey, OcTreeKey(maxKey[0]-1, maxKey[1]-1, maxKey[2]-1), logodds, true);
       }
     }
 